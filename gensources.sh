@@ -25,6 +25,10 @@ echo SRC_SEARCH = \\ >> sources.am
 cat search.sources | grep src/search/ | sed '$s/.$//' >> sources.am
 echo "" >> sources.am
 
+echo SRC_BENCH = \\ >> sources.am
+ls src/bench/*.cpp | sed 's/$/ \\/' | sed '$s/.$//' >> sources.am
+echo "" >> sources.am
+
 echo "SRC_DARKSTAR = \$(SRC_COMMON)" >> sources.am
 
 rm *.sources
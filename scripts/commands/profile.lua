@@ -0,0 +1,35 @@
+---------------------------------------------------------------------------------------------------
+-- func: profile
+-- desc: Controls the per-zone tick profiler and shows where a zone spends its ticks.
+--       !profile on | off | reset | dump | [zoneid]
+---------------------------------------------------------------------------------------------------
+
+cmdprops =
+{
+    permission = 3,
+    parameters = "s"
+};
+
+function onTrigger(player, arg)
+    if (arg == "on") then
+        SetZoneProfiling(true);
+        player:PrintToPlayer("Zone profiler on, samples are written to log/zone_profile.csv every minute.");
+    elseif (arg == "off") then
+        SetZoneProfiling(false);
+        player:PrintToPlayer("Zone profiler off.");
+    elseif (arg == "reset") then
+        ResetZoneProfile();
+        player:PrintToPlayer("Zone profiler window cleared.");
+    elseif (arg == "dump") then
+        if (DumpZoneProfile()) then
+            player:PrintToPlayer("Zone profile written to log/zone_profile.csv.");
+        else
+            player:PrintToPlayer("Could not write log/zone_profile.csv.");
+        end
+    else
+        local zone = tonumber(arg) or player:getZoneID();
+        for _, line in ipairs(GetZoneProfile(zone)) do
+            player:PrintToPlayer(line);
+        end
+    end
+end;
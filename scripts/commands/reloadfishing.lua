@@ -0,0 +1,15 @@
+---------------------------------------------------------------------------------------------------
+-- func: reloadfishing
+-- desc: Rebuilds the fishing catch tables after the fishing_* tables have been edited.
+---------------------------------------------------------------------------------------------------
+
+cmdprops =
+{
+    permission = 4,
+    parameters = ""
+};
+
+function onTrigger(player)
+    ReloadFishingCatches();
+    player:PrintToPlayer("Fishing catch tables reloaded.");
+end;
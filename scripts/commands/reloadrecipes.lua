@@ -0,0 +1,15 @@
+---------------------------------------------------------------------------------------------------
+-- func: reloadrecipes
+-- desc: Rebuilds the synthesis recipe index after synth_recipes has been edited.
+---------------------------------------------------------------------------------------------------
+
+cmdprops =
+{
+    permission = 4,
+    parameters = ""
+};
+
+function onTrigger(player)
+    ReloadSynthRecipes();
+    player:PrintToPlayer("Synthesis recipes reloaded.");
+end;
@@ -0,0 +1,850 @@
+/*
+===========================================================================
+
+  Copyright (c) 2010-2015 Darkstar Dev Teams
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see http://www.gnu.org/licenses/
+
+  This file is part of DarkStar-server source code.
+
+===========================================================================
+*/
+
+#include "../common/blowfish.h"
+#include "../common/kernel.h"
+#include "../common/malloc.h"
+#include "../common/md52.h"
+#include "../common/mmo.h"
+#include "../common/showmsg.h"
+
+#include "../common/taskmgr.h"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <random>
+#include <string.h>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "../map/capture.h"
+#include "../map/dbworker.h"
+#include "../map/map.h"
+#include "../map/merit.h"
+#include "../map/packet_system.h"
+#include "../map/profiler.h"
+#include "../map/zone.h"
+#include "../map/ai/ai_container.h"
+#include "../map/entities/charentity.h"
+#include "../map/entities/mobentity.h"
+#include "../map/items/item_weapon.h"
+#include "../map/lua/luautils.h"
+#include "../map/packets/basic.h"
+#include "../map/packets/chat_message.h"
+#include "../map/utils/charutils.h"
+#include "../map/utils/mobutils.h"
+#include "../map/utils/synthutils.h"
+#include "../map/utils/zoneutils.h"
+
+/************************************************************************
+*                                                                       *
+*  dsbench: runs the map server core against the normal database        *
+*  without client sockets. Synthetic characters are fed through parse() *
+*  and drained through send_parse(), the zone is ticked directly.       *
+*                                                                       *
+*  dsbench [--port n] [--scenario all|crypto|synth|zone|replay]         *
+*          [--zone id] [--players n] [--mobs n] [--ticks n]             *
+*          [--interval ms] [--seed n] [--capture file] [--speed n]      *
+*                                                                       *
+*  --mobs adds that many aggressive level 75 copies of the zone's mobs  *
+*  around the players, for zones that are too quiet to load the aggro   *
+*  pass. They stay in the zone until the process exits.                 *
+*                                                                       *
+*  replay is not part of all, it needs a capture made with              *
+*  packet_capture in map_darkstar.conf and writes to the database like  *
+*  the captured players did, so run it against a copy.                  *
+*                                                                       *
+************************************************************************/
+
+namespace
+{
+    const uint32 BENCH_CHARID = 0x7F000000;     // far above anything the login server hands out
+
+    struct bench_options_t
+    {
+        string_t scenario = "all";
+        uint16   zone = 0;                      // 0 picks the zone with the most mobs
+        uint32   players = 60;
+        uint32   mobs = 0;                      // synthetic aggressive mobs on top of the zone's own
+        uint32   ticks = 240;
+        uint32   interval = 500;                // same pace as the zone timer, 0 runs ticks back to back
+        uint32   seed = 1;
+        string_t capture;
+        uint32   speed = 1;                     // replay pace relative to the capture, 0 replays as fast as possible
+    };
+
+    struct bench_char_t
+    {
+        CCharEntity*        PChar;
+        map_session_data_t* session;
+        position_t          anchor;
+        uint16              target;             // targid of the mob this char walks to and fights
+    };
+
+    // small client packets of one tick, laid out the way parse() finds them after decryption
+    struct inbound_t
+    {
+        uint8  data[FFXI_HEADER_SIZE + 512];
+        size_t size;
+
+        void begin(map_session_data_t* session)
+        {
+            memset(data, 0, sizeof(data));
+            size = FFXI_HEADER_SIZE;
+            WBUFW(data, 0) = session->client_packet_id + 1;
+            WBUFW(data, 2) = session->server_packet_id;
+        }
+
+        uint8* add(uint16 type, uint16 length)
+        {
+            length = (length + 3) & ~3;
+
+            if (size + length > sizeof(data))
+            {
+                return nullptr;
+            }
+            uint8* packet = data + size;
+            WBUFW(packet, 0) = type | ((length / 4) << 9);
+            WBUFW(packet, 2) = RBUFW(data, 0);
+            size += length;
+            return packet;
+        }
+    };
+
+    double Percentile(std::vector<double>& samples, double p)
+    {
+        if (samples.empty())
+        {
+            return 0;
+        }
+        size_t index = std::min(samples.size() - 1, (size_t)(p * (samples.size() - 1) + 0.5));
+        std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+        return samples[index];
+    }
+
+    double ElapsedUs(time_point start)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(server_clock::now() - start).count() / 1000.0;
+    }
+
+    /************************************************************************
+    *                                                                       *
+    *  Packet crypto: buffer kernels against the scalar reference           *
+    *                                                                       *
+    ************************************************************************/
+
+    void BenchCrypto()
+    {
+        const uint32 rounds = 20000;
+        const uint32 length = 1296;             // largest datagram send_parse builds, in whole blocks
+
+        blowfish_t key {};
+        for (uint8 i = 0; i < 5; ++i)
+        {
+            key.key[i] = 0x9E3779B9 * (i + 1);
+        }
+        md5((uint8*)key.key, key.hash, 20);
+        blowfish_init((int8*)key.hash, 16, key.P, key.S[0]);
+
+        std::vector<uint8> buffer(length);
+        for (size_t i = 0; i < buffer.size(); ++i)
+        {
+            buffer[i] = (uint8)(i * 31);
+        }
+        uint32* blocks = (uint32*)buffer.data();
+
+        time_point start = server_clock::now();
+        for (uint32 r = 0; r < rounds; ++r)
+        {
+            for (uint32 b = 0; b < length / 8; ++b)
+            {
+                blowfish_encipher(&blocks[b * 2], &blocks[b * 2 + 1], key.P, key.S[0]);
+            }
+        }
+        double scalar = ElapsedUs(start);
+
+        start = server_clock::now();
+        for (uint32 r = 0; r < rounds; ++r)
+        {
+            blowfish_encipher_buffer(blocks, length / 8, key.P, key.S[0]);
+        }
+        double vector = ElapsedUs(start);
+
+        double megabytes = (double)rounds * length / (1024 * 1024);
+        ShowInfo("dsbench: blowfish scalar %.1f MB/s, buffer %.1f MB/s\n", megabytes / (scalar / 1e6), megabytes / (vector / 1e6));
+    }
+
+    /************************************************************************
+    *                                                                       *
+    *  Synthesis: every loaded recipe looked up with scrambled ingredients  *
+    *                                                                       *
+    ************************************************************************/
+
+    void BenchSynth()
+    {
+        std::vector<double> samples;
+
+        for (uint8 i = 0; i < 10; ++i)
+        {
+            time_point start = server_clock::now();
+            synthutils::ReplaySynthRecipes();
+            samples.push_back(ElapsedUs(start));
+        }
+        ShowInfo("dsbench: recipe replay p50 %.0fus, max %.0fus\n", Percentile(samples, 0.5), Percentile(samples, 1.0));
+    }
+
+    /************************************************************************
+    *                                                                       *
+    *  Zone: synthetic characters walking, chatting and fighting            *
+    *                                                                       *
+    ************************************************************************/
+
+    CZone* PickZone(uint16 zoneID)
+    {
+        if (zoneID != 0)
+        {
+            return zoneutils::GetZone(zoneID);
+        }
+        CZone* PBest = nullptr;
+        uint32 best = 0;
+
+        zoneutils::ForEachZone([&](CZone* PZone)
+        {
+            uint32 mobs = 0;
+            PZone->ForEachMob([&](CMobEntity* PMob)
+            {
+                if (PMob->isAlive())
+                {
+                    mobs++;
+                }
+            });
+            if (mobs > best)
+            {
+                best = mobs;
+                PBest = PZone;
+            }
+        });
+        return PBest;
+    }
+
+    map_session_data_t* CreateSession(CCharEntity* PChar)
+    {
+        map_session_data_t* session = new map_session_data_t;
+        memset(session, 0, sizeof(map_session_data_t));
+        CREATE(session->server_packet_data, int8, map_config.buffer_size + 20);
+        CREATE(session->decompress_data, int8, map_config.buffer_size);
+        CREATE(session->staging_data, int8, map_config.buffer_size + 20);
+        session->blowfish.key[0] = PChar->id;
+        md5((uint8*)(session->blowfish.key), session->blowfish.hash, 20);
+        blowfish_init((int8*)session->blowfish.hash, 16, session->blowfish.P, session->blowfish.S[0]);
+        session->PChar = PChar;
+        return session;
+    }
+
+    void DestroySession(map_session_data_t* session)
+    {
+        // the bench may block, the server closes such a session on a later pass instead
+        while (dbworker::IsBusy(session->PChar))
+        {
+            dbworker::HandleCompletions();
+            std::this_thread::yield();
+        }
+        if (session->PChar->loc.zone != nullptr)
+        {
+            session->PChar->loc.zone->DecreaseZoneCounter(session->PChar);
+        }
+        aFree(session->server_packet_data);
+        aFree(session->decompress_data);
+        aFree(session->staging_data);
+        delete session->PChar;
+        delete session;
+    }
+
+    // lua collector stats since the last call
+    void LogGC()
+    {
+        luautils::gc_stats_t gc = luautils::GetGCStats(true);
+
+        ShowInfo("dsbench: lua heap %u KB, %.1f KB/s allocated, gc %.3f ms per pass (max %.3f ms), %u cycles\n",
+            gc.heap, gc.allocRate, gc.avgMs, gc.maxMs, gc.cycles);
+    }
+
+    // sends everything queued for the char, returns the bytes that went out
+    uint64 Drain(map_session_data_t* session, int8* out)
+    {
+        sockaddr_in from {};
+        uint64 bytes = 0;
+
+        while (!session->PChar->isPacketListEmpty())
+        {
+            size_t size = map_config.buffer_size;
+            send_parse(out, &size, &from, session);
+            bytes += size;
+        }
+        return bytes;
+    }
+
+    bench_char_t CreateChar(CZone* PZone, uint32 index, CMobEntity* PMob, std::mt19937& rng)
+    {
+        std::uniform_real_distribution<float> offset(-15.f, 15.f);
+
+        bench_char_t bc {};
+        bc.anchor = PMob->loc.p;
+        bc.anchor.x += offset(rng);
+        bc.anchor.z += offset(rng);
+        bc.target = PMob->targid;
+
+        CCharEntity* PChar = new CCharEntity();
+        PChar->id = BENCH_CHARID + index;
+        PChar->name = "Bench" + std::to_string(index);
+        PChar->look.race = 1;
+        PChar->jobs.job[JOB_WAR] = 75;
+        PChar->SetMJob(JOB_WAR);
+        PChar->SetMLevel(75);
+        PChar->PMeritPoints = new CMeritPoints(PChar);
+        PChar->loc.destination = PZone->GetID();
+        PChar->loc.p = bc.anchor;
+
+        charutils::CalculateStats(PChar);
+        charutils::BuildingCharSkillsTable(PChar);
+        charutils::BuildingCharAbilityTable(PChar);
+        charutils::BuildingCharTraitsTable(PChar);
+        PChar->health.hp = PChar->GetMaxHP();
+        PChar->health.mp = PChar->GetMaxMP();
+        PChar->UpdateHealth();
+
+        PZone->IncreaseZoneCounter(PChar);
+        PChar->status = STATUS_NORMAL;
+
+        bc.PChar = PChar;
+        bc.session = CreateSession(PChar);
+        return bc;
+    }
+
+    // aggressive copy of a mob of the zone in the first free targid, nullptr once there is none
+    CMobEntity* CreateMob(CZone* PZone, CMobEntity* PTemplate, const position_t& near, uint16& targid, std::mt19937& rng)
+    {
+        std::uniform_real_distribution<float> offset(-30.f, 30.f);
+
+        while (targid < 0x700 && PZone->GetEntity(targid) != nullptr)
+        {
+            targid++;
+        }
+        if (targid >= 0x700)
+        {
+            return nullptr;
+        }
+
+        CMobEntity* PMob = new CMobEntity;
+        PMob->name = PTemplate->name;
+        PMob->id = 0x01000000 | (PZone->GetID() << 12) | targid;
+        PMob->targid = targid++;
+
+        PMob->m_SpawnPoint = near;
+        PMob->m_SpawnPoint.x += offset(rng);
+        PMob->m_SpawnPoint.z += offset(rng);
+        PMob->m_SpawnType = SPAWNTYPE_NORMAL;
+        PMob->m_RespawnTime = PTemplate->m_RespawnTime;
+
+        // level of the bench chars, so they pass the exp check of the aggro pass
+        PMob->m_minLevel = 75;
+        PMob->m_maxLevel = 75;
+        PMob->HPmodifier = PTemplate->HPmodifier;
+        PMob->MPmodifier = PTemplate->MPmodifier;
+        PMob->HPscale = PTemplate->HPscale;
+        PMob->MPscale = PTemplate->MPscale;
+
+        PMob->look = PTemplate->look;
+        PMob->SetMJob(PTemplate->GetMJob());
+        PMob->SetSJob(PTemplate->GetSJob());
+        PMob->m_Weapons[SLOT_MAIN]->setMaxHit(1);
+        PMob->m_Weapons[SLOT_MAIN]->setSkillType(PTemplate->m_Weapons[SLOT_MAIN]->getSkillType());
+        PMob->m_Weapons[SLOT_MAIN]->setDelay(PTemplate->m_Weapons[SLOT_MAIN]->getDelay());
+        PMob->m_Weapons[SLOT_MAIN]->setBaseDelay(PTemplate->m_Weapons[SLOT_MAIN]->getBaseDelay());
+        PMob->m_dmgMult = PTemplate->m_dmgMult;
+
+        PMob->m_Behaviour = PTemplate->m_Behaviour;
+        PMob->m_Type = MOBTYPE_NORMAL;
+        PMob->m_EcoSystem = PTemplate->m_EcoSystem;
+        PMob->m_Family = PTemplate->m_Family;
+        PMob->m_Element = PTemplate->m_Element;
+        PMob->speed = PTemplate->speed;
+        PMob->speedsub = PTemplate->speedsub;
+        PMob->m_roamFlags = PTemplate->m_roamFlags;
+        PMob->m_SpellListContainer = PTemplate->m_SpellListContainer;
+        PMob->m_MobSkillList = PTemplate->m_MobSkillList;
+        PMob->m_Pool = PTemplate->m_Pool;
+        PMob->allegiance = PTemplate->allegiance;
+        PMob->namevis = PTemplate->namevis;
+        PMob->m_Aggro = AGGRO_DETECT_SIGHT | AGGRO_DETECT_HEARING;
+
+        mobutils::InitializeMob(PMob, PZone);
+        PZone->InsertMOB(PMob);
+
+        PMob->saveModifiers();
+        PMob->saveMobModifiers();
+        PMob->m_AllowRespawn = true;
+        PMob->Spawn();
+        return PMob;
+    }
+
+    // one tick of client traffic: a position update, now and then a /say and an attack
+    void Script(bench_char_t& bc, uint32 tick, std::mt19937& rng, inbound_t& in)
+    {
+        CCharEntity* PChar = bc.PChar;
+        CBaseEntity* PTarget = PChar->GetEntity(bc.target, TYPE_MOB);
+        position_t goal = bc.anchor;
+
+        if (PTarget != nullptr && PChar->PAI->IsEngaged())
+        {
+            goal = PTarget->loc.p;
+        }
+        else
+        {
+            std::uniform_real_distribution<float> wander(-5.f, 5.f);
+            goal.x += wander(rng);
+            goal.z += wander(rng);
+        }
+        // walk speed of a hume, about 2.5 yalms per half second tick
+        float dx = goal.x - PChar->loc.p.x;
+        float dz = goal.z - PChar->loc.p.z;
+        float length = sqrtf(dx * dx + dz * dz);
+        float step = std::min(length, 2.5f);
+
+        in.begin(bc.session);
+
+        if (uint8* packet = in.add(0x015, PacketSize[0x015] * 2))
+        {
+            WBUFF(packet, (0x04)) = length > 0 ? PChar->loc.p.x + dx / length * step : PChar->loc.p.x;
+            WBUFF(packet, (0x08)) = goal.y;
+            WBUFF(packet, (0x0C)) = length > 0 ? PChar->loc.p.z + dz / length * step : PChar->loc.p.z;
+            WBUFW(packet, (0x12)) = (uint16)(step * 8);
+            WBUFB(packet, (0x14)) = PChar->loc.p.rotation;
+            WBUFW(packet, (0x16)) = bc.target;
+        }
+        if ((tick + bc.PChar->id) % 20 == 0)
+        {
+            static const int8 text[] = "dsbench says hello to everyone in range";
+
+            if (uint8* packet = in.add(0x0B5, 0x06 + sizeof(text)))
+            {
+                WBUFB(packet, (0x04)) = MESSAGE_SAY;
+                memcpy(packet + 0x06, text, sizeof(text));
+            }
+        }
+        if ((tick + bc.PChar->id) % 40 == 0 && PTarget != nullptr && !PChar->PAI->IsEngaged())
+        {
+            if (uint8* packet = in.add(0x01A, PacketSize[0x01A] * 2))
+            {
+                WBUFL(packet, (0x04)) = PTarget->id;
+                WBUFW(packet, (0x08)) = PTarget->targid;
+                WBUFB(packet, (0x0A)) = 0x02;
+            }
+        }
+    }
+
+    void BenchZone(const bench_options_t& options)
+    {
+        CZone* PZone = PickZone(options.zone);
+
+        if (PZone == nullptr)
+        {
+            ShowError("dsbench: no zone to run in\n");
+            return;
+        }
+        std::vector<CMobEntity*> mobs;
+        PZone->ForEachMob([&](CMobEntity* PMob)
+        {
+            if (PMob->isAlive())
+            {
+                mobs.push_back(PMob);
+            }
+        });
+        if (mobs.empty())
+        {
+            ShowError("dsbench: zone %u has no spawned mobs\n", PZone->GetID());
+            return;
+        }
+        ShowInfo("dsbench: zone %u (%s), %u mobs, %u players, %u ticks\n",
+            PZone->GetID(), PZone->GetName(), (uint32)mobs.size(), options.players, options.ticks);
+
+        std::mt19937 rng(options.seed);
+        std::vector<bench_char_t> chars;
+
+        for (uint32 i = 0; i < options.players; ++i)
+        {
+            chars.push_back(CreateChar(PZone, i, mobs[rng() % mobs.size()], rng));
+        }
+
+        std::vector<CMobEntity*> synthetic;
+        uint16 targid = 1;
+
+        for (uint32 i = 0; i < options.mobs; ++i)
+        {
+            CMobEntity* PTemplate = mobs[rng() % mobs.size()];
+            CMobEntity* PMob = CreateMob(PZone, PTemplate, chars.empty() ? PTemplate->loc.p : chars[rng() % chars.size()].anchor, targid, rng);
+
+            if (PMob == nullptr)
+            {
+                ShowError("dsbench: zone %u is out of targids after %u synthetic mobs\n", PZone->GetID(), i);
+                break;
+            }
+            synthetic.push_back(PMob);
+        }
+        if (!synthetic.empty())
+        {
+            ShowInfo("dsbench: added %u aggressive mobs\n", (uint32)synthetic.size());
+        }
+
+        std::vector<double> tickTimes;
+        std::vector<double> frameTimes;
+        uint64 packets = 0;
+        uint64 bytes = 0;
+        size_t allocations = malloc_count() + CBasicPacket::GetHeapAllocations();
+        uint64 luaTime = luautils::GetLuaTime();
+        double busy = 0;
+
+        int8* out = (int8*)aMalloc(map_config.buffer_size + 20);
+        sockaddr_in from {};
+        inbound_t in;
+
+        // the per-subsystem split below, aggro and mob sync in particular
+        bool profiling = profiler::IsEnabled();
+        profiler::SetEnabled(true);
+        profiler::Reset();
+
+        luautils::SetProfiling(true);
+        luautils::GetGCStats(true);
+        time_point begin = server_clock::now();
+        time_point next = begin;
+
+        for (uint32 tick = 0; tick < options.ticks; ++tick)
+        {
+            time_point frame = server_clock::now();
+
+            for (auto& bc : chars)
+            {
+                Script(bc, tick, rng, in);
+                size_t size = in.size;
+                parse((int8*)in.data, &size, &from, bc.session);
+            }
+
+            time_point start = server_clock::now();
+            {
+                CZoneProfileScope profile(PZone, PROFILE_TICK, true);
+                PZone->ZoneServer(start);
+            }
+            tickTimes.push_back(ElapsedUs(start));
+
+            for (auto& bc : chars)
+            {
+                packets += bc.PChar->getPacketCount();
+                bytes += Drain(bc.session, out);
+            }
+            frameTimes.push_back(ElapsedUs(frame));
+            busy += frameTimes.back();
+
+            if (options.interval != 0)
+            {
+                next += std::chrono::milliseconds(options.interval);
+                luautils::StepGC(next);
+                std::this_thread::sleep_until(next);
+            }
+            else
+            {
+                luautils::StepGC(server_clock::now());
+            }
+        }
+
+        luautils::SetProfiling(false);
+        aFree(out);
+
+        double wall = ElapsedUs(begin);
+
+        allocations = malloc_count() + CBasicPacket::GetHeapAllocations() - allocations;
+        luaTime = luautils::GetLuaTime() - luaTime;
+
+        ShowInfo("dsbench: zone tick p50 %.0fus, p90 %.0fus, p99 %.0fus, max %.0fus\n",
+            Percentile(tickTimes, 0.5), Percentile(tickTimes, 0.9), Percentile(tickTimes, 0.99), Percentile(tickTimes, 1.0));
+        ShowInfo("dsbench: full frame p50 %.0fus, p99 %.0fus, max %.0fus\n",
+            Percentile(frameTimes, 0.5), Percentile(frameTimes, 0.99), Percentile(frameTimes, 1.0));
+        ShowInfo("dsbench: %.0f packets/s, %.1f KB/s out, %u heap allocations, lua %.1fms (%.1f%% of busy time)\n",
+            packets / (wall / 1e6), bytes / 1024.0 / (wall / 1e6), (uint32)allocations,
+            luaTime / 1e6, busy > 0 ? luaTime / 10.0 / busy : 0);
+        LogGC();
+
+        if (!synthetic.empty())
+        {
+            uint32 engaged = (uint32)std::count_if(synthetic.begin(), synthetic.end(), [](CMobEntity* PMob) { return PMob->PAI->IsEngaged(); });
+            ShowInfo("dsbench: %u of %u synthetic mobs engaged\n", engaged, (uint32)synthetic.size());
+        }
+        for (auto& line : profiler::Report(PZone->GetID(), 5))
+        {
+            ShowInfo("dsbench: %s\n", line.c_str());
+        }
+        profiler::SetEnabled(profiling);
+
+        for (auto& bc : chars)
+        {
+            DestroySession(bc.session);
+        }
+    }
+
+    /************************************************************************
+    *                                                                       *
+    *  Replay: captured client packets fed straight to PacketParser, with   *
+    *  the task manager and the database worker run in between as the      *
+    *  main loop would. Characters are loaded from the database and put     *
+    *  where the capture saw them.                                          *
+    *                                                                       *
+    *  At speed 0 the task manager runs on the capture clock instead of     *
+    *  the wall clock; code that reads server_clock itself sees the        *
+    *  compressed time.                                                     *
+    *                                                                       *
+    ************************************************************************/
+
+    struct replay_type_t
+    {
+        uint32 calls;
+        double total;                           // us
+        double max;
+    };
+
+    map_session_data_t* LoadReplayChar(const capture_record_t& record)
+    {
+        CCharEntity* PChar = new CCharEntity();
+        PChar->id = record.charid;
+
+        charutils::LoadChar(PChar);
+
+        if (PChar->name.empty())
+        {
+            ShowWarning("dsbench: char %u from the capture is not in the database\n", record.charid);
+            delete PChar;
+            return nullptr;
+        }
+        CZone* PZone = record.zone != 0 ? zoneutils::GetZone(record.zone) : nullptr;
+
+        if (PZone != nullptr)
+        {
+            PChar->loc.destination = record.zone;
+            PChar->loc.p = record.pos;
+            PZone->IncreaseZoneCounter(PChar);
+            PChar->status = STATUS_NORMAL;
+        }
+        else
+        {
+            PChar->status = STATUS_DISAPPEAR;       // waits for its 0x00A like a fresh login
+        }
+        return CreateSession(PChar);
+    }
+
+    void BenchReplay(const bench_options_t& options)
+    {
+        CCaptureReader reader;
+
+        if (options.capture.empty() || !reader.Open(options.capture.c_str()))
+        {
+            ShowError("dsbench: replay needs --capture <file>\n");
+            return;
+        }
+        dsprand::seed(options.seed);
+
+        std::unordered_map<uint32, map_session_data_t*> sessions;
+        std::map<uint16, replay_type_t> types;
+        std::vector<double> handlerTimes;
+        uint32 loaded = 0;
+        uint32 missing = 0;
+        uint32 skipped = 0;
+        uint64 bytes = 0;
+
+        int8* out = (int8*)aMalloc(map_config.buffer_size + 20);
+        uint8 packet[std::max(PACKET_SIZE, (int)sizeof(capture_record_t::data))];
+        capture_record_t record;
+        uint32 now = 0;
+
+        luautils::SetProfiling(true);
+        luautils::GetGCStats(true);
+        uint64 luaTime = luautils::GetLuaTime();
+        time_point begin = server_clock::now();
+
+        // runs the main loop up to the given capture time
+        auto advance = [&](uint32 time)
+        {
+            time_point tick;
+
+            if (options.speed != 0)
+            {
+                std::this_thread::sleep_until(begin + std::chrono::milliseconds(time / options.speed));
+                tick = server_clock::now();
+            }
+            else
+            {
+                tick = begin + std::chrono::milliseconds(time);
+            }
+            CTaskMgr::getInstance()->DoTimer(tick);
+            dbworker::HandleCompletions();
+
+            for (auto& entry : sessions)
+            {
+                bytes += Drain(entry.second, out);
+            }
+            luautils::StepGC(server_clock::now());
+            now = time;
+        };
+
+        while (reader.Next(record))
+        {
+            if (record.time != now)
+            {
+                advance(record.time);
+            }
+            auto it = sessions.find(record.charid);
+
+            if (record.kind == CAPTURE_SESSION)
+            {
+                if (it != sessions.end())
+                {
+                    DestroySession(it->second);
+                    sessions.erase(it);
+                }
+                if (map_session_data_t* session = LoadReplayChar(record))
+                {
+                    sessions[record.charid] = session;
+                    loaded++;
+                }
+                else
+                {
+                    missing++;
+                }
+                continue;
+            }
+            uint16 type = RBUFW(record.data, 0) & 0x1FF;
+
+            if (it == sessions.end() || (it->second->PChar->loc.zone == nullptr && type != 0x0A))
+            {
+                skipped++;
+                continue;
+            }
+            memset(packet, 0, sizeof(packet));
+            memcpy(packet, record.data, record.size);
+
+            time_point start = server_clock::now();
+            PacketParser[type](it->second, it->second->PChar, CBasicPacket(packet));
+            double elapsed = ElapsedUs(start);
+
+            replay_type_t& stats = types[type];
+            stats.calls++;
+            stats.total += elapsed;
+            stats.max = std::max(stats.max, elapsed);
+            handlerTimes.push_back(elapsed);
+        }
+        advance(now);
+
+        luautils::SetProfiling(false);
+        luaTime = luautils::GetLuaTime() - luaTime;
+        aFree(out);
+
+        double wall = ElapsedUs(begin);
+        size_t handled = handlerTimes.size();
+
+        ShowInfo("dsbench: replayed %u packets (%u skipped) for %u chars (%u missing) in %.1fs, capture length %.1fs\n",
+            (uint32)handled, skipped, loaded, missing, wall / 1e6, now / 1000.0);
+        ShowInfo("dsbench: %.0f packets/s, handler p50 %.0fus, p99 %.0fus, max %.0fus, %.1f KB out, lua %.1fms\n",
+            handled / (wall / 1e6), Percentile(handlerTimes, 0.5), Percentile(handlerTimes, 0.99), Percentile(handlerTimes, 1.0),
+            bytes / 1024.0, luaTime / 1e6);
+        LogGC();
+
+        std::vector<std::pair<double, uint16>> order;
+        for (auto& entry : types)
+        {
+            order.emplace_back(entry.second.total, entry.first);
+        }
+        std::sort(order.rbegin(), order.rend());
+
+        for (size_t i = 0; i < order.size() && i < 10; ++i)
+        {
+            replay_type_t& stats = types[order[i].second];
+            ShowInfo("dsbench:   0x%03X %u calls, %.1fms total, avg %.0fus, max %.0fus\n",
+                order[i].second, stats.calls, stats.total / 1000, stats.total / stats.calls, stats.max);
+        }
+
+        for (auto& entry : sessions)
+        {
+            DestroySession(entry.second);
+        }
+    }
+
+    bench_options_t ReadOptions(int32 argc, int8** argv)
+    {
+        bench_options_t options;
+
+        for (int32 i = 1; i + 1 < argc; i++)
+        {
+            if (strcmp(argv[i], "--scenario") == 0)
+                options.scenario = argv[i + 1];
+            else if (strcmp(argv[i], "--zone") == 0)
+                options.zone = (uint16)std::stoi(argv[i + 1]);
+            else if (strcmp(argv[i], "--players") == 0)
+                options.players = std::stoi(argv[i + 1]);
+            else if (strcmp(argv[i], "--mobs") == 0)
+                options.mobs = std::stoi(argv[i + 1]);
+            else if (strcmp(argv[i], "--ticks") == 0)
+                options.ticks = std::stoi(argv[i + 1]);
+            else if (strcmp(argv[i], "--interval") == 0)
+                options.interval = std::stoi(argv[i + 1]);
+            else if (strcmp(argv[i], "--seed") == 0)
+                options.seed = std::stoi(argv[i + 1]);
+            else if (strcmp(argv[i], "--capture") == 0)
+                options.capture = argv[i + 1];
+            else if (strcmp(argv[i], "--speed") == 0)
+                options.speed = std::stoi(argv[i + 1]);
+        }
+        return options;
+    }
+}
+
+int32 do_bench(int32 argc, int8** argv)
+{
+    bench_options_t options = ReadOptions(argc, argv);
+
+    if (options.scenario == "all" || options.scenario == "crypto")
+    {
+        BenchCrypto();
+    }
+    if (options.scenario == "all" || options.scenario == "synth")
+    {
+        BenchSynth();
+    }
+    if (options.scenario == "all" || options.scenario == "zone")
+    {
+        BenchZone(options);
+    }
+    if (options.scenario == "replay")
+    {
+        BenchReplay(options);
+    }
+    return EXIT_SUCCESS;
+}
@@ -25,6 +25,17 @@
 
 #include <string.h>
 
+#if defined(__x86_64__) || defined(_M_X64)
+#define BLOWFISH_SIMD
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define BLOWFISH_TARGET_AVX2
+#else
+#define BLOWFISH_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
 uint8 subkey[4168] =
 {
 	0x88, 0x6A, 0x3F, 0x24, 0xD3, 0x08, 0xA3, 0x85, 0x2E, 0x8A, 0x19, 0x13, 0x44, 0x73, 0x70, 0x03,
@@ -547,3 +558,198 @@ uint32* blowfish_init(int8 key[], int16 keybytes, uint32* P, uint32* S)
 
 	return P;
 }
+
+/************************************************************************
+*                                                                       *
+*  Buffer kernels. Blocks of a packet are enciphered independently      *
+*  (ECB), so with AVX2 eight blocks share one pass through the rounds   *
+*  and the S-box lookups become gathers. Machines without AVX2, and the *
+*  tail that doesn't fill a full vector, use the scalar functions.      *
+*                                                                       *
+************************************************************************/
+
+#ifdef BLOWFISH_SIMD
+
+static bool blowfish_cpu_has_avx2()
+{
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return false;
+	__cpuid(info, 1);
+	if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6)
+		return false;
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+static bool blowfish_use_avx2 = blowfish_cpu_has_avx2();
+
+BLOWFISH_TARGET_AVX2 static inline __m256i TT_avx2(__m256i working, const int* S)
+{
+	const __m256i byte = _mm256_set1_epi32(0xFF);
+	const __m256i one  = _mm256_set1_epi32(1);
+	const __m256i bit5 = _mm256_set1_epi32(32);
+
+	__m256i s0 = _mm256_i32gather_epi32(S,       _mm256_and_si256(working, byte), 4);
+	__m256i s1 = _mm256_i32gather_epi32(S + 256, _mm256_and_si256(_mm256_srli_epi32(working, 8), byte), 4);
+	__m256i s2 = _mm256_i32gather_epi32(S + 512, _mm256_and_si256(_mm256_srli_epi32(working, 16), byte), 4);
+	__m256i s3 = _mm256_i32gather_epi32(S + 768, _mm256_srli_epi32(working, 24), 4);
+
+	s1 = _mm256_xor_si256(_mm256_and_si256(s1, one), bit5);
+	s3 = _mm256_xor_si256(_mm256_and_si256(s3, one), bit5);
+
+	return _mm256_add_epi32(_mm256_add_epi32(s1, s3), _mm256_add_epi32(s2, s0));
+}
+
+// processes blocks in groups of eight, returns the number of blocks done
+BLOWFISH_TARGET_AVX2 static uint32 blowfish_buffer_avx2(uint32* data, uint32 blocks, uint32* P, uint32* S, bool encipher)
+{
+	const __m256i split = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+	const __m256i merge = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+	const int* Sbox = (const int*)S;
+
+	uint32 done = 0;
+
+	for (; done + 8 <= blocks; done += 8)
+	{
+		__m256i* ptr = (__m256i*)(data + done * 2);
+
+		__m256i lo = _mm256_permutevar8x32_epi32(_mm256_loadu_si256(ptr), split);
+		__m256i hi = _mm256_permutevar8x32_epi32(_mm256_loadu_si256(ptr + 1), split);
+
+		__m256i Xl = _mm256_permute2x128_si256(lo, hi, 0x20);
+		__m256i Xr = _mm256_permute2x128_si256(lo, hi, 0x31);
+		__m256i temp;
+
+		for (int32 i = 0; i < 16; ++i)
+		{
+			Xl = _mm256_xor_si256(Xl, _mm256_set1_epi32(P[encipher ? i : 17 - i]));
+			Xr = _mm256_xor_si256(TT_avx2(Xl, Sbox), Xr);
+
+			temp = Xl;
+			Xl = Xr;
+			Xr = temp;
+		}
+
+		temp = Xl;
+		Xl = Xr;
+		Xr = temp;
+
+		Xr = _mm256_xor_si256(Xr, _mm256_set1_epi32(P[encipher ? 16 : 1]));
+		Xl = _mm256_xor_si256(Xl, _mm256_set1_epi32(P[encipher ? 17 : 0]));
+
+		lo = _mm256_permute2x128_si256(Xl, Xr, 0x20);
+		hi = _mm256_permute2x128_si256(Xl, Xr, 0x31);
+
+		_mm256_storeu_si256(ptr,     _mm256_permutevar8x32_epi32(lo, merge));
+		_mm256_storeu_si256(ptr + 1, _mm256_permutevar8x32_epi32(hi, merge));
+	}
+	return done;
+}
+
+#endif
+
+void blowfish_encipher_buffer(uint32* data, uint32 blocks, uint32* P, uint32* S)
+{
+	uint32 done = 0;
+
+#ifdef BLOWFISH_SIMD
+	if (blowfish_use_avx2)
+	{
+		done = blowfish_buffer_avx2(data, blocks, P, S, true);
+	}
+#endif
+	for (; done < blocks; ++done)
+	{
+		blowfish_encipher(data + done * 2, data + done * 2 + 1, P, S);
+	}
+}
+
+void blowfish_decipher_buffer(uint32* data, uint32 blocks, uint32* P, uint32* S)
+{
+	uint32 done = 0;
+
+#ifdef BLOWFISH_SIMD
+	if (blowfish_use_avx2)
+	{
+		done = blowfish_buffer_avx2(data, blocks, P, S, false);
+	}
+#endif
+	for (; done < blocks; ++done)
+	{
+		blowfish_decipher(data + done * 2, data + done * 2 + 1, P, S);
+	}
+}
+
+void blowfish_encipher_batch(uint32** data, uint32* blocks, blowfish_t** keys, uint32 count)
+{
+	for (uint32 i = 0; i < count; ++i)
+	{
+		blowfish_encipher_buffer(data[i], blocks[i], keys[i]->P, keys[i]->S[0]);
+	}
+}
+
+void blowfish_decipher_batch(uint32** data, uint32* blocks, blowfish_t** keys, uint32 count)
+{
+	for (uint32 i = 0; i < count; ++i)
+	{
+		blowfish_decipher_buffer(data[i], blocks[i], keys[i]->P, keys[i]->S[0]);
+	}
+}
+
+/************************************************************************
+*                                                                       *
+*  Checks the buffer kernels against the scalar functions. On mismatch  *
+*  the vector path is switched off and -1 is returned.                  *
+*                                                                       *
+************************************************************************/
+
+int32 blowfish_selftest()
+{
+	static blowfish_t key;
+	uint32 reference[2 * 37];
+	uint32 buffer[2 * 37];
+
+	int8 keydata[20];
+	for (int32 i = 0; i < 20; ++i)
+	{
+		keydata[i] = (int8)(i * 37 + 11);
+	}
+	blowfish_init(keydata, 20, key.P, key.S[0]);
+
+	for (uint32 i = 0; i < 2 * 37; ++i)
+	{
+		reference[i] = buffer[i] = i * 0x9E3779B9;
+	}
+
+	for (uint32 i = 0; i < 37; ++i)
+	{
+		blowfish_encipher(reference + i * 2, reference + i * 2 + 1, key.P, key.S[0]);
+	}
+	blowfish_encipher_buffer(buffer, 37, key.P, key.S[0]);
+
+	bool match = memcmp(reference, buffer, sizeof(buffer)) == 0;
+
+	for (uint32 i = 0; i < 37; ++i)
+	{
+		blowfish_decipher(reference + i * 2, reference + i * 2 + 1, key.P, key.S[0]);
+	}
+	blowfish_decipher_buffer(buffer, 37, key.P, key.S[0]);
+
+	match = match && memcmp(reference, buffer, sizeof(buffer)) == 0;
+
+	if (!match)
+	{
+#ifdef BLOWFISH_SIMD
+		blowfish_use_avx2 = false;
+#endif
+		return -1;
+	}
+	return 0;
+}
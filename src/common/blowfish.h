@@ -46,4 +46,14 @@ void blowfish_encipher(uint32* xl, uint32* xr, uint32* P, uint32* S);
 
 uint32* blowfish_init(int8 key[], int16 keybytes, uint32* P, uint32* S);
 
+// encipher/decipher a run of consecutive 8 byte blocks (xl, xr pairs) with one key
+void blowfish_encipher_buffer(uint32* data, uint32 blocks, uint32* P, uint32* S);
+void blowfish_decipher_buffer(uint32* data, uint32 blocks, uint32* P, uint32* S);
+
+// same, for several buffers each with its own key
+void blowfish_encipher_batch(uint32** data, uint32* blocks, blowfish_t** keys, uint32 count);
+void blowfish_decipher_batch(uint32** data, uint32* blocks, blowfish_t** keys, uint32 count);
+
+int32 blowfish_selftest();
+
 #endif
\ No newline at end of file
@@ -15,6 +15,12 @@ public:
         mt().seed(rd());
     }
 
+    // fixed sequence for replays and benchmarks, only affects the calling thread
+    static void seed(uint32_t value)
+    {
+        mt().seed(value);
+    }
+
     /*Generates a random number in the half-open interval [min, max)
     @param min
     @param max
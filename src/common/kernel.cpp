@@ -242,6 +242,9 @@ int main (int argc, char **argv)
 	socket_init();
 
 	do_init(argc,argv);
+#ifdef dsBENCH
+	do_final(do_bench(argc,argv));
+#else
 	fd_set rfd;
 	{// Main runtime cycle
 		duration next;
@@ -254,5 +257,6 @@ int main (int argc, char **argv)
 	}
 
     do_final(EXIT_SUCCESS);
+#endif
 	return 0;
 }
@@ -39,4 +39,8 @@ extern void set_server_type(void);
 extern void do_abort(void);
 extern void do_final(int);
 
+#ifdef dsBENCH
+extern int do_bench(int,char**);	// runs instead of the socket loop
+#endif
+
 #endif
@@ -73,8 +73,10 @@ public:
       lua_pushstring(L, l->name);
 	  // добавление склеивающего параметра.
       lua_pushlightuserdata(L, (void*)l);
+      // the metatable rides along so thunk can type-check self without a registry lookup
+      lua_pushvalue(L, metatable);
 	   // добавление специального склеивателя.
-      lua_pushcclosure(L, thunk, 1);
+      lua_pushcclosure(L, thunk, 2);
 
       lua_settable(L, methods);
     }
@@ -149,6 +151,13 @@ public:
     return mt;  // index  userdata содержит указатель на T *obj
   }
 
+  // Push obj into a userdata that Lua owns (gc_T deletes it) and anchor it
+  // in the registry, returns the reference to pass to lua_rawgeti/luaL_unref
+  static int ref(lua_State *L, T *obj) {
+    push(L, obj, true);
+    return luaL_ref(L, LUA_REGISTRYINDEX);
+  }
+
   // возврат T* из стека
   static T *check(lua_State *L, int narg) {
     user_t *ud =
@@ -166,7 +175,12 @@ private:
   // распаковщик функции члена.
   static int thunk(lua_State *L) {
     // стек содержит user_t, следующим прямо за аргументами.
-    T *obj = check(L, 1);  
+    // same test as check(), against the metatable bound in upvalue 2
+    user_t *ud = static_cast<user_t*>(lua_touserdata(L, 1));
+    if (ud == NULL || !lua_getmetatable(L, 1) || !lua_rawequal(L, -1, lua_upvalueindex(2)))
+      luaL_typerror(L, 1, T::className);
+    T *obj = ud->pT;
+    lua_settop(L, -2);     // drop the metatable
     lua_remove(L, 1);  
     // Получаем связанное с распаковщиком значение registration
     Register_t *l = static_cast<Register_t*>(lua_touserdata(L, lua_upvalueindex(1)));
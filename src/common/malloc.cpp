@@ -188,6 +188,7 @@ static struct unit_head_large *unit_head_large_first = NULL;
 static struct block* block_malloc(unsigned short hash);
 static void          block_free(struct block* p);
 static size_t        memmgr_usage_bytes;
+static size_t        memmgr_alloc_count;
 
 #define block2unit(p, n) ((struct unit_head*)(&(p)->data[ p->unit_size * (n) ]))
 #define memmgr_assert(v) do { if(!(v)) { ShowError("Memory manager: assertion '" #v "' failed!\n"); } } while(0)
@@ -228,6 +229,7 @@ void* _mmalloc(size_t size, const char *file, int line, const char *func )
 		return NULL;
 	}
 	memmgr_usage_bytes += size;
+	memmgr_alloc_count++;
 
 	/* ubN𒴂̈̊mۂɂ́Amalloc() p */
 	/* ̍ہAunit_head.block  NULL ċʂ */
@@ -513,6 +515,11 @@ size_t memmgr_usage (void)
 	return memmgr_usage_bytes / 1024;
 }
 
+size_t memmgr_count (void)
+{
+	return memmgr_alloc_count;
+}
+
 #ifdef LOG_MEMMGR
 static char memmer_logfile[128];
 static FILE *log_fp;
@@ -691,6 +698,15 @@ size_t malloc_usage (void)
 #endif
 }
 
+size_t malloc_count (void)
+{
+#ifdef USE_MEMMGR
+	return memmgr_count ();
+#else
+	return 0;
+#endif
+}
+
 void malloc_final (void)
 {
 #ifdef USE_MEMMGR
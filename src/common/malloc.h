@@ -161,6 +161,7 @@
 
 bool malloc_verify(void* ptr);
 size_t malloc_usage (void);
+size_t malloc_count (void);
 void malloc_init (void);
 void malloc_final (void);
 
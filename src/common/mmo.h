@@ -87,7 +87,11 @@ enum MSGSERVTYPE : uint8
     MSG_PT_DISBAND,
     MSG_DIRECT,
     MSG_LINKSHELL_RANK_CHANGE,
-    MSG_LINKSHELL_REMOVE
+    MSG_LINKSHELL_REMOVE,
+    MSG_ROSTER_SUBSCRIBE,       // search server -> message server, asks to be sent the roster traffic below
+    MSG_ROSTER_UPDATE,          // map server -> search servers, extra is a roster_entry_t
+    MSG_ROSTER_REMOVE,          // map server -> search servers, extra is the charid
+    MSG_PT_STATE                // map server -> all map servers, extra is an array of changed party_member_t rows
 };
 
 typedef std::string string_t;
@@ -207,6 +211,29 @@ struct search_t
 	string_t message;	// комментарий поиска
 };
 
+// one online character as the map servers publish it to the search server
+struct roster_entry_t
+{
+	uint32 charid;
+	int8   name[16];
+	uint16 zone;			// 0 while zoning, prevzone then holds the zone being left
+	uint16 prevzone;
+	uint8  mjob;
+	uint8  mlvl;
+	uint8  sjob;
+	uint8  slvl;
+	uint8  race;
+	uint8  nation;
+	uint8  rank;			// rank in the char's own nation
+	uint8  linkshellrank1;
+	uint8  linkshellrank2;
+	uint32 nameflags;
+	uint32 partyid;			// charid of the party leader, 0 when not in a party
+	uint32 allianceid;
+	uint32 linkshellid1;
+	uint32 linkshellid2;
+};
+
 struct bazaar_t
 {
 	string_t message;
@@ -0,0 +1,100 @@
+/*
+===========================================================================
+
+  Copyright (c) 2010-2015 Darkstar Dev Teams
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see http://www.gnu.org/licenses/
+
+  This file is part of DarkStar-server source code.
+
+===========================================================================
+*/
+
+#ifndef _MPSC_QUEUE_H
+#define _MPSC_QUEUE_H
+
+#include <atomic>
+#include <utility>
+
+/*
+Unbounded lock-free queue with any number of producers and exactly one consumer.
+
+Producers link a new node onto the head with a single exchange, the consumer
+walks from the tail and never contends with them. push() may be called from
+any thread; pop() and empty() only from the thread that owns the queue.
+*/
+template<typename T>
+class mpsc_queue
+{
+public:
+
+    mpsc_queue()
+        : m_head(new node_t()), m_tail(m_head.load(std::memory_order_relaxed))
+    {}
+
+    ~mpsc_queue()
+    {
+        while (m_tail != nullptr)
+        {
+            node_t* next = m_tail->next.load(std::memory_order_relaxed);
+            delete m_tail;
+            m_tail = next;
+        }
+    }
+
+    mpsc_queue(const mpsc_queue&) = delete;
+    mpsc_queue& operator=(const mpsc_queue&) = delete;
+
+    void push(T value)
+    {
+        node_t* node = new node_t(std::move(value));
+        node_t* prev = m_head.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    bool pop(T& out)
+    {
+        node_t* next = m_tail->next.load(std::memory_order_acquire);
+
+        if (next == nullptr)
+        {
+            return false;
+        }
+        out = std::move(next->value);
+        delete m_tail;
+        m_tail = next;
+        return true;
+    }
+
+    bool empty() const
+    {
+        return m_tail->next.load(std::memory_order_acquire) == nullptr;
+    }
+
+private:
+
+    struct node_t
+    {
+        node_t() : next(nullptr) {}
+        explicit node_t(T&& _value) : next(nullptr), value(std::move(_value)) {}
+
+        std::atomic<node_t*> next;
+        T value;
+    };
+
+    std::atomic<node_t*> m_head;    // last pushed node, shared by producers
+    node_t*              m_tail;    // already consumed stub, owned by the consumer
+};
+
+#endif
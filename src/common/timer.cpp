@@ -139,3 +139,21 @@ time_point get_server_start_time(void)
 {
     return start_time;
 }
+
+uint64 get_cycles(void)
+{
+#if defined(ENABLE_RDTSC)
+	return _rdtsc();
+#else
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+uint64 get_cycles_per_ms(void)
+{
+#if defined(ENABLE_RDTSC)
+	return RDTSC_CLOCK;
+#else
+	return 1000000;
+#endif
+}
@@ -12,6 +12,9 @@ uint32 gettick_nocache(void);
 
 time_point get_server_start_time(void);
 
+uint64 get_cycles(void);            // rdtsc when built with ENABLE_RDTSC, monotonic nanoseconds otherwise
+uint64 get_cycles_per_ms(void);
+
 void timer_init(void);
 void timer_final(void);
 
@@ -23,6 +23,8 @@ This file is part of DarkStar-server source code.
 
 #include <queue>
 #include <mutex>
+#include <set>
+#include <vector>
 
 #include "message_server.h"
 #include "../common/showmsg.h"
@@ -33,6 +35,8 @@ zmq::socket_t* zSocket = nullptr;
 Sql_t* ChatSqlHandle = nullptr;
 std::queue<chat_message_t> msg_queue;
 std::mutex queue_mutex;
+std::set<uint64> roster_subscribers;    // search servers, only touched by the listen thread
+std::vector<uint64> map_servers;        // every map server in zone_settings, loaded on first use
 
 void queue_message(uint64 ipp, MSGSERVTYPE type, zmq::message_t* extra, zmq::message_t* packet)
 {
@@ -88,6 +92,62 @@ void message_server_parse(MSGSERVTYPE type, zmq::message_t* extra, zmq::message_
         from_ip.s_addr = RBUFL(from->data(), 0);
         from_port = RBUFW(from->data(), 4);
     }
+
+    // roster traffic is fanned out to the search servers as is, no lookup needed
+    switch (type)
+    {
+    case MSG_ROSTER_SUBSCRIBE:
+    {
+        if (from && from->size() == sizeof(uint64))
+        {
+            uint64 ipp;
+            memcpy(&ipp, from->data(), sizeof(uint64));
+            roster_subscribers.insert(ipp);
+        }
+        return;
+    }
+    case MSG_ROSTER_UPDATE:
+    case MSG_ROSTER_REMOVE:
+    {
+        for (uint64 ipp : roster_subscribers)
+        {
+            message_server_send(ipp, type, extra, packet);
+        }
+        return;
+    }
+    case MSG_PT_STATE:
+    {
+        if (map_servers.empty())
+        {
+            ret = Sql_Query(ChatSqlHandle, "SELECT zoneip, zoneport FROM zone_settings GROUP BY zoneip, zoneport;");
+
+            while (ret != SQL_ERROR && Sql_NextRow(ChatSqlHandle) == SQL_SUCCESS)
+            {
+                uint64 ip = inet_addr(Sql_GetData(ChatSqlHandle, 0));
+                uint64 port = Sql_GetUIntData(ChatSqlHandle, 1);
+                map_servers.push_back(ip | (port << 32));
+            }
+        }
+
+        // the sender already has the rows
+        uint64 fromipp = 0;
+        if (from && from->size() == sizeof(uint64))
+        {
+            memcpy(&fromipp, from->data(), sizeof(uint64));
+        }
+        for (uint64 ipp : map_servers)
+        {
+            if (ipp != fromipp)
+            {
+                message_server_send(ipp, type, extra, packet);
+            }
+        }
+        return;
+    }
+    default:
+        break;
+    }
+
     switch (type)
     {
     case MSG_CHAT_TELL:
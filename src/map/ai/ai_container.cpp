@@ -42,6 +42,7 @@ This file is part of DarkStar-server source code.
 #include "../entities/charentity.h"
 #include "../entities/mobentity.h"
 #include "../packets/entity_animation.h"
+#include "../profiler.h"
 
 CAIContainer::CAIContainer(CBaseEntity* _PEntity) :
     CAIContainer(_PEntity, nullptr, nullptr, nullptr)
@@ -301,6 +302,8 @@ void CAIContainer::Reset()
 
 void CAIContainer::Tick(time_point _tick)
 {
+    CProfileScope profile(PROFILE_AI);
+
     m_PrevTick = m_Tick;
     m_Tick = _tick;
 
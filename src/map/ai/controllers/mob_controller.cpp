@@ -574,7 +574,7 @@ void CMobController::DoCombatTick(time_point tick)
                 !(PMob->getMobMod(MOBMOD_HP_STANDBACK) == 1 && currentDistance < 20 && PMob->GetHPP() > 70) &&
                 !(PMob->getMobMod(MOBMOD_SPAWN_LEASH) > 0 && distance(PMob->loc.p, PMob->m_SpawnPoint) > PMob->getMobMod(MOBMOD_SPAWN_LEASH)))
             {
-                PMob->PAI->PathFind->PathAround(PTarget->loc.p, 2.0f, PATHFLAG_WALLHACK | PATHFLAG_RUN);
+                PMob->PAI->PathFind->ChaseTo(PTarget, 2.0f, PATHFLAG_WALLHACK | PATHFLAG_RUN);
                 PMob->PAI->PathFind->FollowPath();
             }
         }
@@ -82,7 +82,7 @@ void CPlayerCharmController::DoCombatTick(time_point tick)
         {
             if (POwner->speed > 0)
             {
-                POwner->PAI->PathFind->PathAround(PTarget->loc.p, 2.0f, PATHFLAG_WALLHACK | PATHFLAG_RUN);
+                POwner->PAI->PathFind->ChaseTo(PTarget, 2.0f, PATHFLAG_WALLHACK | PATHFLAG_RUN);
                 POwner->PAI->PathFind->FollowPath();
             }
         }
@@ -100,7 +100,7 @@ void CPlayerCharmController::DoRoamTick(time_point tick)
 
     if (currentDistance > RoamDistance)
     {
-        if (currentDistance < 35.0f && POwner->PAI->PathFind->PathAround(POwner->PMaster->loc.p, 2.0f, PATHFLAG_RUN | PATHFLAG_WALLHACK))
+        if (currentDistance < 35.0f && POwner->PAI->PathFind->ChaseTo(POwner->PMaster, 2.0f, PATHFLAG_RUN | PATHFLAG_WALLHACK))
         {
             POwner->PAI->PathFind->FollowPath();
         }
@@ -26,12 +26,32 @@ This file is part of DarkStar-server source code.
 #include "../../entities/baseentity.h"
 #include "../../entities/mobentity.h"
 #include "../../../common/utils.h"
+#include "../../profiler.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace
+{
+    // last chase path planned towards each target, a zone is only ever ticked by one thread
+    struct chase_share_t
+    {
+        CZone* zone;
+        position_t goal;
+        time_point planned;
+        position_t points[MAX_PATH_POINTS];
+        int16 length;
+    };
+
+    thread_local std::unordered_map<uint32, chase_share_t> ChaseShare;
+}
 
 CPathFind::CPathFind(CBaseEntity* PTarget)
 {
     m_PTarget = PTarget;
     m_pathFlags = 0;
     Clear();
+    ResetChase();
 }
 
 CPathFind::~CPathFind()
@@ -42,7 +62,9 @@ CPathFind::~CPathFind()
 
 bool CPathFind::RoamAround(position_t point, float maxRadius, uint8 maxTurns, uint8 roamFlags)
 {
+    CProfileScope profile(PROFILE_PATHFIND);
     Clear();
+    ResetChase();
 
     m_roamFlags = roamFlags;
 
@@ -83,6 +105,8 @@ bool CPathFind::RoamAround(position_t point, float maxRadius, uint8 maxTurns, ui
 
 bool CPathFind::PathTo(position_t point, uint8 pathFlags, bool clear)
 {
+    CProfileScope profile(PROFILE_PATHFIND);
+
     // don't follow a new path if the current path has script flag and new path doesn't
     if (IsFollowingPath() && (m_pathFlags & PATHFLAG_SCRIPT) && !(pathFlags & PATHFLAG_SCRIPT))
         return false;
@@ -90,6 +114,7 @@ bool CPathFind::PathTo(position_t point, uint8 pathFlags, bool clear)
     if (clear)
     {
         Clear();
+        ResetChase();
     }
 
     m_pathFlags = pathFlags;
@@ -129,6 +154,7 @@ bool CPathFind::PathTo(position_t point, uint8 pathFlags, bool clear)
 bool CPathFind::PathAround(position_t point, float distanceFromPoint, uint8 pathFlags)
 {
     Clear();
+    ResetChase();
     position_t* lastPoint = &point;
 
     float randomRadian = dsprand::GetRandomNumber<float>(0, 2 * M_PI);
@@ -145,10 +171,221 @@ bool CPathFind::PathAround(position_t point, float distanceFromPoint, uint8 path
     return PathTo(point, pathFlags, false);
 }
 
+bool CPathFind::ChaseTo(CBaseEntity* PChaseTarget, float distanceFromPoint, uint8 pathFlags)
+{
+    CProfileScope profile(PROFILE_PATHFIND);
+
+    if (IsFollowingScriptedPath() && !(pathFlags & PATHFLAG_SCRIPT))
+        return false;
+
+    // without a navmesh every path is a single point, there is nothing worth keeping
+    if (!isNavMeshEnabled())
+    {
+        return PathAround(PChaseTarget->loc.p, distanceFromPoint, pathFlags);
+    }
+
+    position_t& goal = PChaseTarget->loc.p;
+    position_t end;
+
+    // keep the old path while the target stays close to where it was planned for
+    // and nothing has moved me off of it (teleports, warps, knockbacks)
+    if (m_chaseTargetID == PChaseTarget->id &&
+        distance(goal, m_chaseGoal) < CHASE_REPLAN_DISTANCE &&
+        distance(m_PTarget->loc.p, m_chaseLastPos) < CHASE_REPLAN_DISTANCE * 2)
+    {
+        CProfileScope repair(PROFILE_PATHFIND, "chase repair");
+
+        end.x = goal.x + m_chaseOffsetX;
+        end.y = goal.y;
+        end.z = goal.z + m_chaseOffsetZ;
+
+        if (RepairChase(end))
+        {
+            m_pathFlags = pathFlags;
+            m_chaseLastPos = m_PTarget->loc.p;
+            return true;
+        }
+    }
+
+    Clear();
+
+    float randomRadian = dsprand::GetRandomNumber<float>(0, 2 * M_PI);
+
+    m_chaseOffsetX = cosf(randomRadian) * distanceFromPoint;
+    m_chaseOffsetZ = sinf(randomRadian) * distanceFromPoint;
+
+    end.x = goal.x + m_chaseOffsetX;
+    end.y = goal.y;
+    end.z = goal.z + m_chaseOffsetZ;
+
+    m_pathFlags = pathFlags;
+
+    // save for sliding logic
+    m_originalPoint = end;
+    m_distanceFromPoint = 1;
+
+    bool joined = false;
+    {
+        CProfileScope join(PROFILE_PATHFIND, "chase join");
+        joined = JoinChase(PChaseTarget, end);
+    }
+
+    if (!joined)
+    {
+        CProfileScope replan(PROFILE_PATHFIND, "chase replan");
+        bool result = false;
+        bool partial = false;
+
+        if (m_pathFlags & PATHFLAG_WALLHACK)
+        {
+            result = FindClosestPath(&m_PTarget->loc.p, &end, CHASE_PLAN_ITERATIONS, &partial);
+        }
+        else
+        {
+            result = FindPath(&m_PTarget->loc.p, &end, CHASE_PLAN_ITERATIONS, &partial);
+        }
+
+        if (!result)
+        {
+            Clear();
+            ResetChase();
+            return false;
+        }
+
+        // single leg paths are cheaper to plan than to share, partial ones stop short of the target
+        if (m_pathLength > 1 && !partial)
+        {
+            if (ChaseShare.size() > 256)
+            {
+                time_point now = server_clock::now();
+
+                for (auto it = ChaseShare.begin(); it != ChaseShare.end();)
+                {
+                    it = now - it->second.planned > CHASE_SHARE_TIME ? ChaseShare.erase(it) : std::next(it);
+                }
+            }
+            chase_share_t& share = ChaseShare[PChaseTarget->id];
+
+            share.zone = m_PTarget->loc.zone;
+            share.goal = goal;
+            share.planned = server_clock::now();
+            share.length = m_pathLength;
+            std::copy(m_points, m_points + m_pathLength, share.points);
+        }
+    }
+
+    m_chaseTargetID = PChaseTarget->id;
+    m_chaseGoal = goal;
+    m_chaseLastPos = m_PTarget->loc.p;
+
+    return true;
+}
+
+bool CPathFind::RepairChase(position_t& end)
+{
+    CNavMesh* navMesh = m_PTarget->loc.zone->m_navMesh;
+
+    if (IsFollowingPath())
+    {
+        position_t* lastPoint = &m_points[m_pathLength - 1];
+
+        // target hasn't really moved
+        if (distance(*lastPoint, end) < 0.5f)
+        {
+            return true;
+        }
+
+        // only the last leg changes, it has to stay walkable
+        position_t* legStart = m_currentPoint < m_pathLength - 1 ? &m_points[m_pathLength - 2] : &m_PTarget->loc.p;
+
+        if (!navMesh->raycast(*legStart, end))
+        {
+            return false;
+        }
+
+        lastPoint->x = end.x;
+        lastPoint->y = end.y;
+        lastPoint->z = end.z;
+    }
+    else
+    {
+        // I already reached the old end point, walk straight over if nothing is in the way
+        if (!navMesh->raycast(m_PTarget->loc.p, end))
+        {
+            return false;
+        }
+        Clear();
+
+        m_pathLength = 1;
+
+        m_points[0].x = end.x;
+        m_points[0].y = end.y;
+        m_points[0].z = end.z;
+    }
+
+    m_originalPoint = end;
+    m_distanceFromPoint = 1;
+
+    return true;
+}
+
+bool CPathFind::JoinChase(CBaseEntity* PChaseTarget, position_t& end)
+{
+    auto it = ChaseShare.find(PChaseTarget->id);
+
+    if (it == ChaseShare.end())
+    {
+        return false;
+    }
+
+    chase_share_t& share = it->second;
+
+    if (share.zone != m_PTarget->loc.zone ||
+        server_clock::now() - share.planned > CHASE_SHARE_TIME ||
+        distance(share.goal, PChaseTarget->loc.p) >= CHASE_REPLAN_DISTANCE)
+    {
+        ChaseShare.erase(it);
+        return false;
+    }
+
+    CNavMesh* navMesh = m_PTarget->loc.zone->m_navMesh;
+
+    // linked mobs stand next to the one that planned the path, so they can usually
+    // see one of its first corners. hop on as far along as possible
+    int16 join = -1;
+
+    for (int16 i = std::min<int16>(1, share.length - 2); i >= 0; --i)
+    {
+        if (navMesh->raycast(m_PTarget->loc.p, share.points[i]))
+        {
+            join = i;
+            break;
+        }
+    }
+
+    // the last leg has to reach my own spot around the target
+    if (join < 0 || !navMesh->raycast(share.points[share.length - 2], end))
+    {
+        return false;
+    }
+
+    m_pathLength = share.length - join;
+    m_currentPoint = 0;
+
+    std::copy(share.points + join, share.points + share.length - 1, m_points);
+
+    m_points[m_pathLength - 1].x = end.x;
+    m_points[m_pathLength - 1].y = end.y;
+    m_points[m_pathLength - 1].z = end.z;
+
+    return true;
+}
+
 bool CPathFind::PathThrough(position_t* points, uint8 totalPoints, uint8 pathFlags)
 {
 
     Clear();
+    ResetChase();
 
     m_pathFlags = pathFlags;
 
@@ -160,6 +397,7 @@ bool CPathFind::PathThrough(position_t* points, uint8 totalPoints, uint8 pathFla
 bool CPathFind::WarpTo(position_t point, float maxDistance)
 {
     Clear();
+    ResetChase();
 
     position_t newPoint = nearPosition(point, maxDistance, M_PI);
 
@@ -241,6 +479,7 @@ void CPathFind::StopWithin(float within)
 void CPathFind::FollowPath()
 {
     if (!IsFollowingPath()) return;
+    CProfileScope profile(PROFILE_PATHFIND);
 
     m_onPoint = false;
 
@@ -324,10 +563,10 @@ void CPathFind::StepTo(position_t* pos, bool run)
     m_PTarget->updatemask |= UPDATE_POS;
 }
 
-bool CPathFind::FindPath(position_t* start, position_t* end)
+bool CPathFind::FindPath(position_t* start, position_t* end, int32 maxIterations, bool* partial)
 {
 
-    m_pathLength = m_PTarget->loc.zone->m_navMesh->findPath(*start, *end, m_points, MAX_PATH_POINTS);
+    m_pathLength = m_PTarget->loc.zone->m_navMesh->findPath(*start, *end, m_points, MAX_PATH_POINTS, maxIterations, partial);
     m_currentPoint = 0;
 
     if (m_pathLength <= 0)
@@ -369,10 +608,10 @@ bool CPathFind::FindRandomPath(position_t* start, float maxRadius, uint8 maxTurn
     return true;
 }
 
-bool CPathFind::FindClosestPath(position_t* start, position_t* end)
+bool CPathFind::FindClosestPath(position_t* start, position_t* end, int32 maxIterations, bool* partial)
 {
 
-    m_pathLength = m_PTarget->loc.zone->m_navMesh->findPath(*start, *end, m_points, MAX_PATH_POINTS);
+    m_pathLength = m_PTarget->loc.zone->m_navMesh->findPath(*start, *end, m_points, MAX_PATH_POINTS, maxIterations, partial);
     m_currentPoint = 0;
 
     if (m_pathLength <= 0)
@@ -476,6 +715,13 @@ void CPathFind::Clear()
     m_turnLength = 0;
 }
 
+void CPathFind::ResetChase()
+{
+    m_chaseTargetID = 0;
+    m_chaseOffsetX = 0;
+    m_chaseOffsetZ = 0;
+}
+
 void CPathFind::AddPoints(position_t* points, uint8 totalPoints, bool reverse)
 {
 
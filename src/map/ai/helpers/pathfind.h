@@ -37,6 +37,13 @@ class CBaseEntity;
 #define MAX_TURN_POINTS 5
 #define VERTICAL_PATH_LIMIT 3.5
 
+// a chase path is repaired in place until its target drifts this far from where it was planned
+#define CHASE_REPLAN_DISTANCE 4.0f
+// how long a chase path stays available for other mobs chasing the same target
+#define CHASE_SHARE_TIME std::chrono::milliseconds(1000)
+// navmesh nodes a chase re-plan may search, a far target gets a partial path that later ticks extend
+#define CHASE_PLAN_ITERATIONS 64
+
 enum PATHFLAG {
   PATHFLAG_NONE			= 0x00,
   PATHFLAG_RUN			= 0x01, // run twice the speed
@@ -61,6 +68,9 @@ class CPathFind
     // move some where around the point
     bool PathAround(position_t point, float distanceFromPoint, uint8 pathFlags = 0);
 
+    // follow an entity around, reusing the previous chase path while the target only moves a little
+    bool ChaseTo(CBaseEntity* PChaseTarget, float distanceFromPoint, uint8 pathFlags = 0);
+
     // walk through the given points. No new points made.
     bool PathThrough(position_t* points, uint8 totalPoints, uint8 pathFlags = 0);
 
@@ -114,12 +124,21 @@ class CPathFind
 
   private:
 
+    // patch the current chase path so it ends at the target's new position
+    bool RepairChase(position_t& end);
+
+    // start from another mob's fresh path to the same target
+    bool JoinChase(CBaseEntity* PChaseTarget, position_t& end);
+
+    // forget the last chase, called whenever a path is set by other means
+    void ResetChase();
+
     // find a valid path using polys
-    bool FindPath(position_t* start, position_t* end);
+    bool FindPath(position_t* start, position_t* end, int32 maxIterations = 0, bool* partial = nullptr);
 
     // cut some corners and find the fastest path
     // this will make the mob run down cliffs
-    bool FindClosestPath(position_t* start, position_t* end);
+    bool FindClosestPath(position_t* start, position_t* end, int32 maxIterations = 0, bool* partial = nullptr);
 
     // finds a random path around the given point
     bool FindRandomPath(position_t* start, float maxRadius, uint8 maxTurns, uint8 roamFlags);
@@ -145,6 +164,12 @@ class CPathFind
 
     float m_distanceMoved;
     float m_maxDistance;
+
+    uint32 m_chaseTargetID;
+    position_t m_chaseGoal;         // target position the chase path was planned for
+    position_t m_chaseLastPos;      // my position when the chase was last updated
+    float m_chaseOffsetX;
+    float m_chaseOffsetZ;
 };
 
 #endif
@@ -30,6 +30,7 @@
 #include "utils/charutils.h"
 #include "conquest_system.h"
 #include "utils/jailutils.h"
+#include "utils/partyutils.h"
 #include "map.h"
 #include "party.h"
 #include "treasure_pool.h"
@@ -54,7 +55,7 @@ CAlliance::CAlliance(CBattleEntity* PEntity)
 
     addParty(PEntity->PParty);
 	this->aLeader = PEntity->PParty;
-    Sql_Query(SqlHandle, "UPDATE accounts_parties SET partyflag = partyflag | %d WHERE partyid = %u AND partyflag & %d;", ALLIANCE_LEADER, m_AllianceID, PARTY_LEADER);
+    partyutils::SetAllianceLeaderFlag(m_AllianceID);
 }
 
 CAlliance::CAlliance(uint32 id)
@@ -67,17 +68,12 @@ void CAlliance::dissolveAlliance(bool playerInitiated)
     if (playerInitiated)
     {
         //Sql_Query(SqlHandle, "UPDATE accounts_parties SET allianceid = 0, partyflag = partyflag & ~%d WHERE allianceid = %u;", ALLIANCE_LEADER | PARTY_SECOND | PARTY_THIRD, m_AllianceID);
-        uint8 data[8] {};
-        WBUFL(data, 0) = m_AllianceID;
-        WBUFL(data, 4) = m_AllianceID;
-        message::send(MSG_PT_DISBAND, data, sizeof data, nullptr);
+        partyutils::Notify(MSG_PT_DISBAND, m_AllianceID, m_AllianceID);
     }
     else
     {
-        Sql_Query(SqlHandle, "UPDATE accounts_parties JOIN accounts_sessions USING (charid) \
-                        SET allianceid = 0, partyflag = partyflag & ~%d \
-                        WHERE allianceid = %u AND IF(%u = 0 AND %u = 0, true, server_addr = %u AND server_port = %u);", 
-                        ALLIANCE_LEADER | PARTY_SECOND | PARTY_THIRD, m_AllianceID, map_ip, map_port, map_ip, map_port);
+        // every server hosting members gets the disband, whichever handles it first clears the rows for all of them
+        partyutils::DissolveAlliance(m_AllianceID);
         //first kick out the third party if it exsists
         CParty* party = nullptr;
         if (this->partyList.size() == 3)
@@ -109,27 +105,16 @@ void CAlliance::dissolveAlliance(bool playerInitiated)
 
 uint32 CAlliance::partyCount(void) 
 {	
-    int ret = Sql_Query(SqlHandle, "SELECT * FROM accounts_parties WHERE allianceid = %d GROUP BY partyid;", m_AllianceID, PARTY_SECOND | PARTY_THIRD);
-
-    if (ret != SQL_ERROR)
-    {
-        return Sql_NumRows(SqlHandle);
-    }
-    return 0;
+    return partyutils::GetAlliancePartyCount(m_AllianceID);
 }
 
 void CAlliance::removeParty(CParty * party) 
 {
     delParty(party);
 
-    Sql_Query(SqlHandle, "UPDATE accounts_parties SET allianceid = 0, partyflag = partyflag & ~%d WHERE partyid = %u;", ALLIANCE_LEADER | PARTY_SECOND | PARTY_THIRD, party->GetPartyID());
-    uint8 data[4] {};
-	WBUFL(data, 0) = m_AllianceID;
-    message::send(MSG_PT_RELOAD, data, sizeof data, nullptr);
-
-    uint8 data2[4] {};
-    WBUFL(data2, 0) = party->GetPartyID();
-    message::send(MSG_PT_RELOAD, data2, sizeof data2, nullptr);
+    partyutils::LeaveAlliance(party->GetPartyID());
+    partyutils::Notify(MSG_PT_RELOAD, m_AllianceID);
+    partyutils::Notify(MSG_PT_RELOAD, party->GetPartyID());
 }
 
 void CAlliance::delParty(CParty* party)
@@ -138,12 +123,10 @@ void CAlliance::delParty(CParty* party)
 
     //if main party then pass alliance lead to the next (d/c fix)
     if (alliance->getMainParty() == party){
-        int ret = Sql_Query(SqlHandle, "SELECT charname FROM accounts_sessions JOIN chars ON accounts_sessions.charid = chars.charid \
-                                JOIN accounts_parties ON accounts_parties.charid = chars.charid WHERE allianceid = %u AND partyflag & %d \
-                                AND partyid != %d ORDER BY timestamp ASC LIMIT 1;", m_AllianceID, PARTY_LEADER, party->GetPartyID());
-        if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) != 0 && Sql_NextRow(SqlHandle) == SQL_SUCCESS)
+        std::string newLeader = partyutils::GetNextAllianceLeader(m_AllianceID, party->GetPartyID());
+
+        if (!newLeader.empty())
         {
-            std::string newLeader(Sql_GetData(SqlHandle, 0));
             assignAllianceLeader(newLeader.c_str());
         }
         if (alliance->getMainParty() == party)
@@ -208,57 +191,22 @@ void CAlliance::addParty(CParty * party)
 	party->m_PAlliance = this;
 	partyList.push_back(party);
 	
-    int newparty = 0;
-
-    int ret = Sql_Query(SqlHandle, "SELECT partyflag & %d FROM accounts_parties WHERE allianceid = %d ORDER BY partyflag & %d ASC;", PARTY_SECOND | PARTY_THIRD, m_AllianceID, PARTY_SECOND | PARTY_THIRD);
-
-    if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) > 0)
-    {
-        while (Sql_NextRow(SqlHandle) == SQL_SUCCESS)
-        {
-            if (Sql_GetUIntData(SqlHandle, 0) == newparty)
-            {
-                newparty++;
-            }
-        }
-    }
-
 	for (uint8 i = 0; i < party->members.size(); ++i)
 	{
 		party->ReloadTreasurePool((CCharEntity*)party->members.at(i));
 		charutils::SaveCharStats((CCharEntity*)party->members.at(i));
 	}
-    Sql_Query(SqlHandle, "UPDATE accounts_parties SET allianceid = %u, partyflag = partyflag | %d WHERE partyid = %u;", m_AllianceID, newparty, party->GetPartyID());
+    uint8 newparty = partyutils::JoinAlliance(party->GetPartyID(), m_AllianceID);
     party->SetPartyNumber(newparty);
 
-    uint8 data[4] {};
-	WBUFL(data, 0) = m_AllianceID;
-    message::send(MSG_PT_RELOAD, data, sizeof data, nullptr);
+    partyutils::Notify(MSG_PT_RELOAD, m_AllianceID);
 
 }
 
 void CAlliance::addParty(uint32 partyid)
 {
-    int newparty = 0;
-
-    int ret = Sql_Query(SqlHandle, "SELECT partyflag FROM accounts_parties WHERE allianceid = %d ORDER BY partyflag & %d ASC;", m_AllianceID, PARTY_SECOND | PARTY_THIRD);
-
-    if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) > 0)
-    {
-        while (Sql_NextRow(SqlHandle) == SQL_SUCCESS)
-        {
-            uint8 partyflag = Sql_GetUIntData(SqlHandle, 0);
-            uint8 oldparty = partyflag & (PARTY_SECOND | PARTY_THIRD);
-            if (oldparty == newparty)
-            {
-                newparty++;
-            }
-        }
-    }
-    Sql_Query(SqlHandle, "UPDATE accounts_parties SET allianceid = %u, partyflag = partyflag | %d WHERE partyid = %u;", m_AllianceID, newparty, partyid);
-    uint8 data[4] {};
-	WBUFL(data, 0) = m_AllianceID;
-    message::send(MSG_PT_RELOAD, data, sizeof data, nullptr);
+    partyutils::JoinAlliance(partyid, m_AllianceID);
+    partyutils::Notify(MSG_PT_RELOAD, m_AllianceID);
 }
 
 void CAlliance::pushParty(CParty* PParty, uint8 number)
@@ -287,14 +235,10 @@ void CAlliance::setMainParty(CParty * aLeader)
 
 void CAlliance::assignAllianceLeader(const char* name)
 {
-    int ret = Sql_Query(SqlHandle, "SELECT chars.charid from accounts_sessions JOIN chars USING (charid) JOIN accounts_parties USING (charid) "
-        "WHERE charname = '%s' AND allianceid = %d AND partyflag & %d;", name, m_AllianceID, PARTY_LEADER);
-    if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) > 0 && Sql_NextRow(SqlHandle) == SQL_SUCCESS)
-    {
-        int charid = Sql_GetUIntData(SqlHandle, 0);
+    uint32 charid = partyutils::SetAllianceLeader(m_AllianceID, name);
 
-        Sql_Query(SqlHandle, "UPDATE accounts_parties SET partyflag = partyflag & ~%d WHERE allianceid = %u AND partyflag & %d", ALLIANCE_LEADER, m_AllianceID, ALLIANCE_LEADER);
-        Sql_Query(SqlHandle, "UPDATE accounts_parties SET allianceid = %u WHERE allianceid = %u;", charid, m_AllianceID);
+    if (charid != 0)
+    {
         m_AllianceID = charid;
 
         //in case leader's on another server 
@@ -308,7 +252,5 @@ void CAlliance::assignAllianceLeader(const char* name)
                 break;
             }
         }
-
-        Sql_Query(SqlHandle, "UPDATE accounts_parties SET partyflag = partyflag | %d WHERE charid = %u", ALLIANCE_LEADER, charid);
     }
 }
\ No newline at end of file
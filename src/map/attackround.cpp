@@ -38,6 +38,10 @@ CAttackRound::CAttackRound(CBattleEntity* attacker, CBattleEntity* defender)
     m_attacker = attacker;
     m_defender = defender;
     m_kickAttackOccured = false;
+
+    // every swing of the round reads the same ATT/ACC/EVA/DEF and base stats, compute them once
+    m_attacker->OpenStatSnapshot();
+    m_defender->OpenStatSnapshot();
     m_sataOccured = false;
     m_subWeaponType = 0;
 
@@ -86,7 +90,8 @@ CAttackRound::CAttackRound(CBattleEntity* attacker, CBattleEntity* defender)
 ************************************************************************/
 CAttackRound::~CAttackRound()
 {
-
+    m_attacker->CloseStatSnapshot();
+    m_defender->CloseStatSnapshot();
 }
 
 /************************************************************************
@@ -45,6 +45,7 @@ class CAttackRound
 {
 public:
     CAttackRound(CBattleEntity* attacker, CBattleEntity* defender);
+    CAttackRound(const CAttackRound&) = delete;
     ~CAttackRound();
 
     void						AddAttackSwing(PHYSICAL_ATTACK_TYPE type, PHYSICAL_ATTACK_DIRECTION direction, uint8 count); // Adds an attack swing.
@@ -34,6 +34,7 @@
 #include "packets/char_skills.h"
 #include "packets/message_basic.h"
 #include "recast_container.h"
+#include "profiler.h"
 
 CBattlefieldHandler::CBattlefieldHandler(uint16 zoneid)
 {
@@ -63,6 +64,8 @@ CBattlefieldHandler::CBattlefieldHandler(uint16 zoneid)
 }
 
 void CBattlefieldHandler::handleBattlefields(time_point tick) {
+    CProfileScope profile(PROFILE_BATTLEFIELD);
+
     for (int i = 0; i < m_MaxBattlefields; i++) {
         if (m_Battlefields[i] != nullptr) { //handle it!
             CBattlefield* PBattlefield = m_Battlefields[i];
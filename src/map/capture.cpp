@@ -0,0 +1,192 @@
+/*
+===========================================================================
+
+  Copyright (c) 2010-2015 Darkstar Dev Teams
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see http://www.gnu.org/licenses/
+
+  This file is part of DarkStar-server source code.
+
+===========================================================================
+*/
+
+#include "../common/showmsg.h"
+#include "../common/socket.h"
+
+#include <chrono>
+#include <string.h>
+#include <unordered_set>
+
+#include "capture.h"
+#include "zone.h"
+#include "entities/charentity.h"
+
+namespace capture
+{
+    namespace
+    {
+        const int8   MAGIC[8] = { 'D', 'S', 'C', 'A', 'P', 'T', 'R', '1' };
+        const size_t SESSION_SIZE = 1 + 4 + 4 + 2 + 12 + 1;
+        const size_t PACKET_HEADER_SIZE = 1 + 4 + 4 + 2;
+
+        FILE*      g_File = nullptr;
+        time_point g_Start;
+
+        // chars whose session record was written, until map.cpp closes their session
+        std::unordered_set<uint32> g_Sessions;
+
+        uint64 UnixMs()
+        {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        }
+    }
+
+    bool Open(const int8* path)
+    {
+        Close();
+
+        g_File = fopen(path, "wb");
+        if (g_File == nullptr)
+        {
+            ShowError("capture::Open: cannot create %s\n", path);
+            return false;
+        }
+        uint8 header[sizeof(MAGIC) + 8];
+        memcpy(header, MAGIC, sizeof(MAGIC));
+        WBUFU(header, sizeof(MAGIC)) = UnixMs();
+        fwrite(header, sizeof(header), 1, g_File);
+
+        g_Start = server_clock::now();
+        ShowStatus("capture: writing client traffic to %s\n", path);
+        return true;
+    }
+
+    void Close()
+    {
+        if (g_File != nullptr)
+        {
+            fclose(g_File);
+            g_File = nullptr;
+        }
+        g_Sessions.clear();
+    }
+
+    bool IsActive()
+    {
+        return g_File != nullptr;
+    }
+
+    void Record(CCharEntity* PChar, const int8* packet, uint16 size)
+    {
+        if (g_File == nullptr)
+        {
+            return;
+        }
+        uint32 time = (uint32)std::chrono::duration_cast<std::chrono::milliseconds>(server_clock::now() - g_Start).count();
+        uint8 buf[SESSION_SIZE];
+
+        if (g_Sessions.insert(PChar->id).second)
+        {
+            WBUFB(buf, 0) = CAPTURE_SESSION;
+            WBUFL(buf, 1) = time;
+            WBUFL(buf, 5) = PChar->id;
+            WBUFW(buf, 9) = PChar->loc.zone != nullptr ? PChar->getZone() : 0;
+            WBUFF(buf, 11) = PChar->loc.p.x;
+            WBUFF(buf, 15) = PChar->loc.p.y;
+            WBUFF(buf, 19) = PChar->loc.p.z;
+            WBUFB(buf, 23) = PChar->loc.p.rotation;
+            fwrite(buf, SESSION_SIZE, 1, g_File);
+        }
+        WBUFB(buf, 0) = CAPTURE_PACKET;
+        WBUFL(buf, 1) = time;
+        WBUFL(buf, 5) = PChar->id;
+        WBUFW(buf, 9) = size;
+        fwrite(buf, PACKET_HEADER_SIZE, 1, g_File);
+        fwrite(packet, size, 1, g_File);
+    }
+
+    void EndSession(uint32 charid)
+    {
+        g_Sessions.erase(charid);
+    }
+};
+
+/************************************************************************
+*                                                                       *
+*  Reader used by the replay driver                                     *
+*                                                                       *
+************************************************************************/
+
+CCaptureReader::~CCaptureReader()
+{
+    if (m_file != nullptr)
+    {
+        fclose(m_file);
+    }
+}
+
+bool CCaptureReader::Open(const int8* path)
+{
+    uint8 header[sizeof(capture::MAGIC) + 8];
+
+    m_file = fopen(path, "rb");
+    if (m_file == nullptr)
+    {
+        ShowError("CCaptureReader: cannot open %s\n", path);
+        return false;
+    }
+    if (fread(header, sizeof(header), 1, m_file) != 1 || memcmp(header, capture::MAGIC, sizeof(capture::MAGIC)) != 0)
+    {
+        ShowError("CCaptureReader: %s is not a capture file\n", path);
+        return false;
+    }
+    m_start = RBUFU(header, sizeof(capture::MAGIC));
+    return true;
+}
+
+bool CCaptureReader::Next(capture_record_t& record)
+{
+    uint8 buf[capture::SESSION_SIZE];
+
+    if (m_file == nullptr || fread(buf, capture::PACKET_HEADER_SIZE, 1, m_file) != 1)
+    {
+        return false;
+    }
+    record.kind = RBUFB(buf, 0);
+    record.time = RBUFL(buf, 1);
+    record.charid = RBUFL(buf, 5);
+
+    if (record.kind == CAPTURE_SESSION)
+    {
+        if (fread(buf + capture::PACKET_HEADER_SIZE, capture::SESSION_SIZE - capture::PACKET_HEADER_SIZE, 1, m_file) != 1)
+        {
+            return false;
+        }
+        record.zone = RBUFW(buf, 9);
+        record.pos = {};
+        record.pos.x = RBUFF(buf, 11);
+        record.pos.y = RBUFF(buf, 15);
+        record.pos.z = RBUFF(buf, 19);
+        record.pos.rotation = RBUFB(buf, 23);
+        record.size = 0;
+        return true;
+    }
+    if (record.kind == CAPTURE_PACKET)
+    {
+        record.size = RBUFW(buf, 9);
+        return record.size <= sizeof(record.data) && fread(record.data, record.size, 1, m_file) == 1;
+    }
+    ShowError("CCaptureReader: unknown record type %u\n", record.kind);
+    return false;
+}
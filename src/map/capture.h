@@ -0,0 +1,94 @@
+/*
+===========================================================================
+
+  Copyright (c) 2010-2015 Darkstar Dev Teams
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see http://www.gnu.org/licenses/
+
+  This file is part of DarkStar-server source code.
+
+===========================================================================
+*/
+
+#ifndef _CAPTURE_H
+#define _CAPTURE_H
+
+#include "../common/cbasetypes.h"
+#include "../common/mmo.h"
+
+#include <cstdio>
+
+class CCharEntity;
+
+/************************************************************************
+*                                                                       *
+*  Capture of decrypted client traffic for offline replay (dsbench      *
+*  --scenario replay). The file is a header followed by records:        *
+*                                                                       *
+*  header   "DSCAPTR1", uint64 unix time of the first record in ms      *
+*  session  uint8 0, uint32 ms, uint32 charid, uint16 zone (0 while     *
+*           zoning), float x, y, z, uint8 rotation                      *
+*  packet   uint8 1, uint32 ms, uint32 charid, uint16 size, small       *
+*           packet as parse() handed it to PacketParser                 *
+*                                                                       *
+*  A session record precedes the first packet of every map session      *
+*  (login or zone in), so a replay knows where the character stood.     *
+*                                                                       *
+************************************************************************/
+
+enum CAPTURE_RECORD
+{
+    CAPTURE_SESSION = 0,
+    CAPTURE_PACKET  = 1
+};
+
+struct capture_record_t
+{
+    uint8      kind;
+    uint32     time;                    // ms since the start of the capture
+    uint32     charid;
+    uint16     zone;
+    position_t pos;
+    uint16     size;
+    uint8      data[512];
+};
+
+namespace capture
+{
+    bool Open(const int8* path);
+    void Close();
+    bool IsActive();
+
+    void Record(CCharEntity* PChar, const int8* packet, uint16 size);
+    void EndSession(uint32 charid);                 // the next packet of the char starts a new session
+};
+
+class CCaptureReader
+{
+public:
+
+    CCaptureReader() : m_file(nullptr), m_start(0) {}
+    ~CCaptureReader();
+
+    bool   Open(const int8* path);
+    bool   Next(capture_record_t& record);     // false at the end of the file or on a truncated record
+    uint64 GetStartTime() { return m_start; }
+
+private:
+
+    FILE*  m_file;
+    uint64 m_start;
+};
+
+#endif
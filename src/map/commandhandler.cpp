@@ -145,10 +145,9 @@ int32 CCommandHandler::call(CCharEntity* PChar, const int8* commandline)
     }
 
     // Push the calling character (if exists)..
-    CLuaBaseEntity LuaCmdCaller(PChar);
     int32 cntparam = 0;
 
-    Lunar<CLuaBaseEntity>::push(m_LState, &LuaCmdCaller);
+    CLuaBaseEntity::Push(m_LState, PChar);
     cntparam += 1;
 
     // Prepare parameters..
@@ -0,0 +1,295 @@
+/*
+===========================================================================
+
+  Copyright (c) 2010-2015 Darkstar Dev Teams
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see http://www.gnu.org/licenses/
+
+  This file is part of DarkStar-server source code.
+
+===========================================================================
+*/
+
+#include "../common/mpsc_queue.h"
+#include "../common/showmsg.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "dbworker.h"
+#include "entities/charentity.h"
+#include "map.h"
+
+namespace dbworker
+{
+    namespace
+    {
+        struct db_job_t
+        {
+            DBOP_TYPE    op;
+            CCharEntity* PChar;
+            uint32       charid;
+            bool         transaction;
+            bool         result;
+            work_t       work;
+            done_t       done;
+            time_point   queued;
+        };
+
+        const uint32 LATENCY_BOUNDS[] = { 1, 2, 5, 10, 25, 50, 100, 250, 500, 1000 };      // ms, last bucket is open
+        const uint8  LATENCY_BUCKETS = sizeof(LATENCY_BOUNDS) / sizeof(LATENCY_BOUNDS[0]) + 1;
+
+        const int8* OP_NAMES[MAX_DBOP] =
+        {
+            "delivery list", "delivery add", "delivery send", "delivery cancel", "delivery count",
+            "delivery receive", "delivery clear", "delivery return", "delivery take", "delivery drop",
+            "delivery confirm", "delivery restore", "ah history", "ah sell", "ah buy", "ah cancel"
+        };
+
+        std::mutex g_JobMutex;
+        std::condition_variable g_JobSignal;
+        std::deque<db_job_t*> g_Jobs;
+        std::thread g_Worker;
+        bool g_Stopping = false;
+
+        mpsc_queue<db_job_t*> g_Completed;
+
+        // owned by the main thread
+        std::unordered_set<uint32> g_InFlight;
+        std::unordered_multimap<uint32, idle_t> g_WhenIdle;     // by charid, run once its jobs are done
+        uint32 g_Latency[MAX_DBOP][LATENCY_BUCKETS] {};
+        uint32 g_LatencyMax[MAX_DBOP] {};
+
+        bool Execute(Sql_t* handle, db_job_t* job)
+        {
+            if (!job->transaction)
+            {
+                return job->work(handle);
+            }
+            bool isAutoCommitOn = Sql_GetAutoCommit(handle);
+            bool commit = false;
+
+            if (Sql_SetAutoCommit(handle, false) && Sql_TransactionStart(handle))
+            {
+                commit = job->work(handle) && Sql_TransactionCommit(handle);
+
+                if (!commit)
+                {
+                    Sql_TransactionRollback(handle);
+                }
+            }
+            Sql_SetAutoCommit(handle, isAutoCommitOn);
+            return commit;
+        }
+
+        void Run()
+        {
+            Sql_t* handle = Sql_Malloc();
+
+            if (Sql_Connect(handle, map_config.mysql_login,
+                map_config.mysql_password,
+                map_config.mysql_host,
+                map_config.mysql_port,
+                map_config.mysql_database) == SQL_ERROR)
+            {
+                ShowError("dbworker::Run: unable to connect to the database, delivery box and auction house will fail\n");
+                Sql_Free(handle);
+                handle = nullptr;
+            }
+
+            while (true)
+            {
+                db_job_t* job = nullptr;
+                {
+                    std::unique_lock<std::mutex> lk(g_JobMutex);
+
+                    // the connection is only ever used from here, so it is kept alive here as well
+                    if (!g_JobSignal.wait_for(lk, std::chrono::minutes(30), [] { return g_Stopping || !g_Jobs.empty(); }))
+                    {
+                        lk.unlock();
+
+                        if (handle != nullptr)
+                        {
+                            Sql_Ping(handle);
+                        }
+                        continue;
+                    }
+                    if (g_Jobs.empty())
+                    {
+                        break;
+                    }
+                    job = g_Jobs.front();
+                    g_Jobs.pop_front();
+                }
+                job->result = handle != nullptr && Execute(handle, job);
+                g_Completed.push(job);
+            }
+
+            if (handle != nullptr)
+            {
+                Sql_Free(handle);
+            }
+        }
+
+        void Record(DBOP_TYPE op, time_point queued)
+        {
+            uint32 ms = (uint32)std::chrono::duration_cast<std::chrono::milliseconds>(server_clock::now() - queued).count();
+            uint8 bucket = 0;
+
+            while (bucket < LATENCY_BUCKETS - 1 && ms >= LATENCY_BOUNDS[bucket])
+            {
+                bucket++;
+            }
+            g_Latency[op][bucket]++;
+
+            if (ms > g_LatencyMax[op])
+            {
+                g_LatencyMax[op] = ms;
+            }
+        }
+    }
+
+    void Initialize()
+    {
+        g_Worker = std::thread(Run);
+    }
+
+    void Free()
+    {
+        {
+            std::lock_guard<std::mutex> lk(g_JobMutex);
+            g_Stopping = true;
+        }
+        g_JobSignal.notify_one();
+
+        if (g_Worker.joinable())
+        {
+            g_Worker.join();
+        }
+        // nobody is left to receive the results
+        db_job_t* job = nullptr;
+
+        while (g_Completed.pop(job))
+        {
+            delete job;
+        }
+        g_InFlight.clear();
+        g_WhenIdle.clear();
+    }
+
+    bool IsBusy(CCharEntity* PChar)
+    {
+        return g_InFlight.find(PChar->id) != g_InFlight.end();
+    }
+
+    bool Submit(CCharEntity* PChar, DBOP_TYPE op, bool transaction, work_t work, done_t done)
+    {
+        // a char on its way out is reloaded elsewhere, its done step would run on a stale copy
+        if (PChar->status == STATUS_DISAPPEAR || PChar->status == STATUS_SHUTDOWN)
+        {
+            return false;
+        }
+        if (!g_InFlight.insert(PChar->id).second)
+        {
+            return false;
+        }
+        db_job_t* job = new db_job_t {op, PChar, PChar->id, transaction, false, std::move(work), std::move(done), server_clock::now()};
+        {
+            std::lock_guard<std::mutex> lk(g_JobMutex);
+            g_Jobs.push_back(job);
+        }
+        g_JobSignal.notify_one();
+        return true;
+    }
+
+    void HandleCompletions()
+    {
+        db_job_t* job = nullptr;
+
+        while (g_Completed.pop(job))
+        {
+            Record(job->op, job->queued);
+
+            // cleared first so the done step may queue a follow-up job
+            g_InFlight.erase(job->charid);
+
+            if (job->done)
+            {
+                job->done(job->PChar, job->result);
+            }
+            // a follow-up job queued by the done step is waited for as well
+            if (!IsBusy(job->PChar))
+            {
+                auto range = g_WhenIdle.equal_range(job->charid);
+                std::vector<idle_t> waiting;
+
+                for (auto it = range.first; it != range.second; ++it)
+                {
+                    waiting.push_back(std::move(it->second));
+                }
+                g_WhenIdle.erase(range.first, range.second);
+
+                for (auto& then : waiting)
+                {
+                    then(job->PChar);
+                }
+            }
+            delete job;
+        }
+    }
+
+    void WhenIdle(CCharEntity* PChar, idle_t then)
+    {
+        if (IsBusy(PChar))
+        {
+            g_WhenIdle.emplace(PChar->id, std::move(then));
+            return;
+        }
+        then(PChar);
+    }
+
+    void LogLatency()
+    {
+        for (uint8 op = 0; op < MAX_DBOP; ++op)
+        {
+            uint32 total = 0;
+            std::string buckets;
+
+            for (uint8 i = 0; i < LATENCY_BUCKETS; ++i)
+            {
+                int8 buf[32];
+                if (i < LATENCY_BUCKETS - 1)
+                {
+                    snprintf(buf, sizeof(buf), " <%ums:%u", LATENCY_BOUNDS[i], g_Latency[op][i]);
+                }
+                else
+                {
+                    snprintf(buf, sizeof(buf), " >=%ums:%u", LATENCY_BOUNDS[i - 1], g_Latency[op][i]);
+                }
+                buckets += buf;
+                total += g_Latency[op][i];
+            }
+            if (total != 0)
+            {
+                ShowDebug("dbworker: %s %u jobs, max %ums,%s\n", OP_NAMES[op], total, g_LatencyMax[op], buckets.c_str());
+            }
+        }
+    }
+};
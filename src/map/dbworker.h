@@ -0,0 +1,89 @@
+/*
+===========================================================================
+
+  Copyright (c) 2010-2015 Darkstar Dev Teams
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see http://www.gnu.org/licenses/
+
+  This file is part of DarkStar-server source code.
+
+===========================================================================
+*/
+
+#ifndef _DBWORKER_H
+#define _DBWORKER_H
+
+#include "../common/cbasetypes.h"
+#include "../common/sql.h"
+
+#include <functional>
+
+class CCharEntity;
+
+enum DBOP_TYPE
+{
+    DBOP_DELIVERY_LIST,
+    DBOP_DELIVERY_ADD,
+    DBOP_DELIVERY_SEND,
+    DBOP_DELIVERY_CANCEL,
+    DBOP_DELIVERY_COUNT,
+    DBOP_DELIVERY_RECEIVE,
+    DBOP_DELIVERY_CLEAR,
+    DBOP_DELIVERY_RETURN,
+    DBOP_DELIVERY_TAKE,
+    DBOP_DELIVERY_DROP,
+    DBOP_DELIVERY_CONFIRM,
+    DBOP_DELIVERY_RESTORE,
+    DBOP_AH_HISTORY,
+    DBOP_AH_SELL,
+    DBOP_AH_BUY,
+    DBOP_AH_CANCEL,
+
+    MAX_DBOP
+};
+
+/************************************************************************
+*                                                                       *
+*  Database jobs for the delivery box and the auction house. The work   *
+*  step runs on a dedicated thread with its own connection and may only *
+*  touch that connection and what it captured by value; the done step   *
+*  runs on the main thread and owns the character again.                *
+*                                                                       *
+*  A character has at most one job in flight, further clicks are        *
+*  refused until its done step has run. A character leaving the server  *
+*  gets no new jobs, and its session is not closed while one is still   *
+*  in flight, so a done step never runs after the character was         *
+*  reloaded somewhere else.                                             *
+*                                                                       *
+************************************************************************/
+
+namespace dbworker
+{
+    typedef std::function<bool(Sql_t*)> work_t;                 // false rolls the transaction back
+    typedef std::function<void(CCharEntity*, bool)> done_t;     // second argument is the work result
+    typedef std::function<void(CCharEntity*)> idle_t;
+
+    void Initialize();
+    void Free();
+
+    bool IsBusy(CCharEntity* PChar);
+    bool Submit(CCharEntity* PChar, DBOP_TYPE op, bool transaction, work_t work, done_t done);
+
+    void HandleCompletions();                                   // main loop
+    void WhenIdle(CCharEntity* PChar, idle_t then);             // runs now, or once the char's jobs are done
+
+    void LogLatency();
+};
+
+#endif
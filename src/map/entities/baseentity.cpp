@@ -27,6 +27,7 @@
 #include "../zone.h"
 #include "../ai/ai_container.h"
 #include "../instance.h"
+#include "../lua/lua_baseentity.h"
 
 CBaseEntity::CBaseEntity()
 {
@@ -37,6 +38,9 @@ CBaseEntity::CBaseEntity()
 	PBCNM = nullptr;
 	PInstance = nullptr;
 
+    PLuaState = nullptr;
+    LuaRef = 0;
+
 	speed    = 40 + map_config.speed_mod;
 	speedsub = 40 + map_config.speed_mod;
 
@@ -52,6 +56,7 @@ CBaseEntity::CBaseEntity()
 
 CBaseEntity::~CBaseEntity()
 {
+    CLuaBaseEntity::Release(this);
 }
 
 void CBaseEntity::Spawn()
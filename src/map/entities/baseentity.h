@@ -189,6 +189,9 @@ public:
     std::unique_ptr<CAIContainer> PAI;       // AI container
     CBattlefield*	PBCNM;              // pointer to bcnm (if in one)
     CInstance*		PInstance;
+
+    struct lua_State* PLuaState;        // state that holds the cached script wrapper (see CLuaBaseEntity::Push)
+    int32           LuaRef;             // registry reference to that wrapper
 protected:
     std::map<std::string, uint32> m_localVars;
 };
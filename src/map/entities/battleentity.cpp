@@ -499,65 +499,68 @@ int32 CBattleEntity::addMP(int32 mp)
 
 uint16 CBattleEntity::STR()
 {
-    return dsp_cap(stats.STR + m_modStat[MOD_STR], 0, 999);
+    return SnapshotStat(COMBATSTAT_STR, [&]() { return dsp_cap(stats.STR + m_modStat[MOD_STR], 0, 999); });
 }
 
 uint16 CBattleEntity::DEX()
 {
-    return dsp_cap(stats.DEX + m_modStat[MOD_DEX], 0, 999);
+    return SnapshotStat(COMBATSTAT_DEX, [&]() { return dsp_cap(stats.DEX + m_modStat[MOD_DEX], 0, 999); });
 }
 
 uint16 CBattleEntity::VIT()
 {
-    return dsp_cap(stats.VIT + m_modStat[MOD_VIT], 0, 999);
+    return SnapshotStat(COMBATSTAT_VIT, [&]() { return dsp_cap(stats.VIT + m_modStat[MOD_VIT], 0, 999); });
 }
 
 uint16 CBattleEntity::AGI()
 {
-    return dsp_cap(stats.AGI + m_modStat[MOD_AGI], 0, 999);
+    return SnapshotStat(COMBATSTAT_AGI, [&]() { return dsp_cap(stats.AGI + m_modStat[MOD_AGI], 0, 999); });
 }
 
 uint16 CBattleEntity::INT()
 {
-    return dsp_cap(stats.INT + m_modStat[MOD_INT], 0, 999);
+    return SnapshotStat(COMBATSTAT_INT, [&]() { return dsp_cap(stats.INT + m_modStat[MOD_INT], 0, 999); });
 }
 
 uint16 CBattleEntity::MND()
 {
-    return dsp_cap(stats.MND + m_modStat[MOD_MND], 0, 999);
+    return SnapshotStat(COMBATSTAT_MND, [&]() { return dsp_cap(stats.MND + m_modStat[MOD_MND], 0, 999); });
 }
 
 uint16 CBattleEntity::CHR()
 {
-    return dsp_cap(stats.CHR + m_modStat[MOD_CHR], 0, 999);
+    return SnapshotStat(COMBATSTAT_CHR, [&]() { return dsp_cap(stats.CHR + m_modStat[MOD_CHR], 0, 999); });
 }
 
 uint16 CBattleEntity::ATT()
 {
-    //TODO: consider which weapon!
-    int32 ATT = 8 + m_modStat[MOD_ATT];
-    if (m_Weapons[SLOT_MAIN]->isTwoHanded())
+    return SnapshotStat(COMBATSTAT_ATT, [&]() -> uint16
     {
-        ATT += (STR() * 3) / 4;
-    }
-    else {
-        ATT += (STR()) / 2;
-    }
+        //TODO: consider which weapon!
+        int32 ATT = 8 + m_modStat[MOD_ATT];
+        if (m_Weapons[SLOT_MAIN]->isTwoHanded())
+        {
+            ATT += (STR() * 3) / 4;
+        }
+        else {
+            ATT += (STR()) / 2;
+        }
 
-    if (this->StatusEffectContainer->HasStatusEffect(EFFECT_ENDARK))
-        ATT += this->getMod(MOD_ENSPELL_DMG);
+        if (this->StatusEffectContainer->HasStatusEffect(EFFECT_ENDARK))
+            ATT += this->getMod(MOD_ENSPELL_DMG);
 
-    if (this->objtype & TYPE_PC) {
-        ATT += GetSkill(m_Weapons[SLOT_MAIN]->getSkillType()) + m_Weapons[SLOT_MAIN]->getILvlSkill();
-    }
-    else if (this->objtype == TYPE_PET && ((CPetEntity*)this)->getPetType() == PETTYPE_AUTOMATON)
-    {
-        ATT += PMaster->GetSkill(SKILL_AME);
-        return ATT + (ATT * (m_modStat[MOD_ATTP] + ((CCharEntity*)PMaster)->PMeritPoints->GetMeritValue(MERIT_OPTIMIZATION, (CCharEntity*)PMaster)) / 100) +
+        if (this->objtype & TYPE_PC) {
+            ATT += GetSkill(m_Weapons[SLOT_MAIN]->getSkillType()) + m_Weapons[SLOT_MAIN]->getILvlSkill();
+        }
+        else if (this->objtype == TYPE_PET && ((CPetEntity*)this)->getPetType() == PETTYPE_AUTOMATON)
+        {
+            ATT += PMaster->GetSkill(SKILL_AME);
+            return ATT + (ATT * (m_modStat[MOD_ATTP] + ((CCharEntity*)PMaster)->PMeritPoints->GetMeritValue(MERIT_OPTIMIZATION, (CCharEntity*)PMaster)) / 100) +
+                dsp_min((ATT * m_modStat[MOD_FOOD_ATTP] / 100), m_modStat[MOD_FOOD_ATT_CAP]);
+        }
+        return ATT + (ATT * m_modStat[MOD_ATTP] / 100) +
             dsp_min((ATT * m_modStat[MOD_FOOD_ATTP] / 100), m_modStat[MOD_FOOD_ATT_CAP]);
-    }
-    return ATT + (ATT * m_modStat[MOD_ATTP] / 100) +
-        dsp_min((ATT * m_modStat[MOD_FOOD_ATTP] / 100), m_modStat[MOD_FOOD_ATT_CAP]);
+    });
 }
 
 uint16 CBattleEntity::RATT(uint8 skill, uint16 bonusSkill)
@@ -605,79 +608,126 @@ uint16 CBattleEntity::RACC(uint8 skill, uint16 bonusSkill)
 
 uint16 CBattleEntity::ACC(uint8 attackNumber, uint8 offsetAccuracy)
 {
-    if (this->objtype & TYPE_PC) {
-        uint8 skill = 0;
-        uint16 iLvlSkill = 0;
-        if (attackNumber == 0)
-        {
-            skill = m_Weapons[SLOT_MAIN]->getSkillType();
-            iLvlSkill = m_Weapons[SLOT_MAIN]->getILvlSkill();
-            if (skill == SKILL_NON && GetSkill(SKILL_H2H) > 0)
-                skill = SKILL_H2H;
-        }
-        else if (attackNumber == 1)
-        {
-            skill = m_Weapons[SLOT_SUB]->getSkillType();
-            iLvlSkill = m_Weapons[SLOT_SUB]->getILvlSkill();
-            if (skill == SKILL_NON && GetSkill(SKILL_H2H) > 0 &&
-                (m_Weapons[SLOT_MAIN]->getSkillType() == SKILL_NON || m_Weapons[SLOT_MAIN]->getSkillType() == SKILL_H2H))
+    auto compute = [&]() -> uint16
+    {
+        if (this->objtype & TYPE_PC) {
+            uint8 skill = 0;
+            uint16 iLvlSkill = 0;
+            if (attackNumber == 0)
+            {
+                skill = m_Weapons[SLOT_MAIN]->getSkillType();
+                iLvlSkill = m_Weapons[SLOT_MAIN]->getILvlSkill();
+                if (skill == SKILL_NON && GetSkill(SKILL_H2H) > 0)
+                    skill = SKILL_H2H;
+            }
+            else if (attackNumber == 1)
+            {
+                skill = m_Weapons[SLOT_SUB]->getSkillType();
+                iLvlSkill = m_Weapons[SLOT_SUB]->getILvlSkill();
+                if (skill == SKILL_NON && GetSkill(SKILL_H2H) > 0 &&
+                    (m_Weapons[SLOT_MAIN]->getSkillType() == SKILL_NON || m_Weapons[SLOT_MAIN]->getSkillType() == SKILL_H2H))
+                    skill = SKILL_H2H;
+            }
+            else if (attackNumber == 2)
+            {
+                iLvlSkill = m_Weapons[SLOT_MAIN]->getILvlSkill();
                 skill = SKILL_H2H;
+            }
+            int16 ACC = GetSkill(skill) + iLvlSkill;
+            ACC = (ACC > 200 ? (((ACC - 200)*0.9) + 200) : ACC);
+            if (m_Weapons[SLOT_MAIN]->isTwoHanded() == true)
+            {
+                ACC += DEX() * 0.75;
+            }
+            else
+            {
+                ACC += DEX() * 0.5;
+            }
+            ACC = (ACC + m_modStat[MOD_ACC] + offsetAccuracy);
+            ACC = ACC + dsp_min((ACC * m_modStat[MOD_FOOD_ACCP] / 100), m_modStat[MOD_FOOD_ACC_CAP]);
+            return dsp_max(0, ACC);
         }
-        else if (attackNumber == 2)
-        {
-            iLvlSkill = m_Weapons[SLOT_MAIN]->getILvlSkill();
-            skill = SKILL_H2H;
-        }
-        int16 ACC = GetSkill(skill) + iLvlSkill;
-        ACC = (ACC > 200 ? (((ACC - 200)*0.9) + 200) : ACC);
-        if (m_Weapons[SLOT_MAIN]->isTwoHanded() == true)
+        else if (this->objtype == TYPE_PET && ((CPetEntity*)this)->getPetType() == PETTYPE_AUTOMATON)
         {
-            ACC += DEX() * 0.75;
+            int16 ACC = PMaster->GetSkill(SKILL_AME);
+            ACC = (ACC > 200 ? (((ACC - 200)*0.9) + 200) : ACC);
+            ACC += DEX() * 0.5;
+            ACC += m_modStat[MOD_ACC] + offsetAccuracy + ((CCharEntity*)PMaster)->PMeritPoints->GetMeritValue(MERIT_FINE_TUNING, (CCharEntity*)PMaster);
+            ACC = ACC + dsp_min((ACC * m_modStat[MOD_FOOD_ACCP] / 100), m_modStat[MOD_FOOD_ACC_CAP]);
+            return dsp_max(0, ACC);
         }
         else
         {
-            ACC += DEX() * 0.5;
+            int16 ACC = m_modStat[MOD_ACC];
+            ACC = ACC + dsp_min((ACC * m_modStat[MOD_FOOD_ACCP] / 100), m_modStat[MOD_FOOD_ACC_CAP]) + DEX() / 2; //food mods here for Snatch Morsel
+            return dsp_max(0, ACC);
         }
-        ACC = (ACC + m_modStat[MOD_ACC] + offsetAccuracy);
-        ACC = ACC + dsp_min((ACC * m_modStat[MOD_FOOD_ACCP] / 100), m_modStat[MOD_FOOD_ACC_CAP]);
-        return dsp_max(0, ACC);
-    }
-    else if (this->objtype == TYPE_PET && ((CPetEntity*)this)->getPetType() == PETTYPE_AUTOMATON)
-    {
-        int16 ACC = PMaster->GetSkill(SKILL_AME);
-        ACC = (ACC > 200 ? (((ACC - 200)*0.9) + 200) : ACC);
-        ACC += DEX() * 0.5;
-        ACC += m_modStat[MOD_ACC] + offsetAccuracy + ((CCharEntity*)PMaster)->PMeritPoints->GetMeritValue(MERIT_FINE_TUNING, (CCharEntity*)PMaster);
-        ACC = ACC + dsp_min((ACC * m_modStat[MOD_FOOD_ACCP] / 100), m_modStat[MOD_FOOD_ACC_CAP]);
-        return dsp_max(0, ACC);
-    }
-    else
+    };
+
+    // only the plain swing accuracies are kept, zanshin's bonus accuracy is rare
+    if (offsetAccuracy == 0 && attackNumber <= 2)
     {
-        int16 ACC = m_modStat[MOD_ACC];
-        ACC = ACC + dsp_min((ACC * m_modStat[MOD_FOOD_ACCP] / 100), m_modStat[MOD_FOOD_ACC_CAP]) + DEX() / 2; //food mods here for Snatch Morsel
-        return dsp_max(0, ACC);
+        return SnapshotStat((COMBATSTAT)(COMBATSTAT_ACC_MAIN + attackNumber), compute);
     }
+    return compute();
 }
 
 uint16 CBattleEntity::DEF()
 {
-    if (this->StatusEffectContainer->HasStatusEffect(EFFECT_COUNTERSTANCE, 0)) {
-        return VIT() / 2 + 1;
-    }
-    int32 DEF = 8 + m_modStat[MOD_DEF] + VIT() / 2;
+    return SnapshotStat(COMBATSTAT_DEF, [&]() -> uint16
+    {
+        if (this->StatusEffectContainer->HasStatusEffect(EFFECT_COUNTERSTANCE, 0)) {
+            return VIT() / 2 + 1;
+        }
+        int32 DEF = 8 + m_modStat[MOD_DEF] + VIT() / 2;
 
-    return DEF + (DEF * m_modStat[MOD_DEFP] / 100) +
-        dsp_min((DEF * m_modStat[MOD_FOOD_DEFP] / 100), m_modStat[MOD_FOOD_DEF_CAP]);
+        return DEF + (DEF * m_modStat[MOD_DEFP] / 100) +
+            dsp_min((DEF * m_modStat[MOD_FOOD_DEFP] / 100), m_modStat[MOD_FOOD_DEF_CAP]);
+    });
 }
 
 uint16 CBattleEntity::EVA()
 {
-    int16 evasion = GetSkill(SKILL_EVA);
+    return SnapshotStat(COMBATSTAT_EVA, [&]() -> uint16
+    {
+        int16 evasion = GetSkill(SKILL_EVA);
+
+        if (evasion > 200) { //Evasion skill is 0.9 evasion post-200
+            evasion = 200 + (evasion - 200)*0.9;
+        }
+        return dsp_max(0, (m_modStat[MOD_EVA] + evasion + AGI() / 2));
+    });
+}
 
-    if (evasion > 200) { //Evasion skill is 0.9 evasion post-200
-        evasion = 200 + (evasion - 200)*0.9;
+/************************************************************************
+*                                                                       *
+*  While a snapshot is open (for the length of an attack round) the     *
+*  derived stats are computed once and reused by every swing. Anything  *
+*  that changes their inputs invalidates the cached values.             *
+*                                                                       *
+************************************************************************/
+
+void CBattleEntity::OpenStatSnapshot()
+{
+    if (m_statSnapshotDepth++ == 0)
+    {
+        m_statSnapshotValid = 0;
     }
-    return dsp_max(0, (m_modStat[MOD_EVA] + evasion + AGI() / 2));
+}
+
+void CBattleEntity::CloseStatSnapshot()
+{
+    DSP_DEBUG_BREAK_IF(m_statSnapshotDepth == 0);
+
+    if (--m_statSnapshotDepth == 0)
+    {
+        m_statSnapshotValid = 0;
+    }
+}
+
+void CBattleEntity::InvalidateStatSnapshot()
+{
+    m_statSnapshotValid = 0;
 }
 
 /************************************************************************
@@ -725,6 +775,7 @@ void CBattleEntity::SetMLevel(uint8 mlvl)
     m_modStat[MOD_DEF] -= m_mlvl + dsp_cap(m_mlvl - 50, 0, 10);
     m_mlvl = (mlvl == 0 ? 1 : mlvl);
     m_modStat[MOD_DEF] += m_mlvl + dsp_cap(m_mlvl - 50, 0, 10);
+    InvalidateStatSnapshot();
 
     if (this->objtype & TYPE_PC)
         Sql_Query(SqlHandle, "UPDATE char_stats SET mlvl = %u WHERE charid = %u LIMIT 1;", m_mlvl, this->id);
@@ -746,6 +797,7 @@ void CBattleEntity::SetSLevel(uint8 slvl)
 
 void CBattleEntity::addModifier(uint16 type, int16 amount)
 {
+    InvalidateStatSnapshot();
     m_modStat[type] += amount;
 }
 
@@ -757,14 +809,16 @@ void CBattleEntity::addModifier(uint16 type, int16 amount)
 
 void CBattleEntity::addModifiers(std::vector<CModifier*> *modList)
 {
+    InvalidateStatSnapshot();
     for (auto modifier : *modList)
     {
         m_modStat[modifier->getModID()] += modifier->getModAmount();
     }
 }
 
-void CBattleEntity::addEquipModifiers(std::vector<CModifier*> *modList, uint8 itemLevel, uint8 slotid)
+void CBattleEntity::addEquipModifiers(const std::vector<CModifier*> *modList, uint8 itemLevel, uint8 slotid)
 {
+    InvalidateStatSnapshot();
     if (GetMLevel() >= itemLevel)
     {
         for (uint16 i = 0; i < modList->size(); ++i)
@@ -851,6 +905,7 @@ void CBattleEntity::addEquipModifiers(std::vector<CModifier*> *modList, uint8 it
 
 void CBattleEntity::setModifier(uint16 type, int16 amount)
 {
+    InvalidateStatSnapshot();
     m_modStat[type] = amount;
 }
 
@@ -862,6 +917,7 @@ void CBattleEntity::setModifier(uint16 type, int16 amount)
 
 void CBattleEntity::setModifiers(std::vector<CModifier*> *modList)
 {
+    InvalidateStatSnapshot();
     for (uint16 i = 0; i < modList->size(); ++i)
     {
         m_modStat[modList->at(i)->getModID()] = modList->at(i)->getModAmount();
@@ -876,6 +932,7 @@ void CBattleEntity::setModifiers(std::vector<CModifier*> *modList)
 
 void CBattleEntity::delModifier(uint16 type, int16 amount)
 {
+    InvalidateStatSnapshot();
     m_modStat[type] -= amount;
 }
 
@@ -886,6 +943,7 @@ void CBattleEntity::saveModifiers()
 
 void CBattleEntity::restoreModifiers()
 {
+    InvalidateStatSnapshot();
     m_modStat = m_modStatSave;
 }
 
@@ -897,14 +955,16 @@ void CBattleEntity::restoreModifiers()
 
 void CBattleEntity::delModifiers(std::vector<CModifier*> *modList)
 {
+    InvalidateStatSnapshot();
     for (uint16 i = 0; i < modList->size(); ++i)
     {
         m_modStat[modList->at(i)->getModID()] -= modList->at(i)->getModAmount();
     }
 }
 
-void CBattleEntity::delEquipModifiers(std::vector<CModifier*> *modList, uint8 itemLevel, uint8 slotid)
+void CBattleEntity::delEquipModifiers(const std::vector<CModifier*> *modList, uint8 itemLevel, uint8 slotid)
 {
+    InvalidateStatSnapshot();
     if (GetMLevel() >= itemLevel)
     {
         for (uint16 i = 0; i < modList->size(); ++i)
@@ -1024,7 +1084,7 @@ void CBattleEntity::delPetModifier(uint16 type, int16 amount)
     }
 }
 
-void CBattleEntity::addPetModifiers(std::vector<CModifier*> *modList)
+void CBattleEntity::addPetModifiers(const std::vector<CModifier*> *modList)
 {
     for (auto modifier : *modList)
     {
@@ -1032,7 +1092,7 @@ void CBattleEntity::addPetModifiers(std::vector<CModifier*> *modList)
     }
 }
 
-void CBattleEntity::delPetModifiers(std::vector<CModifier*> *modList)
+void CBattleEntity::delPetModifiers(const std::vector<CModifier*> *modList)
 {
     for (auto modifier : *modList)
     {
@@ -1596,6 +1656,11 @@ void CBattleEntity::SetBattleStartTime(time_point time)
     m_battleStartTime = time;
 }
 
+time_point CBattleEntity::GetBattleStartTime()
+{
+    return m_battleStartTime;
+}
+
 duration CBattleEntity::GetBattleTime()
 {
     return server_clock::now() - m_battleStartTime;
@@ -446,6 +446,25 @@ class CWeaponSkillState;
 class CMagicState;
 struct action_t;
 
+// derived stats kept while a combat stat snapshot is open
+enum COMBATSTAT
+{
+    COMBATSTAT_STR,
+    COMBATSTAT_DEX,
+    COMBATSTAT_VIT,
+    COMBATSTAT_AGI,
+    COMBATSTAT_INT,
+    COMBATSTAT_MND,
+    COMBATSTAT_CHR,
+    COMBATSTAT_DEF,
+    COMBATSTAT_ATT,
+    COMBATSTAT_EVA,
+    COMBATSTAT_ACC_MAIN,
+    COMBATSTAT_ACC_SUB,
+    COMBATSTAT_ACC_KICK,
+    COMBATSTAT_COUNT
+};
+
 class CBattleEntity : public CBaseEntity
 {
 public:
@@ -466,6 +485,10 @@ public:
     uint16          RATT(uint8 skill, uint16 bonusSkill = 0);
     uint16          RACC(uint8 skill, uint16 bonusSkill = 0);
 
+    void            OpenStatSnapshot();         // derived stats above are computed once and reused until closed
+    void            CloseStatSnapshot();
+    void            InvalidateStatSnapshot();   // an input of the derived stats changed (modifiers, effects, skills)
+
     uint8           GetSpeed();
 
     bool		    isDead();					// проверяем, мертва ли сущность
@@ -515,18 +538,18 @@ public:
     void		    setModifier(uint16 type, int16 amount);
     void		    delModifier(uint16 type, int16 amount);
     void		    addModifiers(std::vector<CModifier*> *modList);
-    void            addEquipModifiers(std::vector<CModifier*> *modList, uint8 itemLevel, uint8 slotid);
+    void            addEquipModifiers(const std::vector<CModifier*> *modList, uint8 itemLevel, uint8 slotid);
     void		    setModifiers(std::vector<CModifier*> *modList);
     void		    delModifiers(std::vector<CModifier*> *modList);
-    void            delEquipModifiers(std::vector<CModifier*> *modList, uint8 itemLevel, uint8 slotid);
+    void            delEquipModifiers(const std::vector<CModifier*> *modList, uint8 itemLevel, uint8 slotid);
     void 		    saveModifiers(); // save current state of modifiers
     void 		    restoreModifiers(); // restore to saved state
 
     void            addPetModifier(uint16 type, int16 amount);
     void            setPetModifier(uint16 type, int16 amount);
     void            delPetModifier(uint16 type, int16 amount);
-    void            addPetModifiers(std::vector<CModifier*> *modList);
-    void            delPetModifiers(std::vector<CModifier*> *modList);
+    void            addPetModifiers(const std::vector<CModifier*> *modList);
+    void            delPetModifiers(const std::vector<CModifier*> *modList);
     void            applyPetModifiers(CPetEntity* PPet);
     void            removePetModifiers(CPetEntity* PPet);
 
@@ -598,6 +621,7 @@ public:
     virtual void TryHitInterrupt(CBattleEntity* PAttacker);
 
     void SetBattleStartTime(time_point);
+    time_point GetBattleStartTime();
     duration GetBattleTime();
 
     virtual void Tick(time_point) override;
@@ -643,6 +667,27 @@ private:
     std::unordered_map<uint16, int16>		m_modStat;	// массив модификаторов
     std::unordered_map<uint16, int16>		m_modStatSave;	// saved state
     std::unordered_map<uint16, int16>       m_petMod;
+
+    uint8       m_statSnapshotDepth {0};                // open snapshots (attack rounds) involving this entity
+    uint16      m_statSnapshotValid {0};                // bit per COMBATSTAT holding a cached value
+    uint16      m_statSnapshot[COMBATSTAT_COUNT];
+
+    template<typename F>
+    uint16 SnapshotStat(COMBATSTAT stat, F compute)
+    {
+        if (m_statSnapshotValid & (1 << stat))
+        {
+            return m_statSnapshot[stat];
+        }
+        uint16 value = compute();
+
+        if (m_statSnapshotDepth > 0)
+        {
+            m_statSnapshot[stat] = value;
+            m_statSnapshotValid |= (1 << stat);
+        }
+        return value;
+    }
 };
 
 #endif
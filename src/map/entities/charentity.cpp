@@ -26,6 +26,7 @@
 #include "../../common/utils.h"
 
 #include <string.h>
+#include <algorithm>
 
 #include "../packets/action.h"
 #include "../packets/basic.h"
@@ -109,6 +110,7 @@ CCharEntity::CCharEntity()
     memset(&equip, 0, sizeof(equip));
     memset(&equipLoc, 0, sizeof(equipLoc));
     memset(&RealSkills, 0, sizeof(RealSkills));
+    memset(&m_rosterEntry, 0, sizeof(m_rosterEntry));
     memset(&nationtp, 0, sizeof(nationtp));
     memset(&expChain, 0, sizeof(expChain));
     memset(&nameflags, 0, sizeof(nameflags));
@@ -187,6 +189,7 @@ CCharEntity::CCharEntity()
     m_PlayTime = 0;
     m_SaveTime = 0;
     m_reloadParty = 0;
+    m_SupersededPackets = 0;
 
     m_LastYell = 0;
     m_moghouseID = 0;
@@ -241,9 +244,112 @@ void CCharEntity::clearPacketList()
     }
 }
 
+/************************************************************************
+*                                                                       *
+*  Entity (0x00E) and char (0x00D) update packets for the same target   *
+*  are coalesced while they wait in the queue: the queued packet keeps  *
+*  its place and takes the newest contents, plus any field blocks only  *
+*  it carried, with the update masks merged.                            *
+*                                                                       *
+************************************************************************/
+
+namespace
+{
+    struct UpdateBlock_t
+    {
+        uint8 mask;
+        uint8 begin;
+        uint8 end;
+    };
+
+    const UpdateBlock_t EntityUpdateBlocks[] =
+    {
+        { UPDATE_POS,    0x0B, 0x1E },
+        { UPDATE_HP,     0x1E, 0x20 },
+        { UPDATE_HP,     0x21, 0x2C },
+        { UPDATE_STATUS, 0x2C, 0x30 },
+        { UPDATE_NAME,   0x34, 0x48 },
+    };
+
+    const UpdateBlock_t CharUpdateBlocks[] =
+    {
+        { UPDATE_POS,    0x0B, 0x1E },
+        { UPDATE_HP,     0x1E, 0x38 },
+        { UPDATE_LOOK,   0x48, 0x5A },
+        { UPDATE_NAME,   0x5A, 0x74 },
+    };
+
+    const uint8 UPDATE_DESPAWN = 0x20;
+
+    bool isCoalescable(CBasicPacket* packet)
+    {
+        return (packet->id() == 0x0D || packet->id() == 0x0E) && !(packet->ref<uint8>(0x0A) & UPDATE_DESPAWN);
+    }
+
+    uint64 getUpdateKey(CBasicPacket* packet)
+    {
+        return ((uint64)packet->id() << 32) | packet->ref<uint32>(0x04);
+    }
+
+    void mergeUpdate(CBasicPacket* newer, CBasicPacket* older)
+    {
+        uint8 newMask = newer->ref<uint8>(0x0A);
+        uint8 oldMask = older->ref<uint8>(0x0A);
+
+        const UpdateBlock_t* blocks = EntityUpdateBlocks;
+        size_t count = sizeof(EntityUpdateBlocks) / sizeof(UpdateBlock_t);
+
+        if (newer->id() == 0x0D)
+        {
+            blocks = CharUpdateBlocks;
+            count = sizeof(CharUpdateBlocks) / sizeof(UpdateBlock_t);
+        }
+        for (size_t i = 0; i < count; ++i)
+        {
+            if ((oldMask & blocks[i].mask) && !(newMask & blocks[i].mask))
+            {
+                memcpy(*newer + blocks[i].begin, *older + blocks[i].begin, blocks[i].end - blocks[i].begin);
+            }
+        }
+        newer->ref<uint8>(0x0A) = newMask | oldMask;
+
+        if (older->length() > newer->length())
+        {
+            newer->length(older->length());
+        }
+    }
+}
+
 void CCharEntity::pushPacket(CBasicPacket* packet)
 {
-    std::lock_guard<std::mutex> lk(m_PacketListMutex);
+    if (packet->id() == 0x0D || packet->id() == 0x0E)
+    {
+        uint64 key = getUpdateKey(packet);
+        auto pending = m_PendingUpdates.find(key);
+
+        if (!isCoalescable(packet))
+        {
+            // despawn closes the chain, later updates must not be merged in front of it
+            if (pending != m_PendingUpdates.end())
+            {
+                m_PendingUpdates.erase(pending);
+            }
+        }
+        else if (pending != m_PendingUpdates.end())
+        {
+            // still queued, popPacket drops the entry once it is sent
+            mergeUpdate(packet, pending->second);
+            memcpy(*pending->second, *packet, PACKET_SIZE);
+            delete packet;
+
+            m_SupersededPackets++;
+            return;
+        }
+        else
+        {
+            m_PendingUpdates[key] = packet;
+        }
+    }
     PacketList.push_back(packet);
 }
 
@@ -254,24 +360,38 @@ void CCharEntity::pushPacket(std::unique_ptr<CBasicPacket> packet)
 
 CBasicPacket* CCharEntity::popPacket()
 {
-    std::lock_guard<std::mutex> lk(m_PacketListMutex);
     CBasicPacket* PPacket = PacketList.front();
     PacketList.pop_front();
+
+    if (PPacket->id() == 0x0D || PPacket->id() == 0x0E)
+    {
+        auto pending = m_PendingUpdates.find(getUpdateKey(PPacket));
+
+        if (pending != m_PendingUpdates.end() && pending->second == PPacket)
+        {
+            m_PendingUpdates.erase(pending);
+        }
+    }
     return PPacket;
 }
 
-PacketList_t CCharEntity::getPacketList()
+size_t CCharEntity::peekPackets(CBasicPacket** out, size_t max)
 {
-    std::lock_guard<std::mutex> lk(m_PacketListMutex);
-    return PacketList;
+    size_t count = std::min(max, PacketList.size());
+    std::copy_n(PacketList.begin(), count, out);
+    return count;
 }
 
 size_t CCharEntity::getPacketCount()
 {
-    std::lock_guard<std::mutex> lk(m_PacketListMutex);
     return PacketList.size();
 }
 
+uint32 CCharEntity::getSupersededPacketCount()
+{
+    return m_SupersededPackets;
+}
+
 void CCharEntity::erasePackets(uint8 num)
 {
     for (auto i = 0; i < num; i++)
@@ -29,7 +29,6 @@ This file is part of DarkStar-server source code.
 
 #include <map>
 #include <deque>
-#include <mutex>
 #include <bitset>
 
 #include "battleentity.h"
@@ -172,6 +171,7 @@ class CItemState;
 class CItemUsable;
 
 typedef std::deque<CBasicPacket*> PacketList_t;
+typedef std::map<uint64, CBasicPacket*> PendingUpdateList_t;
 typedef std::map<uint32, CBaseEntity*> SpawnIDList_t;
 typedef std::vector<EntityID_t> BazaarList_t;
 
@@ -235,13 +235,15 @@ public:
     void              pushPacket(std::unique_ptr<CBasicPacket>);    // push packet to packet list
     bool			  isPacketListEmpty();          // проверка размера PacketList
     CBasicPacket*	  popPacket();                  // получение первого пакета из PacketList
-    PacketList_t      getPacketList();              // returns a COPY of packet list
+    size_t            peekPackets(CBasicPacket** out, size_t max); // copies up to max packets from the front of the list into out
     size_t            getPacketCount();
     void              erasePackets(uint8 num);      // erase num elements from front of packet list
+    uint32            getSupersededPacketCount();   // number of queued entity/char updates merged into a newer one
     virtual void      HandleErrorMessage(std::unique_ptr<CMessageBasicPacket>&) override;
 
     CLinkshell*       PLinkshell1;                  // linkshell, в которой общается персонаж
     CLinkshell*       PLinkshell2;                  // linkshell 2
+    roster_entry_t    m_rosterEntry;                // what the search server was last told about this char
     CTreasurePool*	  PTreasurePool;                // сокровища, добытые с монстров
     CMeritPoints*     PMeritPoints;                 //
     bool			  MeritMode;					//If true then player is meriting
@@ -377,8 +379,8 @@ private:
     bool			m_reloadParty;
 
     PacketList_t      PacketList;					// в этом списке хранятся все пакеты, предназначенные для отправки персонажу
-
-    std::mutex      m_PacketListMutex;
+    PendingUpdateList_t m_PendingUpdates;           // queued 0x00D/0x00E packets by (type, target id), for coalescing
+    uint32            m_SupersededPackets;          // updates dropped because a newer one for the same target was queued
 };
 
 #endif
@@ -32,75 +32,176 @@ This file is part of DarkStar-server source code.
 #include "entities/npcentity.h"
 #include "lua/luautils.h"
 #include "items/item_weapon.h"
+#include "utils/instanceutils.h"
 #include "utils/mobutils.h"
 #include "mob_spell_list.h"
 
+namespace
+{
+    /************************************************************************
+    *                                                                       *
+    *  Prefab rows keep the raw column text, these read it back the same   *
+    *  way the Sql_Get*Data functions do                                    *
+    *                                                                       *
+    ************************************************************************/
+
+    int32 RowInt(const InstancePrefabRow_t& row, size_t col)
+    {
+        return (int32)atoi(row[col].c_str());
+    }
+
+    uint32 RowUInt(const InstancePrefabRow_t& row, size_t col)
+    {
+        return (uint32)strtoul(row[col].c_str(), nullptr, 10);
+    }
+
+    float RowFloat(const InstancePrefabRow_t& row, size_t col)
+    {
+        return (float)atof(row[col].c_str());
+    }
+
+    const int8* RowData(const InstancePrefabRow_t& row, size_t col)
+    {
+        return row[col].c_str();
+    }
+
+    void RowCopy(const InstancePrefabRow_t& row, size_t col, void* dest, size_t size)
+    {
+        memcpy(dest, row[col].data(), dsp_min(row[col].size(), size));
+    }
+
+    void ReadRows(Sql_t* handle, std::vector<InstancePrefabRow_t>& rows)
+    {
+        while (Sql_NextRow(handle) == SQL_SUCCESS)
+        {
+            InstancePrefabRow_t row(Sql_NumColumns(handle));
+
+            for (size_t col = 0; col < row.size(); ++col)
+            {
+                char*  data = nullptr;
+                size_t length = 0;
+                Sql_GetData(handle, col, &data, &length);
+
+                if (data != nullptr)
+                {
+                    row[col].assign(data, length);
+                }
+            }
+            rows.push_back(std::move(row));
+        }
+    }
+}
+
 CInstanceLoader::CInstanceLoader(uint8 instanceid, CZone* PZone, CCharEntity* PRequester)
 {
     DSP_DEBUG_BREAK_IF(PZone->GetType() != ZONETYPE_DUNGEON_INSTANCED);
 
 	requester = PRequester;
     zone = PZone;
-    CInstance* instance = ((CZoneInstance*)PZone)->CreateInstance(instanceid);
-
-	SqlInstanceHandle = Sql_Malloc();
-
-	if (Sql_Connect(SqlInstanceHandle, map_config.mysql_login,
-		map_config.mysql_password,
-		map_config.mysql_host,
-		map_config.mysql_port,
-		map_config.mysql_database) == SQL_ERROR)
-	{
-		do_final(EXIT_FAILURE);
-	}
-	Sql_Keepalive(SqlInstanceHandle);
-
-	task = std::async(std::launch::async, &CInstanceLoader::LoadInstance, this, instance);
+    start = server_clock::now();
+    instance = ((CZoneInstance*)PZone)->CreateInstance(instanceid);
+    SqlInstanceHandle = nullptr;
+    prefab = instanceutils::GetPrefab(PZone->GetID(), instanceid);
+    cached = prefab != nullptr;
 }
 
 CInstanceLoader::~CInstanceLoader()
 {
-	Sql_Free(SqlInstanceHandle);
+    if (task.valid())
+    {
+        // the connection is only lent out together with a task
+        delete task.get();
+        instanceutils::ReleaseLoaderConnection(SqlInstanceHandle);
+    }
+}
+
+CInstance* CInstanceLoader::GetInstance()
+{
+    return instance;
 }
 
 bool CInstanceLoader::Check()
 {
-	if (task.valid())
-	{
-		if (task.wait_for(std::chrono::milliseconds(0)) == std::future_status::ready)
-		{
-			CInstance* instance = task.get();
-			if (!instance)
-			{
-				//Instance failed to load
-				luautils::OnInstanceCreated(requester, nullptr);
-			}
-			else
-			{
-                // finish loading by launching remaining setup scripts
-                for (auto PMob : instance->m_mobList)
-                {
-                    luautils::OnMobInitialize(PMob.second);
-                    luautils::ApplyMixins(PMob.second);
-                    ((CMobEntity*)PMob.second)->saveModifiers();
-                    ((CMobEntity*)PMob.second)->saveMobModifiers();
-                }
-                for (auto PNpc : instance->m_npcList)
-                {
-                    luautils::OnNpcSpawn(PNpc.second);
-                }
-				luautils::OnInstanceCreated(requester, instance);
-				luautils::OnInstanceCreated(instance);
-			}
-			return true;
-		}
-	}
-	return false;
+    if (prefab == nullptr && !task.valid())
+    {
+        // another loader may have read this instance id in the meantime
+        prefab = instanceutils::GetPrefab(zone->GetID(), instance->GetID());
+
+        if (prefab == nullptr)
+        {
+            // only the first instance of an id goes to the database, later ones are built from its prefab
+            LOADER_CONNECTION status = instanceutils::AcquireLoaderConnection(&SqlInstanceHandle);
+
+            if (status == LOADER_CONNECTION_BUSY)
+            {
+                return false;
+            }
+            if (status == LOADER_CONNECTION_OK)
+            {
+                task = std::async(std::launch::async, &CInstanceLoader::LoadPrefab, this, instance->GetID(), zone->GetID());
+                return false;
+            }
+            instance->Cancel();
+        }
+    }
+    if (prefab == nullptr && task.valid())
+    {
+        if (task.wait_for(std::chrono::milliseconds(0)) != std::future_status::ready)
+        {
+            return false;
+        }
+        InstancePrefab_t* loaded = task.get();
+
+        instanceutils::ReleaseLoaderConnection(SqlInstanceHandle);
+        SqlInstanceHandle = nullptr;
+
+        if (loaded != nullptr)
+        {
+            prefab = instanceutils::AddPrefab(zone->GetID(), instance->GetID(), loaded);
+        }
+        else
+        {
+            instance->Cancel();
+        }
+    }
+
+    if (prefab == nullptr || instance->Failed())
+    {
+        //Instance failed to load
+        luautils::OnInstanceCreated(requester, nullptr);
+        return true;
+    }
+
+    Instantiate();
+
+    // finish loading by launching remaining setup scripts
+    for (auto PMob : instance->m_mobList)
+    {
+        luautils::OnMobInitialize(PMob.second);
+        luautils::ApplyMixins(PMob.second);
+        ((CMobEntity*)PMob.second)->saveModifiers();
+        ((CMobEntity*)PMob.second)->saveMobModifiers();
+    }
+    for (auto PNpc : instance->m_npcList)
+    {
+        luautils::OnNpcSpawn(PNpc.second);
+    }
+    luautils::OnInstanceCreated(requester, instance);
+    luautils::OnInstanceCreated(instance);
+
+    instanceutils::ReportLoadTime(zone->GetID(), instance->GetID(), server_clock::now() - start, cached);
+    return true;
 }
 
-CInstance* CInstanceLoader::LoadInstance(CInstance* instance)
+/************************************************************************
+*                                                                       *
+*  Reads the mob and npc rows of an instance id (loader thread)         *
+*                                                                       *
+************************************************************************/
+
+InstancePrefab_t* CInstanceLoader::LoadPrefab(uint8 instanceid, uint16 zoneid)
 {
-	int8* Query =
+	const int8* Query =
 		"SELECT mobname, mobid, pos_rot, pos_x, pos_y, pos_z, \
 		respawntime, spawntype, dropid, mob_groups.HP, mob_groups.MP, minLevel, maxLevel, \
 		modelid, mJob, sJob, cmbSkill, cmbDmgMult, cmbDelay, behavior, links, mobType, immunity, \
@@ -117,170 +218,193 @@ CInstance* CInstanceLoader::LoadInstance(CInstance* instance)
 		INNER JOIN mob_family_system ON mob_pools.familyid = mob_family_system.familyid \
 		WHERE instanceid = %u AND NOT (pos_x = 0 AND pos_y = 0 AND pos_z = 0);";
 
-	int32 ret = Sql_Query(SqlInstanceHandle, Query, instance->GetID());
-
-	if (!instance->Failed() && ret != SQL_ERROR && Sql_NumRows(SqlInstanceHandle) != 0)
+	// a pooled connection may have timed out while idle, it is replaced from this thread
+	if (Sql_Ping(SqlInstanceHandle) == SQL_ERROR)
 	{
-		while (Sql_NextRow(SqlInstanceHandle) == SQL_SUCCESS)
+		Sql_Free(SqlInstanceHandle);
+		SqlInstanceHandle = instanceutils::ConnectLoader();
+
+		if (SqlInstanceHandle == nullptr)
 		{
-			CMobEntity* PMob = new CMobEntity;
-
-			PMob->name.insert(0, Sql_GetData(SqlInstanceHandle, 0));
-			PMob->id = (uint32)Sql_GetUIntData(SqlInstanceHandle, 1);
-			PMob->targid = (uint16)PMob->id & 0x0FFF;
-
-			PMob->m_SpawnPoint.rotation = (uint8)Sql_GetIntData(SqlInstanceHandle, 2);
-			PMob->m_SpawnPoint.x = Sql_GetFloatData(SqlInstanceHandle, 3);
-			PMob->m_SpawnPoint.y = Sql_GetFloatData(SqlInstanceHandle, 4);
-			PMob->m_SpawnPoint.z = Sql_GetFloatData(SqlInstanceHandle, 5);
-
-			PMob->m_RespawnTime = Sql_GetUIntData(SqlInstanceHandle, 6) * 1000;
-			PMob->m_SpawnType = (SPAWNTYPE)Sql_GetUIntData(SqlInstanceHandle, 7);
-			PMob->m_DropID = Sql_GetUIntData(SqlInstanceHandle, 8);
-
-			PMob->HPmodifier = (uint32)Sql_GetIntData(SqlInstanceHandle, 9);
-			PMob->MPmodifier = (uint32)Sql_GetIntData(SqlInstanceHandle, 10);
-
-			PMob->m_minLevel = (uint8)Sql_GetIntData(SqlInstanceHandle, 11);
-			PMob->m_maxLevel = (uint8)Sql_GetIntData(SqlInstanceHandle, 12);
-
-			memcpy(&PMob->look, Sql_GetData(SqlInstanceHandle, 13), 23);
-
-			PMob->SetMJob(Sql_GetIntData(SqlInstanceHandle, 14));
-			PMob->SetSJob(Sql_GetIntData(SqlInstanceHandle, 15));
-
-			PMob->m_Weapons[SLOT_MAIN]->setMaxHit(1);
-			PMob->m_Weapons[SLOT_MAIN]->setSkillType(Sql_GetIntData(SqlInstanceHandle, 16));
-			PMob->m_dmgMult = Sql_GetUIntData(SqlInstanceHandle, 17);
-			PMob->m_Weapons[SLOT_MAIN]->setDelay((Sql_GetIntData(SqlInstanceHandle, 18) * 1000) / 60);
-			PMob->m_Weapons[SLOT_MAIN]->setBaseDelay((Sql_GetIntData(SqlInstanceHandle, 18) * 1000) / 60);
-
-			PMob->m_Behaviour = (uint16)Sql_GetIntData(SqlInstanceHandle, 19);
-			PMob->m_Link = (uint8)Sql_GetIntData(SqlInstanceHandle, 20);
-			PMob->m_Type = (uint8)Sql_GetIntData(SqlInstanceHandle, 21);
-			PMob->m_Immunity = (IMMUNITY)Sql_GetIntData(SqlInstanceHandle, 22);
-			PMob->m_EcoSystem = (ECOSYSTEM)Sql_GetIntData(SqlInstanceHandle, 23);
-			PMob->m_ModelSize += (uint8)Sql_GetIntData(SqlInstanceHandle, 24);
-
-			PMob->speed = (uint8)Sql_GetIntData(SqlInstanceHandle, 25);
-			PMob->speedsub = (uint8)Sql_GetIntData(SqlInstanceHandle, 25);
-
-			PMob->strRank = (uint8)Sql_GetIntData(SqlInstanceHandle, 26);
-			PMob->dexRank = (uint8)Sql_GetIntData(SqlInstanceHandle, 27);
-			PMob->vitRank = (uint8)Sql_GetIntData(SqlInstanceHandle, 28);
-			PMob->agiRank = (uint8)Sql_GetIntData(SqlInstanceHandle, 29);
-			PMob->intRank = (uint8)Sql_GetIntData(SqlInstanceHandle, 30);
-			PMob->mndRank = (uint8)Sql_GetIntData(SqlInstanceHandle, 31);
-			PMob->chrRank = (uint8)Sql_GetIntData(SqlInstanceHandle, 32);
-			PMob->evaRank = (uint8)Sql_GetIntData(SqlInstanceHandle, 33);
-			PMob->defRank = (uint8)Sql_GetIntData(SqlInstanceHandle, 34);
-			PMob->attRank = (uint8)Sql_GetIntData(SqlInstanceHandle, 56);
-			PMob->accRank = (uint8)Sql_GetIntData(SqlInstanceHandle, 57);
-
-			PMob->setModifier(MOD_SLASHRES, (uint16)(Sql_GetFloatData(SqlInstanceHandle, 35) * 1000));
-			PMob->setModifier(MOD_PIERCERES, (uint16)(Sql_GetFloatData(SqlInstanceHandle, 36) * 1000));
-			PMob->setModifier(MOD_HTHRES, (uint16)(Sql_GetFloatData(SqlInstanceHandle, 37) * 1000));
-			PMob->setModifier(MOD_IMPACTRES, (uint16)(Sql_GetFloatData(SqlInstanceHandle, 38) * 1000));
-
-			PMob->setModifier(MOD_FIRERES, (int16)((Sql_GetFloatData(SqlInstanceHandle, 39) - 1) * -100)); // These are stored as floating percentages
-			PMob->setModifier(MOD_ICERES, (int16)((Sql_GetFloatData(SqlInstanceHandle, 40) - 1) * -100)); // and need to be adjusted into modifier units.
-			PMob->setModifier(MOD_WINDRES, (int16)((Sql_GetFloatData(SqlInstanceHandle, 41) - 1) * -100)); // Higher RES = lower damage.
-			PMob->setModifier(MOD_EARTHRES, (int16)((Sql_GetFloatData(SqlInstanceHandle, 42) - 1) * -100)); // Negatives signify lower resist chance.
-			PMob->setModifier(MOD_THUNDERRES, (int16)((Sql_GetFloatData(SqlInstanceHandle, 43) - 1) * -100)); // Positives signify increased resist chance.
-			PMob->setModifier(MOD_WATERRES, (int16)((Sql_GetFloatData(SqlInstanceHandle, 44) - 1) * -100));
-			PMob->setModifier(MOD_LIGHTRES, (int16)((Sql_GetFloatData(SqlInstanceHandle, 45) - 1) * -100));
-			PMob->setModifier(MOD_DARKRES, (int16)((Sql_GetFloatData(SqlInstanceHandle, 46) - 1) * -100));
-
-			PMob->m_Element = (uint8)Sql_GetIntData(SqlInstanceHandle, 47);
-			PMob->m_Family = (uint16)Sql_GetIntData(SqlInstanceHandle, 48);
-			PMob->m_name_prefix = (uint8)Sql_GetIntData(SqlInstanceHandle, 49);
-			PMob->m_flags = (uint32)Sql_GetIntData(SqlInstanceHandle, 50);
-
-			//Special sub animation for Mob (yovra, jailer of love, phuabo)
-			// yovra 1: en hauteur, 2: en bas, 3: en haut
-			// phuabo 1: sous l'eau, 2: sort de l'eau, 3: rentre dans l'eau
-			PMob->animationsub = (uint32)Sql_GetIntData(SqlInstanceHandle, 51);
-
-			// Setup HP / MP Stat Percentage Boost
-			PMob->HPscale = Sql_GetFloatData(SqlInstanceHandle, 52);
-			PMob->MPscale = Sql_GetFloatData(SqlInstanceHandle, 53);
-
-			// Check if we should be looking up scripts for this mob
-			PMob->m_HasSpellScript = (uint8)Sql_GetIntData(SqlInstanceHandle, 54);
-
-			PMob->m_SpellListContainer = mobSpellList::GetMobSpellList(Sql_GetIntData(SqlInstanceHandle, 55));
-
-			PMob->m_Pool = Sql_GetUIntData(SqlInstanceHandle, 58);
-
-            PMob->allegiance = Sql_GetUIntData(SqlInstanceHandle, 59);
-            PMob->namevis = Sql_GetUIntData(SqlInstanceHandle, 60);
-            PMob->m_Aggro = Sql_GetUIntData(SqlInstanceHandle, 61);
-            PMob->m_MobSkillList = Sql_GetUIntData(SqlInstanceHandle, 62);
-
-			// must be here first to define mobmods
-			mobutils::InitializeMob(PMob, zone);
-			PMob->PInstance = instance;
-
-			instance->InsertMOB(PMob);
+			return nullptr;
 		}
+	}
 
-		Query =
-			"SELECT npcid, name, pos_rot, pos_x, pos_y, pos_z,\
-			flag, speed, speedsub, animation, animationsub, namevis,\
-			status, flags, look, name_prefix \
-			FROM instance_entities INNER JOIN npc_list ON \
-			(instance_entities.id = npc_list.npcid) \
-			WHERE instanceid = %u AND npcid >= %u and npcid < %u;";
-
-		uint32 zoneMin = (zone->GetID() << 12) + 0x1000000;
-		uint32 zoneMax = zoneMin + 1024;
-
-		ret = Sql_Query(SqlHandle, Query, instance->GetID(), zoneMin, zoneMax);
+	int32 ret = Sql_Query(SqlInstanceHandle, Query, instanceid);
 
-		if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) != 0)
-		{
-			while (Sql_NextRow(SqlHandle) == SQL_SUCCESS)
-			{
-				CNpcEntity* PNpc = new CNpcEntity;
-				PNpc->id = (uint16)Sql_GetUIntData(SqlHandle, 0);
-				PNpc->targid = PNpc->id & 0xFFF;
+	if (ret == SQL_ERROR || Sql_NumRows(SqlInstanceHandle) == 0)
+	{
+		return nullptr;
+	}
 
-				PNpc->name.insert(0, Sql_GetData(SqlHandle, 1));
+	InstancePrefab_t* PPrefab = new InstancePrefab_t;
+	ReadRows(SqlInstanceHandle, PPrefab->mobs);
 
-				PNpc->loc.p.rotation = (uint8)Sql_GetIntData(SqlHandle, 2);
-				PNpc->loc.p.x = Sql_GetFloatData(SqlHandle, 3);
-				PNpc->loc.p.y = Sql_GetFloatData(SqlHandle, 4);
-				PNpc->loc.p.z = Sql_GetFloatData(SqlHandle, 5);
-				PNpc->loc.p.moving = (uint16)Sql_GetUIntData(SqlHandle, 6);
+	Query =
+		"SELECT npcid, name, pos_rot, pos_x, pos_y, pos_z,\
+		flag, speed, speedsub, animation, animationsub, namevis,\
+		status, flags, look, name_prefix \
+		FROM instance_entities INNER JOIN npc_list ON \
+		(instance_entities.id = npc_list.npcid) \
+		WHERE instanceid = %u AND npcid >= %u and npcid < %u;";
 
-				PNpc->m_TargID = (uint32)Sql_GetUIntData(SqlHandle, 6) >> 16; // вполне вероятно
+	uint32 zoneMin = (zoneid << 12) + 0x1000000;
+	uint32 zoneMax = zoneMin + 1024;
 
-				PNpc->speed = (uint8)Sql_GetIntData(SqlHandle, 7);
-				PNpc->speedsub = (uint8)Sql_GetIntData(SqlHandle, 8);
-				PNpc->animation = (uint8)Sql_GetIntData(SqlHandle, 9);
-				PNpc->animationsub = (uint8)Sql_GetIntData(SqlHandle, 10);
+	ret = Sql_Query(SqlInstanceHandle, Query, instanceid, zoneMin, zoneMax);
 
-				PNpc->namevis = (uint8)Sql_GetIntData(SqlHandle, 11);
-				PNpc->status = (STATUSTYPE)Sql_GetIntData(SqlHandle, 12);
-				PNpc->m_flags = (uint32)Sql_GetUIntData(SqlHandle, 13);
+	if (ret != SQL_ERROR)
+	{
+		ReadRows(SqlInstanceHandle, PPrefab->npcs);
+	}
 
-				PNpc->name_prefix = (uint8)Sql_GetIntData(SqlHandle, 15);
+	//TODO: pets
 
-				memcpy(&PNpc->look, Sql_GetData(SqlHandle, 14), 20);
+	return PPrefab;
+}
 
-				PNpc->PInstance = instance;
+/************************************************************************
+*                                                                       *
+*  Creates the instance's entities from the prefab (main thread)        *
+*                                                                       *
+************************************************************************/
 
-				instance->InsertNPC(PNpc);
-			}
-		}
-	}
-	else
+void CInstanceLoader::Instantiate()
+{
+	for (const InstancePrefabRow_t& row : prefab->mobs)
 	{
-        instance->Cancel();
-		instance = nullptr;
+		CMobEntity* PMob = new CMobEntity;
+
+		PMob->name.insert(0, RowData(row, 0));
+		PMob->id = (uint32)RowUInt(row, 1);
+		PMob->targid = (uint16)PMob->id & 0x0FFF;
+
+		PMob->m_SpawnPoint.rotation = (uint8)RowInt(row, 2);
+		PMob->m_SpawnPoint.x = RowFloat(row, 3);
+		PMob->m_SpawnPoint.y = RowFloat(row, 4);
+		PMob->m_SpawnPoint.z = RowFloat(row, 5);
+
+		PMob->m_RespawnTime = RowUInt(row, 6) * 1000;
+		PMob->m_SpawnType = (SPAWNTYPE)RowUInt(row, 7);
+		PMob->m_DropID = RowUInt(row, 8);
+
+		PMob->HPmodifier = (uint32)RowInt(row, 9);
+		PMob->MPmodifier = (uint32)RowInt(row, 10);
+
+		PMob->m_minLevel = (uint8)RowInt(row, 11);
+		PMob->m_maxLevel = (uint8)RowInt(row, 12);
+
+		RowCopy(row, 13, &PMob->look, 23);
+
+		PMob->SetMJob(RowInt(row, 14));
+		PMob->SetSJob(RowInt(row, 15));
+
+		PMob->m_Weapons[SLOT_MAIN]->setMaxHit(1);
+		PMob->m_Weapons[SLOT_MAIN]->setSkillType(RowInt(row, 16));
+		PMob->m_dmgMult = RowUInt(row, 17);
+		PMob->m_Weapons[SLOT_MAIN]->setDelay((RowInt(row, 18) * 1000) / 60);
+		PMob->m_Weapons[SLOT_MAIN]->setBaseDelay((RowInt(row, 18) * 1000) / 60);
+
+		PMob->m_Behaviour = (uint16)RowInt(row, 19);
+		PMob->m_Link = (uint8)RowInt(row, 20);
+		PMob->m_Type = (uint8)RowInt(row, 21);
+		PMob->m_Immunity = (IMMUNITY)RowInt(row, 22);
+		PMob->m_EcoSystem = (ECOSYSTEM)RowInt(row, 23);
+		PMob->m_ModelSize += (uint8)RowInt(row, 24);
+
+		PMob->speed = (uint8)RowInt(row, 25);
+		PMob->speedsub = (uint8)RowInt(row, 25);
+
+		PMob->strRank = (uint8)RowInt(row, 26);
+		PMob->dexRank = (uint8)RowInt(row, 27);
+		PMob->vitRank = (uint8)RowInt(row, 28);
+		PMob->agiRank = (uint8)RowInt(row, 29);
+		PMob->intRank = (uint8)RowInt(row, 30);
+		PMob->mndRank = (uint8)RowInt(row, 31);
+		PMob->chrRank = (uint8)RowInt(row, 32);
+		PMob->evaRank = (uint8)RowInt(row, 33);
+		PMob->defRank = (uint8)RowInt(row, 34);
+		PMob->attRank = (uint8)RowInt(row, 56);
+		PMob->accRank = (uint8)RowInt(row, 57);
+
+		PMob->setModifier(MOD_SLASHRES, (uint16)(RowFloat(row, 35) * 1000));
+		PMob->setModifier(MOD_PIERCERES, (uint16)(RowFloat(row, 36) * 1000));
+		PMob->setModifier(MOD_HTHRES, (uint16)(RowFloat(row, 37) * 1000));
+		PMob->setModifier(MOD_IMPACTRES, (uint16)(RowFloat(row, 38) * 1000));
+
+		PMob->setModifier(MOD_FIRERES, (int16)((RowFloat(row, 39) - 1) * -100)); // These are stored as floating percentages
+		PMob->setModifier(MOD_ICERES, (int16)((RowFloat(row, 40) - 1) * -100)); // and need to be adjusted into modifier units.
+		PMob->setModifier(MOD_WINDRES, (int16)((RowFloat(row, 41) - 1) * -100)); // Higher RES = lower damage.
+		PMob->setModifier(MOD_EARTHRES, (int16)((RowFloat(row, 42) - 1) * -100)); // Negatives signify lower resist chance.
+		PMob->setModifier(MOD_THUNDERRES, (int16)((RowFloat(row, 43) - 1) * -100)); // Positives signify increased resist chance.
+		PMob->setModifier(MOD_WATERRES, (int16)((RowFloat(row, 44) - 1) * -100));
+		PMob->setModifier(MOD_LIGHTRES, (int16)((RowFloat(row, 45) - 1) * -100));
+		PMob->setModifier(MOD_DARKRES, (int16)((RowFloat(row, 46) - 1) * -100));
+
+		PMob->m_Element = (uint8)RowInt(row, 47);
+		PMob->m_Family = (uint16)RowInt(row, 48);
+		PMob->m_name_prefix = (uint8)RowInt(row, 49);
+		PMob->m_flags = (uint32)RowInt(row, 50);
+
+		//Special sub animation for Mob (yovra, jailer of love, phuabo)
+		// yovra 1: en hauteur, 2: en bas, 3: en haut
+		// phuabo 1: sous l'eau, 2: sort de l'eau, 3: rentre dans l'eau
+		PMob->animationsub = (uint32)RowInt(row, 51);
+
+		// Setup HP / MP Stat Percentage Boost
+		PMob->HPscale = RowFloat(row, 52);
+		PMob->MPscale = RowFloat(row, 53);
+
+		// Check if we should be looking up scripts for this mob
+		PMob->m_HasSpellScript = (uint8)RowInt(row, 54);
+
+		PMob->m_SpellListContainer = mobSpellList::GetMobSpellList(RowInt(row, 55));
+
+		PMob->m_Pool = RowUInt(row, 58);
+
+            PMob->allegiance = RowUInt(row, 59);
+            PMob->namevis = RowUInt(row, 60);
+            PMob->m_Aggro = RowUInt(row, 61);
+            PMob->m_MobSkillList = RowUInt(row, 62);
+
+		// must be here first to define mobmods
+		mobutils::InitializeMob(PMob, zone);
+		PMob->PInstance = instance;
+
+		instance->InsertMOB(PMob);
 	}
 
-	//TODO: pets
+	for (const InstancePrefabRow_t& row : prefab->npcs)
+	{
+		CNpcEntity* PNpc = new CNpcEntity;
+		PNpc->id = (uint32)RowUInt(row, 0);
+		PNpc->targid = PNpc->id & 0xFFF;
+
+		PNpc->name.insert(0, RowData(row, 1));
+
+		PNpc->loc.p.rotation = (uint8)RowInt(row, 2);
+		PNpc->loc.p.x = RowFloat(row, 3);
+		PNpc->loc.p.y = RowFloat(row, 4);
+		PNpc->loc.p.z = RowFloat(row, 5);
+		PNpc->loc.p.moving = (uint16)RowUInt(row, 6);
+
+		PNpc->m_TargID = (uint32)RowUInt(row, 6) >> 16; // вполне вероятно
 
-	return instance;
+		PNpc->speed = (uint8)RowInt(row, 7);
+		PNpc->speedsub = (uint8)RowInt(row, 8);
+		PNpc->animation = (uint8)RowInt(row, 9);
+		PNpc->animationsub = (uint8)RowInt(row, 10);
+
+		PNpc->namevis = (uint8)RowInt(row, 11);
+		PNpc->status = (STATUSTYPE)RowInt(row, 12);
+		PNpc->m_flags = (uint32)RowUInt(row, 13);
+
+		PNpc->name_prefix = (uint8)RowInt(row, 15);
+
+		RowCopy(row, 14, &PNpc->look, 20);
+
+		PNpc->PInstance = instance;
+
+		instance->InsertNPC(PNpc);
+	}
 }
@@ -25,6 +25,8 @@ This file is part of DarkStar-server source code.
 #define _CINSTANCELOADER_H
 
 #include <future>
+#include <string>
+#include <vector>
 
 #include "../common/cbasetypes.h"
 #include "../common/socket.h"
@@ -34,6 +36,15 @@ class CCharEntity;
 class CInstance;
 class CZone;
 
+typedef std::vector<std::string> InstancePrefabRow_t;
+
+// raw mob and npc rows of an instance id, read once and shared by every instance built from them
+struct InstancePrefab_t
+{
+	std::vector<InstancePrefabRow_t> mobs;
+	std::vector<InstancePrefabRow_t> npcs;
+};
+
 class CInstanceLoader
 {
 public:
@@ -45,10 +56,15 @@ public:
 private:
 	CZone* zone;
 	CCharEntity* requester;
-	Sql_t* SqlInstanceHandle;
-	std::future<CInstance*> task;
+	CInstance* instance;
+	Sql_t* SqlInstanceHandle;					// borrowed from the loader pool while the prefab is read
+	const InstancePrefab_t* prefab;				// owned by the prefab cache
+	bool cached;
+	time_point start;
+	std::future<InstancePrefab_t*> task;
 
-	CInstance* LoadInstance(CInstance* instance);
+	InstancePrefab_t* LoadPrefab(uint8 instanceid, uint16 zoneid);
+	void Instantiate();
 
 };
 
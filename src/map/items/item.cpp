@@ -242,13 +242,12 @@ uint32 CItem::getCharPrice()
 
 const int8* CItem::getName()
 {
-	return m_name.c_str();
+	return m_name ? m_name->c_str() : "";
 }
 
 void CItem::setName(int8* name)
 {
-	m_name.clear();
-	m_name.insert(0,name);
+	m_name = std::make_shared<const string_t>(name);
 }
 
 /************************************************************************
@@ -27,6 +27,8 @@
 #include "../../common/cbasetypes.h"
 #include "../../common/mmo.h"
 
+#include <memory>
+
 // основной тип предмета m_type
 
 enum ITEM_TYPE
@@ -147,7 +149,7 @@ private:
 
     bool        m_sent;
 
-	string_t	m_name;
+	std::shared_ptr<const string_t> m_name;    // shared with the g_pItemList template, never changes after load
     string_t	m_send;
     string_t    m_recv;
 };
@@ -26,10 +26,28 @@
 #include <string.h>
 #include "../map.h"
 
+namespace
+{
+    // returns a list only this item refers to, copying the shared one if needed
+    template<typename T>
+    std::vector<T*>& ownList(std::shared_ptr<std::vector<T*>>& list)
+    {
+        if (list.use_count() > 1)
+        {
+            list = std::make_shared<std::vector<T*>>(*list);
+        }
+        return *list;
+    }
+}
+
 CItemArmor::CItemArmor(uint16 id) : CItemUsable(id)
 {
 	setType(ITEM_ARMOR);
 
+    m_modList      = std::make_shared<std::vector<CModifier*>>();
+    m_petModList   = std::make_shared<std::vector<CModifier*>>();
+    m_latentList   = std::make_shared<std::vector<CLatentEffect*>>();
+
 	m_jobs         = 0;
 	m_modelID      = 0;
 	m_removeSlotID = 0;
@@ -199,16 +217,16 @@ void CItemArmor::addModifier(CModifier* modifier)
         }
         m_absorption = dsp_min(pdt,100);
     }
-    modList.push_back(modifier);
+    ownList(m_modList).push_back(modifier);
 }
 
 int16 CItemArmor::getModifier(uint16 mod)
 {
-	for (uint16 i = 0; i < modList.size(); ++i)
+	for (auto modifier : *m_modList)
 	{
-		if (modList.at(i)->getModID() == mod)
+		if (modifier->getModID() == mod)
 		{
-			return modList.at(i)->getModAmount();
+			return modifier->getModAmount();
 		}
 	}
 	return 0;
@@ -216,12 +234,27 @@ int16 CItemArmor::getModifier(uint16 mod)
 
 void CItemArmor::addPetModifier(CModifier* modifier)
 {
-    petModList.push_back(modifier);
+    ownList(m_petModList).push_back(modifier);
 }
 
 void CItemArmor::addLatent(CLatentEffect* latent)
 {
-	latentList.push_back(latent);
+	ownList(m_latentList).push_back(latent);
+}
+
+const std::vector<CModifier*>& CItemArmor::getModList()
+{
+    return *m_modList;
+}
+
+const std::vector<CModifier*>& CItemArmor::getPetModList()
+{
+    return *m_petModList;
+}
+
+const std::vector<CLatentEffect*>& CItemArmor::getLatentList()
+{
+    return *m_latentList;
 }
 
 /************************************************************************
@@ -26,6 +26,7 @@
 
 #include "../../common/utils.h"
 
+#include <memory>
 #include <vector>
 
 #include "item_usable.h"
@@ -90,12 +91,18 @@ public:
     void    addPetModifier(CModifier* modifier);
 	void	addLatent(CLatentEffect* latent);
 
-	std::vector<CModifier*> modList;			// список модификаторов
-    std::vector<CModifier*> petModList;         // mod list for pets
-	std::vector<CLatentEffect*> latentList;     // contains latents
+    const std::vector<CModifier*>&     getModList();        // список модификаторов
+    const std::vector<CModifier*>&     getPetModList();     // mod list for pets
+    const std::vector<CLatentEffect*>& getLatentList();     // contains latents
 
 private:
 
+    // copies made by itemutils::GetItem share these with the template,
+    // an augment gives the instance its own modifier lists on first write
+    std::shared_ptr<std::vector<CModifier*>>     m_modList;
+    std::shared_ptr<std::vector<CModifier*>>     m_petModList;
+    std::shared_ptr<std::vector<CLatentEffect*>> m_latentList;
+
 	uint8	m_reqLvl;
     uint8   m_iLvl;
 	uint32  m_jobs;
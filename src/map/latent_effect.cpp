@@ -140,12 +140,12 @@ void CLatentEffect::Deactivate()
             {
                 if (GetModValue() == MOD_ADDITIONAL_EFFECT)
                 {
-                    for (uint8 i = 0; i < weapon->modList.size(); ++i)
+                    for (uint8 i = 0; i < weapon->getModList().size(); ++i)
                     {
                         //ensure the additional effect is fully removed from the weapon
-                        if (weapon->modList.at(i)->getModID() == MOD_ADDITIONAL_EFFECT)
+                        if (weapon->getModList().at(i)->getModID() == MOD_ADDITIONAL_EFFECT)
                         {
-                            weapon->modList.at(i)->setModAmount(0);
+                            weapon->getModList().at(i)->setModAmount(0);
                         }
                     }
                 }
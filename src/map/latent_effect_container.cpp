@@ -61,7 +61,7 @@ void CLatentEffectContainer::AddLatentEffect(CLatentEffect* LatentEffect)
     LatentEffect->SetOwner(m_POwner);
 }
 
-void CLatentEffectContainer::AddLatentEffects(std::vector<CLatentEffect*> *latentList, uint8 reqLvl, uint8 slot)
+void CLatentEffectContainer::AddLatentEffects(const std::vector<CLatentEffect*> *latentList, uint8 reqLvl, uint8 slot)
 {
     for (uint16 i = 0; i < latentList->size(); ++i)
     {
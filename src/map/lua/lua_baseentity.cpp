@@ -153,6 +153,51 @@ CLuaBaseEntity::CLuaBaseEntity(CBaseEntity* PEntity)
     m_PBaseEntity = PEntity;
 }
 
+/************************************************************************
+*                                                                       *
+*  Every entity owns one wrapper, created the first time it is handed   *
+*  to a script and kept alive by a registry reference. Later calls      *
+*  push that same userdata instead of allocating a new one per hook.    *
+*                                                                       *
+************************************************************************/
+
+void CLuaBaseEntity::Push(lua_State* L, CBaseEntity* PEntity)
+{
+    // L may be a coroutine of a sliced hook; it shares the registry of the main state,
+    // which outlives it and is what the wrapper is bound to
+    lua_State* state = luautils::LuaHandle;
+
+    if (PEntity == nullptr || (PEntity->PLuaState != nullptr && PEntity->PLuaState != state))
+    {
+        // no entity, or it is already bound to another state: hand out a throwaway wrapper
+        Lunar<CLuaBaseEntity>::push(L, new CLuaBaseEntity(PEntity), true);
+        return;
+    }
+    if (PEntity->PLuaState == nullptr)
+    {
+        PEntity->LuaRef = Lunar<CLuaBaseEntity>::ref(L, new CLuaBaseEntity(PEntity));
+        PEntity->PLuaState = state;
+    }
+    lua_rawgeti(L, LUA_REGISTRYINDEX, PEntity->LuaRef);
+}
+
+void CLuaBaseEntity::Release(CBaseEntity* PEntity)
+{
+    lua_State* L = PEntity->PLuaState;
+
+    if (L == nullptr)
+    {
+        return;
+    }
+    // scripts may still hold the userdata, leave it pointing at nothing
+    lua_rawgeti(L, LUA_REGISTRYINDEX, PEntity->LuaRef);
+    Lunar<CLuaBaseEntity>::check(L, -1)->m_PBaseEntity = nullptr;
+    lua_pop(L, 1);
+
+    luaL_unref(L, LUA_REGISTRYINDEX, PEntity->LuaRef);
+    PEntity->PLuaState = nullptr;
+}
+
 //======================================================//
 
 inline int32 CLuaBaseEntity::leavegame(lua_State *L)
@@ -308,12 +353,7 @@ inline int32 CLuaBaseEntity::getPet(lua_State* L)
 
         CBattleEntity* PPet = ((CBattleEntity*)m_PBaseEntity)->PPet;
 
-        lua_getglobal(L, CLuaBaseEntity::className);
-        lua_pushstring(L, "new");
-        lua_gettable(L, -2);
-        lua_insert(L, -2);
-        lua_pushlightuserdata(L, (void*)PPet);
-        lua_pcall(L, 2, 1, 0);
+        CLuaBaseEntity::Push(L, PPet);
         return 1;
     }
     lua_pushnil(L);
@@ -2751,12 +2791,7 @@ inline int32 CLuaBaseEntity::getEventTarget(lua_State *L)
     {
         ShowWarning(CL_YELLOW"EventTarget is empty: %s\n" CL_RESET, m_PBaseEntity->GetName());
     }
-    lua_getglobal(L, CLuaBaseEntity::className);
-    lua_pushstring(L, "new");
-    lua_gettable(L, -2);
-    lua_insert(L, -2);
-    lua_pushlightuserdata(L, (void*)((CCharEntity*)m_PBaseEntity)->m_event.Target);
-    lua_pcall(L, 2, 1, 0);
+    CLuaBaseEntity::Push(L, ((CCharEntity*)m_PBaseEntity)->m_event.Target);
     return 1;
 }
 
@@ -4467,12 +4502,7 @@ inline int32 CLuaBaseEntity::getPartyMember(lua_State* L)
 
     if (PTargetChar != nullptr)
     {
-        lua_getglobal(L, CLuaBaseEntity::className);
-        lua_pushstring(L, "new");
-        lua_gettable(L, -2);
-        lua_insert(L, -2);
-        lua_pushlightuserdata(L, (void*)PTargetChar);
-        lua_pcall(L, 2, 1, 0);
+        CLuaBaseEntity::Push(L, PTargetChar);
         return 1;
     }
     ShowError(CL_RED"Lua::getPartyMember :: Member or Alliance Number is not valid.\n" CL_RESET);
@@ -6455,12 +6485,7 @@ inline int32 CLuaBaseEntity::getCursorTarget(lua_State* L)
     }
     else
     {
-        lua_getglobal(L, CLuaBaseEntity::className);
-        lua_pushstring(L, "new");
-        lua_gettable(L, -2);
-        lua_insert(L, -2);
-        lua_pushlightuserdata(L, PTarget);
-        lua_pcall(L, 2, 1, 0);
+        CLuaBaseEntity::Push(L, PTarget);
     }
 
     return 1;
@@ -8426,12 +8451,7 @@ inline int32 CLuaBaseEntity::getTrickAttackChar(lua_State *L)
         CBattleEntity* taTarget = battleutils::getAvailableTrickAttackChar((CBattleEntity*)m_PBaseEntity, PMob);
         if (taTarget)
         {
-            lua_getglobal(L, CLuaBaseEntity::className);
-            lua_pushstring(L, "new");
-            lua_gettable(L, -2);
-            lua_insert(L, -2);
-            lua_pushlightuserdata(L, taTarget);
-            lua_pcall(L, 2, 1, 0);
+            CLuaBaseEntity::Push(L, taTarget);
             return 1;
         }
     }
@@ -8725,12 +8745,7 @@ inline int32 CLuaBaseEntity::getTarget(lua_State* L)
     auto PBattleTarget {m_PBaseEntity->GetEntity(static_cast<CBattleEntity*>(m_PBaseEntity)->GetBattleTargetID())};
     if (PBattleTarget)
     {
-        lua_getglobal(L, CLuaBaseEntity::className);
-        lua_pushstring(L, "new");
-        lua_gettable(L, -2);
-        lua_insert(L, -2);
-        lua_pushlightuserdata(L, PBattleTarget);
-        lua_pcall(L, 2, 1, 0);
+        CLuaBaseEntity::Push(L, PBattleTarget);
         return 1;
     }
     else
@@ -8771,12 +8786,7 @@ inline int32 CLuaBaseEntity::getMaster(lua_State* L)
 
             CBaseEntity* PMaster = ((CBattleEntity*)m_PBaseEntity)->PMaster;
 
-            lua_getglobal(L, CLuaBaseEntity::className);
-            lua_pushstring(L, "new");
-            lua_gettable(L, -2);
-            lua_insert(L, -2);
-            lua_pushlightuserdata(L, (void*)PMaster);
-            lua_pcall(L, 2, 1, 0);
+            CLuaBaseEntity::Push(L, PMaster);
             return 1;
         }
     lua_pushnil(L);
@@ -9447,12 +9457,7 @@ inline int32 CLuaBaseEntity::getPartyLeader(lua_State* L) // Todo: also add abil
         CBattleEntity* PLeader = PChar->PParty->GetLeader();
         if (PLeader != nullptr)
         {
-            lua_getglobal(L, CLuaBaseEntity::className);
-            lua_pushstring(L, "new");
-            lua_gettable(L, -2);
-            lua_insert(L, -2);
-            lua_pushlightuserdata(L, (void*)PLeader);
-            lua_pcall(L, 2, 1, 0);
+            CLuaBaseEntity::Push(L, PLeader);
             return 1;
         }
     }
@@ -9487,12 +9492,7 @@ inline int32 CLuaBaseEntity::getParty(lua_State* L)
     int i = 1;
     ((CBattleEntity*)m_PBaseEntity)->ForParty([this, &L, &i](CBattleEntity* member)
     {
-        lua_getglobal(L, CLuaBaseEntity::className);
-        lua_pushstring(L, "new");
-        lua_gettable(L, -2);
-        lua_insert(L, -2);
-        lua_pushlightuserdata(L, (void*)member);
-        lua_pcall(L, 2, 1, 0);
+        CLuaBaseEntity::Push(L, member);
 
         lua_rawseti(L, -2, i++);
     });
@@ -9525,12 +9525,7 @@ inline int32 CLuaBaseEntity::getAlliance(lua_State* L)
 
     PChar->ForAlliance([this, &L, &i](CBattleEntity* PMember)
     {
-        lua_getglobal(L, CLuaBaseEntity::className);
-        lua_pushstring(L, "new");
-        lua_gettable(L, -2);
-        lua_insert(L, -2);
-        lua_pushlightuserdata(L, (void*)PMember);
-        lua_pcall(L, 2, 1, 0);
+        CLuaBaseEntity::Push(L, PMember);
 
         lua_rawseti(L, -2, i++);
     });
@@ -9709,12 +9704,7 @@ inline int32 CLuaBaseEntity::getEnmityList(lua_State* L)
         int i = 1;
         for (auto member : *enmityList)
         {
-            lua_getglobal(L, CLuaBaseEntity::className);
-            lua_pushstring(L, "new");
-            lua_gettable(L, -2);
-            lua_insert(L, -2);
-            lua_pushlightuserdata(L, (void*)member.second->PEnmityOwner);
-            lua_pcall(L, 2, 1, 0);
+            CLuaBaseEntity::Push(L, member.second->PEnmityOwner);
 
             lua_rawseti(L, -2, i++);
         }
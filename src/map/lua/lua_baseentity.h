@@ -46,6 +46,9 @@ public:
         return m_PBaseEntity;
     }
 
+    static void Push(lua_State*, CBaseEntity*);     // pushes the entity's cached wrapper, creating it on first use
+    static void Release(CBaseEntity*);              // drops the cached wrapper, called when the entity is destroyed
+
     int32 ChangeMusic(lua_State* L);        // Sets the specified music Track for specified music block.
 
     int32 warp(lua_State*);                 // Returns Character to home point
@@ -146,12 +146,7 @@ inline int32 CLuaBattlefield::insertAlly(lua_State* L)
         m_PLuaBattlefield->m_AllyList.push_back(PAlly);
         PAlly->PBCNM = m_PLuaBattlefield;
         PAlly->StatusEffectContainer->AddStatusEffect(new CStatusEffect(EFFECT_BATTLEFIELD, EFFECT_BATTLEFIELD, m_PLuaBattlefield->getID(), 0, 0), true);
-        lua_getglobal(L, CLuaBaseEntity::className);
-        lua_pushstring(L, "new");
-        lua_gettable(L, -2);
-        lua_insert(L, -2);
-        lua_pushlightuserdata(L, (void*)PAlly);
-        lua_pcall(L, 2, 1, 0);
+        CLuaBaseEntity::Push(L, PAlly);
     }
     else
     {
@@ -170,12 +165,7 @@ inline int32 CLuaBattlefield::getAllies(lua_State* L)
     int i = 1;
     for (auto ally : m_PLuaBattlefield->m_AllyList)
     {
-        lua_getglobal(L, CLuaBaseEntity::className);
-        lua_pushstring(L, "new");
-        lua_gettable(L, -2);
-        lua_insert(L, -2);
-        lua_pushlightuserdata(L, (void*)ally);
-        lua_pcall(L, 2, 1, 0);
+        CLuaBaseEntity::Push(L, ally);
 
         lua_rawseti(L, -2, i++);
     }
@@ -80,12 +80,7 @@ inline int32 CLuaInstance::getChars(lua_State* L)
     int i = 1;
     for (auto member : m_PLuaInstance->m_charList)
     {
-        lua_getglobal(L, CLuaBaseEntity::className);
-        lua_pushstring(L, "new");
-        lua_gettable(L, -2);
-        lua_insert(L, -2);
-        lua_pushlightuserdata(L, (void*)member.second);
-        lua_pcall(L, 2, 1, 0);
+        CLuaBaseEntity::Push(L, member.second);
 
         lua_rawseti(L, -2, i++);
     }
@@ -102,12 +97,7 @@ inline int32 CLuaInstance::getMobs(lua_State* L)
     int i = 1;
     for (auto member : m_PLuaInstance->m_mobList)
     {
-        lua_getglobal(L, CLuaBaseEntity::className);
-        lua_pushstring(L, "new");
-        lua_gettable(L, -2);
-        lua_insert(L, -2);
-        lua_pushlightuserdata(L, (void*)member.second);
-        lua_pcall(L, 2, 1, 0);
+        CLuaBaseEntity::Push(L, member.second);
 
         lua_rawseti(L, -2, i++);
     }
@@ -124,12 +114,7 @@ inline int32 CLuaInstance::getNpcs(lua_State* L)
     int i = 1;
     for (auto member : m_PLuaInstance->m_npcList)
     {
-        lua_getglobal(L, CLuaBaseEntity::className);
-        lua_pushstring(L, "new");
-        lua_gettable(L, -2);
-        lua_insert(L, -2);
-        lua_pushlightuserdata(L, (void*)member.second);
-        lua_pcall(L, 2, 1, 0);
+        CLuaBaseEntity::Push(L, member.second);
 
         lua_rawseti(L, -2, i++);
     }
@@ -146,12 +131,7 @@ inline int32 CLuaInstance::getPets(lua_State* L)
     int i = 1;
     for (auto member : m_PLuaInstance->m_petList)
     {
-        lua_getglobal(L, CLuaBaseEntity::className);
-        lua_pushstring(L, "new");
-        lua_gettable(L, -2);
-        lua_insert(L, -2);
-        lua_pushlightuserdata(L, (void*)member.second);
-        lua_pcall(L, 2, 1, 0);
+        CLuaBaseEntity::Push(L, member.second);
 
         lua_rawseti(L, -2, i++);
     }
@@ -240,12 +220,7 @@ inline int32 CLuaInstance::getEntity(lua_State* L)
 
     if (PEntity)
     {
-        lua_getglobal(L, CLuaBaseEntity::className);
-        lua_pushstring(L, "new");
-        lua_gettable(L, -2);
-        lua_insert(L, -2);
-        lua_pushlightuserdata(L, (void*)(PEntity));
-        lua_pcall(L, 2, 1, 0);
+        CLuaBaseEntity::Push(L, PEntity);
     }
     else
     {
@@ -359,12 +334,7 @@ inline int32 CLuaInstance::insertAlly(lua_State* L)
     CMobEntity* PAlly = mobutils::InstantiateAlly(groupid, m_PLuaInstance->GetZone()->GetID(), m_PLuaInstance);
     if (PAlly)
     {
-        lua_getglobal(L, CLuaBaseEntity::className);
-        lua_pushstring(L, "new");
-        lua_gettable(L, -2);
-        lua_insert(L, -2);
-        lua_pushlightuserdata(L, (void*)PAlly);
-        lua_pcall(L, 2, 1, 0);
+        CLuaBaseEntity::Push(L, PAlly);
     }
     else
     {
@@ -123,12 +123,7 @@ inline int32 CLuaZone::getPlayers(lua_State* L)
     int newTable = lua_gettop(L);
 
     m_pLuaZone->ForEachChar([&L, &newTable](CCharEntity* PChar) {
-        lua_getglobal(L, CLuaBaseEntity::className);
-        lua_pushstring(L, "new");
-        lua_gettable(L, -2);
-        lua_insert(L, -2);
-        lua_pushlightuserdata(L, (void*)PChar);
-        lua_pcall(L, 2, 1, 0);
+        CLuaBaseEntity::Push(L, PChar);
         lua_setfield(L, newTable, PChar->GetName());
     });
 
@@ -25,9 +25,14 @@
 #include "../../common/timer.h"
 #include "../../common/utils.h"
 
+#include <algorithm>
+#include <atomic>
+#include <list>
 #include <string.h>
 #include <unordered_map>
+#include <unordered_set>
 #include <cstdio>
+#include <vector>
 
 #include "luautils.h"
 #include "lua_action.h"
@@ -65,10 +70,14 @@
 #include "../entities/automatonentity.h"
 #include "../utils/itemutils.h"
 #include "../utils/charutils.h"
+#include "../utils/synthutils.h"
+#include "../utils/fishingutils.h"
+#include "../utils/serverutils.h"
 #include "../conquest_system.h"
 #include "../weapon_skill.h"
 #include "../status_effect_container.h"
 #include "../instance.h"
+#include "../profiler.h"
 #include "../ai/ai_container.h"
 #include "../ai/states/attack_state.h"
 #include "../ai/states/death_state.h"
@@ -91,6 +100,88 @@ namespace luautils
     bool expansionRestrictionEnabled;
     std::unordered_map<std::string, bool> expansionEnabledMap;
 
+    bool Profiling = false;
+    std::atomic<uint64> LuaTime {0};
+    thread_local bool InScript = false;
+    thread_local const char* CurrentHook = nullptr;     // set by prepFile for the next call, the zone profiler sums by it
+
+    const int32 SLICE_INSTRUCTIONS = 1000;
+
+    struct sliced_call_t
+    {
+        lua_State*  thread;
+        int32       ref;                            // keeps the thread alive in the registry
+        const char* hook;
+        string_t    file;
+        uint32      owner;                          // one pending call per hook and owner
+        std::vector<std::pair<CLuaBaseEntity*, int32>> entities;    // wrappers passed in and their refs, a released one cancels the call
+        CBattleEntity* fighter;                     // fight hooks end with the engagement they started in
+        time_point  engaged;
+        uint32      slices;
+        uint64      cycles;                         // running time over all slices
+        uint64      overrun;                        // worst time past the deadline in one slice
+    };
+
+    struct slice_stats_t
+    {
+        uint32 calls;                               // calls that needed more than one slice or overran
+        uint32 skipped;                             // calls refused because the last one was still pending
+        uint32 maxSlices;
+        uint64 maxOverrun;
+    };
+
+    std::list<sliced_call_t> SlicedCalls;
+    std::unordered_map<string_t, slice_stats_t> SliceStats;     // by "file:hook"
+    std::unordered_set<string_t> SlicedHooks;                   // "file:hook" that went over budget as a direct call
+
+    const int32 GC_IDLE_STEP = 16;                  // KB of work per extra step while the loop is idle
+
+    struct gc_state_t
+    {
+        int32      heap;                            // KB in use after the last step
+        int32      threshold;                       // KB at which the next cycle starts
+        bool       collecting;                      // a cycle is in progress
+        uint64     allocated;                       // KB allocated since the stats were reset
+        uint64     cycles;                          // time spent stepping since then
+        uint64     maxCycles;                       // longest single StepGC
+        uint32     calls;
+        uint32     completed;                       // full cycles finished
+        time_point since;
+    };
+
+    gc_state_t GCState;
+
+    // every call from the core into a script goes through here, nested calls are counted by the outer one
+    int32 pcall(lua_State* L, int32 nargs, int32 nresults, int32 errfunc)
+    {
+        if (InScript || (!Profiling && !profiler::IsEnabled()))
+        {
+            CurrentHook = nullptr;
+            return lua_pcall(L, nargs, nresults, errfunc);
+        }
+        InScript = true;
+        CProfileScope profile(PROFILE_LUA, CurrentHook != nullptr ? CurrentHook : "(anonymous)");
+        time_point start = server_clock::now();
+        int32 ret = lua_pcall(L, nargs, nresults, errfunc);
+        if (Profiling)
+        {
+            LuaTime += std::chrono::duration_cast<std::chrono::nanoseconds>(server_clock::now() - start).count();
+        }
+        InScript = false;
+        CurrentHook = nullptr;
+        return ret;
+    }
+
+    void SetProfiling(bool enabled)
+    {
+        Profiling = enabled;
+    }
+
+    uint64 GetLuaTime()
+    {
+        return LuaTime.load();
+    }
+
     /************************************************************************
     *                                                                       *
     *  Инициализация lua, пользовательских классов и глобальных функций		*
@@ -140,6 +231,12 @@ namespace luautils
         lua_register(LuaHandle, "clearVarFromAll", luautils::clearVarFromAll);
         lua_register(LuaHandle, "SendEntityVisualPacket", luautils::SendEntityVisualPacket);
         lua_register(LuaHandle, "UpdateServerMessage", luautils::UpdateServerMessage);
+        lua_register(LuaHandle, "ReloadSynthRecipes", luautils::ReloadSynthRecipes);
+        lua_register(LuaHandle, "ReloadFishingCatches", luautils::ReloadFishingCatches);
+        lua_register(LuaHandle, "SetZoneProfiling", luautils::SetZoneProfiling);
+        lua_register(LuaHandle, "GetZoneProfile", luautils::GetZoneProfile);
+        lua_register(LuaHandle, "DumpZoneProfile", luautils::DumpZoneProfile);
+        lua_register(LuaHandle, "ResetZoneProfile", luautils::ResetZoneProfile);
         lua_register(LuaHandle, "UpdateTreasureSpawnPoint", luautils::UpdateTreasureSpawnPoint);
         lua_register(LuaHandle, "GetMobRespawnTime", luautils::GetMobRespawnTime);
         lua_register(LuaHandle, "DeterMob", luautils::DeterMob);
@@ -166,6 +263,15 @@ namespace luautils
 
         luaL_dostring(LuaHandle, "if not bit then bit = require('bit') end");
 
+        // collected from the main loop only, see StepGC
+        lua_gc(LuaHandle, LUA_GCSTOP, 0);
+        GCState = gc_state_t();
+        GCState.heap = lua_gc(LuaHandle, LUA_GCCOUNT, 0);
+        GCState.threshold = GCState.heap * 2;
+        GCState.since = server_clock::now();
+
+        CTaskMgr::getInstance()->AddTask("lua_slices", server_clock::now(), nullptr, CTaskMgr::TASK_INTERVAL, ResumeSliced, 100ms);
+
         expansionRestrictionEnabled = (GetSettingsVariable("RESTRICT_BY_EXPANSION") != 0);
 
         ShowMessage("\t\t - " CL_GREEN"[OK]" CL_RESET"\n");
@@ -181,19 +287,98 @@ namespace luautils
     int32 free()
     {
         ShowStatus(CL_WHITE"luautils::free" CL_RESET":lua free...");
+        SlicedCalls.clear();
         lua_close(LuaHandle);
         ShowMessage("\t - " CL_GREEN"[OK]" CL_RESET"\n");
         return 0;
     }
 
-    int32 garbageCollect()
+    /************************************************************************
+    *                                                                       *
+    *  The collector's own allocation driven steps are stopped, so they     *
+    *  never land inside whatever hook happens to allocate. The main loop   *
+    *  calls StepGC once per pass after the sockets instead: it pays for    *
+    *  what was allocated since the last call, then keeps stepping while    *
+    *  the loop would be idle (at most lua_gc_budget ms) until the cycle is *
+    *  done. A new cycle starts once the heap has doubled, like the default *
+    *  gc pause.                                                            *
+    *                                                                       *
+    ************************************************************************/
+
+    void StepGC(time_point deadline)
+    {
+        uint64 start = get_cycles();
+        int32 heap = lua_gc(LuaHandle, LUA_GCCOUNT, 0);
+
+        if (heap > GCState.heap)
+        {
+            GCState.allocated += heap - GCState.heap;
+        }
+        if (!GCState.collecting && heap < GCState.threshold)
+        {
+            GCState.heap = heap;
+            return;
+        }
+
+        int64 idle = std::chrono::duration_cast<std::chrono::microseconds>(deadline - server_clock::now()).count();
+        uint64 budget = std::min<uint64>(map_config.lua_gc_budget * get_cycles_per_ms(), idle > 0 ? idle * get_cycles_per_ms() / 1000 : 0);
+        int32 size = std::max(heap - GCState.heap, 1);
+        bool finished = false;
+
+        do
+        {
+            finished = lua_gc(LuaHandle, LUA_GCSTEP, size) != 0;
+            size = GC_IDLE_STEP;
+        }
+        while (!finished && get_cycles() - start < budget);
+
+        // an explicit step re-arms the automatic ones
+        lua_gc(LuaHandle, LUA_GCSTOP, 0);
+
+        GCState.heap = lua_gc(LuaHandle, LUA_GCCOUNT, 0);
+        GCState.collecting = !finished;
+        if (finished)
+        {
+            GCState.threshold = GCState.heap * 2;
+            GCState.completed++;
+        }
+
+        uint64 elapsed = get_cycles() - start;
+        GCState.cycles += elapsed;
+        GCState.maxCycles = std::max(GCState.maxCycles, elapsed);
+        GCState.calls++;
+    }
+
+    gc_stats_t GetGCStats(bool reset)
     {
+        gc_stats_t stats;
+        double seconds = std::chrono::duration<double>(server_clock::now() - GCState.since).count();
+        double cyclesPerMs = (double)get_cycles_per_ms();
 
-        int32 top = lua_gettop(LuaHandle);
-        ShowDebug(CL_CYAN"[Lua] Garbage Collected. Current State Top: %d\n" CL_RESET, top);
+        stats.heap = lua_gc(LuaHandle, LUA_GCCOUNT, 0);
+        stats.allocRate = seconds > 0 ? GCState.allocated / seconds : 0;
+        stats.avgMs = GCState.calls != 0 ? GCState.cycles / cyclesPerMs / GCState.calls : 0;
+        stats.maxMs = GCState.maxCycles / cyclesPerMs;
+        stats.cycles = GCState.completed;
 
-        lua_gc(LuaHandle, LUA_GCSTEP, 10);
+        if (reset)
+        {
+            GCState.allocated = 0;
+            GCState.cycles = 0;
+            GCState.maxCycles = 0;
+            GCState.calls = 0;
+            GCState.completed = 0;
+            GCState.since = server_clock::now();
+        }
+        return stats;
+    }
+
+    int32 garbageCollect()
+    {
+        gc_stats_t stats = GetGCStats(true);
 
+        ShowDebug(CL_CYAN"[Lua] heap %u KB, %.1f KB/s allocated, gc %.3f ms per pass (max %.3f ms), %u cycles. Current State Top: %d\n" CL_RESET,
+            stats.heap, stats.allocRate, stats.avgMs, stats.maxMs, stats.cycles, lua_gettop(LuaHandle));
         return 0;
     }
 
@@ -245,7 +430,8 @@ namespace luautils
             return -1;
         }
 
-        ret = lua_pcall(LuaHandle, 0, 0, 0);
+        CurrentHook = function;
+        ret = pcall(LuaHandle, 0, 0, 0);
         if (ret)
         {
             ShowError("luautils::%s: %s\n", function, lua_tostring(LuaHandle, -1));
@@ -257,8 +443,10 @@ namespace luautils
         if (lua_isnil(LuaHandle, -1))
         {
             lua_pop(LuaHandle, 1);
+            CurrentHook = nullptr;
             return -1;
         }
+        CurrentHook = function;
         return 0;
     }
 
@@ -270,13 +458,254 @@ namespace luautils
 
     void callFunc(int nargs)
     {
-        if (lua_pcall(LuaHandle, nargs, 0, 0))
+        if (pcall(LuaHandle, nargs, 0, 0))
         {
             ShowError("[Lua] Anonymous function: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
         }
     }
 
+    /************************************************************************
+    *                                                                       *
+    *  Sliced hooks. A designated long-running hook is called directly, at  *
+    *  full speed, until one call goes over the budget (lua_slice_budget    *
+    *  ms). From then on that hook runs in a coroutine, kept interpreted so *
+    *  that a count hook can look at the clock every SLICE_INSTRUCTIONS     *
+    *  instructions and yield once the budget is used up; the lua_slices    *
+    *  task resumes pending calls on later ticks, sharing one budget per    *
+    *  tick between them.                                                   *
+    *                                                                       *
+    *  A hook cannot yield while it is inside pcall, a metamethod or        *
+    *  another C call, such a slice runs on and is reported as overrun.     *
+    *                                                                       *
+    ************************************************************************/
+
+    lua_State* SliceThread = nullptr;
+    uint64     SliceDeadline = 0;
+
+    void SliceHook(lua_State* L, lua_Debug* ar)
+    {
+        if (L != SliceThread || get_cycles() < SliceDeadline)
+        {
+            return;
+        }
+        lua_Debug frame;
+        for (int32 level = 0; lua_getstack(L, level, &frame); ++level)
+        {
+            lua_getinfo(L, "S", &frame);
+            if (frame.what[0] == 'C')
+            {
+                return;
+            }
+        }
+        lua_yield(L, 0);
+    }
+
+    // runs one slice, returns true once the call is done
+    bool RunSlice(sliced_call_t& call, int32 nargs, uint64 deadline)
+    {
+        CProfileScope profile(PROFILE_LUA, call.hook);
+        lua_State* outerThread = SliceThread;
+        uint64 outerDeadline = SliceDeadline;
+        uint64 start = get_cycles();
+
+        SliceThread = call.thread;
+        SliceDeadline = deadline;
+        lua_sethook(call.thread, SliceHook, LUA_MASKCOUNT, SLICE_INSTRUCTIONS);
+
+        int32 ret = lua_resume(call.thread, nargs);
+
+        lua_sethook(call.thread, nullptr, 0, 0);
+        SliceThread = outerThread;
+        SliceDeadline = outerDeadline;
+        if (outerThread != nullptr)
+        {
+            lua_sethook(outerThread, SliceHook, LUA_MASKCOUNT, SLICE_INSTRUCTIONS);     // LuaJIT keeps one hook for all threads
+        }
+
+        uint64 end = get_cycles();
+        call.slices++;
+        call.cycles += end - start;
+        call.overrun = std::max(call.overrun, end > deadline ? end - deadline : 0);
+
+        if (ret == LUA_YIELD)
+        {
+            return false;
+        }
+        if (ret != 0)
+        {
+            ShowError("luautils::%s (%s): %s\n", call.hook, call.file.c_str(), lua_tostring(call.thread, -1));
+        }
+        return true;
+    }
+
+    void FinishSliced(sliced_call_t& call)
+    {
+        luaL_unref(LuaHandle, LUA_REGISTRYINDEX, call.ref);
+        for (auto& entity : call.entities)
+        {
+            luaL_unref(LuaHandle, LUA_REGISTRYINDEX, entity.second);
+        }
+
+        if (call.slices == 1 && call.overrun == 0)
+        {
+            return;
+        }
+        slice_stats_t& stats = SliceStats[call.file + ":" + call.hook];
+
+        if (stats.calls++ == 0)
+        {
+            ShowWarning("luautils::%s (%s): over budget, %u slices, %.1fms in total, %.1fms past the deadline\n", call.hook, call.file.c_str(),
+                call.slices, (double)call.cycles / get_cycles_per_ms(), (double)call.overrun / get_cycles_per_ms());
+        }
+        stats.maxSlices = std::max(stats.maxSlices, call.slices);
+        stats.maxOverrun = std::max(stats.maxOverrun, call.overrun);
+    }
+
+    // the function and its nargs arguments are on top of the stack, as for pcall
+    int32 CallSliced(const int8* File, const char* hook, uint32 owner, int32 nargs, CBattleEntity* PFighter = nullptr)
+    {
+        string_t key = string_t(File) + ":" + hook;
+
+        if (SlicedHooks.find(key) == SlicedHooks.end())
+        {
+            uint64 start = get_cycles();
+            uint64 budget = map_config.lua_slice_budget * get_cycles_per_ms();
+
+            if (pcall(LuaHandle, nargs, 0, 0))
+            {
+                ShowError("luautils::%s (%s): %s\n", hook, File, lua_tostring(LuaHandle, -1));
+                lua_pop(LuaHandle, 1);
+            }
+
+            uint64 elapsed = get_cycles() - start;
+            if (elapsed > budget)
+            {
+                ShowWarning("luautils::%s (%s): %.1fms in one call, later calls run in slices\n", hook, File, (double)elapsed / get_cycles_per_ms());
+
+                slice_stats_t& stats = SliceStats[key];
+                stats.calls++;
+                stats.maxSlices = std::max<uint32>(stats.maxSlices, 1);
+                stats.maxOverrun = std::max(stats.maxOverrun, elapsed - budget);
+                SlicedHooks.insert(key);
+            }
+            return 0;
+        }
+        CurrentHook = nullptr;
+
+        sliced_call_t call {};
+        call.thread = lua_newthread(LuaHandle);
+        call.ref = luaL_ref(LuaHandle, LUA_REGISTRYINDEX);
+        call.hook = hook;
+        call.file = File;
+        call.owner = owner;
+        call.fighter = PFighter;
+        call.engaged = PFighter != nullptr ? PFighter->GetBattleStartTime() : time_point();
+
+        int32 base = lua_gettop(LuaHandle) - nargs;
+
+        luaL_getmetatable(LuaHandle, CLuaBaseEntity::className);
+        for (int32 i = base + 1; i <= base + nargs; ++i)
+        {
+            if (lua_type(LuaHandle, i) == LUA_TUSERDATA && lua_getmetatable(LuaHandle, i))
+            {
+                if (lua_rawequal(LuaHandle, -1, -2))
+                {
+                    lua_pushvalue(LuaHandle, i);
+                    call.entities.emplace_back(Lunar<CLuaBaseEntity>::check(LuaHandle, i), luaL_ref(LuaHandle, LUA_REGISTRYINDEX));
+                }
+                lua_pop(LuaHandle, 1);
+            }
+        }
+        lua_pop(LuaHandle, 1);
+
+        // LuaJIT does not run hooks inside compiled code, keep the hook interpreted; the
+        // file is loaded again for every call, so each call brings a new function to switch off
+        lua_getglobal(LuaHandle, "jit");
+        if (lua_istable(LuaHandle, -1))
+        {
+            lua_getfield(LuaHandle, -1, "off");
+            lua_pushvalue(LuaHandle, base);
+            lua_pushboolean(LuaHandle, 1);
+            lua_pcall(LuaHandle, 2, 0, 0);
+        }
+        lua_pop(LuaHandle, 1);
+
+        lua_xmove(LuaHandle, call.thread, nargs + 1);
+
+        if (RunSlice(call, nargs, get_cycles() + map_config.lua_slice_budget * get_cycles_per_ms()))
+        {
+            FinishSliced(call);
+            return 0;
+        }
+        SlicedCalls.push_back(std::move(call));
+        return 0;
+    }
+
+    // true if the hook is still running for this owner; the new call is dropped and counted
+    bool IsSlicePending(const int8* File, const char* hook, uint32 owner)
+    {
+        for (auto& call : SlicedCalls)
+        {
+            if (call.owner == owner && strcmp(call.hook, hook) == 0)
+            {
+                SliceStats[string_t(File) + ":" + hook].skipped++;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    int32 ResumeSliced(time_point tick, CTaskMgr::CTask* PTask)
+    {
+        uint64 deadline = get_cycles() + map_config.lua_slice_budget * get_cycles_per_ms();
+        size_t pending = SlicedCalls.size();
+
+        for (size_t i = 0; i < pending && get_cycles() < deadline; ++i)
+        {
+            sliced_call_t call = std::move(SlicedCalls.front());
+            SlicedCalls.pop_front();
+
+            bool released = std::any_of(call.entities.begin(), call.entities.end(), [](std::pair<CLuaBaseEntity*, int32>& entity)
+            {
+                return entity.first->GetBaseEntity() == nullptr;
+            });
+            // the fighter is one of the entities passed in, so it is only looked at while it still exists
+            bool fightOver = !released && call.fighter != nullptr &&
+                (!call.fighter->isAlive() || !call.fighter->PAI->IsEngaged() || call.fighter->GetBattleStartTime() != call.engaged);
+
+            if (released)
+            {
+                ShowWarning("luautils::%s (%s): entity went away after %u slices, call dropped\n", call.hook, call.file.c_str(), call.slices);
+                FinishSliced(call);
+            }
+            else if (fightOver)
+            {
+                FinishSliced(call);
+            }
+            else if (RunSlice(call, 0, deadline))
+            {
+                FinishSliced(call);
+            }
+            else
+            {
+                SlicedCalls.push_back(std::move(call));     // back of the queue, the others go first next tick
+            }
+        }
+        return 0;
+    }
+
+    void LogSliceOverruns()
+    {
+        for (auto& entry : SliceStats)
+        {
+            ShowDebug("luautils: %s over budget %u times (most %u slices, %.1fms past a deadline), %u calls skipped while pending\n",
+                entry.first.c_str(), entry.second.calls, entry.second.maxSlices,
+                (double)entry.second.maxOverrun / get_cycles_per_ms(), entry.second.skipped);
+        }
+        SliceStats.clear();
+    }
+
     int32 SendEntityVisualPacket(lua_State* L)
     {
         if ((!lua_isnil(L, 1) && lua_isnumber(L, 1)) &&
@@ -337,12 +766,7 @@ namespace luautils
             }
             else
             {
-                lua_getglobal(L, CLuaBaseEntity::className);
-                lua_pushstring(L, "new");
-                lua_gettable(L, -2);
-                lua_insert(L, -2);
-                lua_pushlightuserdata(L, (void*)PNpc);
-                lua_pcall(L, 2, 1, 0);
+                CLuaBaseEntity::Push(L, PNpc);
             }
 
             return 1;
@@ -372,12 +796,7 @@ namespace luautils
             }
             else
             {
-                lua_getglobal(L, CLuaBaseEntity::className);
-                lua_pushstring(L, "new");
-                lua_gettable(L, -2);
-                lua_insert(L, -2);
-                lua_pushlightuserdata(L, (void*)PMob);
-                lua_pcall(L, 2, 1, 0);
+                CLuaBaseEntity::Push(L, PMob);
             }
 
             return 1;
@@ -519,7 +938,7 @@ namespace luautils
 
         snprintf(File, sizeof(File), "scripts/globals/conquest.lua");
 
-        if (luaL_loadfile(LuaHandle, File) || lua_pcall(LuaHandle, 0, 0, 0))
+        if (luaL_loadfile(LuaHandle, File) || pcall(LuaHandle, 0, 0, 0))
         {
             ShowError("luautils::SetRegionalConquestOverseers: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -536,7 +955,7 @@ namespace luautils
 
         lua_pushinteger(LuaHandle, regionID);
 
-        if (lua_pcall(LuaHandle, 1, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 1, LUA_MULTRET, 0))
         {
             ShowError("luautils::SetRegionalConquestOverseers: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -857,12 +1276,7 @@ namespace luautils
                         ShowDebug(CL_CYAN"SpawnMob: <%s> is already spawned\n" CL_RESET, PMob->GetName());
                     }
                 }
-                lua_getglobal(L, CLuaBaseEntity::className);
-                lua_pushstring(L, "new");
-                lua_gettable(L, -2);
-                lua_insert(L, -2);
-                lua_pushlightuserdata(L, (void*)PMob);
-                lua_pcall(L, 2, 1, 0);
+                CLuaBaseEntity::Push(L, PMob);
                 return 1;
             }
             else
@@ -966,12 +1380,7 @@ namespace luautils
 
             if (PTargetChar != nullptr)
             {
-                lua_getglobal(L, CLuaBaseEntity::className);
-                lua_pushstring(L, "new");
-                lua_gettable(L, -2);
-                lua_insert(L, -2);
-                lua_pushlightuserdata(L, (void*)PTargetChar);
-                lua_pcall(L, 2, 1, 0);
+                CLuaBaseEntity::Push(L, PTargetChar);
                 return 1;
             }
         }
@@ -1070,7 +1479,7 @@ namespace luautils
         memset(File, 0, sizeof(File));
         snprintf(File, sizeof(File), "scripts/zones/%s/TextIDs.lua", zoneutils::GetZone(ZoneID)->GetName());
 
-        if (luaL_loadfile(LuaHandle, File) || lua_pcall(LuaHandle, 0, 0, 0))
+        if (luaL_loadfile(LuaHandle, File) || pcall(LuaHandle, 0, 0, 0))
         {
             lua_pop(LuaHandle, 1);
             return 0;
@@ -1104,7 +1513,7 @@ namespace luautils
         memset(File, 0, sizeof(File));
         snprintf(File, sizeof(File), "scripts/globals/settings.lua");
 
-        if (luaL_loadfile(LuaHandle, File) || lua_pcall(LuaHandle, 0, 0, 0))
+        if (luaL_loadfile(LuaHandle, File) || pcall(LuaHandle, 0, 0, 0))
         {
             lua_pop(LuaHandle, 1);
             return 0;
@@ -1180,7 +1589,7 @@ namespace luautils
         CLuaZone LuaZone(PZone);
         Lunar<CLuaZone>::push(LuaHandle, &LuaZone);
 
-        if (lua_pcall(LuaHandle, 1, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 1, LUA_MULTRET, 0))
         {
             ShowError("luautils::onInitialize: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -1210,13 +1619,12 @@ namespace luautils
             return -1;
         }
 
-        CLuaBaseEntity LuaBaseEntity(PChar);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaBaseEntity);
+        CLuaBaseEntity::Push(LuaHandle, PChar);
 
         lua_pushboolean(LuaHandle, PChar->GetPlayTime(false) == 0); // first login
         lua_pushboolean(LuaHandle, zoning);
 
-        if (lua_pcall(LuaHandle, 3, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 3, LUA_MULTRET, 0))
         {
             ShowError("luautils::onGameIn: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -1247,12 +1655,11 @@ namespace luautils
             return -1;
         }
 
-        CLuaBaseEntity LuaBaseEntity(PChar);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaBaseEntity);
+        CLuaBaseEntity::Push(LuaHandle, PChar);
 
         lua_pushinteger(LuaHandle, PChar->loc.prevzone);
 
-        if (lua_pcall(LuaHandle, 2, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 2, LUA_MULTRET, 0))
         {
             ShowError("luautils::onZoneIn: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -1288,10 +1695,9 @@ namespace luautils
             return -1;
         }
 
-        CLuaBaseEntity LuaBaseEntity(PChar);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaBaseEntity);
+        CLuaBaseEntity::Push(LuaHandle, PChar);
 
-        if (lua_pcall(LuaHandle, 1, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 1, LUA_MULTRET, 0))
         {
             ShowError("luautils::afterZoneIn: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -1326,12 +1732,11 @@ namespace luautils
             return -1;
         }
 
-        CLuaBaseEntity LuaBaseEntity(PChar);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaBaseEntity);
+        CLuaBaseEntity::Push(LuaHandle, PChar);
         CLuaRegion LuaRegion(PRegion);
         Lunar<CLuaRegion>::push(LuaHandle, &LuaRegion);
 
-        if (lua_pcall(LuaHandle, 2, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 2, LUA_MULTRET, 0))
         {
             ShowError("luautils::onRegionEnter: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -1365,12 +1770,11 @@ namespace luautils
             return -1;
         }
 
-        CLuaBaseEntity LuaBaseEntity(PChar);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaBaseEntity);
+        CLuaBaseEntity::Push(LuaHandle, PChar);
         CLuaRegion LuaRegion(PRegion);
         Lunar<CLuaRegion>::push(LuaHandle, &LuaRegion);
 
-        if (lua_pcall(LuaHandle, 2, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 2, LUA_MULTRET, 0))
         {
             ShowError("luautils::onRegionLeave: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -1412,7 +1816,7 @@ namespace luautils
             return -1;
         }
 
-        ret = lua_pcall(LuaHandle, 0, 0, 0);
+        ret = pcall(LuaHandle, 0, 0, 0);
         if (ret)
         {
             ShowError("luautils::%s: %s\n", "onTrigger", lua_tostring(LuaHandle, -1));
@@ -1427,13 +1831,11 @@ namespace luautils
             return -1;
         }
 
-        CLuaBaseEntity LuaBaseEntity(PChar);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaBaseEntity);
+        CLuaBaseEntity::Push(LuaHandle, PChar);
 
-        CLuaBaseEntity LuaBaseEntityTarg(PNpc);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaBaseEntityTarg);
+        CLuaBaseEntity::Push(LuaHandle, PNpc);
 
-        if (lua_pcall(LuaHandle, 2, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 2, LUA_MULTRET, 0))
         {
             ShowError("luautils::onTrigger: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -1479,13 +1881,13 @@ namespace luautils
         lua_setglobal(LuaHandle, "onEventUpdate");
 
         int8 File[255];
-        if (luaL_loadfile(LuaHandle, PChar->m_event.Script.c_str()) || lua_pcall(LuaHandle, 0, 0, 0))
+        if (luaL_loadfile(LuaHandle, PChar->m_event.Script.c_str()) || pcall(LuaHandle, 0, 0, 0))
         {
             lua_pop(LuaHandle, 1);
             memset(File, 0, sizeof(File));
             snprintf(File, sizeof(File), "scripts/zones/%s/Zone.lua", PChar->loc.zone->GetName());
 
-            if (luaL_loadfile(LuaHandle, File) || lua_pcall(LuaHandle, 0, 0, 0))
+            if (luaL_loadfile(LuaHandle, File) || pcall(LuaHandle, 0, 0, 0))
             {
                 ShowError("luautils::onEventUpdate %s\n", lua_tostring(LuaHandle, -1));
                 ShowError("luautils::onEventUpdate: %s\n", lua_tostring(LuaHandle, -1));
@@ -1502,16 +1904,14 @@ namespace luautils
             return -1;
         }
 
-        CLuaBaseEntity LuaBaseEntity(PChar);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaBaseEntity);
+        CLuaBaseEntity::Push(LuaHandle, PChar);
 
         lua_pushinteger(LuaHandle, eventID);
         lua_pushinteger(LuaHandle, result);
 
-        CLuaBaseEntity LuaTargetEntity(PChar->m_event.Target);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaTargetEntity);
+        CLuaBaseEntity::Push(LuaHandle, PChar->m_event.Target);
 
-        if (lua_pcall(LuaHandle, 4, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 4, LUA_MULTRET, 0))
         {
             ShowError("luautils::onEventUpdate: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -1534,13 +1934,13 @@ namespace luautils
         lua_setglobal(LuaHandle, "onEventUpdate");
 
         int8 File[255];
-        if (luaL_loadfile(LuaHandle, PChar->m_event.Script.c_str()) || lua_pcall(LuaHandle, 0, 0, 0))
+        if (luaL_loadfile(LuaHandle, PChar->m_event.Script.c_str()) || pcall(LuaHandle, 0, 0, 0))
         {
             lua_pop(LuaHandle, 1);
             memset(File, 0, sizeof(File));
             snprintf(File, sizeof(File), "scripts/zones/%s/Zone.lua", PChar->loc.zone->GetName());
 
-            if (luaL_loadfile(LuaHandle, File) || lua_pcall(LuaHandle, 0, 0, 0))
+            if (luaL_loadfile(LuaHandle, File) || pcall(LuaHandle, 0, 0, 0))
             {
                 ShowError("luautils::onEventUpdate %s\n", lua_tostring(LuaHandle, -1));
                 ShowError("luautils::onEventUpdate: %s\n", lua_tostring(LuaHandle, -1));
@@ -1557,16 +1957,14 @@ namespace luautils
             return -1;
         }
 
-        CLuaBaseEntity LuaBaseEntity(PChar);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaBaseEntity);
+        CLuaBaseEntity::Push(LuaHandle, PChar);
 
         lua_pushinteger(LuaHandle, PChar->m_event.EventID);
         lua_pushstring(LuaHandle, string);
 
-        CLuaBaseEntity LuaTargetEntity(PChar->m_event.Target);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaTargetEntity);
+        CLuaBaseEntity::Push(LuaHandle, PChar->m_event.Target);
 
-        if (lua_pcall(LuaHandle, 4, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 4, LUA_MULTRET, 0))
         {
             ShowError("luautils::onEventUpdate: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -1595,13 +1993,13 @@ namespace luautils
         lua_setglobal(LuaHandle, "onEventFinish");
 
         int8 File[255];
-        if (luaL_loadfile(LuaHandle, PChar->m_event.Script.c_str()) || lua_pcall(LuaHandle, 0, 0, 0))
+        if (luaL_loadfile(LuaHandle, PChar->m_event.Script.c_str()) || pcall(LuaHandle, 0, 0, 0))
         {
             lua_pop(LuaHandle, 1);
             memset(File, 0, sizeof(File));
             snprintf(File, sizeof(File), "scripts/zones/%s/Zone.lua", PChar->loc.zone->GetName());
 
-            if (luaL_loadfile(LuaHandle, File) || lua_pcall(LuaHandle, 0, 0, 0))
+            if (luaL_loadfile(LuaHandle, File) || pcall(LuaHandle, 0, 0, 0))
             {
                 ShowError("luautils::onEventFinish %s\n", lua_tostring(LuaHandle, -1));
                 lua_pop(LuaHandle, 1);
@@ -1617,16 +2015,14 @@ namespace luautils
             return -1;
         }
 
-        CLuaBaseEntity LuaBaseEntity(PChar);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaBaseEntity);
+        CLuaBaseEntity::Push(LuaHandle, PChar);
 
         lua_pushinteger(LuaHandle, eventID);
         lua_pushinteger(LuaHandle, result);
 
-        CLuaBaseEntity LuaTargetEntity(PChar->m_event.Target);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaTargetEntity);
+        CLuaBaseEntity::Push(LuaHandle, PChar->m_event.Target);
 
-        if (lua_pcall(LuaHandle, 4, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 4, LUA_MULTRET, 0))
         {
             ShowError("luautils::onEventFinish %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -1665,16 +2061,14 @@ namespace luautils
             return -1;
         }
 
-        CLuaBaseEntity LuaBaseEntity(PChar);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaBaseEntity);
+        CLuaBaseEntity::Push(LuaHandle, PChar);
 
-        CLuaBaseEntity LuaBaseEntityTarg(PNpc);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaBaseEntityTarg);
+        CLuaBaseEntity::Push(LuaHandle, PNpc);
 
         CLuaTradeContainer LuaTradeContainer(PChar->TradeContainer);
         Lunar<CLuaTradeContainer>::push(LuaHandle, &LuaTradeContainer);
 
-        if (lua_pcall(LuaHandle, 3, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 3, LUA_MULTRET, 0))
         {
             ShowError("luautils::onTrade: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -1700,10 +2094,9 @@ namespace luautils
             return -1;
         }
 
-        CLuaBaseEntity LuaBaseEntity(PNpc);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaBaseEntity);
+        CLuaBaseEntity::Push(LuaHandle, PNpc);
 
-        if (lua_pcall(LuaHandle, 1, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 1, LUA_MULTRET, 0))
         {
             ShowError("luautils::onNpcSpawn: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -1728,15 +2121,13 @@ namespace luautils
             return -1;
         }
 
-        CLuaBaseEntity LuaBaseEntity(PAttacker);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaBaseEntity);
+        CLuaBaseEntity::Push(LuaHandle, PAttacker);
 
-        CLuaBaseEntity LuaMobEntity(PDefender);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaMobEntity);
+        CLuaBaseEntity::Push(LuaHandle, PDefender);
 
         lua_pushinteger(LuaHandle, damage);
 
-        if (lua_pcall(LuaHandle, 3, 3, 0))
+        if (pcall(LuaHandle, 3, 3, 0))
         {
             ShowError("luautils::onAdditionalEffect: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -1760,15 +2151,13 @@ namespace luautils
             return -1;
         }
 
-        CLuaBaseEntity LuaBaseEntity(PDefender);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaBaseEntity);
+        CLuaBaseEntity::Push(LuaHandle, PDefender);
 
-        CLuaBaseEntity LuaMobEntity(PAttacker);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaMobEntity);
+        CLuaBaseEntity::Push(LuaHandle, PAttacker);
 
         lua_pushinteger(LuaHandle, damage);
 
-        if (lua_pcall(LuaHandle, 3, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 3, LUA_MULTRET, 0))
         {
             ShowError("luautils::onSpikesDamage: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -1816,13 +2205,12 @@ namespace luautils
             return -1;
         }
 
-        CLuaBaseEntity LuaBaseEntity(PEntity);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaBaseEntity);
+        CLuaBaseEntity::Push(LuaHandle, PEntity);
 
         CLuaStatusEffect LuaStatusEffect(PStatusEffect);
         Lunar<CLuaStatusEffect>::push(LuaHandle, &LuaStatusEffect);
 
-        if (lua_pcall(LuaHandle, 2, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 2, LUA_MULTRET, 0))
         {
             ShowError("luautils::onEffectGain: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -1852,13 +2240,12 @@ namespace luautils
             return -1;
         }
 
-        CLuaBaseEntity LuaBaseEntity(PEntity);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaBaseEntity);
+        CLuaBaseEntity::Push(LuaHandle, PEntity);
 
         CLuaStatusEffect LuaStatusEffect(PStatusEffect);
         Lunar<CLuaStatusEffect>::push(LuaHandle, &LuaStatusEffect);
 
-        if (lua_pcall(LuaHandle, 2, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 2, LUA_MULTRET, 0))
         {
             ShowError("luautils::onEffectTick: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -1889,13 +2276,12 @@ namespace luautils
             return -1;
         }
 
-        CLuaBaseEntity LuaBaseEntity(PEntity);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaBaseEntity);
+        CLuaBaseEntity::Push(LuaHandle, PEntity);
 
         CLuaStatusEffect LuaStatusEffect(PStatusEffect);
         Lunar<CLuaStatusEffect>::push(LuaHandle, &LuaStatusEffect);
 
-        if (lua_pcall(LuaHandle, 2, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 2, LUA_MULTRET, 0))
         {
             ShowError("luautils::onEffectLose: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -1919,12 +2305,11 @@ namespace luautils
             return -1;
         }
 
-        CLuaBaseEntity LuaBaseEntity(PEntity);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaBaseEntity);
+        CLuaBaseEntity::Push(LuaHandle, PEntity);
 
         lua_pushinteger(LuaHandle, maneuvers);
 
-        if (lua_pcall(LuaHandle, 2, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 2, LUA_MULTRET, 0))
         {
             ShowError("luautils::onManeuverGain: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -1948,12 +2333,11 @@ namespace luautils
             return -1;
         }
 
-        CLuaBaseEntity LuaBaseEntity(PEntity);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaBaseEntity);
+        CLuaBaseEntity::Push(LuaHandle, PEntity);
 
         lua_pushinteger(LuaHandle, maneuvers);
 
-        if (lua_pcall(LuaHandle, 2, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 2, LUA_MULTRET, 0))
         {
             ShowError("luautils::onManeuverLose: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -1984,12 +2368,11 @@ namespace luautils
             return -1;
         }
 
-        CLuaBaseEntity LuaBaseEntity(PTarget);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaBaseEntity);
+        CLuaBaseEntity::Push(LuaHandle, PTarget);
 
         lua_pushinteger(LuaHandle, param);
 
-        if (lua_pcall(LuaHandle, 2, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 2, LUA_MULTRET, 0))
         {
             ShowError("luautils::onItemCheck: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -2037,10 +2420,9 @@ namespace luautils
             return -1;
         }
 
-        CLuaBaseEntity LuaBaseEntity(PTarget);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaBaseEntity);
+        CLuaBaseEntity::Push(LuaHandle, PTarget);
 
-        if (lua_pcall(LuaHandle, 1, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 1, LUA_MULTRET, 0))
         {
             ShowError("luautils::onItemUse: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -2071,12 +2453,11 @@ namespace luautils
             return 56;
         }
 
-        CLuaBaseEntity LuaBaseEntity(PTarget);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaBaseEntity);
+        CLuaBaseEntity::Push(LuaHandle, PTarget);
 
         lua_pushinteger(LuaHandle, 0);
 
-        if (lua_pcall(LuaHandle, 2, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 2, LUA_MULTRET, 0))
         {
             ShowError("luautils::CheckForGearSet: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -2110,16 +2491,14 @@ namespace luautils
             return 0;
         }
 
-        CLuaBaseEntity LuaCasterEntity(PCaster);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaCasterEntity);
+        CLuaBaseEntity::Push(LuaHandle, PCaster);
 
-        CLuaBaseEntity LuaTargetEntity(PTarget);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaTargetEntity);
+        CLuaBaseEntity::Push(LuaHandle, PTarget);
 
         CLuaSpell LuaSpell(PSpell);
         Lunar<CLuaSpell>::push(LuaHandle, &LuaSpell);
 
-        if (lua_pcall(LuaHandle, 3, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 3, LUA_MULTRET, 0))
         {
             ShowError("luautils::onSpellCast: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -2158,13 +2537,12 @@ namespace luautils
                 return 0;
             }
 
-            CLuaBaseEntity LuaCasterEntity(PCaster);
-            Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaCasterEntity);
+            CLuaBaseEntity::Push(LuaHandle, PCaster);
 
             CLuaSpell LuaSpell(PSpell);
             Lunar<CLuaSpell>::push(LuaHandle, &LuaSpell);
 
-            if (lua_pcall(LuaHandle, 2, LUA_MULTRET, 0))
+            if (pcall(LuaHandle, 2, LUA_MULTRET, 0))
             {
                 ShowError("luautils::onSpellPrecast: %s\n", lua_tostring(LuaHandle, -1));
                 lua_pop(LuaHandle, 1);
@@ -2191,14 +2569,12 @@ namespace luautils
             return -1;
         }
 
-        CLuaBaseEntity LuaMobEntity(PCaster);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaMobEntity);
+        CLuaBaseEntity::Push(LuaHandle, PCaster);
 
-        CLuaBaseEntity LuaTargetEntity(PTarget);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaTargetEntity);
+        CLuaBaseEntity::Push(LuaHandle, PTarget);
 
 
-        if (lua_pcall(LuaHandle, 2, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 2, LUA_MULTRET, 0))
         {
             ShowError("luautils::onMonsterMagicPrepare: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -2238,16 +2614,14 @@ namespace luautils
             return 0;
         }
 
-        CLuaBaseEntity LuaCasterEntity(PCaster);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaCasterEntity);
+        CLuaBaseEntity::Push(LuaHandle, PCaster);
 
-        CLuaBaseEntity LuaTargetEntity(PTarget);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaTargetEntity);
+        CLuaBaseEntity::Push(LuaHandle, PTarget);
 
         CLuaSpell LuaSpell(PSpell);
         Lunar<CLuaSpell>::push(LuaHandle, &LuaSpell);
 
-        if (lua_pcall(LuaHandle, 3, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 3, LUA_MULTRET, 0))
         {
             ShowError("luautils::onMagicHit: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -2290,15 +2664,13 @@ namespace luautils
             return 0;
         }
 
-        CLuaBaseEntity LuaMobEntity(PMob);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaMobEntity);
+        CLuaBaseEntity::Push(LuaHandle, PMob);
 
-        CLuaBaseEntity LuaBaseEntity(PAttacker);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaBaseEntity);
+        CLuaBaseEntity::Push(LuaHandle, PAttacker);
 
         lua_pushinteger(LuaHandle, PWeaponskill);
 
-        if (lua_pcall(LuaHandle, 3, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 3, LUA_MULTRET, 0))
         {
             ShowError("luautils::onWeaponskillHit: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -2339,10 +2711,9 @@ namespace luautils
             return -1;
         }
 
-        CLuaBaseEntity LuaMobEntity(PMob);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaMobEntity);
+        CLuaBaseEntity::Push(LuaHandle, PMob);
 
-        if (lua_pcall(LuaHandle, 1, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 1, LUA_MULTRET, 0))
         {
             ShowError("luautils::onMobInitialize: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -2376,7 +2747,7 @@ namespace luautils
             return -1;
         }
 
-        ret = lua_pcall(LuaHandle, 0, 0, 0);
+        ret = pcall(LuaHandle, 0, 0, 0);
         if (ret)
         {
             ShowError("luautils::%s: %s\n", "applyMixins", lua_tostring(LuaHandle, -1));
@@ -2392,8 +2763,7 @@ namespace luautils
             return -1;
         }
 
-        CLuaBaseEntity LuaMobEntity(PMob);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaMobEntity);
+        CLuaBaseEntity::Push(LuaHandle, PMob);
 
         //get the parameter "mixins"
         lua_getglobal(LuaHandle, "mixins");
@@ -2405,7 +2775,7 @@ namespace luautils
         //get the parameter "mixinOptions" (optional)
         lua_getglobal(LuaHandle, "mixinOptions");
 
-        if (lua_pcall(LuaHandle, 3, 0, 0))
+        if (pcall(LuaHandle, 3, 0, 0))
         {
             ShowError("luautils::applyMixins: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -2426,10 +2796,9 @@ namespace luautils
                 return -1;
             }
 
-            CLuaBaseEntity LuaMobEntity(PEntity);
-            Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaMobEntity);
+            CLuaBaseEntity::Push(LuaHandle, PEntity);
 
-            if (lua_pcall(LuaHandle, 1, 0, 0))
+            if (pcall(LuaHandle, 1, 0, 0))
             {
                 ShowError("luautils::onPath: %s\n", lua_tostring(LuaHandle, -1));
                 lua_pop(LuaHandle, 1);
@@ -2449,9 +2818,6 @@ namespace luautils
     {
         DSP_DEBUG_BREAK_IF(PTarget == nullptr || PMob == nullptr);
 
-        CLuaBaseEntity LuaMobEntity(PMob);
-        CLuaBaseEntity LuaKillerEntity(PTarget);
-
         int8 File[255];
         PMob->objtype == TYPE_PET ? snprintf(File, sizeof(File), "scripts/globals/pets/%s.lua", static_cast<CPetEntity*>(PMob)->GetScriptName().c_str()) :
             snprintf(File, sizeof(File), "scripts/zones/%s/mobs/%s.lua", PMob->loc.zone->GetName(), PMob->GetName());
@@ -2468,10 +2834,10 @@ namespace luautils
             return -1;
         }
 
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaMobEntity);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaKillerEntity);
+        CLuaBaseEntity::Push(LuaHandle, PMob);
+        CLuaBaseEntity::Push(LuaHandle, PTarget);
 
-        if (lua_pcall(LuaHandle, 2, 0, 0))
+        if (pcall(LuaHandle, 2, 0, 0))
         {
             ShowError("luautils::onMobEngaged: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -2501,12 +2867,11 @@ namespace luautils
             return -1;
         }
 
-        CLuaBaseEntity LuaMobEntity(PMob);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaMobEntity);
+        CLuaBaseEntity::Push(LuaHandle, PMob);
 
         lua_pushinteger(LuaHandle, weather);
 
-        if (lua_pcall(LuaHandle, 2, 0, 0))
+        if (pcall(LuaHandle, 2, 0, 0))
         {
             ShowError("luautils::onMobDisengage: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -2519,9 +2884,6 @@ namespace luautils
     {
         DSP_DEBUG_BREAK_IF(PTarget == nullptr || PMob == nullptr);
 
-        CLuaBaseEntity LuaMobEntity(PMob);
-        CLuaBaseEntity LuaKillerEntity(PTarget);
-
         lua_prepscript("scripts/zones/%s/mobs/%s.lua", PMob->loc.zone->GetName(), PMob->GetName());
 
         if (PTarget->objtype != TYPE_PET && PTarget->objtype != TYPE_MOB)
@@ -2536,10 +2898,10 @@ namespace luautils
             return -1;
         }
 
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaMobEntity);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaKillerEntity);
+        CLuaBaseEntity::Push(LuaHandle, PMob);
+        CLuaBaseEntity::Push(LuaHandle, PTarget);
 
-        if (lua_pcall(LuaHandle, 2, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 2, LUA_MULTRET, 0))
         {
             ShowError("luautils::onMobDrawIn: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -2565,36 +2927,29 @@ namespace luautils
         DSP_DEBUG_BREAK_IF(PMob == nullptr);
         DSP_DEBUG_BREAK_IF(PTarget == nullptr || PTarget->objtype == TYPE_NPC);
 
-        CLuaBaseEntity LuaMobEntity(PMob);
-        CLuaBaseEntity LuaKillerEntity(PTarget);
-
         int8 File[255];
         PMob->objtype == TYPE_PET ? snprintf(File, sizeof(File), "scripts/globals/pets/%s.lua", static_cast<CPetEntity*>(PMob)->GetScriptName().c_str()) :
             snprintf(File, sizeof(File), "scripts/zones/%s/mobs/%s.lua", PMob->loc.zone->GetName(), PMob->GetName());
 
+        if (IsSlicePending(File, "onMobFight", PMob->id))
+        {
+            return 0;
+        }
         if (prepFile(File, "onMobFight"))
         {
             return -1;
         }
 
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaMobEntity);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaKillerEntity);
+        CLuaBaseEntity::Push(LuaHandle, PMob);
+        CLuaBaseEntity::Push(LuaHandle, PTarget);
 
-        if (lua_pcall(LuaHandle, 2, 0, 0))
-        {
-            ShowError("luautils::onMobFight: %s\n", lua_tostring(LuaHandle, -1));
-            lua_pop(LuaHandle, 1);
-            return -1;
-        }
-        return 0;
+        return CallSliced(File, "onMobFight", PMob->id, 2, static_cast<CBattleEntity*>(PMob));
     }
 
     int32 OnCriticalHit(CBattleEntity* PMob)
     {
         DSP_DEBUG_BREAK_IF(PMob == nullptr || PMob->objtype != TYPE_MOB)
 
-            CLuaBaseEntity LuaMobEntity(PMob);
-
         lua_prepscript("scripts/zones/%s/mobs/%s.lua", PMob->loc.zone->GetName(), PMob->GetName());
 
         if (prepFile(File, "onCriticalHit"))
@@ -2602,9 +2957,9 @@ namespace luautils
             return -1;
         }
 
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaMobEntity);
+        CLuaBaseEntity::Push(LuaHandle, PMob);
 
-        if (lua_pcall(LuaHandle, 1, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 1, LUA_MULTRET, 0))
         {
             ShowError("luautils::onCriticalHit: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -2645,21 +3000,17 @@ namespace luautils
                         return;
                     }
 
-                    CLuaBaseEntity LuaMobEntity(PMob);
-                    CLuaBaseEntity LuaKillerEntity(PChar);
-                    CLuaBaseEntity LuaAllyEntity(PMember);
-
                     bool isWeaponSkillKill = PChar->getWeaponSkillKill();
 
-                    Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaMobEntity);
-                    Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaKillerEntity);
-                    Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaAllyEntity);
+                    CLuaBaseEntity::Push(LuaHandle, PMob);
+                    CLuaBaseEntity::Push(LuaHandle, PChar);
+                    CLuaBaseEntity::Push(LuaHandle, PMember);
                     lua_pushboolean(LuaHandle, isWeaponSkillKill);
                     // lua_pushboolean(LuaHandle, isMagicKill);
                     // lua_pushboolean(LuaHandle, isPetKill);
                     // Upcoming AI rewrite will likely have a better way to handle it..
 
-                    if (lua_pcall(LuaHandle, 4, 0, 0))
+                    if (pcall(LuaHandle, 4, 0, 0))
                     {
                         ShowError("luautils::onMobDeathEx: %s\n", lua_tostring(LuaHandle, -1));
                         lua_pop(LuaHandle, 1);
@@ -2680,15 +3031,12 @@ namespace luautils
                 CCharEntity* PMember = (CCharEntity*)PPartyMember;
                 if (PMember->getZone() == PChar->getZone())
                 {
-                    CLuaBaseEntity LuaMobEntity(PMob);
-                    CLuaBaseEntity LuaKillerEntity(PChar);
-                    CLuaBaseEntity LuaAllyEntity(PMember);
 
                     PMember->m_event.reset();
                     PMember->m_event.Target = PMob;
                     PMember->m_event.Script.insert(0, File);
 
-                    if (luaL_loadfile(LuaHandle, File) || lua_pcall(LuaHandle, 0, 0, 0))
+                    if (luaL_loadfile(LuaHandle, File) || pcall(LuaHandle, 0, 0, 0))
                     {
                         lua_pop(LuaHandle, 1);
                         return;
@@ -2702,20 +3050,18 @@ namespace luautils
                         return;
                     }
 
-                    Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaMobEntity);
+                    CLuaBaseEntity::Push(LuaHandle, PMob);
                     if (PMember)
                     {
-                        CLuaBaseEntity LuaKillerEntity(PChar);
-                        CLuaBaseEntity LuaAllyEntity(PMember);
-                        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaKillerEntity);
-                        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaAllyEntity);
+                        CLuaBaseEntity::Push(LuaHandle, PChar);
+                        CLuaBaseEntity::Push(LuaHandle, PMember);
                     }
                     else
                     {
                         lua_pushnil(LuaHandle);
                     }
 
-                    if (lua_pcall(LuaHandle, 3, LUA_MULTRET, 0))
+                    if (pcall(LuaHandle, 3, LUA_MULTRET, 0))
                     {
                         ShowError("luautils::onMobDeath: %s\n", lua_tostring(LuaHandle, -1));
                         lua_pop(LuaHandle, 1);
@@ -2741,9 +3087,7 @@ namespace luautils
             lua_pushnil(LuaHandle);
             lua_setglobal(LuaHandle, "onMobDeath");
 
-            CLuaBaseEntity LuaMobEntity(PMob);
-
-            if (luaL_loadfile(LuaHandle, File) || lua_pcall(LuaHandle, 0, 0, 0))
+            if (luaL_loadfile(LuaHandle, File) || pcall(LuaHandle, 0, 0, 0))
             {
                 lua_pop(LuaHandle, 1);
                 return -1;
@@ -2757,11 +3101,11 @@ namespace luautils
                 return -1;
             }
 
-            Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaMobEntity);
+            CLuaBaseEntity::Push(LuaHandle, PMob);
             lua_pushnil(LuaHandle);
             lua_pushnil(LuaHandle);
 
-            if (lua_pcall(LuaHandle, 3, 0, 0))
+            if (pcall(LuaHandle, 3, 0, 0))
             {
                 ShowError("luautils::onMobDeath: %s\n", lua_tostring(LuaHandle, -1));
                 lua_pop(LuaHandle, 1);
@@ -2790,11 +3134,10 @@ namespace luautils
             return -1;
         }
 
-        CLuaBaseEntity LuaMobEntity(PMob);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaMobEntity);
+        CLuaBaseEntity::Push(LuaHandle, PMob);
 
 
-        if (lua_pcall(LuaHandle, 1, 0, 0))
+        if (pcall(LuaHandle, 1, 0, 0))
         {
             ShowError("luautils::onMobSpawn: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -2807,8 +3150,6 @@ namespace luautils
     {
         DSP_DEBUG_BREAK_IF(PMob == nullptr || PMob->objtype != TYPE_MOB)
 
-            CLuaBaseEntity LuaMobEntity(PMob);
-
         lua_prepscript("scripts/zones/%s/mobs/%s.lua", PMob->loc.zone->GetName(), PMob->GetName());
 
         if (prepFile(File, "onMobRoamAction"))
@@ -2816,9 +3157,9 @@ namespace luautils
             return -1;
         }
 
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaMobEntity);
+        CLuaBaseEntity::Push(LuaHandle, PMob);
 
-        if (lua_pcall(LuaHandle, 1, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 1, LUA_MULTRET, 0))
         {
             ShowError("luautils::onMobRoamAction: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -2842,8 +3183,6 @@ namespace luautils
     {
         DSP_DEBUG_BREAK_IF(PMob == nullptr || PMob->objtype != TYPE_MOB)
 
-            CLuaBaseEntity LuaMobEntity(PMob);
-
         lua_prepscript("scripts/zones/%s/mobs/%s.lua", PMob->loc.zone->GetName(), PMob->GetName());
 
         if (prepFile(File, "onMobRoam"))
@@ -2851,9 +3190,9 @@ namespace luautils
             return -1;
         }
 
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaMobEntity);
+        CLuaBaseEntity::Push(LuaHandle, PMob);
 
-        if (lua_pcall(LuaHandle, 1, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 1, LUA_MULTRET, 0))
         {
             ShowError("luautils::onMobRoam: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -2888,10 +3227,9 @@ namespace luautils
             return -1;
         }
 
-        CLuaBaseEntity LuaMobEntity(PMob);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaMobEntity);
+        CLuaBaseEntity::Push(LuaHandle, PMob);
 
-        if (lua_pcall(LuaHandle, 1, 0, 0))
+        if (pcall(LuaHandle, 1, 0, 0))
         {
             ShowError("luautils::onMobDespawn: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -2910,24 +3248,16 @@ namespace luautils
     {
         lua_prepscript("scripts/zones/%s/Zone.lua", PZone->GetName());
 
-        if (prepFile(File, "onGameDay"))
+        if (IsSlicePending(File, "onGameDay", PZone->GetID()))
         {
-            return -1;
+            return 0;
         }
-
-        if (lua_pcall(LuaHandle, 0, LUA_MULTRET, 0))
+        if (prepFile(File, "onGameDay"))
         {
-            ShowError("luautils::onGameDay: %s\n", lua_tostring(LuaHandle, -1));
-            lua_pop(LuaHandle, 1);
             return -1;
         }
-        int32 returns = lua_gettop(LuaHandle) - oldtop;
-        if (returns > 0)
-        {
-            ShowError("luautils::onGameDay (%s): 0 returns expected, got %d\n", File, returns);
-            lua_pop(LuaHandle, returns);
-        }
-        return 0;
+
+        return CallSliced(File, "onGameDay", PZone->GetID(), 0);
     }
 
     /************************************************************************
@@ -2940,24 +3270,16 @@ namespace luautils
     {
         lua_prepscript("scripts/zones/%s/Zone.lua", PZone->GetName());
 
-        if (prepFile(File, "onGameHour"))
+        if (IsSlicePending(File, "onGameHour", PZone->GetID()))
         {
-            return -1;
+            return 0;
         }
-
-        if (lua_pcall(LuaHandle, 0, LUA_MULTRET, 0))
+        if (prepFile(File, "onGameHour"))
         {
-            ShowError("luautils::onGameHour: %s\n", lua_tostring(LuaHandle, -1));
-            lua_pop(LuaHandle, 1);
             return -1;
         }
-        int32 returns = lua_gettop(LuaHandle) - oldtop;
-        if (returns > 0)
-        {
-            ShowError("luautils::onGameHour (%s): 0 returns expected, got %d\n", File, returns);
-            lua_pop(LuaHandle, returns);
-        }
-        return 0;
+
+        return CallSliced(File, "onGameHour", PZone->GetID(), 0);
     }
 
     int32 OnZoneWeatherChange(uint16 ZoneID, uint8 weather)
@@ -2971,7 +3293,7 @@ namespace luautils
 
         lua_pushinteger(LuaHandle, weather);
 
-        if (lua_pcall(LuaHandle, 1, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 1, LUA_MULTRET, 0))
         {
             lua_pop(LuaHandle, 1);
             return -1;
@@ -2996,7 +3318,7 @@ namespace luautils
 
         lua_pushinteger(LuaHandle, TOTD);
 
-        if (lua_pcall(LuaHandle, 1, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 1, LUA_MULTRET, 0))
         {
             lua_pop(LuaHandle, 1);
             return -1;
@@ -3025,11 +3347,9 @@ namespace luautils
             return std::tuple<int32, uint8, uint8>();
         }
 
-        CLuaBaseEntity LuaBaseEntity(PChar);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaBaseEntity);
+        CLuaBaseEntity::Push(LuaHandle, PChar);
 
-        CLuaBaseEntity LuaMobEntity(PMob);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaMobEntity);
+        CLuaBaseEntity::Push(LuaHandle, PMob);
 
         lua_pushinteger(LuaHandle, wskill->getID());
         lua_pushnumber(LuaHandle, tp/10);
@@ -3038,7 +3358,7 @@ namespace luautils
         CLuaAction LuaAction(&action);
         Lunar<CLuaAction>::push(LuaHandle, &LuaAction);
 
-        if (lua_pcall(LuaHandle, 6, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 6, LUA_MULTRET, 0))
         {
             ShowError("luautils::onUseWeaponSkill: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -3082,16 +3402,14 @@ namespace luautils
 
         if (!prepFile(File, "onMobWeaponSkill"))
         {
-            CLuaBaseEntity LuaBaseEntity(PTarget);
-            Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaBaseEntity);
+            CLuaBaseEntity::Push(LuaHandle, PTarget);
 
-            CLuaBaseEntity LuaMobEntity(PMob);
-            Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaMobEntity);
+            CLuaBaseEntity::Push(LuaHandle, PMob);
 
             CLuaMobSkill LuaMobSkill(PMobSkill);
             Lunar<CLuaMobSkill>::push(LuaHandle, &LuaMobSkill);
 
-            if (lua_pcall(LuaHandle, 3, LUA_MULTRET, 0))
+            if (pcall(LuaHandle, 3, LUA_MULTRET, 0))
             {
                 ShowError("luautils::onMobWeaponSkill: %s\n", lua_tostring(LuaHandle, -1));
                 lua_pop(LuaHandle, 1);
@@ -3116,14 +3434,12 @@ namespace luautils
         {
             return 0;
         }
-        CLuaBaseEntity LuaBaseEntity(PTarget);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaBaseEntity);
-        CLuaBaseEntity LuaMobEntity(PMob);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaMobEntity);
+        CLuaBaseEntity::Push(LuaHandle, PTarget);
+        CLuaBaseEntity::Push(LuaHandle, PMob);
         CLuaMobSkill LuaMobSkill(PMobSkill);
         Lunar<CLuaMobSkill>::push(LuaHandle, &LuaMobSkill);
 
-        if (lua_pcall(LuaHandle, 3, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 3, LUA_MULTRET, 0))
         {
             ShowError("luautils::onMobWeaponSkill: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -3160,16 +3476,14 @@ namespace luautils
             return 1;
         }
 
-        CLuaBaseEntity LuaBaseEntity(PTarget);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaBaseEntity);
+        CLuaBaseEntity::Push(LuaHandle, PTarget);
 
-        CLuaBaseEntity LuaMobEntity(PMob);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaMobEntity);
+        CLuaBaseEntity::Push(LuaHandle, PMob);
 
         CLuaMobSkill LuaMobSkill(PMobSkill);
         Lunar<CLuaMobSkill>::push(LuaHandle, &LuaMobSkill);
 
-        if (lua_pcall(LuaHandle, 3, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 3, LUA_MULTRET, 0))
         {
             ShowError("luautils::onMobSkillCheck (%s): %s\n", PMobSkill->getName(), lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -3200,16 +3514,14 @@ namespace luautils
             return -1;
         }
 
-        CLuaBaseEntity LuaBaseEntity(PTarget);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaBaseEntity);
+        CLuaBaseEntity::Push(LuaHandle, PTarget);
 
-        CLuaBaseEntity LuaMobEntity(PAutomaton);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaMobEntity);
+        CLuaBaseEntity::Push(LuaHandle, PAutomaton);
 
         CLuaMobSkill LuaMobSkill(PMobSkill);
         Lunar<CLuaMobSkill>::push(LuaHandle, &LuaMobSkill);
 
-        if (lua_pcall(LuaHandle, 3, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 3, LUA_MULTRET, 0))
         {
             ShowError("luautils::OnMobAutomatonSkillCheck (%s): %s\n", PMobSkill->getName(), lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -3246,16 +3558,14 @@ namespace luautils
             return 47;
         }
 
-        CLuaBaseEntity LuaCharEntity(PChar);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaCharEntity);
+        CLuaBaseEntity::Push(LuaHandle, PChar);
 
-        CLuaBaseEntity LuaBaseEntity(PTarget);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaBaseEntity);
+        CLuaBaseEntity::Push(LuaHandle, PTarget);
 
         CLuaSpell LuaSpell(PSpell);
         Lunar<CLuaSpell>::push(LuaHandle, &LuaSpell);
 
-        if (lua_pcall(LuaHandle, 3, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 3, LUA_MULTRET, 0))
         {
             ShowError("luautils::onMagicCastingCheck (%s): %s\n", PSpell->getName(), lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -3315,7 +3625,7 @@ namespace luautils
             }
         }
 
-        ret = lua_pcall(LuaHandle, 0, 0, 0);
+        ret = pcall(LuaHandle, 0, 0, 0);
         if (ret)
         {
             ShowError("luautils::%s: %s\n", "onAbilityCheck", lua_tostring(LuaHandle, -1));
@@ -3330,16 +3640,14 @@ namespace luautils
             return 87;
         }
 
-        CLuaBaseEntity LuaCharEntity(PChar);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaCharEntity);
+        CLuaBaseEntity::Push(LuaHandle, PChar);
 
-        CLuaBaseEntity LuaBaseEntity(PTarget);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaBaseEntity);
+        CLuaBaseEntity::Push(LuaHandle, PTarget);
 
         CLuaAbility LuaAbility(PAbility);
         Lunar<CLuaAbility>::push(LuaHandle, &LuaAbility);
 
-        if (lua_pcall(LuaHandle, 3, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 3, LUA_MULTRET, 0))
         {
             ShowError("luautils::onAbilityCheck (%s): %s\n", PAbility->getName(), lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -3380,22 +3688,19 @@ namespace luautils
             return 0;
         }
 
-        CLuaBaseEntity LuaBaseEntity(PTarget);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaBaseEntity);
+        CLuaBaseEntity::Push(LuaHandle, PTarget);
 
-        CLuaBaseEntity LuaMobEntity(PMob);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaMobEntity);
+        CLuaBaseEntity::Push(LuaHandle, PMob);
 
         CLuaMobSkill LuaMobSkill(PMobSkill);
         Lunar<CLuaMobSkill>::push(LuaHandle, &LuaMobSkill);
 
-        CLuaBaseEntity LuaMasterEntity(PMobMaster);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaMasterEntity);
+        CLuaBaseEntity::Push(LuaHandle, PMobMaster);
 
         CLuaAction LuaAction(action);
         Lunar<CLuaAction>::push(LuaHandle, &LuaAction);
 
-        if (lua_pcall(LuaHandle, 5, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 5, LUA_MULTRET, 0))
         {
             ShowError("luautils::onPetAbility: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -3434,11 +3739,9 @@ namespace luautils
             return 0;
         }
 
-        CLuaBaseEntity LuaBaseEntity(PUser);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaBaseEntity);
+        CLuaBaseEntity::Push(LuaHandle, PUser);
 
-        CLuaBaseEntity LuaMobEntity(PTarget);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaMobEntity);
+        CLuaBaseEntity::Push(LuaHandle, PTarget);
 
         CLuaAbility LuaAbility(PAbility);
         Lunar<CLuaAbility>::push(LuaHandle, &LuaAbility);
@@ -3446,7 +3749,7 @@ namespace luautils
         CLuaAction LuaAction(action);
         Lunar<CLuaAction>::push(LuaHandle, &LuaAction);
 
-        if (lua_pcall(LuaHandle, 4, 1, 0))
+        if (pcall(LuaHandle, 4, 1, 0))
         {
             ShowError("luautils::onUseAbility: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -3501,13 +3804,12 @@ namespace luautils
             return -1;
         }
 
-        CLuaBaseEntity LuaEntity(PChar);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaEntity);
+        CLuaBaseEntity::Push(LuaHandle, PChar);
 
         CLuaInstance LuaInstance(PInstance);
         Lunar<CLuaInstance>::push(LuaHandle, &LuaInstance);
 
-        if (lua_pcall(LuaHandle, 2, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 2, LUA_MULTRET, 0))
         {
             ShowError("luautils::onInstanceZoneIn: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -3535,10 +3837,9 @@ namespace luautils
             return -1;
         }
 
-        CLuaBaseEntity LuaBaseEntity(PChar);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaBaseEntity);
+        CLuaBaseEntity::Push(LuaHandle, PChar);
 
-        if (lua_pcall(LuaHandle, 1, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 1, LUA_MULTRET, 0))
         {
             ShowError("luautils::afterInstanceRegister: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -3562,7 +3863,7 @@ namespace luautils
             return -1;
         }
 
-        if (lua_pcall(LuaHandle, 0, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 0, LUA_MULTRET, 0))
         {
             ShowError("luautils::onInstanceLoadFailed: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -3598,7 +3899,7 @@ namespace luautils
 
         lua_pushinteger(LuaHandle, time);
 
-        if (lua_pcall(LuaHandle, 2, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 2, LUA_MULTRET, 0))
         {
             ShowError("luautils::onInstanceTimeUpdate: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -3625,7 +3926,7 @@ namespace luautils
         CLuaInstance LuaInstance(PInstance);
         Lunar<CLuaInstance>::push(LuaHandle, &LuaInstance);
 
-        if (lua_pcall(LuaHandle, 1, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 1, LUA_MULTRET, 0))
         {
             ShowError("luautils::onInstanceFailure: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -3654,12 +3955,12 @@ namespace luautils
         lua_setglobal(LuaHandle, "onInstanceCreated");
 
         int8 File[255];
-        if (luaL_loadfile(LuaHandle, PChar->m_event.Script.c_str()) || lua_pcall(LuaHandle, 0, 0, 0))
+        if (luaL_loadfile(LuaHandle, PChar->m_event.Script.c_str()) || pcall(LuaHandle, 0, 0, 0))
         {
             memset(File, 0, sizeof(File));
             snprintf(File, sizeof(File), "scripts/zones/%s/Zone.lua", PChar->loc.zone->GetName());
 
-            if (luaL_loadfile(LuaHandle, File) || lua_pcall(LuaHandle, 0, 0, 0))
+            if (luaL_loadfile(LuaHandle, File) || pcall(LuaHandle, 0, 0, 0))
             {
                 ShowError("luautils::onInstanceCreated %s\n", lua_tostring(LuaHandle, -1));
                 lua_pop(LuaHandle, 1);
@@ -3675,11 +3976,9 @@ namespace luautils
             return -1;
         }
 
-        CLuaBaseEntity LuaBaseEntity(PChar);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaBaseEntity);
+        CLuaBaseEntity::Push(LuaHandle, PChar);
 
-        CLuaBaseEntity LuaTargetEntity(PChar->m_event.Target);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaTargetEntity);
+        CLuaBaseEntity::Push(LuaHandle, PChar->m_event.Target);
 
         if (PInstance)
         {
@@ -3691,7 +3990,7 @@ namespace luautils
             lua_pushnil(LuaHandle);
         }
 
-        if (lua_pcall(LuaHandle, 3, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 3, LUA_MULTRET, 0))
         {
             ShowError("luautils::onInstanceCreated %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -3724,7 +4023,7 @@ namespace luautils
         CLuaInstance LuaInstance(PInstance);
         Lunar<CLuaInstance>::push(LuaHandle, &LuaInstance);
 
-        if (lua_pcall(LuaHandle, 1, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 1, LUA_MULTRET, 0))
         {
             ShowError("luautils::onInstanceCreated %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -3753,7 +4052,7 @@ namespace luautils
 
         lua_pushinteger(LuaHandle, PInstance->GetProgress());
 
-        if (lua_pcall(LuaHandle, 2, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 2, LUA_MULTRET, 0))
         {
             ShowError("luautils::onInstanceProgressUpdate %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -3782,7 +4081,7 @@ namespace luautils
 
         lua_pushinteger(LuaHandle, PInstance->GetStage());
 
-        if (lua_pcall(LuaHandle, 2, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 2, LUA_MULTRET, 0))
         {
             ShowError("luautils::onInstanceStageChange %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -3809,7 +4108,7 @@ namespace luautils
         CLuaInstance LuaInstance(PInstance);
         Lunar<CLuaInstance>::push(LuaHandle, &LuaInstance);
 
-        if (lua_pcall(LuaHandle, 1, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 1, LUA_MULTRET, 0))
         {
             ShowError("luautils::onInstanceComplete %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -3850,17 +4149,7 @@ namespace luautils
     {
         DSP_DEBUG_BREAK_IF(lua_isnil(L, -1) || !lua_isstring(L, -1));
 
-        int32 value = 0;
-
-        int32 ret = Sql_Query(SqlHandle, "SELECT value FROM server_variables WHERE name = '%s' LIMIT 1;", lua_tostring(L, -1));
-
-        if (ret != SQL_ERROR &&
-            Sql_NumRows(SqlHandle) != 0 &&
-            Sql_NextRow(SqlHandle) == SQL_SUCCESS)
-        {
-            value = (int32)Sql_GetIntData(SqlHandle, 0);
-        }
-        lua_pushinteger(L, value);
+        lua_pushinteger(L, serverutils::GetServerVar(lua_tostring(L, -1)));
         return 1;
     }
 
@@ -3875,16 +4164,7 @@ namespace luautils
         DSP_DEBUG_BREAK_IF(lua_isnil(L, -1) || !lua_isnumber(L, -1));
         DSP_DEBUG_BREAK_IF(lua_isnil(L, -2) || !lua_isstring(L, -2));
 
-        const int8* name = lua_tostring(L, -2);
-        int32 value = (int32)lua_tointeger(L, -1);
-
-        if (value == 0)
-        {
-            Sql_Query(SqlHandle, "DELETE FROM server_variables WHERE name = '%s' LIMIT 1;", name);
-            return 0;
-        }
-        Sql_Query(SqlHandle, "INSERT INTO server_variables VALUES ('%s', %i) ON DUPLICATE KEY UPDATE value = %i;", name, value, value);
-
+        serverutils::SetServerVar(lua_tostring(L, -2), (int32)lua_tointeger(L, -1));
         return 0;
     }
 
@@ -3903,12 +4183,11 @@ namespace luautils
             return -1;
         }
 
-        CLuaBaseEntity LuaBaseEntity(PChar);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaBaseEntity);
+        CLuaBaseEntity::Push(LuaHandle, PChar);
 
         lua_pushinteger(LuaHandle, TransportID);
 
-        if (lua_pcall(LuaHandle, 2, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 2, LUA_MULTRET, 0))
         {
             ShowError("luautils::onTransportEvent: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -3936,7 +4215,7 @@ namespace luautils
 
         lua_pushinteger(LuaHandle, type);
 
-        if (lua_pcall(LuaHandle, 2, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 2, LUA_MULTRET, 0))
         {
             ShowError("luautils::onConquestUpdate: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -3966,13 +4245,12 @@ namespace luautils
             return 0;
         }
 
-        CLuaBaseEntity LuaBaseEntity(PChar);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaBaseEntity);
+        CLuaBaseEntity::Push(LuaHandle, PChar);
 
         CLuaBattlefield LuaBattlefieldEntity(PBattlefield);
         Lunar<CLuaBattlefield>::push(LuaHandle, &LuaBattlefieldEntity);
 
-        if (lua_pcall(LuaHandle, 2, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 2, LUA_MULTRET, 0))
         {
             ShowError("luautils::onBcnmEnter: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -4009,8 +4287,7 @@ namespace luautils
             return 0;
         }
 
-        CLuaBaseEntity LuaBaseEntity(PChar);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaBaseEntity);
+        CLuaBaseEntity::Push(LuaHandle, PChar);
 
         CLuaBattlefield LuaBattlefieldEntity(PBattlefield);
         Lunar<CLuaBattlefield>::push(LuaHandle, &LuaBattlefieldEntity);
@@ -4021,7 +4298,7 @@ namespace luautils
         PChar->m_event.Target = PChar;
         PChar->m_event.Script.insert(0, File);
 
-        if (lua_pcall(LuaHandle, 3, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 3, LUA_MULTRET, 0))
         {
             ShowError("luautils::onBcnmLeave: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -4055,12 +4332,11 @@ namespace luautils
             return 0;
         }
 
-        CLuaBaseEntity LuaBaseEntity(PChar);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaBaseEntity);
+        CLuaBaseEntity::Push(LuaHandle, PChar);
 
         CLuaBattlefield LuaBattlefieldEntity(PBattlefield);
         Lunar<CLuaBattlefield>::push(LuaHandle, &LuaBattlefieldEntity);
-        if (lua_pcall(LuaHandle, 2, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 2, LUA_MULTRET, 0))
         {
             ShowError("luautils::onBcnmRegister: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -4092,7 +4368,7 @@ namespace luautils
         CLuaBattlefield LuaBattlefieldEntity(PBattlefield);
         Lunar<CLuaBattlefield>::push(LuaHandle, &LuaBattlefieldEntity);
 
-        if (lua_pcall(LuaHandle, 1, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 1, LUA_MULTRET, 0))
         {
             ShowError("luautils::onBcnmDestroy: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -4370,6 +4646,77 @@ namespace luautils
         return 0;
     }
 
+    /************************************************************************
+    *                                                                       *
+    *  Rebuilds the synthesis recipe index after synth_recipes was edited   *
+    *                                                                       *
+    ************************************************************************/
+
+    int32 ReloadSynthRecipes(lua_State* L)
+    {
+        synthutils::LoadSynthRecipes();
+        return 0;
+    }
+
+    /************************************************************************
+    *                                                                       *
+    *  Rebuilds the fishing catch tables after the fishing_* tables changed *
+    *                                                                       *
+    ************************************************************************/
+
+    int32 ReloadFishingCatches(lua_State* L)
+    {
+        fishingutils::LoadFishingCatches();
+        return 0;
+    }
+
+    /************************************************************************
+    *                                                                       *
+    *  Per-zone tick profiler, used by !profile                             *
+    *                                                                       *
+    ************************************************************************/
+
+    int32 SetZoneProfiling(lua_State* L)
+    {
+        DSP_DEBUG_BREAK_IF(lua_isnil(L, 1) || !lua_isboolean(L, 1));
+
+        profiler::SetEnabled(lua_toboolean(L, 1));
+        return 0;
+    }
+
+    int32 GetZoneProfile(lua_State* L)
+    {
+        DSP_DEBUG_BREAK_IF(lua_isnil(L, 1) || !lua_isnumber(L, 1));
+
+        std::vector<std::string> lines = profiler::Report((uint16)lua_tointeger(L, 1), lua_isnumber(L, 2) ? (uint8)lua_tointeger(L, 2) : 5);
+
+        gc_stats_t gc = GetGCStats(false);
+        int8 buf[128];
+
+        snprintf(buf, sizeof(buf), "  lua heap %u KB, %.1f KB/s allocated, gc %.3f ms per pass, max %.3f ms", gc.heap, gc.allocRate, gc.avgMs, gc.maxMs);
+        lines.emplace_back(buf);
+
+        lua_createtable(L, (int)lines.size(), 0);
+        for (size_t i = 0; i < lines.size(); ++i)
+        {
+            lua_pushstring(L, lines[i].c_str());
+            lua_rawseti(L, -2, (int)i + 1);
+        }
+        return 1;
+    }
+
+    int32 DumpZoneProfile(lua_State* L)
+    {
+        lua_pushboolean(L, profiler::Dump());
+        return 1;
+    }
+
+    int32 ResetZoneProfile(lua_State* L)
+    {
+        profiler::Reset();
+        return 0;
+    }
+
     inline int32 nearLocation(lua_State* L)
     {
         DSP_DEBUG_BREAK_IF(lua_isnil(L, 1));
@@ -4413,10 +4760,9 @@ namespace luautils
         if (prepFile(File, "onPlayerLevelUp"))
             return -1;
 
-        CLuaBaseEntity LuaBaseEntity(PChar);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaBaseEntity);
+        CLuaBaseEntity::Push(LuaHandle, PChar);
 
-        if (lua_pcall(LuaHandle, 1, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 1, LUA_MULTRET, 0))
         {
             ShowError("luautils::onPlayerLevelUp: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -4439,10 +4785,9 @@ namespace luautils
         if (prepFile(File, "onPlayerLevelDown"))
             return -1;
 
-        CLuaBaseEntity LuaBaseEntity(PChar);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaBaseEntity);
+        CLuaBaseEntity::Push(LuaHandle, PChar);
 
-        if (lua_pcall(LuaHandle, 1, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 1, LUA_MULTRET, 0))
         {
             ShowError("luautils::onPlayerLevelDown: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
@@ -4466,12 +4811,11 @@ namespace luautils
         if (prepFile(File, "onChocoboDig"))
             return false;
 
-        CLuaBaseEntity LuaBaseEntity(PChar);
-        Lunar<CLuaBaseEntity>::push(LuaHandle, &LuaBaseEntity);
+        CLuaBaseEntity::Push(LuaHandle, PChar);
 
         lua_pushboolean(LuaHandle, pre);
 
-        if (lua_pcall(LuaHandle, 2, LUA_MULTRET, 0))
+        if (pcall(LuaHandle, 2, LUA_MULTRET, 0))
         {
             ShowError("luautils::onChocoboDig: %s\n", lua_tostring(LuaHandle, -1));
             lua_pop(LuaHandle, 1);
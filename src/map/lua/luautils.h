@@ -71,11 +71,26 @@ enum ConquestUpdate : uint8;
 
 namespace luautils
 {
+    struct gc_stats_t
+    {
+        uint32 heap;                    // KB in use
+        double allocRate;               // KB/s allocated
+        double avgMs;                   // collector time per main loop pass
+        double maxMs;
+        uint32 cycles;                  // full cycles finished
+    };
+
     extern struct lua_State* LuaHandle;
 
     int32 init();
     int32 free();
-    int32 garbageCollect(); // performs a full garbage collecting cycle
+    int32 garbageCollect();             // logs heap and collector stats and starts a new window
+    void  StepGC(time_point deadline);  // collector work for one main loop pass, extra steps until the deadline
+    gc_stats_t GetGCStats(bool reset);
+    void  SetProfiling(bool enabled);   // time script calls made from the core, off outside of the bench
+    uint64 GetLuaTime();                // ns spent in script calls while profiling
+    int32 ResumeSliced(time_point tick, CTaskMgr::CTask* PTask);    // runs pending sliced hooks within the per-tick budget
+    void  LogSliceOverruns();           // sliced hooks that went over budget since the last call
     int register_fp(int index);
     void unregister_fp(int);
     int32 print(lua_State*);
@@ -86,7 +101,7 @@ namespace luautils
 
     //TODO: if the classes themselves held the lua method declarations, this voodoo to get the wrappers wouldn't be needed!
     template<class T>
-    typename std::enable_if_t<std::is_pointer<T>::value> pushArg(CBaseEntity* arg) { pushLuaType<CBaseEntity, CLuaBaseEntity>(arg); }
+    typename std::enable_if_t<std::is_pointer<T>::value> pushArg(CBaseEntity* arg) { CLuaBaseEntity::Push(LuaHandle, arg); }
     template<class T>
     typename std::enable_if_t<std::is_pointer<T>::value> pushArg(CAbility* arg) { pushLuaType<CAbility, CLuaAbility>(arg); }
     template<class T>
@@ -255,6 +270,12 @@ namespace luautils
     int32 SetDropRate(lua_State*);												// Set drop rate of a mob setDropRate(dropid,itemid,newrate)
     int32 UpdateTreasureSpawnPoint(lua_State* L);                               // Update the spawn point of an Treasure
     int32 UpdateServerMessage(lua_State*);										// update server message, first modify in conf and update
+    int32 ReloadSynthRecipes(lua_State*);                                       // rebuild the synthesis recipe index from the database
+    int32 ReloadFishingCatches(lua_State*);                                     // rebuild the fishing catch tables from the database
+    int32 SetZoneProfiling(lua_State*);                                         // turn the per-zone tick profiler on or off
+    int32 GetZoneProfile(lua_State*);                                           // profiler summary of a zone as a table of lines
+    int32 DumpZoneProfile(lua_State*);                                          // write the profiler window to log/zone_profile.csv now
+    int32 ResetZoneProfile(lua_State*);                                         // start a new profiler window, on or off stays as it is
 
     int32 OnAdditionalEffect(CBattleEntity* PAttacker, CBattleEntity* PDefender, CItemWeapon* PItem, actionTarget_t* Action, uint32 damage); // for items with additional effects
     //int32 OnSpikesDamage(CBattleEntity* PDefender, CBattleEntity* PAttacker, apAction_t* Action, uint32 damage);                         // for mobs with spikes
@@ -51,7 +51,9 @@ This file is part of DarkStar-server source code.
 #include "mob_spell_list.h"
 #include "packet_system.h"
 #include "party.h"
+#include "utils/partyutils.h"
 #include "utils/petutils.h"
+#include "utils/synthutils.h"
 #include "spell.h"
 #include "time_server.h"
 #include "transport.h"
@@ -59,6 +61,9 @@ This file is part of DarkStar-server source code.
 #include "status_effect_container.h"
 #include "utils/zoneutils.h"
 #include "conquest_system.h"
+#include "dbworker.h"
+#include "profiler.h"
+#include "capture.h"
 #include "utils/mobutils.h"
 
 #include "lua/luautils.h"
@@ -71,10 +76,13 @@ This file is part of DarkStar-server source code.
 const int8* MAP_CONF_FILENAME = nullptr;
 
 int8*  g_PBuff = nullptr;                // глобальный буфер обмена пакетами
-int8*  PTempBuff = nullptr;                // временный  буфер обмена пакетами
 
 thread_local Sql_t* SqlHandle = nullptr;
 
+#ifdef DEBUG
+uint32 map_hotpath_allocations = 0;
+#endif
+
 int32  map_fd = 0;                      // main socket
 uint32 map_amntplayers = 0;             // map amnt unique players
 
@@ -117,6 +125,8 @@ map_session_data_t* mapsession_createsession(uint32 ip, uint16 port)
     memset(map_session_data, 0, sizeof(map_session_data_t));
 
     CREATE(map_session_data->server_packet_data, int8, map_config.buffer_size + 20);
+    CREATE(map_session_data->decompress_data, int8, map_config.buffer_size);
+    CREATE(map_session_data->staging_data, int8, map_config.buffer_size + 20);
 
     map_session_data->last_update = time(nullptr);
     map_session_data->client_addr = ip;
@@ -135,6 +145,11 @@ map_session_data_t* mapsession_createsession(uint32 ip, uint16 port)
 		Sql_NumRows(SqlHandle) == 0)
 	{
 		ShowError(CL_RED"recv_parse: Invalid login attempt from %s\n" CL_RESET, ip2str(map_session_data->client_addr, nullptr));
+
+        aFree(map_session_data->server_packet_data);
+        aFree(map_session_data->decompress_data);
+        aFree(map_session_data->staging_data);
+        delete map_session_data;
 		return nullptr;
 	}
     return map_session_data;
@@ -195,6 +210,17 @@ int32 do_init(int32 argc, int8** argv)
     zlib_init();
     ShowMessage("\t\t\t - " CL_GREEN"[OK]" CL_RESET"\n");
 
+    ShowStatus("do_init: verifying crypto kernels");
+    if (blowfish_selftest() == 0)
+    {
+        ShowMessage("\t - " CL_GREEN"[OK]" CL_RESET"\n");
+    }
+    else
+    {
+        ShowMessage("\t - " CL_YELLOW"[SCALAR]" CL_RESET"\n");
+        ShowWarning("do_init: vectorised blowfish disagrees with the reference, using scalar code\n");
+    }
+
     messageThread = std::thread(message::init, map_config.msg_server_ip, map_config.msg_server_port);
 
     ShowStatus("do_init: loading items");
@@ -210,6 +236,8 @@ int32 do_init(int32 argc, int8** argv)
     ShowMessage("\t\t\t - " CL_GREEN"[OK]" CL_RESET"\n");
 
     guildutils::Initialize();
+    partyutils::Initialize();
+    dbworker::Initialize();
     charutils::LoadExpTable();
     traits::LoadTraitsList();
     effects::LoadEffectsParameters();
@@ -227,6 +255,9 @@ int32 do_init(int32 argc, int8** argv)
     ShowMessage("\t\t\t - " CL_GREEN"[OK]" CL_RESET"\n");
 
     fishingutils::LoadFishingMessages();
+    fishingutils::LoadFishingCatches();
+
+    synthutils::LoadSynthRecipes();
 
     ShowStatus("do_init: server is binding with port %u", map_port == 0 ? map_config.usMapPort : map_port);
     map_fd = makeBind_udp(map_config.uiMapIp, map_port == 0 ? map_config.usMapPort : map_port);
@@ -239,11 +270,20 @@ int32 do_init(int32 argc, int8** argv)
     CTransportHandler::getInstance()->InitializeTransport();
 
     CTaskMgr::getInstance()->AddTask("time_server", server_clock::now(), nullptr, CTaskMgr::TASK_INTERVAL, time_server, 2400ms);
+    CTaskMgr::getInstance()->AddTask("instance_loader", server_clock::now(), nullptr, CTaskMgr::TASK_INTERVAL, instanceutils::CheckInstance, 100ms);
     CTaskMgr::getInstance()->AddTask("map_cleanup", server_clock::now(), nullptr, CTaskMgr::TASK_INTERVAL, map_cleanup, 5s);
     CTaskMgr::getInstance()->AddTask("garbage_collect", server_clock::now(), nullptr, CTaskMgr::TASK_INTERVAL, map_garbage_collect, 15min);
 
+    profiler::Initialize(map_config.zone_profiler);
+
+#ifndef dsBENCH
+    if (map_config.packet_capture[0] != '\0')
+    {
+        capture::Open(map_config.packet_capture);
+    }
+#endif
+
     CREATE(g_PBuff, int8, map_config.buffer_size + 20);
-    CREATE(PTempBuff, int8, map_config.buffer_size + 20);
 
     ShowStatus("The map-server is " CL_GREEN"ready" CL_RESET" to work...\n");
     ShowMessage("=======================================================================\n");
@@ -259,18 +299,22 @@ int32 do_init(int32 argc, int8** argv)
 void do_final(int code)
 {
     aFree(g_PBuff);
-    aFree(PTempBuff);
 
     aFree((void*)map_config.mysql_host);
     aFree((void*)map_config.mysql_database);
 
+    capture::Close();
+    profiler::Free();
+    dbworker::Free();
     itemutils::FreeItemList();
     battleutils::FreeWeaponSkillsList();
     battleutils::FreeMobSkillList();
 
     petutils::FreePetList();
+    instanceutils::FreePrefabs();
     zoneutils::FreeZoneList();
     luautils::free();
+    partyutils::Free();
     message::close();
     if (messageThread.joinable())
     {
@@ -311,6 +355,28 @@ void set_server_type()
     SERVER_TYPE = DARKSTAR_SERVER_MAP;
 }
 
+/************************************************************************
+*                                                                       *
+*  The UDP path (decrypt, decompress, compress, encrypt) works only on  *
+*  session buffers and pooled packets. Debug builds verify that it does *
+*  not allocate, so regressions show up immediately.                    *
+*                                                                       *
+************************************************************************/
+
+#ifdef DEBUG
+#define MAP_HOTPATH_BEGIN() size_t hotpath_mark = malloc_count() + CBasicPacket::GetHeapAllocations()
+#define MAP_HOTPATH_END(name) \
+    if (malloc_count() + CBasicPacket::GetHeapAllocations() != hotpath_mark) \
+    { \
+        map_hotpath_allocations++; \
+        ShowFatalError(CL_RED"%s: heap allocation on the packet hot path (%u so far)\n" CL_RESET, name, map_hotpath_allocations); \
+        DSP_DEBUG_BREAK_IF(true); \
+    }
+#else
+#define MAP_HOTPATH_BEGIN()
+#define MAP_HOTPATH_END(name)
+#endif
+
 /************************************************************************
 *                                                                       *
 *  do_sockets                                                           *
@@ -322,6 +388,7 @@ int32 do_sockets(fd_set* rfd, duration next)
     struct timeval timeout;
     int32 ret;
     memcpy(rfd, &readfds, sizeof(*rfd));
+    time_point wake = server_clock::now() + next;
 
     timeout.tv_sec = std::chrono::duration_cast<std::chrono::seconds>(next).count();
     timeout.tv_usec = std::chrono::duration_cast<std::chrono::microseconds>(next - std::chrono::duration_cast<std::chrono::seconds>(next)).count();
@@ -340,6 +407,9 @@ int32 do_sockets(fd_set* rfd, duration next)
 
     last_tick = time(nullptr);
 
+    message::handle_incoming();
+    dbworker::HandleCompletions();
+
     if (sFD_ISSET(map_fd, rfd))
     {
         struct sockaddr_in from;
@@ -396,6 +466,7 @@ int32 do_sockets(fd_set* rfd, duration next)
             }
         }
     }
+    luautils::StepGC(wake);
     return 0;
 }
 
@@ -418,7 +489,7 @@ int32 parse_console(int8* buf)
 
 int32 map_decipher_packet(int8* buff, size_t size, sockaddr_in* from, map_session_data_t* map_session_data)
 {
-    uint16 tmp, i;
+    uint16 tmp;
 
     // counting blocks whose size = 4 byte
     tmp = (size - FFXI_HEADER_SIZE) / 4;
@@ -432,10 +503,7 @@ int32 map_decipher_packet(int8* buff, size_t size, sockaddr_in* from, map_sessio
 
     blowfish_t *pbfkey = &map_session_data->blowfish;
 
-    for (i = 0; i < tmp; i += 2)
-    {
-        blowfish_decipher((uint32*)buff + i + 7, (uint32*)buff + i + 8, pbfkey->P, pbfkey->S[0]);
-    }
+    blowfish_decipher_buffer((uint32*)buff + 7, tmp / 2, pbfkey->P, pbfkey->S[0]);
 
     if (checksum((uint8*)(buff + FFXI_HEADER_SIZE), size - (FFXI_HEADER_SIZE + 16), buff + size - 16) == 0)
     {
@@ -525,6 +593,7 @@ int32 recv_parse(int8* buff, size_t* buffsize, sockaddr_in* from, map_session_da
     else
     {
         //char packets
+        MAP_HOTPATH_BEGIN();
 
         if (map_decipher_packet(buff, *buffsize, from, map_session_data) == -1)
         {
@@ -533,9 +602,8 @@ int32 recv_parse(int8* buff, size_t* buffsize, sockaddr_in* from, map_session_da
         }
         // reading data size
         uint32 PacketDataSize = RBUFL(buff, *buffsize - sizeof(int32) - 16);
-        // creating buffer for decompress data
-        int8* PacketDataBuff = nullptr;
-        CREATE(PacketDataBuff, int8, map_config.buffer_size);
+        // decompressing into the session buffer, no allocation per datagram
+        int8* PacketDataBuff = map_session_data->decompress_data;
         // it's decompressing data and getting new size
         PacketDataSize = zlib_decompress(buff + FFXI_HEADER_SIZE,
             PacketDataSize,
@@ -548,7 +616,7 @@ int32 recv_parse(int8* buff, size_t* buffsize, sockaddr_in* from, map_session_da
         memcpy(buff + FFXI_HEADER_SIZE, PacketDataBuff, PacketDataSize);
         *buffsize = FFXI_HEADER_SIZE + PacketDataSize;
 
-        aFree(PacketDataBuff);
+        MAP_HOTPATH_END("recv_parse");
         return 0;
     }
     return -1;
@@ -600,6 +668,9 @@ int32 parse(int8* buff, size_t* buffsize, sockaddr_in* from, map_session_data_t*
             }
             else
             {
+                capture::Record(PChar, SmallPD_ptr, SmallPD_Size * 2);
+
+                CZoneProfileScope profile(PChar->loc.zone, PROFILE_PACKETS, false);
                 PacketParser[SmallPD_Type](map_session_data, PChar, CBasicPacket(reinterpret_cast<uint8*>(SmallPD_ptr)));
             }
         }
@@ -646,6 +717,8 @@ int32 send_parse(int8 *buff, size_t* buffsize, sockaddr_in* from, map_session_da
     //  - присвоить исходящему пакету номер последнего отправленного клиенту пакета +1
     //  - записать текущее время отправки пакета
 
+    MAP_HOTPATH_BEGIN();
+
     WBUFW(buff, 0) = map_session_data->server_packet_id;
     WBUFW(buff, 2) = map_session_data->client_packet_id;
 
@@ -655,26 +728,25 @@ int32 send_parse(int8 *buff, size_t* buffsize, sockaddr_in* from, map_session_da
     // собираем большой пакет, состоящий из нескольких маленьких
     CCharEntity *PChar = map_session_data->PChar;
     CBasicPacket* PSmallPacket;
+    CBasicPacket* packetList[UINT8_MAX];
+    int8* PTempBuff = map_session_data->staging_data;
     uint32 PacketSize = UINT32_MAX;
-    uint32 PacketCount = PChar->getPacketCount();
+    uint32 PacketCount = PChar->peekPackets(packetList, UINT8_MAX);
     uint8 packets = 0;
 
     while (PacketSize > 1300 - FFXI_HEADER_SIZE - 16) //max size for client to accept
     {
         *buffsize = FFXI_HEADER_SIZE;
-        PacketList_t packetList = PChar->getPacketList();
         packets = 0;
 
-        while (!packetList.empty() && *buffsize + packetList.front()->length() < map_config.buffer_size &&
-            packets < PacketCount)
+        while (packets < PacketCount && *buffsize + packetList[packets]->length() < map_config.buffer_size)
         {
-            PSmallPacket = packetList.front();
+            PSmallPacket = packetList[packets];
 
             PSmallPacket->sequence(map_session_data->server_packet_id);
             memcpy(buff + *buffsize, *PSmallPacket, PSmallPacket->length());
 
             *buffsize += PSmallPacket->length();
-            packetList.pop_front();
             packets++;
         }
         //Сжимаем данные без учета заголовка
@@ -706,10 +778,7 @@ int32 send_parse(int8 *buff, size_t* buffsize, sockaddr_in* from, map_session_da
 
     blowfish_t* pbfkey = &map_session_data->blowfish;
 
-    for (uint32 j = 0; j < CypherSize; j += 2)
-    {
-        blowfish_encipher((uint32*)(buff)+j + 7, (uint32*)(buff)+j + 8, pbfkey->P, pbfkey->S[0]);
-    }
+    blowfish_encipher_buffer((uint32*)(buff) + 7, CypherSize / 2, pbfkey->P, pbfkey->S[0]);
 
     // контролируем размер отправляемого пакета. в случае,
     // если его размер превышает 1400 байт (размер данных + 42 байта IP заголовок),
@@ -720,6 +789,7 @@ int32 send_parse(int8 *buff, size_t* buffsize, sockaddr_in* from, map_session_da
 
     *buffsize = PacketSize + FFXI_HEADER_SIZE;
 
+    MAP_HOTPATH_END("send_parse");
     return 0;
 }
 
@@ -736,12 +806,25 @@ int32 map_close_session(time_point tick, map_session_data_t* map_session_data)
         map_session_data->server_packet_data != nullptr &&
         map_session_data->PChar != nullptr)
     {
+        // its done step still needs the char, map_cleanup closes the session once the job is through
+        if (dbworker::IsBusy(map_session_data->PChar))
+        {
+            return 0;
+        }
         charutils::SavePlayTime(map_session_data->PChar);
 
+        if (profiler::IsEnabled())
+        {
+            ShowDebug("map_close_session: %s had %u superseded update packets coalesced\n",
+                map_session_data->PChar->GetName(), map_session_data->PChar->getSupersededPacketCount());
+        }
+
         //clear accounts_sessions if character is logging out (not when zoning)
         if (map_session_data->shuttingDown == 1)
         {
             Sql_Query(SqlHandle, "DELETE FROM accounts_sessions WHERE charid = %u", map_session_data->PChar->id);
+            charutils::SendRosterRemove(map_session_data->PChar->id);
+            partyutils::RemoveMember(map_session_data->PChar->id);
         }
 
         uint64 port64 = map_session_data->client_port;
@@ -751,6 +834,9 @@ int32 map_close_session(time_point tick, map_session_data_t* map_session_data)
         map_session_data->PChar->StatusEffectContainer->SaveStatusEffects(map_session_data->shuttingDown == 1);
 
         aFree(map_session_data->server_packet_data);
+        aFree(map_session_data->decompress_data);
+        aFree(map_session_data->staging_data);
+        capture::EndSession(map_session_data->PChar->id);
         delete map_session_data->PChar;
         delete map_session_data;
         map_session_data = nullptr;
@@ -830,12 +916,17 @@ int32 map_cleanup(time_point tick, CTaskMgr::CTask* PTask)
                         PChar->status = STATUS_SHUTDOWN;
                         PacketParser[0x00D](map_session_data, PChar, 0);
                     }
-                    else
+                    else if (!dbworker::IsBusy(PChar))     // otherwise closed on a later pass, once its job is done
                     {
                         map_session_data->PChar->StatusEffectContainer->SaveStatusEffects(true);
                         Sql_Query(SqlHandle, "DELETE FROM accounts_sessions WHERE charid = %u;", map_session_data->PChar->id);
+                        charutils::SendRosterRemove(map_session_data->PChar->id);
+                        partyutils::RemoveMember(map_session_data->PChar->id);
 
                         aFree(map_session_data->server_packet_data);
+                        aFree(map_session_data->decompress_data);
+                        aFree(map_session_data->staging_data);
+                        capture::EndSession(map_session_data->PChar->id);
                         delete map_session_data->PChar;
                         delete map_session_data;
                         map_session_data = nullptr;
@@ -853,6 +944,8 @@ int32 map_cleanup(time_point tick, CTaskMgr::CTask* PTask)
                     Sql_Query(SqlHandle, Query, map_session_data->client_addr, map_session_data->client_port);
 
                     aFree(map_session_data->server_packet_data);
+                    aFree(map_session_data->decompress_data);
+                    aFree(map_session_data->staging_data);
                     map_session_list.erase(it++);
                     delete map_session_data;
                     continue;
@@ -978,6 +1071,10 @@ int32 map_config_default()
     map_config.audit_linkshell = 0;
     map_config.msg_server_port = 54003;
     map_config.msg_server_ip = "127.0.0.1";
+    map_config.zone_profiler = false;
+    map_config.packet_capture = "";
+    map_config.lua_slice_budget = 5;
+    map_config.lua_gc_budget = 2;
     return 0;
 }
 
@@ -1263,6 +1360,22 @@ int32 map_config_read(const int8* cfgName)
         {
             map_config.msg_server_ip = aStrdup(w2);
         }
+        else if (strcmp(w1, "zone_profiler") == 0)
+        {
+            map_config.zone_profiler = atoi(w2);
+        }
+        else if (strcmp(w1, "packet_capture") == 0)
+        {
+            map_config.packet_capture = aStrdup(w2);
+        }
+        else if (strcmp(w1, "lua_slice_budget") == 0)
+        {
+            map_config.lua_slice_budget = atoi(w2);
+        }
+        else if (strcmp(w1, "lua_gc_budget") == 0)
+        {
+            map_config.lua_gc_budget = atoi(w2);
+        }
         else if (strcmp(w1, "mob_no_despawn") == 0)
         {
             map_config.mob_no_despawn = atoi(w2);
@@ -1323,6 +1436,8 @@ int32 map_config_read(const int8* cfgName)
 int32 map_garbage_collect(time_point tick, CTaskMgr::CTask* PTask)
 {
     luautils::garbageCollect();
+    dbworker::LogLatency();
+    luautils::LogSliceOverruns();
     return 0;
 }
 
@@ -123,6 +123,10 @@ struct map_config_t
 	bool   audit_party;
 	uint16 msg_server_port;			// central message server port
 	const char* msg_server_ip;		// central message server IP
+    bool   zone_profiler;           // start with the per-zone tick profiler on, see !profile
+    const char* packet_capture;     // file decrypted client packets are captured to, empty for none
+    uint32 lua_slice_budget;        // ms a sliced script hook (onGameHour, onMobFight...) may run per tick before it yields
+    uint32 lua_gc_budget;           // ms of idle time per main loop pass the lua collector may use
 };
 
 /************************************************************************
@@ -139,6 +143,8 @@ struct map_session_data_t
 	uint16		 server_packet_id;			// id последнего пакета, отправленного сервером
 	int8*		 server_packet_data; 		// указатель на собранный пакет, который был ранее отправлен клиенту
 	size_t		 server_packet_size;	    // размер пакета, который был ранее отправлен клиенту
+	int8*		 decompress_data;			// preallocated buffer for inflating inbound packets
+	int8*		 staging_data;				// preallocated buffer for compressing outbound packets
 	time_t		 last_update;				// time of last packet recv
 	blowfish_t   blowfish;					// unique decypher keys
 	CCharEntity* PChar;						// game char
@@ -156,6 +162,10 @@ extern int32 map_fd;
 
 extern thread_local Sql_t* SqlHandle;
 
+#ifdef DEBUG
+extern uint32 map_hotpath_allocations;      // heap allocations seen while (de)crypting and (de)compressing, must stay 0
+#endif
+
 extern CCommandHandler CmdHandler;
 
 typedef std::map<uint64,map_session_data_t*> map_session_list_t;
@@ -21,8 +21,9 @@ This file is part of DarkStar-server source code.
 ===========================================================================
 */
 
-#include <mutex>
-#include <queue>
+#include <atomic>
+
+#include "../common/mpsc_queue.h"
 
 #include "message.h"
 
@@ -37,24 +38,36 @@ This file is part of DarkStar-server source code.
 #include "packets/party_invite.h"
 #include "packets/server_ip.h"
 
+#include "utils/charutils.h"
 #include "utils/zoneutils.h"
 #include "utils/jailutils.h"
+#include "utils/partyutils.h"
 #include "items/item_linkshell.h"
 
 namespace message
 {
     zmq::context_t zContext;
     zmq::socket_t* zSocket = nullptr;
-    std::mutex send_mutex;
-    std::queue<chat_message_t> message_queue;
+    std::atomic<bool> shuttingDown {false};
+
+    // the chat thread only moves frames between the socket and these queues,
+    // everything that touches game state runs on the main thread in handle_incoming
+    mpsc_queue<chat_message_t> inbound_queue;
+    mpsc_queue<chat_message_t> outbound_queue;
+
+    void free_message(chat_message_t& msg)
+    {
+        delete msg.type;
+        delete msg.data;
+        delete msg.packet;
+    }
 
     void send_queue()
     {
-        while (!message_queue.empty())
+        chat_message_t msg;
+
+        while (outbound_queue.pop(msg))
         {
-            std::lock_guard<std::mutex> lk(send_mutex);
-            chat_message_t msg = message_queue.front();
-            message_queue.pop();
             try
             {
                 zSocket->send(*msg.type, ZMQ_SNDMORE);
@@ -65,6 +78,7 @@ namespace message
             {
                 ShowError("Message: %s", e.what());
             }
+            free_message(msg);
         }
     }
 
@@ -80,11 +94,12 @@ namespace message
             if (!PChar)
             {
                 Sql_Query(SqlHandle, "DELETE FROM accounts_sessions WHERE charid = %d;", RBUFL(extra->data(), 0));
+                charutils::SendRosterRemove(RBUFL(extra->data(), 0));
+                partyutils::RemoveMember(RBUFL(extra->data(), 0));
             }
             else
             {
                 PChar->status = STATUS_SHUTDOWN;
-                //won't save their position (since this is the wrong thread) but not a huge deal
                 PChar->pushPacket(new CServerIPPacket(PChar, 1, 0));
             }
             break;
@@ -233,17 +248,17 @@ namespace message
                 else
                 {
                     //both party leaders?
-                    int ret = Sql_Query(SqlHandle, "SELECT * FROM accounts_parties WHERE partyid <> 0 AND \
-                                                   													   	((charid = %u OR charid = %u) AND partyflag & %u);", inviterId,
-                                                                                                        inviteeId, PARTY_LEADER);
-                    if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) == 2)
+                    party_member_t inviter;
+                    party_member_t invitee;
+                    bool inviterInParty = partyutils::GetMember(inviterId, &inviter);
+                    bool inviteeInParty = partyutils::GetMember(inviteeId, &invitee);
+
+                    if (inviterInParty && inviteeInParty && (inviter.flags & PARTY_LEADER) && (invitee.flags & PARTY_LEADER))
                     {
                         if (PInviter->PParty->m_PAlliance)
                         {
-                            ret = Sql_Query(SqlHandle, "SELECT * FROM accounts_parties WHERE allianceid <> 0 AND \
-                                                       														   	allianceid = (SELECT allianceid FROM accounts_parties where \
-                                                                                                                															charid = %u) GROUP BY partyid;", inviterId);
-                            if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) > 0 && Sql_NumRows(SqlHandle) < 3)
+                            uint32 parties = inviter.allianceid != 0 ? partyutils::GetAlliancePartyCount(inviter.allianceid) : 0;
+                            if (parties > 0 && parties < 3)
                             {
                                 PInviter->PParty->m_PAlliance->addParty(inviteeId);
                             }
@@ -267,9 +282,7 @@ namespace message
                         }
                         if (PInviter->PParty->GetLeader() == PInviter)
                         {
-                            ret = Sql_Query(SqlHandle, "SELECT * FROM accounts_parties WHERE partyid <> 0 AND \
-                                                       															charid = %u;", inviteeId);
-                            if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) == 0)
+                            if (!inviteeInParty)
                             {
                                 PInviter->PParty->AddMember(inviteeId);
                             }
@@ -279,6 +292,11 @@ namespace message
             }
             break;
         }
+        case MSG_PT_STATE:
+        {
+            partyutils::Apply(extra->data(), extra->size());
+            break;
+        }
         case MSG_PT_RELOAD:
         {
             CCharEntity* PChar = zoneutils::GetChar(RBUFL(extra->data(), 0));
@@ -354,51 +372,77 @@ namespace message
         }
     }
 
-    void listen()
+    bool recv_message()
     {
-        while (true)
+        chat_message_t msg;
+        msg.type = new zmq::message_t();
+        msg.data = new zmq::message_t();
+        msg.packet = new zmq::message_t();
+
+        if (!zSocket->recv(msg.type, ZMQ_DONTWAIT))
+        {
+            free_message(msg);
+            return false;
+        }
+
+        int more;
+        size_t size = sizeof(more);
+        zSocket->getsockopt(ZMQ_RCVMORE, &more, &size);
+        if (more)
         {
-            zmq::message_t type;
-            zmq::message_t extra;
-            zmq::message_t packet;
+            zSocket->recv(msg.data);
+            zSocket->getsockopt(ZMQ_RCVMORE, &more, &size);
+            if (more)
+            {
+                zSocket->recv(msg.packet);
+            }
+        }
+        inbound_queue.push(msg);
+        return true;
+    }
+
+    void listen()
+    {
+        zmq::pollitem_t items[] = { { (void*)*zSocket, 0, ZMQ_POLLIN, 0 } };
 
+        while (!shuttingDown)
+        {
             try
             {
-                if (!zSocket)
-                {
-                    return;
-                }
-                if (!zSocket->recv(&type))
-                {
-                    if (!message_queue.empty())
-                        send_queue();
-                    continue;
-                }
+                // flush everything the main thread queued since the last wakeup,
+                // the poll timeout bounds how long an outgoing message can wait
+                send_queue();
 
-                int more;
-                size_t size = sizeof(more);
-                zSocket->getsockopt(ZMQ_RCVMORE, &more, &size);
-                if (more)
+                zmq::poll(items, 1, 10);
+
+                if (items[0].revents & ZMQ_POLLIN)
                 {
-                    zSocket->recv(&extra);
-                    zSocket->getsockopt(ZMQ_RCVMORE, &more, &size);
-                    if (more)
-                    {
-                        zSocket->recv(&packet);
-                    }
+                    while (recv_message());
                 }
             }
-            catch (zmq::error_t e)
+            catch (zmq::error_t& e)
             {
-                if (!zSocket)
+                if (shuttingDown)
                 {
-                    return;
+                    break;
                 }
                 ShowError("Message: %s\n", e.what());
-                continue;
             }
+        }
 
-            parse((MSGSERVTYPE)RBUFB(type.data(), 0), &extra, &packet);
+        zSocket->close();
+        delete zSocket;
+        zSocket = nullptr;
+    }
+
+    void handle_incoming()
+    {
+        chat_message_t msg;
+
+        while (inbound_queue.pop(msg))
+        {
+            parse((MSGSERVTYPE)RBUFB(msg.type->data(), 0), msg.data, msg.packet);
+            free_message(msg);
         }
     }
 
@@ -414,7 +458,6 @@ namespace message
         {
             exit(EXIT_FAILURE);
         }
-        Sql_Keepalive(SqlHandle);
 
         zContext = zmq::context_t(1);
         zSocket = new zmq::socket_t(zContext, ZMQ_DEALER);
@@ -434,10 +477,11 @@ namespace message
         }
         ipp |= (port << 32);
 
-        zSocket->setsockopt(ZMQ_IDENTITY, &ipp, sizeof ipp);
+        // messages are handled on the main thread with its own handle, this one was only needed for the lookup above
+        Sql_Free(SqlHandle);
+        SqlHandle = nullptr;
 
-        uint32 to = 500;
-        zSocket->setsockopt(ZMQ_RCVTIMEO, &to, sizeof to);
+        zSocket->setsockopt(ZMQ_IDENTITY, &ipp, sizeof ipp);
 
         string_t server = "tcp://";
         server.append(chatIp);
@@ -458,18 +502,20 @@ namespace message
 
     void close()
     {
-        if (zSocket)
+        // the chat thread closes its own socket once it sees the flag,
+        // terminating the context wakes it up if it is still blocked in zmq
+        shuttingDown = true;
+        zContext.close();
+
+        chat_message_t msg;
+        while (inbound_queue.pop(msg))
         {
-            zSocket->close();
-            delete zSocket;
-            zSocket = nullptr;
+            free_message(msg);
         }
-        zContext.close();
     }
 
     void send(MSGSERVTYPE type, void* data, size_t datalen, CBasicPacket* packet)
     {
-        std::lock_guard<std::mutex> lk(send_mutex);
         chat_message_t msg;
         msg.type = new zmq::message_t(sizeof(MSGSERVTYPE));
         WBUFB(msg.type->data(), 0) = type;
@@ -480,12 +526,15 @@ namespace message
 
         if (packet)
         {
-            msg.packet = new zmq::message_t(*packet, packet->length(), [](void *data, void *hint) {delete[](uint8*) data; });
+            // packet storage belongs to the packet pools, so zmq gets its own copy
+            msg.packet = new zmq::message_t(packet->length());
+            memcpy(msg.packet->data(), *packet, packet->length());
+            delete packet;
         }
         else
         {
             msg.packet = new zmq::message_t(0);
         }
-        message_queue.push(msg);
+        outbound_queue.push(msg);
     }
 };
@@ -40,5 +40,6 @@ namespace message
 {
     void init(const char* chatIp, uint16 chatPort);
     void send(MSGSERVTYPE type, void* data, size_t datalen, CBasicPacket* packet);
+    void handle_incoming();     // runs queued messages from the chat thread, main thread only
     void close();
 };
\ No newline at end of file
@@ -0,0 +1,250 @@
+﻿/*
+===========================================================================
+
+  Copyright (c) 2010-2015 Darkstar Dev Teams
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see http://www.gnu.org/licenses/
+
+  This file is part of DarkStar-server source code.
+
+===========================================================================
+*/
+
+#include "mob_hot_core.h"
+
+#include <math.h>
+
+#include "mob_modifier.h"
+#include "modifier.h"
+
+#include "ai/ai_container.h"
+#include "entities/charentity.h"
+#include "entities/mobentity.h"
+#include "profiler.h"
+
+#define MOBCORE_NO_SLOT 0xFFFF
+
+namespace
+{
+    /************************************************************************
+    *                                                                       *
+    *  Widest range at which CMobController::CanDetectTarget can succeed    *
+    *  for this mob, before the target's stealth is added                   *
+    *                                                                       *
+    ************************************************************************/
+
+    float GetAggroRange(CMobEntity* PMob)
+    {
+        uint16 aggro = PMob->m_Aggro;
+        float range = 0;
+
+        if (aggro & (AGGRO_DETECT_SIGHT | AGGRO_DETECT_TRUESIGHT))
+        {
+            range = dsp_max(range, (float)PMob->getMobMod(MOBMOD_SIGHT_RANGE));
+        }
+        if (aggro & (AGGRO_DETECT_HEARING | AGGRO_DETECT_TRUEHEARING))
+        {
+            range = dsp_max(range, (float)PMob->getMobMod(MOBMOD_SOUND_RANGE));
+        }
+        if (aggro & (AGGRO_DETECT_LOWHP | AGGRO_DETECT_MAGIC | AGGRO_DETECT_WEAPONSKILL | AGGRO_DETECT_JOBABILITY))
+        {
+            range = dsp_max(range, 20.0f);
+        }
+        if (PMob->m_Behaviour & BEHAVIOUR_AGGRO_AMBUSH)
+        {
+            range = dsp_max(range, 3.0f);
+        }
+        return range;
+    }
+}
+
+CMobHotCore::CMobHotCore()
+{
+    m_dirty = true;
+}
+
+void CMobHotCore::Invalidate()
+{
+    m_dirty = true;
+}
+
+bool CMobHotCore::Invalidated() const
+{
+    return m_dirty;
+}
+
+uint16 CMobHotCore::size() const
+{
+    return (uint16)entity.size();
+}
+
+uint16 CMobHotCore::GetSlot(uint16 _targid) const
+{
+    if (_targid >= m_slotByTargid.size() || m_slotByTargid[_targid] == MOBCORE_NO_SLOT)
+    {
+        return size();
+    }
+    return m_slotByTargid[_targid];
+}
+
+CMobEntity* CMobHotCore::GetMob(uint16 slot) const
+{
+    return entity[slot];
+}
+
+void CMobHotCore::Rebuild(const EntityList_t& mobList)
+{
+    size_t count = mobList.size();
+
+    entity.clear();
+    targid.clear();
+    m_slotByTargid.assign(0x1000, MOBCORE_NO_SLOT);
+
+    for (auto PMob : mobList)
+    {
+        if (PMob.first >= m_slotByTargid.size())
+        {
+            m_slotByTargid.resize(PMob.first + 1, MOBCORE_NO_SLOT);
+        }
+        m_slotByTargid[PMob.first] = (uint16)entity.size();
+
+        entity.push_back((CMobEntity*)PMob.second);
+        targid.push_back(PMob.first);
+    }
+    x.resize(count);
+    y.resize(count);
+    z.resize(count);
+    status.resize(count);
+    flags.resize(count);
+    hp.resize(count);
+    mp.resize(count);
+    tp.resize(count);
+    aggroRange.resize(count);
+
+    m_dirty = false;
+}
+
+void CMobHotCore::Sync(const EntityList_t& mobList)
+{
+    CProfileScope profile(PROFILE_MOB_SYNC);
+
+    if (m_dirty)
+    {
+        Rebuild(mobList);
+    }
+
+    for (uint16 i = 0; i < entity.size(); ++i)
+    {
+        CMobEntity* PMob = entity[i];
+
+        x[i] = PMob->loc.p.x;
+        y[i] = PMob->loc.p.y;
+        z[i] = PMob->loc.p.z;
+        status[i] = PMob->status;
+        hp[i] = PMob->health.hp;
+        mp[i] = PMob->health.mp;
+        tp[i] = PMob->health.tp;
+
+        uint8 mobFlags = 0;
+
+        if (PMob->PAI->IsSpawned())  mobFlags |= MOBCORE_SPAWNED;
+        if (PMob->PAI->IsEngaged())  mobFlags |= MOBCORE_ENGAGED;
+        if (PMob->isDead())          mobFlags |= MOBCORE_DEAD;
+        if (PMob->m_neutral)         mobFlags |= MOBCORE_NEUTRAL;
+        if (PMob->PMaster != nullptr) mobFlags |= MOBCORE_PET;
+
+        flags[i] = mobFlags;
+        aggroRange[i] = 0;
+
+        if (status[i] == STATUS_MOB && mobFlags == MOBCORE_SPAWNED)
+        {
+            aggroRange[i] = GetAggroRange(PMob);
+        }
+    }
+}
+
+void CMobHotCore::FindInRange(const position_t& pos, float range, std::vector<uint16>& slots) const
+{
+    const float rangeSq = range * range;
+    const uint16 count = size();
+
+    slots.clear();
+
+    // same test as distance(pos, mob) < range, without the sqrt; the first loop has no branches so the compiler vectorises it
+    thread_local std::vector<uint8> mask;
+    mask.resize(count);
+
+    for (uint16 i = 0; i < count; ++i)
+    {
+        float dX = x[i] - pos.x;
+        float dY = y[i] - pos.y;
+        float dZ = z[i] - pos.z;
+
+        mask[i] = (uint8)((dX * dX + dY * dY + dZ * dZ < rangeSq) & (status[i] == STATUS_MOB));
+    }
+    for (uint16 i = 0; i < count; ++i)
+    {
+        if (mask[i])
+        {
+            slots.push_back(i);
+        }
+    }
+}
+
+void CMobHotCore::FindAggroPairs(const EntityList_t& charList, std::vector<std::pair<uint16, CCharEntity*>>& pairs) const
+{
+    const uint16 count = size();
+
+    pairs.clear();
+
+    thread_local std::vector<uint8> mask;
+    mask.resize(count);
+
+    for (auto it : charList)
+    {
+        CCharEntity* PChar = (CCharEntity*)it.second;
+
+        if (PChar->status == STATUS_SHUTDOWN || PChar->isDead() || (PChar->nameflags.flags & FLAG_GM) ||
+            PChar->animation == ANIMATION_CHOCOBO)
+        {
+            continue;
+        }
+
+        const float cX = PChar->loc.p.x;
+        const float cY = PChar->loc.p.y;
+        const float cZ = PChar->loc.p.z;
+        const float stealth = (float)PChar->getMod(MOD_STEALTH);
+
+        // detection needs distance + stealth below the mob's range, less than 8 yalms of height
+        // difference and the mob to be visible to the character (50 yalms); the slack keeps the
+        // squared comparison from rejecting pairs CanDetectTarget would accept
+        for (uint16 i = 0; i < count; ++i)
+        {
+            float dX = x[i] - cX;
+            float dY = y[i] - cY;
+            float dZ = z[i] - cZ;
+            float distSq = dX * dX + dY * dY + dZ * dZ;
+            float reach = aggroRange[i] - stealth + 0.01f;
+
+            mask[i] = (uint8)((aggroRange[i] > 0) & (reach > 0) & (distSq <= reach * reach) & (distSq < 2500) & (fabsf(dY) <= 8));
+        }
+        for (uint16 i = 0; i < count; ++i)
+        {
+            if (mask[i])
+            {
+                pairs.emplace_back(i, PChar);
+            }
+        }
+    }
+}
@@ -0,0 +1,95 @@
+﻿/*
+===========================================================================
+
+  Copyright (c) 2010-2015 Darkstar Dev Teams
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see http://www.gnu.org/licenses/
+
+  This file is part of DarkStar-server source code.
+
+===========================================================================
+*/
+
+#ifndef _CMOBHOTCORE_H
+#define _CMOBHOTCORE_H
+
+#include "../common/cbasetypes.h"
+#include "../common/mmo.h"
+
+#include <utility>
+#include <vector>
+
+#include "zone.h"
+
+class CCharEntity;
+class CMobEntity;
+
+enum MOBCORE_FLAG : uint8
+{
+    MOBCORE_SPAWNED = 0x01,
+    MOBCORE_ENGAGED = 0x02,
+    MOBCORE_DEAD    = 0x04,
+    MOBCORE_NEUTRAL = 0x08,
+    MOBCORE_PET     = 0x10      // has a master, never aggroes on its own
+};
+
+/************************************************************************
+*                                                                       *
+*  Hot state of a zone's mobs in contiguous arrays, one slot per mob    *
+*  in targid order. The mob entities stay the owners of this state,    *
+*  the arrays are refreshed from them once per zone tick, right after  *
+*  the mobs have ticked and their update packets went out, so they see  *
+*  the same state as the clients. Bulk passes over many mobs read the  *
+*  arrays instead of chasing each entity.                               *
+*                                                                       *
+************************************************************************/
+
+class CMobHotCore
+{
+public:
+
+    CMobHotCore();
+
+    void    Invalidate();                                       // mob list changed, slots are rebuilt on next Sync
+    bool    Invalidated() const;
+    void    Sync(const EntityList_t& mobList);                  // refresh the arrays from the entities
+
+    uint16  size() const;
+    uint16  GetSlot(uint16 targid) const;                       // slot of a targid, or size() if there is none
+    CMobEntity* GetMob(uint16 slot) const;
+
+    // slots of spawned mobs within range of pos, in slot order
+    void    FindInRange(const position_t& pos, float range, std::vector<uint16>& slots) const;
+
+    // (slot, character) pairs close enough for the mob to possibly detect the character
+    void    FindAggroPairs(const EntityList_t& charList, std::vector<std::pair<uint16, CCharEntity*>>& pairs) const;
+
+    std::vector<CMobEntity*> entity;
+    std::vector<uint16>      targid;
+    std::vector<float>       x, y, z;
+    std::vector<uint8>       status;                            // STATUSTYPE
+    std::vector<uint8>       flags;                             // MOBCORE_FLAG
+    std::vector<int32>       hp, mp;
+    std::vector<int16>       tp;
+    std::vector<float>       aggroRange;                        // widest detection range of an idle aggressive mob, 0 otherwise
+
+private:
+
+    bool                m_dirty;
+    std::vector<uint16> m_slotByTargid;                         // targid -> slot, 0xFFFF for none
+
+    void    Rebuild(const EntityList_t& mobList);
+};
+
+#endif
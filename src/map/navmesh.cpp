@@ -210,7 +210,7 @@ void CNavMesh::unload()
     }
 }
 
-int16 CNavMesh::findPath(position_t start, position_t end, position_t* path, uint16 pathSize)
+int16 CNavMesh::findPath(position_t start, position_t end, position_t* path, uint16 pathSize, int32 maxIterations, bool* partial)
 {
 
     dtStatus status;
@@ -273,7 +273,29 @@ int16 CNavMesh::findPath(position_t start, position_t end, position_t* path, uin
     // not sure what this is for?
     int32 pathCount = 0;
 
-    status = m_navMeshQuery->findPath(startRef, endRef, snearest, enearest, &filter, m_polys, &pathCount, MAX_NAV_POLYS);
+    if (maxIterations > 0)
+    {
+        status = m_navMeshQuery->initSlicedFindPath(startRef, endRef, snearest, enearest, &filter);
+
+        if (dtStatusInProgress(status))
+        {
+            status = m_navMeshQuery->updateSlicedFindPath(maxIterations, nullptr);
+        }
+        if (!dtStatusFailed(status))
+        {
+            // also finalizes a search that is still in progress, up to its best node so far
+            status = m_navMeshQuery->finalizeSlicedFindPath(m_polys, &pathCount, MAX_NAV_POLYS);
+        }
+    }
+    else
+    {
+        status = m_navMeshQuery->findPath(startRef, endRef, snearest, enearest, &filter, m_polys, &pathCount, MAX_NAV_POLYS);
+    }
+
+    if (partial != nullptr)
+    {
+        *partial = dtStatusDetail(status, DT_PARTIAL_RESULT);
+    }
 
     if (dtStatusFailed(status))
     {
@@ -70,7 +70,9 @@ public:
     bool load(char* path);
     void unload();
 
-    int16 findPath(position_t start, position_t end, position_t* path, uint16 pathSize);
+    // with maxIterations the search runs as a sliced query capped at that many nodes, and an unfinished
+    // one returns the path to the polygon closest to the end (partial is set)
+    int16 findPath(position_t start, position_t end, position_t* path, uint16 pathSize, int32 maxIterations = 0, bool* partial = nullptr);
     int16 findRandomPosition(position_t start, float maxRadius, position_t* randomPosition);
 
     // returns true if the point is in water
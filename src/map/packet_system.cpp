@@ -31,12 +31,14 @@ This file is part of DarkStar-server source code.
 #include "../common/timer.h"
 #include "../common/utils.h"
 
+#include <memory>
 #include <string.h>
 #include "alliance.h"
 #include "utils/blueutils.h"
 #include "party.h"
 #include "packet_system.h"
 #include "conquest_system.h"
+#include "dbworker.h"
 #include "utils/battleutils.h"
 #include "utils/blacklistutils.h"
 #include "utils/charutils.h"
@@ -45,6 +47,7 @@ This file is part of DarkStar-server source code.
 #include "utils/fishingutils.h"
 #include "utils/itemutils.h"
 #include "utils/jailutils.h"
+#include "utils/partyutils.h"
 #include "linkshell.h"
 #include "map.h"
 #include "entities/mobentity.h"
@@ -1468,6 +1471,66 @@ void SmallPacket0x04B(map_session_data_t* session, CCharEntity* PChar, CBasicPac
 *                                                                       *
 ************************************************************************/
 
+// every delivery_box read goes through the same column list so a row can be copied back verbatim
+#define DELIVERY_COLUMNS "itemid, itemsubid, slot, quantity, sent, extra, sender, charname, senderid"
+
+struct delivery_row_t
+{
+    uint16   itemid;
+    uint16   subid;
+    uint8    slot;
+    uint32   quantity;
+    bool     sent;
+    uint8    extra[sizeof(CItem::m_extra)];
+    string_t sender;
+    string_t charname;
+    uint32   senderid;
+};
+
+static void ReadDeliveryRow(Sql_t* sql, delivery_row_t& row)
+{
+    row.itemid = (uint16)Sql_GetUIntData(sql, 0);
+    row.subid = (uint16)Sql_GetUIntData(sql, 1);
+    row.slot = (uint8)Sql_GetUIntData(sql, 2);
+    row.quantity = Sql_GetUIntData(sql, 3);
+    row.sent = Sql_GetUIntData(sql, 4) > 0;
+
+    size_t length = 0;
+    int8* extra = nullptr;
+    Sql_GetData(sql, 5, &extra, &length);
+    memset(row.extra, 0, sizeof(row.extra));
+    memcpy(row.extra, extra, (length > sizeof(row.extra) ? sizeof(row.extra) : length));
+
+    row.sender = Sql_GetData(sql, 6);
+    row.charname = Sql_GetData(sql, 7);
+    row.senderid = Sql_GetUIntData(sql, 8);
+}
+
+// runs on the main thread, items are never created by the db worker
+static CItem* MakeDeliveryItem(const delivery_row_t& row)
+{
+    CItem* PItem = itemutils::GetItem(row.itemid);
+
+    if (PItem != nullptr) // Prevent an access violation in the event that an item doesn't exist for an ID
+    {
+        PItem->setSubID(row.subid);
+        PItem->setSlotID(row.slot);
+        PItem->setQuantity(row.quantity);
+        PItem->setSent(row.sent);
+        memcpy(PItem->m_extra, row.extra, sizeof(PItem->m_extra));
+        PItem->setSender((int8*)row.sender.c_str());
+        PItem->setReceiver((int8*)row.charname.c_str());
+    }
+    return PItem;
+}
+
+static string_t EscapeName(Sql_t* sql, const string_t& name)
+{
+    int8 escaped[16 * 2 + 1];
+    Sql_EscapeStringLen(sql, escaped, name.c_str(), name.size() > 16 ? 16 : name.size());
+    return escaped;
+}
+
 void SmallPacket0x04D(map_session_data_t* session, CCharEntity* PChar, CBasicPacket data)
 {
     uint8 action = RBUFB(data, (0x04));
@@ -1493,55 +1556,62 @@ void SmallPacket0x04D(map_session_data_t* session, CCharEntity* PChar, CBasicPac
     // 0x0e - Opening to receive mail..
     // 0x0f - Closing mail window..
 
+    // the previous click is still in the database, its reply answers this one as well;
+    // opening and closing the window never wait, the done steps check the box is still open
+    if (dbworker::IsBusy(PChar) && action != 0x0D && action != 0x0E && action != 0x0F)
+    {
+        return;
+    }
+
+    uint32 charid = PChar->id;
+    string_t charname = PChar->GetName();
+
     switch (action)
     {
     case 0x01:
     {
-        int8* fmtQuery;
-
-        fmtQuery = "SELECT itemid, itemsubid, slot, quantity, sent, extra, sender, charname FROM delivery_box WHERE charid = %u AND box = %d AND slot < 8 ORDER BY slot;";
+        auto rows = std::make_shared<std::vector<delivery_row_t>>();
 
-        int32 ret = Sql_Query(SqlHandle, fmtQuery, PChar->id, boxtype);
+        dbworker::Submit(PChar, DBOP_DELIVERY_LIST, false,
+            [=](Sql_t* sql)
+        {
+            int32 ret = Sql_Query(sql, "SELECT " DELIVERY_COLUMNS " FROM delivery_box WHERE charid = %u AND box = %d AND slot < 8 ORDER BY slot;", charid, boxtype);
 
-        if (ret != SQL_ERROR)
+            if (ret == SQL_ERROR)
+            {
+                return false;
+            }
+            while (Sql_NextRow(sql) == SQL_SUCCESS)
+            {
+                delivery_row_t row;
+                ReadDeliveryRow(sql, row);
+                rows->push_back(row);
+            }
+            return true;
+        },
+            [=](CCharEntity* PChar, bool ok)
         {
-            int items = 0;
-            if (Sql_NumRows(SqlHandle) != 0)
+            if (!ok || PChar->UContainer->GetType() != UCONTAINER_DELIVERYBOX)
             {
-                while (Sql_NextRow(SqlHandle) == SQL_SUCCESS)
-                {
-                    CItem* PItem = itemutils::GetItem(Sql_GetIntData(SqlHandle, 0));
-
-                    if (PItem != nullptr) // Prevent an access violation in the event that an item doesn't exist for an ID
-                    {
-                        PItem->setSubID(Sql_GetIntData(SqlHandle, 1));
-                        PItem->setSlotID(Sql_GetIntData(SqlHandle, 2));
-                        PItem->setQuantity(Sql_GetUIntData(SqlHandle, 3));
-
-                        int what = Sql_GetUIntData(SqlHandle, 4);
-                        if (Sql_GetUIntData(SqlHandle, 4) > 0)
-                        {
-                            PItem->setSent(true);
-                        }
-
-                        size_t length = 0;
-                        int8* extra = nullptr;
-                        Sql_GetData(SqlHandle, 5, &extra, &length);
-                        memcpy(PItem->m_extra, extra, (length > sizeof(PItem->m_extra) ? sizeof(PItem->m_extra) : length));
+                return;
+            }
+            int items = 0;
 
-                        PItem->setSender(Sql_GetData(SqlHandle, 6));
-                        PItem->setReceiver(Sql_GetData(SqlHandle, 7));
+            for (auto& row : *rows)
+            {
+                CItem* PItem = MakeDeliveryItem(row);
 
-                        PChar->UContainer->SetItem(PItem->getSlotID(), PItem);
-                        ++items;
-                    }
+                if (PItem != nullptr)
+                {
+                    PChar->UContainer->SetItem(PItem->getSlotID(), PItem);
+                    ++items;
                 }
             }
             for (uint8 i = 0; i < 8; ++i)
             {
-                PChar->pushPacket(new CDeliveryBoxPacket(action, boxtype, PChar->UContainer->GetItem(i),i, items, 1));
+                PChar->pushPacket(new CDeliveryBoxPacket(action, boxtype, PChar->UContainer->GetItem(i), i, items, 1));
             }
-        }
+        });
         return;
     }
     case 0x02: //add items to send box
@@ -1550,57 +1620,97 @@ void SmallPacket0x04D(map_session_data_t* session, CCharEntity* PChar, CBasicPac
         uint32 quantity = RBUFL(data, (0x08));
         CItem* PItem = PChar->getStorage(LOC_INVENTORY)->GetItem(invslot);
 
-        if (quantity > 0 && PItem && PItem->getQuantity() >= quantity && PChar->UContainer->IsSlotEmpty(slotID))
+        if (quantity > 0 && PItem && !PItem->isSubType(ITEM_LOCKED) && PItem->getQuantity() >= quantity && PChar->UContainer->IsSlotEmpty(slotID))
         {
-            int32 ret = Sql_Query(SqlHandle, "SELECT charid, accid FROM chars WHERE charname = '%s' LIMIT 1;", data[0x10]);
-            if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) > 0 && Sql_NextRow(SqlHandle) == SQL_SUCCESS)
+            bool sameAccount = (PItem->getFlag() & ITEM_FLAG_NODELIVERY) != 0;
+
+            if (sameAccount && !(PItem->getFlag() & ITEM_FLAG_DELIVERYINNER))
+            {
+                return;
+            }
+            const int8* name = data[0x10];
+            string_t receiver(name, strnlen(name, 16));
+            uint16 itemid = PItem->getID();
+            uint16 subid = PItem->getSubID();
+            uint8 extra[sizeof(PItem->m_extra)];
+            memcpy(extra, PItem->m_extra, sizeof(extra));
+
+            // the stack can't be moved or traded away while its row is being written
+            PItem->setSubType(ITEM_LOCKED);
+
+            dbworker::Submit(PChar, DBOP_DELIVERY_ADD, false,
+                [=](Sql_t* sql)
             {
-                uint32 charid = Sql_GetUIntData(SqlHandle, 0);
+                string_t escaped = EscapeName(sql, receiver);
+                int32 ret = Sql_Query(sql, "SELECT charid, accid FROM chars WHERE charname = '%s' LIMIT 1;", escaped.c_str());
 
-                if (PItem->getFlag() & ITEM_FLAG_NODELIVERY)
+                if (ret == SQL_ERROR || Sql_NumRows(sql) == 0 || Sql_NextRow(sql) != SQL_SUCCESS)
                 {
-                    if (!(PItem->getFlag() & ITEM_FLAG_DELIVERYINNER))
-                        return;
-
-                    uint32 accid = Sql_GetUIntData(SqlHandle, 1);
-                    int32 ret = Sql_Query(SqlHandle, "SELECT COUNT(*) FROM chars WHERE charid = '%u' AND accid = '%u' LIMIT 1;", PChar->id, accid);
-                    if (ret == SQL_ERROR || Sql_NextRow(SqlHandle) != SQL_SUCCESS || Sql_GetUIntData(SqlHandle, 0) == 0)
-                        return;
+                    return false;
                 }
+                uint32 receiverid = Sql_GetUIntData(sql, 0);
 
-                CItem* PUBoxItem = itemutils::GetItem(PItem->getID());
-                PUBoxItem->setReceiver(data[0x10]);
-                PUBoxItem->setSender((int8*)PChar->GetName());
-                PUBoxItem->setQuantity(quantity);
-                PUBoxItem->setSlotID(PItem->getSlotID());
-                memcpy(PUBoxItem->m_extra, PItem->m_extra, sizeof(PUBoxItem->m_extra));
+                if (sameAccount)
+                {
+                    uint32 accid = Sql_GetUIntData(sql, 1);
+                    ret = Sql_Query(sql, "SELECT COUNT(*) FROM chars WHERE charid = '%u' AND accid = '%u' LIMIT 1;", charid, accid);
 
-                int8 extra[sizeof(PItem->m_extra) * 2 + 1];
-                Sql_EscapeStringLen(SqlHandle, extra, (const int8*)PItem->m_extra, sizeof(PItem->m_extra));
+                    if (ret == SQL_ERROR || Sql_NextRow(sql) != SQL_SUCCESS || Sql_GetUIntData(sql, 0) == 0)
+                    {
+                        return false;
+                    }
+                }
+                int8 escapedExtra[sizeof(extra) * 2 + 1];
+                Sql_EscapeStringLen(sql, escapedExtra, (const int8*)extra, sizeof(extra));
 
-                ret = Sql_Query(SqlHandle,
+                ret = Sql_Query(sql,
                     "INSERT INTO delivery_box(charid, charname, box, slot, itemid, itemsubid, quantity, extra, senderid, sender) VALUES(%u, '%s', 2, %u, %u, %u, %u, '%s', %u, '%s'); ",
-                    PChar->id,
-                    PChar->GetName(),
+                    charid,
+                    charname.c_str(),
                     slotID,
-                    PItem->getID(),
-                    PItem->getSubID(),
+                    itemid,
+                    subid,
                     quantity,
-                    extra,
-                    charid,
-                    data[0x10]);
+                    escapedExtra,
+                    receiverid,
+                    escaped.c_str());
+
+                return ret != SQL_ERROR && Sql_AffectedRows(sql) == 1;
+            },
+                [=](CCharEntity* PChar, bool ok)
+            {
+                CItem* PItem = PChar->getStorage(LOC_INVENTORY)->GetItem(invslot);
 
-                if (ret != SQL_ERROR && Sql_AffectedRows(SqlHandle) == 1 && charutils::UpdateItem(PChar, LOC_INVENTORY, invslot, -(int32)quantity))
+                if (PItem != nullptr)
+                {
+                    PItem->setSubType(ITEM_UNLOCKED);
+                }
+                if (!ok)
                 {
-                    PChar->UContainer->SetItem(slotID, PUBoxItem);
-                    PChar->pushPacket(new CDeliveryBoxPacket(action, boxtype, PUBoxItem, slotID, PChar->UContainer->GetItemsCount(), 1));
+                    return;
+                }
+                if (PItem != nullptr && PItem->getID() == itemid && charutils::UpdateItem(PChar, LOC_INVENTORY, invslot, -(int32)quantity))
+                {
+                    // a box closed in the meantime reads the row back on the next open
+                    if (PChar->UContainer->GetType() == UCONTAINER_DELIVERYBOX)
+                    {
+                        CItem* PUBoxItem = itemutils::GetItem(itemid);
+                        PUBoxItem->setReceiver((int8*)receiver.c_str());
+                        PUBoxItem->setSender((int8*)charname.c_str());
+                        PUBoxItem->setQuantity(quantity);
+                        PUBoxItem->setSlotID(invslot);
+                        memcpy(PUBoxItem->m_extra, extra, sizeof(PUBoxItem->m_extra));
+
+                        PChar->UContainer->SetItem(slotID, PUBoxItem);
+                        PChar->pushPacket(new CDeliveryBoxPacket(action, boxtype, PUBoxItem, slotID, PChar->UContainer->GetItemsCount(), 1));
+                    }
                     PChar->pushPacket(new CInventoryFinishPacket());
                 }
                 else
                 {
-                    delete PUBoxItem;
+                    ShowError("SmallPacket0x04D: item %u left inventory while its delivery was written. PlayerID: %d Slot: %d\n", itemid, charid, slotID);
                 }
-            }
+            });
         }
         return;
     }
@@ -1621,51 +1731,60 @@ void SmallPacket0x04D(map_session_data_t* session, CCharEntity* PChar, CBasicPac
 
             if (PItem && !PItem->isSent())
             {
-                bool isAutoCommitOn = Sql_GetAutoCommit(SqlHandle);
-                bool commit = false;
+                string_t receiver = PItem->getReceiver();
+                uint16 itemid = PItem->getID();
+                uint16 subid = PItem->getSubID();
+                uint32 quantity = PItem->getQuantity();
+                uint8 extra[sizeof(PItem->m_extra)];
+                memcpy(extra, PItem->m_extra, sizeof(extra));
 
-                if (Sql_SetAutoCommit(SqlHandle, false) && Sql_TransactionStart(SqlHandle))
+                dbworker::Submit(PChar, DBOP_DELIVERY_SEND, true,
+                    [=](Sql_t* sql)
                 {
-                    int32 ret = Sql_Query(SqlHandle, "SELECT charid FROM chars WHERE charname = '%s' LIMIT 1", PItem->getReceiver());
+                    string_t escaped = EscapeName(sql, receiver);
+                    int32 ret = Sql_Query(sql, "SELECT charid FROM chars WHERE charname = '%s' LIMIT 1", escaped.c_str());
 
-                    if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) > 0 && Sql_NextRow(SqlHandle) == SQL_SUCCESS)
+                    if (ret == SQL_ERROR || Sql_NumRows(sql) == 0 || Sql_NextRow(sql) != SQL_SUCCESS)
                     {
-                        uint32 charid = Sql_GetUIntData(SqlHandle, 0);
+                        return false;
+                    }
+                    uint32 receiverid = Sql_GetUIntData(sql, 0);
 
-                        ret = Sql_Query(SqlHandle, "UPDATE delivery_box SET sent = 1 WHERE charid = %u AND senderid = %u AND slot = %u AND box = 2;", PChar->id, charid, slotID);
+                    ret = Sql_Query(sql, "UPDATE delivery_box SET sent = 1 WHERE charid = %u AND senderid = %u AND slot = %u AND box = 2;", charid, receiverid, slotID);
 
-                        if (ret != SQL_ERROR && Sql_AffectedRows(SqlHandle) == 1)
-                        {
-                            int8 extra[sizeof(PItem->m_extra) * 2 + 1];
-                            Sql_EscapeStringLen(SqlHandle, extra, (const int8*)PItem->m_extra, sizeof(PItem->m_extra));
-
-                            ret = Sql_Query(SqlHandle,
-                                "INSERT INTO delivery_box(charid, charname, box, itemid, itemsubid, quantity, extra, senderid, sender) VALUES(%u, '%s', 1, %u, %u, %u, '%s', %u, '%s'); ",
-                                charid,
-                                PItem->getReceiver(),
-                                PItem->getID(),
-                                PItem->getSubID(),
-                                PItem->getQuantity(),
-                                extra,
-                                PChar->id,
-                                PChar->GetName());
-                            if (ret != SQL_ERROR && Sql_AffectedRows(SqlHandle) == 1)
-                            {
-                                PItem->setSent(true);
-                                PChar->pushPacket(new CDeliveryBoxPacket(action, boxtype, PItem, slotID, send_items, 0x02));
-                                PChar->pushPacket(new CDeliveryBoxPacket(action, boxtype, PItem, slotID, send_items, 0x01));
-                                commit = true;
-                            }
-                        }
-                    }
-                    if (!commit || !Sql_TransactionCommit(SqlHandle))
+                    if (ret == SQL_ERROR || Sql_AffectedRows(sql) != 1)
                     {
-                        Sql_TransactionRollback(SqlHandle);
-                        ShowError("Could not finalize send transaction. PlayerID: %d Target: %s slotID: %d", PChar->id, PItem->getReceiver(), slotID);
+                        return false;
                     }
+                    int8 escapedExtra[sizeof(extra) * 2 + 1];
+                    Sql_EscapeStringLen(sql, escapedExtra, (const int8*)extra, sizeof(extra));
 
-                    Sql_SetAutoCommit(SqlHandle, isAutoCommitOn);
-                }
+                    ret = Sql_Query(sql,
+                        "INSERT INTO delivery_box(charid, charname, box, itemid, itemsubid, quantity, extra, senderid, sender) VALUES(%u, '%s', 1, %u, %u, %u, '%s', %u, '%s'); ",
+                        receiverid,
+                        escaped.c_str(),
+                        itemid,
+                        subid,
+                        quantity,
+                        escapedExtra,
+                        charid,
+                        charname.c_str());
+
+                    return ret != SQL_ERROR && Sql_AffectedRows(sql) == 1;
+                },
+                    [=](CCharEntity* PChar, bool ok)
+                {
+                    CItem* PItem = PChar->UContainer->GetItem(slotID);
+
+                    if (!ok || PItem == nullptr)
+                    {
+                        ShowError("Could not finalize send transaction. PlayerID: %d Target: %s slotID: %d\n", charid, receiver.c_str(), slotID);
+                        return;
+                    }
+                    PItem->setSent(true);
+                    PChar->pushPacket(new CDeliveryBoxPacket(action, boxtype, PItem, slotID, send_items, 0x02));
+                    PChar->pushPacket(new CDeliveryBoxPacket(action, boxtype, PItem, slotID, send_items, 0x01));
+                });
             }
         }
         return;
@@ -1676,43 +1795,48 @@ void SmallPacket0x04D(map_session_data_t* session, CCharEntity* PChar, CBasicPac
 
         if (!PChar->UContainer->IsSlotEmpty(slotID))
         {
-            bool isAutoCommitOn = Sql_GetAutoCommit(SqlHandle);
-            bool commit = false;
+            CItem* PItem = PChar->UContainer->GetItem(slotID);
+            string_t receiver = PItem->getReceiver();
+            uint16 itemid = PItem->getID();
+            uint32 quantity = PItem->getQuantity();
 
-            if (Sql_SetAutoCommit(SqlHandle, false) && Sql_TransactionStart(SqlHandle))
+            dbworker::Submit(PChar, DBOP_DELIVERY_CANCEL, true,
+                [=](Sql_t* sql)
             {
-                int32 ret = Sql_Query(SqlHandle, "SELECT charid FROM chars WHERE charname = '%s' LIMIT 1", PChar->UContainer->GetItem(slotID)->getReceiver());
+                string_t escaped = EscapeName(sql, receiver);
+                int32 ret = Sql_Query(sql, "SELECT charid FROM chars WHERE charname = '%s' LIMIT 1", escaped.c_str());
 
-                if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) > 0 && Sql_NextRow(SqlHandle) == SQL_SUCCESS)
+                if (ret == SQL_ERROR || Sql_NumRows(sql) == 0 || Sql_NextRow(sql) != SQL_SUCCESS)
                 {
-                    uint32 charid = Sql_GetUIntData(SqlHandle, 0);
-                    ret = Sql_Query(SqlHandle, "UPDATE delivery_box SET sent = 0 WHERE charid = %u AND box = 2 AND slot = %u AND sent = 1 AND received = 0 LIMIT 1;", PChar->id, slotID);
-
-                    if (ret != SQL_ERROR && Sql_AffectedRows(SqlHandle) == 1)
-                    {
-                        CItem* PItem = PChar->UContainer->GetItem(slotID);
-                        int32 ret = Sql_Query(SqlHandle, "DELETE FROM delivery_box WHERE senderid = %u AND box = 1 AND charid = %u AND itemid = %u AND quantity = %u AND slot >= 8 LIMIT 1;",
-                            PChar->id, charid, PItem->getID(), PItem->getQuantity());
+                    return false;
+                }
+                uint32 receiverid = Sql_GetUIntData(sql, 0);
+                ret = Sql_Query(sql, "UPDATE delivery_box SET sent = 0 WHERE charid = %u AND box = 2 AND slot = %u AND sent = 1 AND received = 0 LIMIT 1;", charid, slotID);
 
-                        if (ret != SQL_ERROR && Sql_AffectedRows(SqlHandle) == 1)
-                        {
-                            PChar->UContainer->GetItem(slotID)->setSent(false);
-                            commit = true;
-                            PChar->pushPacket(new CDeliveryBoxPacket(action, boxtype, PChar->UContainer->GetItem(slotID), slotID, PChar->UContainer->GetItemsCount(), 0x02));
-                            PChar->pushPacket(new CDeliveryBoxPacket(action, boxtype, PChar->UContainer->GetItem(slotID), slotID, PChar->UContainer->GetItemsCount(), 0x01));
-                        }
-                    }
+                if (ret == SQL_ERROR || Sql_AffectedRows(sql) != 1)
+                {
+                    return false;
                 }
-                if (!commit || !Sql_TransactionCommit(SqlHandle))
+                ret = Sql_Query(sql, "DELETE FROM delivery_box WHERE senderid = %u AND box = 1 AND charid = %u AND itemid = %u AND quantity = %u AND slot >= 8 LIMIT 1;",
+                    charid, receiverid, itemid, quantity);
+
+                return ret != SQL_ERROR && Sql_AffectedRows(sql) == 1;
+            },
+                [=](CCharEntity* PChar, bool ok)
+            {
+                CItem* PItem = PChar->UContainer->GetItem(slotID);
+
+                if (!ok || PItem == nullptr)
                 {
-                    Sql_TransactionRollback(SqlHandle);
-                    ShowError("Could not finalize cancel send transaction. PlayerID: %d slotID: %d", PChar->id, slotID);
+                    ShowError("Could not finalize cancel send transaction. PlayerID: %d slotID: %d\n", charid, slotID);
                     //error message: "Delivery orders are currently backlogged."
                     PChar->pushPacket(new CDeliveryBoxPacket(action, boxtype, 0, -1));
+                    return;
                 }
-
-                Sql_SetAutoCommit(SqlHandle, isAutoCommitOn);
-            }
+                PItem->setSent(false);
+                PChar->pushPacket(new CDeliveryBoxPacket(action, boxtype, PItem, slotID, PChar->UContainer->GetItemsCount(), 0x02));
+                PChar->pushPacket(new CDeliveryBoxPacket(action, boxtype, PItem, slotID, PChar->UContainer->GetItemsCount(), 0x01));
+            });
         }
         return;
     }
@@ -1722,106 +1846,107 @@ void SmallPacket0x04D(map_session_data_t* session, CCharEntity* PChar, CBasicPac
         if (PChar->UContainer->GetType() != UCONTAINER_DELIVERYBOX)
             return;
 
-        uint8 received_items = 0;
-        int32 ret = SQL_ERROR;
-
-        if (boxtype == 0x01)
+        int limit = 0;
+        for (int i = 0; i < 8; ++i)
         {
-            int limit = 0;
-            for (int i = 0; i < 8; ++i)
+            if (PChar->UContainer->IsSlotEmpty(i))
             {
-                if (PChar->UContainer->IsSlotEmpty(i))
-                {
-                    limit++;
-                }
+                limit++;
             }
-            std::string Query = "SELECT charid FROM delivery_box WHERE charid = %u AND box = 1 AND slot >= 8 ORDER BY slot ASC LIMIT %u;";
-            ret = Sql_Query(SqlHandle, Query.c_str(), PChar->id, limit);
-        }
-        else if (boxtype == 0x02)
-        {
-            std::string Query = "SELECT charid FROM delivery_box WHERE charid = %u AND received = 1 AND box = 2;";
-            ret = Sql_Query(SqlHandle, Query.c_str(), PChar->id);
         }
+        auto received_items = std::make_shared<uint8>(0);
 
-        if (ret != SQL_ERROR)
+        dbworker::Submit(PChar, DBOP_DELIVERY_COUNT, false,
+            [=](Sql_t* sql)
         {
-            received_items = Sql_NumRows(SqlHandle);
-        }
-        PChar->pushPacket(new CDeliveryBoxPacket(action, boxtype, 0xFF, 0x02));
-        PChar->pushPacket(new CDeliveryBoxPacket(action, boxtype, received_items, 0x01));
+            int32 ret = SQL_ERROR;
+
+            if (boxtype == 0x01)
+            {
+                ret = Sql_Query(sql, "SELECT charid FROM delivery_box WHERE charid = %u AND box = 1 AND slot >= 8 ORDER BY slot ASC LIMIT %u;", charid, limit);
+            }
+            else if (boxtype == 0x02)
+            {
+                ret = Sql_Query(sql, "SELECT charid FROM delivery_box WHERE charid = %u AND received = 1 AND box = 2;", charid);
+            }
 
+            if (ret != SQL_ERROR)
+            {
+                *received_items = (uint8)Sql_NumRows(sql);
+            }
+            return ret != SQL_ERROR;
+        },
+            [=](CCharEntity* PChar, bool ok)
+        {
+            PChar->pushPacket(new CDeliveryBoxPacket(action, boxtype, 0xFF, 0x02));
+            PChar->pushPacket(new CDeliveryBoxPacket(action, boxtype, *received_items, 0x01));
+        });
         return;
     }
     case 0x06: // Move item to received
     {
         if (boxtype == 1)
         {
-            bool isAutoCommitOn = Sql_GetAutoCommit(SqlHandle);
-            bool commit = false;
-
-            if (Sql_SetAutoCommit(SqlHandle, false) && Sql_TransactionStart(SqlHandle))
+            if (!PChar->UContainer->IsSlotEmpty(slotID))
             {
-                std::string Query = "SELECT itemid, itemsubid, quantity, extra, sender, senderid FROM delivery_box WHERE charid = %u AND box = 1 AND slot >= 8 ORDER BY slot ASC LIMIT 1;";
+                ShowError("Could not find new item to add to delivery box. PlayerID: %d Box :%d Slot: %d\n", charid, boxtype, slotID);
+                PChar->pushPacket(new CDeliveryBoxPacket(action, boxtype, 0, 0xEB));
+                return;
+            }
+            auto row = std::make_shared<delivery_row_t>();
 
-                int32 ret = Sql_Query(SqlHandle, Query.c_str(), PChar->id);
+            dbworker::Submit(PChar, DBOP_DELIVERY_RECEIVE, true,
+                [=](Sql_t* sql)
+            {
+                int32 ret = Sql_Query(sql, "SELECT " DELIVERY_COLUMNS " FROM delivery_box WHERE charid = %u AND box = 1 AND slot >= 8 ORDER BY slot ASC LIMIT 1;", charid);
 
-                CItem* PItem = nullptr;
+                if (ret == SQL_ERROR || Sql_NumRows(sql) == 0 || Sql_NextRow(sql) != SQL_SUCCESS)
+                {
+                    return false;
+                }
+                ReadDeliveryRow(sql, *row);
 
-                if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) > 0 && Sql_NextRow(SqlHandle) == SQL_SUCCESS)
+                if (itemutils::GetItemPointer(row->itemid) == nullptr)
                 {
-                    PItem = itemutils::GetItem(Sql_GetUIntData(SqlHandle, 0));
+                    return false;
+                }
+                row->slot = slotID;
 
-                    if (PItem)
-                    {
-                        PItem->setSubID(Sql_GetIntData(SqlHandle, 1));
-                        PItem->setQuantity(Sql_GetUIntData(SqlHandle, 2));
+                //the result of this query doesn't really matter, it can be sent from the auction house which has no sender record
+                Sql_Query(sql, "UPDATE delivery_box SET received = 1 WHERE senderid = %u AND charid = %u AND box = 2 AND received = 0 AND quantity = %u LIMIT 1;",
+                    charid, row->senderid, row->quantity);
 
-                        size_t length = 0;
-                        int8* extra = nullptr;
-                        Sql_GetData(SqlHandle, 3, &extra, &length);
-                        memcpy(PItem->m_extra, extra, (length > sizeof(PItem->m_extra) ? sizeof(PItem->m_extra) : length));
+                ret = Sql_Query(sql, "UPDATE delivery_box SET slot = %u WHERE charid = %u AND box = 1 AND slot = 8;", slotID, charid);
 
-                        PItem->setSender(Sql_GetData(SqlHandle, 4));
-                        if (PChar->UContainer->IsSlotEmpty(slotID))
-                        {
-                            int senderID = Sql_GetUIntData(SqlHandle, 5);
-                            PItem->setSlotID(slotID);
-
-                            //the result of this query doesn't really matter, it can be sent from the auction house which has no sender record
-                            Sql_Query(SqlHandle, "UPDATE delivery_box SET received = 1 WHERE senderid = %u AND charid = %u AND box = 2 AND received = 0 AND quantity = %u LIMIT 1;",
-                                PChar->id, senderID, PItem->getQuantity());
-
-                            Query = "UPDATE delivery_box SET slot = %u WHERE charid = %u AND box = 1 AND slot = 8;";
-                            ret = Sql_Query(SqlHandle, Query.c_str(), slotID, PChar->id);
-                            if (ret != SQL_ERROR)
-                            {
-                                Query = "UPDATE delivery_box SET slot = slot - 1 WHERE charid = %u AND box = 1 AND slot > 8;";
-                                ret = Sql_Query(SqlHandle, Query.c_str(), PChar->id);
-                                if (ret != SQL_ERROR)
-                                {
-                                    PChar->UContainer->SetItem(slotID, PItem);
-                                    //TODO: increment "count" for every new item, if needed
-                                    PChar->pushPacket(new CDeliveryBoxPacket(action, boxtype, nullptr, slotID, 1, 2));
-                                    PChar->pushPacket(new CDeliveryBoxPacket(action, boxtype, PItem, slotID, 1, 1));
-                                    commit = true;
-                                }
-                            }
-                        }
-                    }
+                if (ret == SQL_ERROR)
+                {
+                    return false;
                 }
-                if (!commit || !Sql_TransactionCommit(SqlHandle))
+                ret = Sql_Query(sql, "UPDATE delivery_box SET slot = slot - 1 WHERE charid = %u AND box = 1 AND slot > 8;", charid);
+
+                return ret != SQL_ERROR;
+            },
+                [=](CCharEntity* PChar, bool ok)
+            {
+                CItem* PItem = ok ? MakeDeliveryItem(*row) : nullptr;
+
+                if (PItem == nullptr)
                 {
-                    if (PItem)
-                    {
-                        delete PItem;
-                    }
-                    Sql_TransactionRollback(SqlHandle);
-                    ShowError("Could not find new item to add to delivery box. PlayerID: %d Box :%d Slot: %d\n", PChar->id, boxtype, slotID);
+                    ShowError("Could not find new item to add to delivery box. PlayerID: %d Box :%d Slot: %d\n", charid, boxtype, slotID);
                     PChar->pushPacket(new CDeliveryBoxPacket(action, boxtype, 0, 0xEB));
+                    return;
                 }
-            }
-            Sql_SetAutoCommit(SqlHandle, isAutoCommitOn);
+                // a box closed in the meantime reads the row back on the next open
+                if (PChar->UContainer->GetType() != UCONTAINER_DELIVERYBOX)
+                {
+                    delete PItem;
+                    return;
+                }
+                PChar->UContainer->SetItem(slotID, PItem);
+                //TODO: increment "count" for every new item, if needed
+                PChar->pushPacket(new CDeliveryBoxPacket(action, boxtype, nullptr, slotID, 1, 2));
+                PChar->pushPacket(new CDeliveryBoxPacket(action, boxtype, PItem, slotID, 1, 1));
+            });
         }
         return;
     }
@@ -1844,17 +1969,30 @@ void SmallPacket0x04D(map_session_data_t* session, CCharEntity* PChar, CBasicPac
                 }
             }
         }
-        CItem* PItem = PChar->UContainer->GetItem(first_received);
+        if (first_received == 0xFF)
+        {
+            return;
+        }
 
-        int32 ret = Sql_Query(SqlHandle, "DELETE FROM delivery_box WHERE charid = %u AND box = 2 AND slot = %u LIMIT 1;", PChar->id, first_received);
+        dbworker::Submit(PChar, DBOP_DELIVERY_CLEAR, false,
+            [=](Sql_t* sql)
+        {
+            int32 ret = Sql_Query(sql, "DELETE FROM delivery_box WHERE charid = %u AND box = 2 AND slot = %u LIMIT 1;", charid, first_received);
 
-        if (ret != SQL_ERROR && Sql_AffectedRows(SqlHandle) == 1)
+            return ret != SQL_ERROR && Sql_AffectedRows(sql) == 1;
+        },
+            [=](CCharEntity* PChar, bool ok)
         {
-            PChar->pushPacket(new CDeliveryBoxPacket(action, boxtype, 0, 0x02));
-            PChar->pushPacket(new CDeliveryBoxPacket(action, boxtype, PItem, first_received, received_items, 0x01));
-            PChar->UContainer->SetItem(first_received, nullptr);
-            delete PItem;
-        }
+            CItem* PItem = PChar->UContainer->GetItem(first_received);
+
+            if (ok && PItem != nullptr)
+            {
+                PChar->pushPacket(new CDeliveryBoxPacket(action, boxtype, 0, 0x02));
+                PChar->pushPacket(new CDeliveryBoxPacket(action, boxtype, PItem, first_received, received_items, 0x01));
+                PChar->UContainer->SetItem(first_received, nullptr);
+                delete PItem;
+            }
+        });
         return;
     }
     case 0x08:
@@ -1871,72 +2009,75 @@ void SmallPacket0x04D(map_session_data_t* session, CCharEntity* PChar, CBasicPac
         if (PChar->UContainer->GetType() == UCONTAINER_DELIVERYBOX &&
             !PChar->UContainer->IsSlotEmpty(slotID))
         {
-            bool isAutoCommitOn = Sql_GetAutoCommit(SqlHandle);
-            bool commit = false; // When in doubt back it out.
-
             CItem* PItem = PChar->UContainer->GetItem(slotID);
-            auto item_id = PItem->getID();
-            auto quantity = PItem->getQuantity();
-            uint32 senderID = 0;
-            string_t senderName;
+            uint16 itemid = PItem->getID();
+            uint16 subid = PItem->getSubID();
+            uint32 quantity = PItem->getQuantity();
+            uint8 extra[sizeof(PItem->m_extra)];
+            memcpy(extra, PItem->m_extra, sizeof(extra));
+            auto senderID = std::make_shared<uint32>(0);
 
-            if (Sql_SetAutoCommit(SqlHandle, false) && Sql_TransactionStart(SqlHandle))
+            dbworker::Submit(PChar, DBOP_DELIVERY_RETURN, true,
+                [=](Sql_t* sql)
             {
                 // Get sender of delivery record
-                int32 ret = Sql_Query(SqlHandle, "SELECT senderid, sender FROM delivery_box WHERE charid = %u AND slot = %u AND box = 1 LIMIT 1;", PChar->id, slotID);
+                int32 ret = Sql_Query(sql, "SELECT senderid, sender FROM delivery_box WHERE charid = %u AND slot = %u AND box = 1 LIMIT 1;", charid, slotID);
 
-                if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) > 0 && Sql_NextRow(SqlHandle) == SQL_SUCCESS)
+                if (ret == SQL_ERROR || Sql_NumRows(sql) == 0 || Sql_NextRow(sql) != SQL_SUCCESS)
                 {
-                    senderID = Sql_GetUIntData(SqlHandle, 0);
-                    senderName.insert(0, Sql_GetData(SqlHandle, 1));
+                    return false;
+                }
+                *senderID = Sql_GetUIntData(sql, 0);
+                string_t senderName = EscapeName(sql, Sql_GetData(sql, 1));
 
-                    if (senderID != 0)
-                    {
-                        int8 extra[sizeof(PItem->m_extra) * 2 + 1];
-                        Sql_EscapeStringLen(SqlHandle, extra, (const int8*)PItem->m_extra, sizeof(PItem->m_extra));
-
-                        // Insert a return record into delivery_box
-                        ret = Sql_Query(SqlHandle,
-                            "INSERT INTO delivery_box(charid, charname, box, itemid, itemsubid, quantity, extra, senderid, sender) VALUES(%u, '%s', 1, %u, %u, %u, '%s', %u, '%s'); ",
-                            senderID,
-                            senderName.c_str(),
-                            PItem->getID(),
-                            PItem->getSubID(),
-                            PItem->getQuantity(),
-                            extra,
-                            PChar->id,
-                            PChar->GetName());
-
-                        if (ret != SQL_ERROR && Sql_AffectedRows(SqlHandle) > 0)
-                        {
-                            // Remove original delivery record
-                            ret = Sql_Query(SqlHandle, "DELETE FROM delivery_box WHERE charid = %u AND slot = %u AND box = 1 LIMIT 1;", PChar->id, slotID);
-
-                            if (ret != SQL_ERROR && Sql_AffectedRows(SqlHandle) > 0)
-                            {
-                                ret = Sql_Query(SqlHandle, "UPDATE delivery_box SET received = 1 WHERE senderid = %u AND charid = %u AND box = 2 LIMIT 1;", PChar->id, senderID);
-
-                                if (ret != SQL_ERROR && Sql_AffectedRows(SqlHandle) == 1)
-                                {
-                                    PChar->UContainer->SetItem(slotID, nullptr);
-                                    PChar->pushPacket(new CDeliveryBoxPacket(action, boxtype, PItem, slotID, PChar->UContainer->GetItemsCount(), 1));
-                                    delete PItem;
-                                    commit = true;
-                                }
-                            }
-                        }
-                    }
+                if (*senderID == 0)
+                {
+                    return false;
                 }
+                int8 escapedExtra[sizeof(extra) * 2 + 1];
+                Sql_EscapeStringLen(sql, escapedExtra, (const int8*)extra, sizeof(extra));
+
+                // Insert a return record into delivery_box
+                ret = Sql_Query(sql,
+                    "INSERT INTO delivery_box(charid, charname, box, itemid, itemsubid, quantity, extra, senderid, sender) VALUES(%u, '%s', 1, %u, %u, %u, '%s', %u, '%s'); ",
+                    *senderID,
+                    senderName.c_str(),
+                    itemid,
+                    subid,
+                    quantity,
+                    escapedExtra,
+                    charid,
+                    charname.c_str());
 
-                if (!commit || !Sql_TransactionCommit(SqlHandle))
+                if (ret == SQL_ERROR || Sql_AffectedRows(sql) == 0)
                 {
-                    Sql_TransactionRollback(SqlHandle);
-                    ShowError("Could not finalize delivery return transaction. PlayerID: %d SenderID :%d ItemID: %d Quantity: %d", PChar->id, senderID, item_id, quantity);
-                    PChar->pushPacket(new CDeliveryBoxPacket(action, boxtype, PItem, slotID, PChar->UContainer->GetItemsCount(), 0xEB));
+                    return false;
                 }
+                // Remove original delivery record
+                ret = Sql_Query(sql, "DELETE FROM delivery_box WHERE charid = %u AND slot = %u AND box = 1 LIMIT 1;", charid, slotID);
 
-                Sql_SetAutoCommit(SqlHandle, isAutoCommitOn);
-            }
+                if (ret == SQL_ERROR || Sql_AffectedRows(sql) == 0)
+                {
+                    return false;
+                }
+                ret = Sql_Query(sql, "UPDATE delivery_box SET received = 1 WHERE senderid = %u AND charid = %u AND box = 2 LIMIT 1;", charid, *senderID);
+
+                return ret != SQL_ERROR && Sql_AffectedRows(sql) == 1;
+            },
+                [=](CCharEntity* PChar, bool ok)
+            {
+                CItem* PItem = PChar->UContainer->GetItem(slotID);
+
+                if (!ok || PItem == nullptr)
+                {
+                    ShowError("Could not finalize delivery return transaction. PlayerID: %d SenderID :%d ItemID: %d Quantity: %d\n", charid, *senderID, itemid, quantity);
+                    PChar->pushPacket(new CDeliveryBoxPacket(action, boxtype, PItem, slotID, PChar->UContainer->GetItemsCount(), 0xEB));
+                    return;
+                }
+                PChar->UContainer->SetItem(slotID, nullptr);
+                PChar->pushPacket(new CDeliveryBoxPacket(action, boxtype, PItem, slotID, PChar->UContainer->GetItemsCount(), 1));
+                delete PItem;
+            });
         }
         return;
     }
@@ -1945,57 +2086,85 @@ void SmallPacket0x04D(map_session_data_t* session, CCharEntity* PChar, CBasicPac
         if (PChar->UContainer->GetType() == UCONTAINER_DELIVERYBOX &&
             !PChar->UContainer->IsSlotEmpty(slotID))
         {
-            bool isAutoCommitOn = Sql_GetAutoCommit(SqlHandle);
-            bool commit = false;
-
             CItem* PItem = PChar->UContainer->GetItem(slotID);
 
-            //ShowMessage("FreeSlots %u\n", PChar->getStorage(LOC_INVENTORY)->GetFreeSlotsCount());
-            //ShowMessage("ItemId %u", PItem->getID());
-
             if (!PItem->isType(ITEM_CURRENCY) &&
                 PChar->getStorage(LOC_INVENTORY)->GetFreeSlotsCount() == 0)
             {
                 PChar->pushPacket(new CDeliveryBoxPacket(action, boxtype, PItem, slotID, PChar->UContainer->GetItemsCount(), 0xB9));
                 return;
             }
+            if (boxtype != 0x01 && boxtype != 0x02)
+            {
+                return;
+            }
+            auto row = std::make_shared<delivery_row_t>();
 
-            if (Sql_SetAutoCommit(SqlHandle, false) && Sql_TransactionStart(SqlHandle))
+            dbworker::Submit(PChar, DBOP_DELIVERY_TAKE, true,
+                [=](Sql_t* sql)
             {
-                int32 ret;
-                if (boxtype == 0x01)
-                {
-                    ret = Sql_Query(SqlHandle, "DELETE FROM delivery_box WHERE charid = %u AND slot = %u AND box = %u LIMIT 1", PChar->id, slotID, boxtype);
-                }
-                else if (boxtype == 0x02)
-                {
-                    ret = Sql_Query(SqlHandle, "DELETE FROM delivery_box WHERE charid = %u AND sent = 0 AND slot = %u AND box = %u LIMIT 1", PChar->id, slotID, boxtype);
-                }
+                // the row is kept in case the inventory filled up in the meantime
+                const int8* sentFilter = boxtype == 0x02 ? "AND sent = 0 " : "";
+                int32 ret = Sql_Query(sql, "SELECT " DELIVERY_COLUMNS " FROM delivery_box WHERE charid = %u %sAND slot = %u AND box = %u LIMIT 1;", charid, sentFilter, slotID, boxtype);
 
-                if (ret != SQL_ERROR &&  Sql_AffectedRows(SqlHandle) != 0)
+                if (ret == SQL_ERROR || Sql_NumRows(sql) == 0 || Sql_NextRow(sql) != SQL_SUCCESS)
                 {
-                    if (charutils::AddItem(PChar, LOC_INVENTORY, itemutils::GetItem(PItem), true) != ERROR_SLOTID)
-                    {
-                        commit = true;
-                    }
+                    return false;
                 }
+                ReadDeliveryRow(sql, *row);
 
-                if (!commit || !Sql_TransactionCommit(SqlHandle))
-                {
-                    Sql_TransactionRollback(SqlHandle);
-                    PChar->pushPacket(new CDeliveryBoxPacket(action, boxtype, PItem, slotID, PChar->UContainer->GetItemsCount(), 0xBA));
-                    ShowError("Could not finalize receive transaction. PlayerID: %d Action: 0x0A", PChar->id);
-                }
-                else
+                ret = Sql_Query(sql, "DELETE FROM delivery_box WHERE charid = %u %sAND slot = %u AND box = %u LIMIT 1", charid, sentFilter, slotID, boxtype);
+
+                return ret != SQL_ERROR && Sql_AffectedRows(sql) != 0;
+            },
+                [=](CCharEntity* PChar, bool ok)
+            {
+                CItem* PItem = PChar->UContainer->GetItem(slotID);
+
+                if (ok && PItem != nullptr && charutils::AddItem(PChar, LOC_INVENTORY, itemutils::GetItem(PItem), true) != ERROR_SLOTID)
                 {
                     PChar->pushPacket(new CDeliveryBoxPacket(action, boxtype, PItem, slotID, PChar->UContainer->GetItemsCount(), 1));
                     PChar->pushPacket(new CInventoryFinishPacket());
                     PChar->UContainer->SetItem(slotID, nullptr);
                     delete PItem;
+                    return;
                 }
-            }
+                PChar->pushPacket(new CDeliveryBoxPacket(action, boxtype, PItem, slotID, PChar->UContainer->GetItemsCount(), 0xBA));
+                ShowError("Could not finalize receive transaction. PlayerID: %d Action: 0x0A\n", charid);
 
-            Sql_SetAutoCommit(SqlHandle, isAutoCommitOn);
+                if (ok)
+                {
+                    dbworker::Submit(PChar, DBOP_DELIVERY_RESTORE, false,
+                        [=](Sql_t* sql)
+                    {
+                        string_t sender = EscapeName(sql, row->sender);
+                        string_t owner = EscapeName(sql, row->charname);
+                        int8 escapedExtra[sizeof(row->extra) * 2 + 1];
+                        Sql_EscapeStringLen(sql, escapedExtra, (const int8*)row->extra, sizeof(row->extra));
+
+                        return Sql_Query(sql,
+                            "INSERT INTO delivery_box(charid, charname, box, slot, itemid, itemsubid, quantity, extra, senderid, sender, sent) VALUES(%u, '%s', %u, %u, %u, %u, %u, '%s', %u, '%s', %u); ",
+                            charid,
+                            owner.c_str(),
+                            boxtype,
+                            row->slot,
+                            row->itemid,
+                            row->subid,
+                            row->quantity,
+                            escapedExtra,
+                            row->senderid,
+                            sender.c_str(),
+                            row->sent ? 1 : 0) != SQL_ERROR;
+                    },
+                        [=](CCharEntity* PChar, bool ok)
+                    {
+                        if (!ok)
+                        {
+                            ShowError("Could not restore delivery box item %u. PlayerID: %d Slot: %d\n", row->itemid, charid, slotID);
+                        }
+                    });
+                }
+            });
         }
         return;
     }
@@ -2004,43 +2173,62 @@ void SmallPacket0x04D(map_session_data_t* session, CCharEntity* PChar, CBasicPac
         if (PChar->UContainer->GetType() == UCONTAINER_DELIVERYBOX &&
             !PChar->UContainer->IsSlotEmpty(slotID))
         {
-            int32 ret = Sql_Query(SqlHandle, "DELETE FROM delivery_box WHERE charid = %u AND slot = %u AND box = 1 LIMIT 1", PChar->id, slotID);
+            dbworker::Submit(PChar, DBOP_DELIVERY_DROP, false,
+                [=](Sql_t* sql)
+            {
+                int32 ret = Sql_Query(sql, "DELETE FROM delivery_box WHERE charid = %u AND slot = %u AND box = 1 LIMIT 1", charid, slotID);
 
-            if (ret != SQL_ERROR && Sql_AffectedRows(SqlHandle) != 0)
+                return ret != SQL_ERROR && Sql_AffectedRows(sql) != 0;
+            },
+                [=](CCharEntity* PChar, bool ok)
             {
                 CItem* PItem = PChar->UContainer->GetItem(slotID);
-                PChar->UContainer->SetItem(slotID, nullptr);
 
-                PChar->pushPacket(new CDeliveryBoxPacket(action, boxtype, PItem, slotID, PChar->UContainer->GetItemsCount(), 1));
-                delete PItem;
-            }
+                if (ok && PItem != nullptr)
+                {
+                    PChar->UContainer->SetItem(slotID, nullptr);
+                    PChar->pushPacket(new CDeliveryBoxPacket(action, boxtype, PItem, slotID, PChar->UContainer->GetItemsCount(), 1));
+                    delete PItem;
+                }
+            });
         }
         return;
     }
     case 0x0C: // Confirm name (send box)
     {
-        int32 ret = Sql_Query(SqlHandle, "SELECT accid FROM chars WHERE charname = '%s' LIMIT 1", data[0x10]);
+        const int8* name = data[0x10];
+        string_t receiver(name, strnlen(name, 16));
+        auto result = std::make_shared<uint8>(0xFB);
+
+        dbworker::Submit(PChar, DBOP_DELIVERY_CONFIRM, false,
+            [=](Sql_t* sql)
+        {
+            string_t escaped = EscapeName(sql, receiver);
+            int32 ret = Sql_Query(sql, "SELECT accid FROM chars WHERE charname = '%s' LIMIT 1", escaped.c_str());
+
+            if (ret == SQL_ERROR || Sql_NumRows(sql) == 0 || Sql_NextRow(sql) != SQL_SUCCESS)
+            {
+                return false;
+            }
+            uint32 accid = Sql_GetUIntData(sql, 0);
+            ret = Sql_Query(sql, "SELECT COUNT(*) FROM chars WHERE charid = '%u' AND accid = '%u' LIMIT 1;", charid, accid);
 
-        if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) > 0 && Sql_NextRow(SqlHandle) == SQL_SUCCESS)
+            *result = (ret != SQL_ERROR && Sql_NextRow(sql) == SQL_SUCCESS && Sql_GetUIntData(sql, 0)) ? 0x01 : 0x00;
+            return true;
+        },
+            [=](CCharEntity* PChar, bool ok)
         {
-            uint32 accid = Sql_GetUIntData(SqlHandle, 0);
-            ret = Sql_Query(SqlHandle, "SELECT COUNT(*) FROM chars WHERE charid = '%u' AND accid = '%u' LIMIT 1;", PChar->id, accid);
-            if (ret != SQL_ERROR && Sql_NextRow(SqlHandle) == SQL_SUCCESS && Sql_GetUIntData(SqlHandle, 0))
+            PChar->pushPacket(new CDeliveryBoxPacket(action, boxtype, 0xFF, 0x02));
+
+            if (ok)
             {
-                PChar->pushPacket(new CDeliveryBoxPacket(action, boxtype, 0xFF, 0x02));
-                PChar->pushPacket(new CDeliveryBoxPacket(action, boxtype, 0x01, 0x01));
+                PChar->pushPacket(new CDeliveryBoxPacket(action, boxtype, *result, 0x01));
             }
             else
             {
-                PChar->pushPacket(new CDeliveryBoxPacket(action, boxtype, 0xFF, 0x02));
-                PChar->pushPacket(new CDeliveryBoxPacket(action, boxtype, 0x00, 0x01));
+                PChar->pushPacket(new CDeliveryBoxPacket(action, boxtype, 0x00, 0xFB));
             }
-        }
-        else
-        {
-            PChar->pushPacket(new CDeliveryBoxPacket(action, boxtype, 0xFF, 0x02));
-            PChar->pushPacket(new CDeliveryBoxPacket(action, boxtype, 0x00, 0xFB));
-        }
+        });
         return;
     }
     case 0x0D: //open send box
@@ -2092,6 +2280,14 @@ void SmallPacket0x04E(map_session_data_t* session, CCharEntity* PChar, CBasicPac
     // 0x0С - Cancel Sale
     // 0x0D - Update Sale List By Player
 
+    if (dbworker::IsBusy(PChar))
+    {
+        return;
+    }
+
+    uint32 charid = PChar->id;
+    string_t charname = PChar->GetName();
+
     switch (action)
     {
     case 0x04:
@@ -2114,35 +2310,51 @@ void SmallPacket0x04E(map_session_data_t* session, CCharEntity* PChar, CBasicPac
 
         if (curTick - PChar->m_AHHistoryTimestamp > 5000)
         {
-            PChar->m_ah_history.clear();
             PChar->m_AHHistoryTimestamp = curTick;
             PChar->pushPacket(new CAuctionHousePacket(action));
 
-            // A single SQL query for the player's AH history which is stored in a Char Entity struct + vector.
-            const int8* Query = "SELECT itemid, price, stack FROM auction_house WHERE seller = %u and sale=0 LIMIT 7;";
+            auto history = std::make_shared<std::vector<AuctionHistory_t>>();
 
-            int32 ret = Sql_Query(SqlHandle, Query, PChar->id);
-
-            if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) != 0)
+            // A single SQL query for the player's AH history which is stored in a Char Entity struct + vector.
+            dbworker::Submit(PChar, DBOP_AH_HISTORY, false,
+                [=](Sql_t* sql)
             {
-                while (Sql_NextRow(SqlHandle) == SQL_SUCCESS)
+                int32 ret = Sql_Query(sql, "SELECT itemid, price, stack FROM auction_house WHERE seller = %u and sale=0 LIMIT 7;", charid);
+
+                if (ret == SQL_ERROR)
+                {
+                    return false;
+                }
+                while (Sql_NextRow(sql) == SQL_SUCCESS)
                 {
                     AuctionHistory_t ah;
-                    ah.itemid = (uint16)Sql_GetIntData(SqlHandle, 0);
-                    ah.price = (uint32)Sql_GetUIntData(SqlHandle, 1);
-                    ah.stack = (uint8)Sql_GetIntData(SqlHandle, 2);
+                    ah.itemid = (uint16)Sql_GetIntData(sql, 0);
+                    ah.price = (uint32)Sql_GetUIntData(sql, 1);
+                    ah.stack = (uint8)Sql_GetIntData(sql, 2);
                     ah.status = 0;
-                    PChar->m_ah_history.push_back(ah);
+                    history->push_back(ah);
                 }
-            }
-            ShowDebug("%s has %i items up on the AH. \n", PChar->GetName(), PChar->m_ah_history.size());
+                return true;
+            },
+                [=](CCharEntity* PChar, bool ok)
+            {
+                PChar->m_ah_history = *history;
+                ShowDebug("%s has %i items up on the AH. \n", PChar->GetName(), PChar->m_ah_history.size());
+
+                uint8 totalItemsOnAh = PChar->m_ah_history.size();
+
+                for (int8 slot = 0; slot < totalItemsOnAh; slot++)
+                {
+                    PChar->pushPacket(new CAuctionHousePacket(0x0C, slot, PChar));
+                }
+            });
         }
         else
         {
             PChar->pushPacket(new CAuctionHousePacket(action, 246, 0, 0)); // try again in a little while msg
-            break;
         }
     }
+    break;
     case 0x0A:
     {
         uint8 totalItemsOnAh = PChar->m_ah_history.size();
@@ -2175,26 +2387,45 @@ void SmallPacket0x04E(map_session_data_t* session, CCharEntity* PChar, CBasicPac
                 PChar->pushPacket(new CAuctionHousePacket(action, 197, 0, 0)); //failed to place up
                 return;
             }
+            uint16 sellid = PItem->getID();
+            int32 sold = -(int32)(quantity != 0 ? 1 : PItem->getStackSize());
 
-            const int8* fmtQuery = "INSERT INTO auction_house(itemid, stack, seller, seller_name, date, price) VALUES(%u,%u,%u,'%s',%u,%u)";
+            // the item can't be moved or traded away while the listing is written
+            PItem->setSubType(ITEM_LOCKED);
 
-            if (Sql_Query(SqlHandle,
-                fmtQuery,
-                PItem->getID(),
-                quantity == 0,
-                PChar->id,
-                PChar->GetName(),
-                (uint32)time(nullptr),
-                price) == SQL_ERROR)
+            dbworker::Submit(PChar, DBOP_AH_SELL, false,
+                [=](Sql_t* sql)
             {
-				ShowError(CL_RED"SmallPacket0x04E::AuctionHouse: Cannot insert item %s to database\n" CL_RESET, PItem->getName());
-                PChar->pushPacket(new CAuctionHousePacket(action, 197, 0, 0)); //failed to place up
-                return;
-            }
-            charutils::UpdateItem(PChar, LOC_INVENTORY, slot, -(int32)(quantity != 0 ? 1 : PItem->getStackSize()));
+                const int8* fmtQuery = "INSERT INTO auction_house(itemid, stack, seller, seller_name, date, price) VALUES(%u,%u,%u,'%s',%u,%u)";
+
+                return Sql_Query(sql,
+                    fmtQuery,
+                    sellid,
+                    quantity == 0,
+                    charid,
+                    charname.c_str(),
+                    (uint32)time(nullptr),
+                    price) != SQL_ERROR;
+            },
+                [=](CCharEntity* PChar, bool ok)
+            {
+                CItem* PItem = PChar->getStorage(LOC_INVENTORY)->GetItem(slot);
+
+                if (PItem != nullptr)
+                {
+                    PItem->setSubType(ITEM_UNLOCKED);
+                }
+                if (!ok)
+                {
+                    ShowError(CL_RED"SmallPacket0x04E::AuctionHouse: Cannot insert item %u to database\n" CL_RESET, sellid);
+                    PChar->pushPacket(new CAuctionHousePacket(action, 197, 0, 0)); //failed to place up
+                    return;
+                }
+                charutils::UpdateItem(PChar, LOC_INVENTORY, slot, sold);
 
-            PChar->pushPacket(new CAuctionHousePacket(action, 1, 0, 0)); //merchandise put up on auction msg
-            PChar->pushPacket(new CAuctionHousePacket(0x0C, PChar->m_ah_history.size(), PChar)); //inform history of slot
+                PChar->pushPacket(new CAuctionHousePacket(action, 1, 0, 0)); //merchandise put up on auction msg
+                PChar->pushPacket(new CAuctionHousePacket(0x0C, PChar->m_ah_history.size(), PChar)); //inform history of slot
+            });
         }
     }
     break;
@@ -2225,33 +2456,47 @@ void SmallPacket0x04E(map_session_data_t* session, CCharEntity* PChar, CBasicPac
                 }
                 CItem* gil = PChar->getStorage(LOC_INVENTORY)->GetItem(0);
 
+                // the bid is held back while it is in flight so it can't be spent twice
                 if (gil != nullptr &&
                     gil->isType(ITEM_CURRENCY) &&
-                    gil->getQuantity() >= price)
+                    gil->getQuantity() >= price &&
+                    charutils::UpdateItem(PChar, LOC_INVENTORY, 0, -(int32)(price)))
                 {
-                    const int8* fmtQuery = "UPDATE auction_house SET buyer_name = '%s', sale = %u, sell_date = %u WHERE itemid = %u AND buyer_name IS NULL AND stack = %u AND price <= %u ORDER BY price LIMIT 1";
+                    uint32 count = (quantity == 0 ? PItem->getStackSize() : 1);
 
-                    if (Sql_Query(SqlHandle,
-                        fmtQuery,
-                        PChar->GetName(),
-                        price,
-                        (uint32)time(nullptr),
-                        itemid,
-                        quantity == 0,
-                        price) != SQL_ERROR &&
-                        Sql_AffectedRows(SqlHandle) != 0)
+                    dbworker::Submit(PChar, DBOP_AH_BUY, false,
+                        [=](Sql_t* sql)
                     {
-                        uint8 SlotID = charutils::AddItem(PChar, LOC_INVENTORY, itemid, (quantity == 0 ? PItem->getStackSize() : 1));
-
-                        if (SlotID != ERROR_SLOTID)
+                        const int8* fmtQuery = "UPDATE auction_house SET buyer_name = '%s', sale = %u, sell_date = %u WHERE itemid = %u AND buyer_name IS NULL AND stack = %u AND price <= %u ORDER BY price LIMIT 1";
+
+                        return Sql_Query(sql,
+                            fmtQuery,
+                            charname.c_str(),
+                            price,
+                            (uint32)time(nullptr),
+                            itemid,
+                            quantity == 0,
+                            price) != SQL_ERROR &&
+                            Sql_AffectedRows(sql) != 0;
+                    },
+                        [=](CCharEntity* PChar, bool ok)
+                    {
+                        if (ok && charutils::AddItem(PChar, LOC_INVENTORY, itemid, count) != ERROR_SLOTID)
                         {
-                            charutils::UpdateItem(PChar, LOC_INVENTORY, 0, -(int32)(price));
-
                             PChar->pushPacket(new CAuctionHousePacket(action, 0x01, itemid, price));
                             PChar->pushPacket(new CInventoryFinishPacket());
+                            return;
                         }
-                        return;
-                    }
+                        charutils::UpdateItem(PChar, LOC_INVENTORY, 0, price);
+
+                        if (ok)
+                        {
+                            ShowError("SmallPacket0x04E: bought item %u but could not add it to inventory. PlayerID: %d\n", itemid, charid);
+                            return;
+                        }
+                        PChar->pushPacket(new CAuctionHousePacket(action, 0xC5, itemid, price));
+                    });
+                    return;
                 }
             }
             PChar->pushPacket(new CAuctionHousePacket(action, 0xC5, itemid, price));
@@ -2266,48 +2511,56 @@ void SmallPacket0x04E(map_session_data_t* session, CCharEntity* PChar, CBasicPac
             PChar->pushPacket(new CAuctionHousePacket(action, 0xE5, PChar, slotid, true)); //invent full, unable to remove msg
             return;
         }
-        else
+        auto removed = std::make_shared<std::pair<uint16, uint16>>(0, 0);
+
+        dbworker::Submit(PChar, DBOP_AH_CANCEL, true,
+            [=](Sql_t* sql)
         {
-            const int8* delQuery = "DELETE FROM auction_house WHERE seller = %u AND id = %u AND sale = 0 LIMIT 1;";
+            int32 ret = Sql_Query(sql, "SELECT itemid, stack, id FROM auction_house WHERE seller = %u and sale=0;", charid);
 
-            const int8* fmtQuery = "SELECT itemid, stack, id FROM auction_house WHERE seller = %u and sale=0;";
-            int32 ret = Sql_Query(SqlHandle, fmtQuery, PChar->id);
-            if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) != 0)
+            if (ret == SQL_ERROR || Sql_NumRows(sql) <= slotid)
             {
-                uint8 count = 0;
-                while (Sql_NextRow(SqlHandle) == SQL_SUCCESS)
+                return false;
+            }
+            for (uint8 count = 0; count <= slotid; ++count)
+            {
+                if (Sql_NextRow(sql) != SQL_SUCCESS)
                 {
-                    if (count == slotid){
-                        uint16 delitemid = (uint16)Sql_GetUIntData(SqlHandle, 0);
-                        uint16 delitemstack = (uint16)Sql_GetUIntData(SqlHandle, 1);
-                        uint32 ahid = (uint32)Sql_GetUIntData(SqlHandle, 2);
-                        int32 delret = Sql_Query(SqlHandle, delQuery, PChar->id, ahid);
-                        if (delret != SQL_ERROR){
-                            //add the item back to the users invent
-                            CItem* PDelItem = itemutils::GetItemPointer(delitemid);
-                            if (PDelItem != nullptr){
-                                uint8 SlotID = charutils::AddItem(PChar, LOC_INVENTORY, delitemid,
-                                    (delitemstack != 0 ? PDelItem->getStackSize() : 1));
-
-                                if (SlotID != ERROR_SLOTID)
-                                {
-                                    PChar->pushPacket(new CAuctionHousePacket(action, 0, PChar, slotid, false));
-                                    PChar->pushPacket(new CInventoryFinishPacket());
-                                }
-                                else {
-                                    ShowError("Failed to return item id %u stack %u to char... \n", delitemid, delitemstack);
-                                }
-                                return;
-                            }
-                        }
-                        break;
-                    }
-                    count++;
+                    return false;
                 }
             }
+            removed->first = (uint16)Sql_GetUIntData(sql, 0);
+            removed->second = (uint16)Sql_GetUIntData(sql, 1);
+            uint32 ahid = (uint32)Sql_GetUIntData(sql, 2);
+
+            return Sql_Query(sql, "DELETE FROM auction_house WHERE seller = %u AND id = %u AND sale = 0 LIMIT 1;", charid, ahid) != SQL_ERROR &&
+                Sql_AffectedRows(sql) != 0;
+        },
+            [=](CCharEntity* PChar, bool ok)
+        {
+            uint16 delitemid = removed->first;
+            uint16 delitemstack = removed->second;
+            CItem* PDelItem = ok ? itemutils::GetItemPointer(delitemid) : nullptr;
+
+            //add the item back to the users invent
+            if (PDelItem != nullptr)
+            {
+                uint8 SlotID = charutils::AddItem(PChar, LOC_INVENTORY, delitemid,
+                    (delitemstack != 0 ? PDelItem->getStackSize() : 1));
+
+                if (SlotID != ERROR_SLOTID)
+                {
+                    PChar->pushPacket(new CAuctionHousePacket(action, 0, PChar, slotid, false));
+                    PChar->pushPacket(new CInventoryFinishPacket());
+                }
+                else {
+                    ShowError("Failed to return item id %u stack %u to char... \n", delitemid, delitemstack);
+                }
+                return;
+            }
             //let client know something went wrong
             PChar->pushPacket(new CAuctionHousePacket(action, 0xE5, PChar, slotid, true)); //invent full, unable to remove msg
-        }
+        });
     }
     break;
     case 0x0D:
@@ -3348,9 +3601,7 @@ void SmallPacket0x077(map_session_data_t* session, CCharEntity* PChar, CBasicPac
         {
 			ShowDebug(CL_CYAN"(Alliance)Changing leader to %s\n" CL_RESET, data[0x04]);
             PChar->PParty->m_PAlliance->assignAllianceLeader(data[0x04]);
-            uint8 data[4] {};
-            WBUFL(data, 0) = PChar->PParty->m_PAlliance->m_AllianceID;
-            message::send(MSG_PT_RELOAD, data, sizeof data, nullptr);
+            partyutils::Notify(MSG_PT_RELOAD, PChar->PParty->m_PAlliance->m_AllianceID);
         }
     }
     break;
@@ -0,0 +1,152 @@
+﻿/*
+===========================================================================
+
+  Copyright (c) 2010-2015 Darkstar Dev Teams
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see http://www.gnu.org/licenses/
+
+  This file is part of DarkStar-server source code.
+
+===========================================================================
+*/
+
+#include <atomic>
+#include <mutex>
+#include <new>
+
+#include "basic.h"
+
+namespace
+{
+    /************************************************************************
+    *                                                                       *
+    *  Free list of fixed-size blocks. Blocks are carved out of chunks      *
+    *  that are never returned to the heap, so after warm-up a packet is    *
+    *  created and destroyed without calling the allocator.                 *
+    *                                                                       *
+    ************************************************************************/
+
+    template<std::size_t BlockSize, std::size_t BlocksPerChunk>
+    class CPacketPool
+    {
+    public:
+
+        void* allocate()
+        {
+            std::lock_guard<std::mutex> lk(m_mutex);
+
+            if (m_free == nullptr)
+            {
+                uint8* chunk = static_cast<uint8*>(::operator new(BlockSize * BlocksPerChunk));
+                m_heapAllocations++;
+
+                for (std::size_t i = 0; i < BlocksPerChunk; ++i)
+                {
+                    node_t* node = reinterpret_cast<node_t*>(chunk + i * BlockSize);
+                    node->next = m_free;
+                    m_free = node;
+                }
+            }
+            node_t* node = m_free;
+            m_free = node->next;
+            return node;
+        }
+
+        void release(void* ptr)
+        {
+            std::lock_guard<std::mutex> lk(m_mutex);
+
+            node_t* node = static_cast<node_t*>(ptr);
+            node->next = m_free;
+            m_free = node;
+        }
+
+    private:
+
+        struct node_t
+        {
+            node_t* next;
+        };
+
+        std::mutex m_mutex;
+        node_t*    m_free {nullptr};
+
+    public:
+
+        static std::atomic<uint32> m_heapAllocations;
+    };
+
+    template<std::size_t BlockSize, std::size_t BlocksPerChunk>
+    std::atomic<uint32> CPacketPool<BlockSize, BlocksPerChunk>::m_heapAllocations {0};
+
+    // packet objects are a vtable and a handful of references, the payload lives in the data pool
+    const std::size_t PACKET_OBJECT_BLOCK = 64;
+    const std::size_t PACKET_DATA_BLOCK = (PACKET_SIZE + 7) & ~7;
+
+    typedef CPacketPool<PACKET_OBJECT_BLOCK, 512> ObjectPool_t;
+    typedef CPacketPool<PACKET_DATA_BLOCK, 512> DataPool_t;
+
+    ObjectPool_t& GetObjectPool()
+    {
+        static ObjectPool_t pool;
+        return pool;
+    }
+
+    DataPool_t& GetDataPool()
+    {
+        static DataPool_t pool;
+        return pool;
+    }
+
+    std::atomic<uint32> OversizedAllocations {0};
+}
+
+uint8* CBasicPacket::allocData()
+{
+    return static_cast<uint8*>(GetDataPool().allocate());
+}
+
+void CBasicPacket::freeData(uint8* ptr)
+{
+    GetDataPool().release(ptr);
+}
+
+void* CBasicPacket::operator new(std::size_t size)
+{
+    if (size > PACKET_OBJECT_BLOCK)
+    {
+        OversizedAllocations++;
+        return ::operator new(size);
+    }
+    return GetObjectPool().allocate();
+}
+
+void CBasicPacket::operator delete(void* ptr, std::size_t size)
+{
+    if (ptr == nullptr)
+    {
+        return;
+    }
+    if (size > PACKET_OBJECT_BLOCK)
+    {
+        ::operator delete(ptr);
+        return;
+    }
+    GetObjectPool().release(ptr);
+}
+
+uint32 CBasicPacket::GetHeapAllocations()
+{
+    return ObjectPool_t::m_heapAllocations + DataPool_t::m_heapAllocations + OversizedAllocations;
+}
@@ -28,6 +28,7 @@ This file is part of DarkStar-server source code.
 
 #include <stdio.h>
 #include <string.h>
+#include <cstddef>
 
 #define PACKET_SIZE 0x104
 
@@ -45,6 +46,10 @@ enum ENTITYUPDATE
 * Contains a 0x104 byte sized buffer
 * Access the raw data with ref<T>(index)
 *
+* Both the packet objects and their buffers come from fixed-size
+* pools (see basic.cpp), so queueing packets does not touch the heap
+* once the pools have warmed up.
+*
 */
 class CBasicPacket
 {
@@ -56,10 +61,13 @@ protected:
     uint16& code;
     bool owner;
 
+    static uint8* allocData();
+    static void   freeData(uint8* ptr);
+
 public:
 
     CBasicPacket()
-        : data(new uint8[PACKET_SIZE]), type(ref<uint8>(0)), size(ref<uint8>(1)), code(ref<uint16>(2)), owner(true)
+        : data(allocData()), type(ref<uint8>(0)), size(ref<uint8>(1)), code(ref<uint16>(2)), owner(true)
     {
         std::fill(data, data + PACKET_SIZE, 0);
     }
@@ -69,7 +77,7 @@ public:
     {}
 
     CBasicPacket(const CBasicPacket& other)
-        : data(new uint8[PACKET_SIZE]), type(ref<uint8>(0)), size(ref<uint8>(1)), code(ref<uint16>(2)), owner(true)
+        : data(allocData()), type(ref<uint8>(0)), size(ref<uint8>(1)), code(ref<uint16>(2)), owner(true)
     {
         memcpy(data, other.data, PACKET_SIZE);
     }
@@ -84,10 +92,15 @@ public:
     {
         if (owner && data)
         {
-            delete[] data;
+            freeData(data);
         }
     }
 
+    static void* operator new(std::size_t size);
+    static void  operator delete(void* ptr, std::size_t size);
+
+    static uint32 GetHeapAllocations();     // number of times the packet pools had to go to the heap
+
     CBasicPacket& operator= (const CBasicPacket& other) = delete;
     CBasicPacket& operator= (CBasicPacket&& other) = delete;
 
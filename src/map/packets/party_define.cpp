@@ -28,6 +28,7 @@
 #include "../entities/charentity.h"
 #include "../party.h"
 #include "../alliance.h"
+#include "../utils/partyutils.h"
 #include "../utils/zoneutils.h"
 
 
@@ -44,24 +45,21 @@ CPartyDefinePacket::CPartyDefinePacket(CParty* PParty)
 			allianceid = PParty->m_PAlliance->m_AllianceID;
 		}
 
-		int ret = Sql_Query(SqlHandle, "SELECT chars.charid, partyflag, pos_zone, pos_prevzone FROM accounts_parties \
-									   	LEFT JOIN chars ON accounts_parties.charid = chars.charid WHERE \
-										IF (allianceid <> 0, allianceid = %d, partyid = %d) ORDER BY partyflag & %u, timestamp;", 
-										allianceid, PParty->GetPartyID(), PARTY_SECOND | PARTY_THIRD);
-		if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) > 0)
+		uint8 i = 0;
+		for (auto&& member : partyutils::GetMembers(PParty->GetPartyID(), allianceid))
 		{
-			uint8 i = 0;
-			while (Sql_NextRow(SqlHandle) == SQL_SUCCESS)
-			{
-				uint16 targid = 0;
-				CCharEntity* PChar = zoneutils::GetChar(Sql_GetUIntData(SqlHandle, 0));
-				if (PChar) targid = PChar->targid;
-				WBUFL(data, 12 * i + (0x08) ) = Sql_GetUIntData(SqlHandle, 0);
-				WBUFW(data, 12 * i + (0x0C) ) = targid;
-				WBUFW(data, 12 * i + (0x0E) ) = Sql_GetUIntData(SqlHandle, 1);
-                WBUFW(data, 12 * i + (0x10) ) = Sql_GetUIntData(SqlHandle, 2) ? Sql_GetUIntData(SqlHandle, 2) : Sql_GetUIntData(SqlHandle, 3);
-				i++;
-			}
+			// an alliance lists its own members only
+			if (allianceid != 0 && member.allianceid != allianceid)
+				continue;
+
+			uint16 targid = 0;
+			CCharEntity* PChar = zoneutils::GetChar(member.charid);
+			if (PChar) targid = PChar->targid;
+			WBUFL(data, 12 * i + (0x08) ) = member.charid;
+			WBUFW(data, 12 * i + (0x0C) ) = targid;
+			WBUFW(data, 12 * i + (0x0E) ) = member.flags;
+			WBUFW(data, 12 * i + (0x10) ) = member.zone ? member.zone : member.prevzone;
+			i++;
 		}
 	}
 }
\ No newline at end of file
@@ -31,6 +31,7 @@
 #include "utils/charutils.h"
 #include "utils/blueutils.h"
 #include "utils/jailutils.h"
+#include "utils/partyutils.h"
 #include "utils/zoneutils.h"
 #include "map.h"
 #include "party.h"
@@ -147,16 +148,13 @@ void CParty::DisbandParty(bool playerInitiated)
                 sync->SetStartTime(server_clock::now());
                 sync->SetDuration(30000);
             }
-            Sql_Query(SqlHandle, "DELETE FROM accounts_parties WHERE charid = %u;", PChar->id);
+            partyutils::RemoveMember(PChar->id);
         }
 
         // make sure chat server isn't notified of a disband if this came from the chat server already
         if (playerInitiated)
         {
-            uint8 data[8] {};
-            WBUFL(data, 0) = m_PartyID;
-            WBUFL(data, 4) = m_PartyID;
-            message::send(MSG_PT_DISBAND, data, sizeof data, nullptr);
+            partyutils::Notify(MSG_PT_DISBAND, m_PartyID, m_PartyID);
         }
     }
     delete this;
@@ -180,9 +178,7 @@ void CParty::AssignPartyRole(int8* MemberName, uint8 role)
         case 6: SetSyncTarget(MemberName, 238);	break;
         case 7: SetSyncTarget(nullptr, 553);       break;
     }
-    uint8 data[4] {};
-    WBUFL(data, 0) = m_PartyID;
-    message::send(MSG_PT_RELOAD, data, sizeof data, nullptr);
+    partyutils::Notify(MSG_PT_RELOAD, m_PartyID);
     return;
 }
 
@@ -286,11 +282,8 @@ void CParty::RemoveMember(CBattleEntity* PEntity)
                     PChar->pushPacket(new CCharUpdatePacket(PChar));
                     PChar->PParty = nullptr;
 
-                    Sql_Query(SqlHandle, "DELETE FROM accounts_parties WHERE charid = %u;", PChar->id);
-
-                    uint8 data[4] {};
-                    WBUFL(data, 0) = m_PartyID;
-                    message::send(MSG_PT_RELOAD, data, sizeof data, nullptr);
+                    partyutils::RemoveMember(PChar->id);
+                    partyutils::Notify(MSG_PT_RELOAD, m_PartyID);
 
                     if (PChar->PTreasurePool != nullptr &&
                         PChar->PTreasurePool->GetPoolType() != TREASUREPOOL_ZONE)
@@ -418,12 +411,10 @@ void CParty::RemovePartyLeader(CBattleEntity* PEntity)
 {
     DSP_DEBUG_BREAK_IF(members.empty());
 
-    int ret = Sql_Query(SqlHandle, "SELECT charname FROM accounts_sessions JOIN chars ON accounts_sessions.charid = chars.charid \
-                                    JOIN accounts_parties ON accounts_parties.charid = chars.charid WHERE partyid = %u AND NOT partyflag & %d \
-                                    ORDER BY timestamp ASC LIMIT 1;", m_PartyID, PARTY_LEADER);
-    if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) != 0 && Sql_NextRow(SqlHandle) == SQL_SUCCESS)
+    std::string newLeader = partyutils::GetNextPartyLeader(m_PartyID);
+
+    if (!newLeader.empty())
     {
-        std::string newLeader(Sql_GetData(SqlHandle, 0));
         SetLeader(newLeader.c_str());
     }
     if (m_PLeader == PEntity)
@@ -439,21 +430,11 @@ void CParty::RemovePartyLeader(CBattleEntity* PEntity)
 std::vector<CParty::partyInfo_t> CParty::GetPartyInfo()
 {
     std::vector<CParty::partyInfo_t> memberinfo;
-    int ret = Sql_Query(SqlHandle, "SELECT chars.charid, partyid, allianceid, charname, partyflag, pos_zone, pos_prevzone FROM accounts_parties \
-                                    LEFT JOIN chars ON accounts_parties.charid = chars.charid WHERE \
-                                    (allianceid <> 0 AND allianceid = %d) OR partyid = %d ORDER BY partyflag & %u, timestamp;",
-        m_PAlliance ? m_PAlliance->m_AllianceID : 0, m_PartyID, PARTY_SECOND | PARTY_THIRD);
 
-    if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) != 0)
+    for (auto&& member : partyutils::GetMembers(m_PartyID, m_PAlliance ? m_PAlliance->m_AllianceID : 0))
     {
-        while (Sql_NextRow(SqlHandle) == SQL_SUCCESS)
-        {
-            memberinfo.push_back({Sql_GetUIntData(SqlHandle,0), Sql_GetUIntData(SqlHandle, 1),
-                Sql_GetUIntData(SqlHandle, 2), std::string(Sql_GetData(SqlHandle, 3)),
-                static_cast<uint16>(Sql_GetUIntData(SqlHandle, 4)),
-                static_cast<uint16>(Sql_GetUIntData(SqlHandle, 5)),
-                static_cast<uint16>(Sql_GetUIntData(SqlHandle, 6))});
-        }
+        memberinfo.push_back({member.charid, member.partyid, member.allianceid,
+            std::string(member.name), member.flags, member.zone, member.prevzone});
     }
     return memberinfo;
 }
@@ -484,10 +465,8 @@ void CParty::AddMember(CBattleEntity* PEntity)
             allianceid = m_PAlliance->m_AllianceID;
         }
 
-        Sql_Query(SqlHandle, "INSERT INTO accounts_parties (charid, partyid, allianceid, partyflag) VALUES (%u, %u, %u, %u);", PChar->id, m_PartyID, allianceid, GetMemberFlags(PChar));
-        uint8 data[4] {};
-        WBUFL(data, 0) = m_PartyID;
-        message::send(MSG_PT_RELOAD, data, sizeof data, nullptr);
+        partyutils::AddMember(PChar, m_PartyID, allianceid, GetMemberFlags(PChar));
+        partyutils::Notify(MSG_PT_RELOAD, m_PartyID);
         ReloadTreasurePool(PChar);
 
         if (PChar->nameflags.flags & FLAG_INVITE)
@@ -531,10 +510,8 @@ void CParty::AddMember(uint32 id)
         {
             allianceid = m_PAlliance->m_AllianceID;
         }
-        Sql_Query(SqlHandle, "INSERT INTO accounts_parties (charid, partyid, allianceid, partyflag) VALUES (%u, %u, %u, %u);", id, m_PartyID, allianceid, 0);
-        uint8 data[4] {};
-        WBUFL(data, 0) = m_PartyID;
-        message::send(MSG_PT_RELOAD, data, sizeof data, nullptr);
+        partyutils::AddMember(id, m_PartyID, allianceid, 0);
+        partyutils::Notify(MSG_PT_RELOAD, m_PartyID);
 
         /*if (PChar->nameflags.flags & FLAG_INVITE)
         {
@@ -870,28 +847,19 @@ void CParty::SetLeader(const char* MemberName)
 {
     if (m_PartyType == PARTY_PCS)
     {
-        uint32 newId = 0;
-        int ret = Sql_Query(SqlHandle, "SELECT chars.charid from accounts_sessions JOIN chars ON chars.charid = accounts_sessions.charid WHERE charname = ('%s')", MemberName);
+        // the party (and alliance) take the new leader's id
+        uint32 newId = partyutils::SetPartyLeader(m_PartyID, MemberName);
 
-        if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) != 0 && Sql_NextRow(SqlHandle) == SQL_SUCCESS)
-        {
-            newId = Sql_GetUIntData(SqlHandle, 0);
-        }
-        else
+        if (newId == 0)
         {
             return;
         }
 
-        Sql_Query(SqlHandle, "UPDATE accounts_parties SET partyflag = partyflag & ~%d WHERE partyid = %u AND partyflag & %d", ALLIANCE_LEADER | PARTY_LEADER, m_PartyID, PARTY_LEADER);
-        Sql_Query(SqlHandle, "UPDATE accounts_parties SET partyid = %u WHERE partyid = %u", newId, m_PartyID);
-        Sql_Query(SqlHandle, "UPDATE accounts_parties SET allianceid = %u WHERE allianceid = %u", newId, m_PartyID);
-
         m_PLeader = GetMemberByName(MemberName);
         if (this->m_PAlliance && this->m_PAlliance->m_AllianceID == m_PartyID)
             m_PAlliance->m_AllianceID = newId;
 
         m_PartyID = newId;
-        Sql_Query(SqlHandle, "UPDATE accounts_parties SET partyflag = partyflag | IF(allianceid = partyid, %d, %d) WHERE charid = %u", ALLIANCE_LEADER | PARTY_LEADER, PARTY_LEADER, newId);
     }
     else
     {
@@ -1001,12 +969,7 @@ void CParty::SetQuarterMaster(const char* MemberName)
 {
     CBattleEntity* PEntity = MemberName ? GetMemberByName(MemberName) : nullptr;
     m_PQuaterMaster = PEntity;
-    Sql_Query(SqlHandle, "UPDATE accounts_parties SET partyflag = partyflag & ~%d WHERE partyid = %u AND partyflag & %d", PARTY_QM, m_PartyID, PARTY_QM);
-    if (MemberName != nullptr)
-    {
-        Sql_Query(SqlHandle, "UPDATE accounts_parties JOIN chars ON accounts_parties.charid = chars.charid \
-                              SET partyflag = partyflag | %d WHERE partyid = %u AND charname = '%s';", PARTY_QM, m_PartyID, MemberName);
-    }
+    partyutils::SetQuarterMaster(m_PartyID, MemberName);
 }
 
 /************************************************************************
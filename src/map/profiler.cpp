@@ -0,0 +1,397 @@
+/*
+===========================================================================
+
+  Copyright (c) 2010-2015 Darkstar Dev Teams
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see http://www.gnu.org/licenses/
+
+  This file is part of DarkStar-server source code.
+
+===========================================================================
+*/
+
+#include "../common/showmsg.h"
+#include "../common/timer.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+
+#include "profiler.h"
+#include "zone.h"
+#include "utils/zoneutils.h"
+
+namespace profiler
+{
+    std::atomic<bool> Enabled {false};
+
+    namespace
+    {
+        const int8* SUBSYSTEM_NAMES[MAX_PROFILE] =
+        {
+            "tick", "packets", "ai", "status effects", "recast", "pathfind", "aggro",
+            "mob sync", "treasure pool", "broadcast", "regions", "battlefield", "lua"
+        };
+
+        const int8* DUMP_FILE = "log/zone_profile.csv";
+
+        struct counter_t
+        {
+            std::atomic<uint64> cycles {0};
+            std::atomic<uint64> calls {0};
+            std::atomic<uint64> max {0};
+
+            void Add(uint64 self, uint64 elapsed)
+            {
+                cycles.fetch_add(self, std::memory_order_relaxed);
+                calls.fetch_add(1, std::memory_order_relaxed);
+                if (elapsed > max.load(std::memory_order_relaxed))
+                {
+                    max.store(elapsed, std::memory_order_relaxed);
+                }
+            }
+
+            void Clear()
+            {
+                cycles.store(0, std::memory_order_relaxed);
+                calls.store(0, std::memory_order_relaxed);
+                max.store(0, std::memory_order_relaxed);
+            }
+        };
+
+        struct hook_t
+        {
+            uint64 cycles;
+            uint64 calls;
+            uint64 max;
+            uint8  subsystem;
+        };
+
+        struct zone_profile_t
+        {
+            counter_t subsystems[MAX_PROFILE];
+            counter_t ticks;                                    // whole ticks, inclusive
+
+            std::mutex hookMutex;
+            std::unordered_map<const char*, hook_t> hooks;      // keyed by the label pointer, merged by name when read
+        };
+
+        zone_profile_t g_Zones[MAX_ZONEID];
+        time_point     g_WindowStart = server_clock::now();
+
+        thread_local zone_profile_t* CurrentZone = nullptr;
+        thread_local CProfileScope*  CurrentScope = nullptr;
+
+        double ToMs(uint64 cycles)
+        {
+            return (double)cycles / std::max<uint64>(get_cycles_per_ms(), 1);
+        }
+
+        // hook totals of a zone, merged by name
+        std::map<std::string, hook_t> CollectHooks(zone_profile_t& zone)
+        {
+            std::map<std::string, hook_t> hooks;
+            std::lock_guard<std::mutex> lk(zone.hookMutex);
+
+            for (auto& entry : zone.hooks)
+            {
+                hook_t& hook = hooks[entry.first];
+                hook.cycles += entry.second.cycles;
+                hook.calls += entry.second.calls;
+                hook.max = std::max(hook.max, entry.second.max);
+                hook.subsystem = entry.second.subsystem;
+            }
+            return hooks;
+        }
+
+        bool HasSamples(zone_profile_t& zone)
+        {
+            for (uint8 i = 0; i < MAX_PROFILE; ++i)
+            {
+                if (zone.subsystems[i].calls.load(std::memory_order_relaxed) != 0)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+    }
+
+    void Initialize(bool enabled)
+    {
+        Reset();
+        SetEnabled(enabled);
+
+        CTaskMgr::getInstance()->AddTask("zone_profile_dump", server_clock::now(), nullptr, CTaskMgr::TASK_INTERVAL, dump_task, 60s);
+    }
+
+    void Free()
+    {
+        if (IsEnabled())
+        {
+            Dump();
+        }
+        SetEnabled(false);
+    }
+
+    void SetEnabled(bool enabled)
+    {
+        if (enabled && !IsEnabled())
+        {
+            Reset();
+        }
+        Enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    void Reset()
+    {
+        for (auto& zone : g_Zones)
+        {
+            for (auto& counter : zone.subsystems)
+            {
+                counter.Clear();
+            }
+            zone.ticks.Clear();
+
+            std::lock_guard<std::mutex> lk(zone.hookMutex);
+            zone.hooks.clear();
+        }
+        g_WindowStart = server_clock::now();
+    }
+
+    /************************************************************************
+    *                                                                       *
+    *  Human readable summary of one zone for the !profile command          *
+    *                                                                       *
+    ************************************************************************/
+
+    std::vector<std::string> Report(uint16 ZoneID, uint8 maxHooks)
+    {
+        std::vector<std::string> lines;
+        int8 buf[256];
+
+        if (ZoneID >= MAX_ZONEID)
+        {
+            return lines;
+        }
+        zone_profile_t& zone = g_Zones[ZoneID];
+        CZone* PZone = zoneutils::GetZone(ZoneID);
+
+        snprintf(buf, sizeof(buf), "Profile of %s (%u), last %llus:", PZone != nullptr ? PZone->GetName() : "unknown zone", ZoneID,
+            (unsigned long long)std::chrono::duration_cast<std::chrono::seconds>(server_clock::now() - g_WindowStart).count());
+        lines.push_back(buf);
+
+        if (!HasSamples(zone))
+        {
+            lines.push_back(IsEnabled() ? "  no samples" : "  no samples, the profiler is off");
+            return lines;
+        }
+
+        uint64 ticks = zone.ticks.calls.load(std::memory_order_relaxed);
+        uint64 total = 0;
+
+        std::vector<std::pair<uint64, uint8>> order;
+        for (uint8 i = 0; i < MAX_PROFILE; ++i)
+        {
+            uint64 cycles = zone.subsystems[i].cycles.load(std::memory_order_relaxed);
+            total += cycles;
+            if (cycles != 0)
+            {
+                order.emplace_back(cycles, i);
+            }
+        }
+        std::sort(order.rbegin(), order.rend());
+
+        snprintf(buf, sizeof(buf), "  ticks %llu, avg %.3f ms, max %.3f ms, total %.1f ms", (unsigned long long)ticks,
+            ticks != 0 ? ToMs(zone.ticks.cycles.load(std::memory_order_relaxed)) / ticks : 0.0,
+            ToMs(zone.ticks.max.load(std::memory_order_relaxed)), ToMs(total));
+        lines.push_back(buf);
+
+        for (auto& entry : order)
+        {
+            counter_t& counter = zone.subsystems[entry.second];
+
+            snprintf(buf, sizeof(buf), "  %s: %.1f%%, %.1f ms, %llu calls, max %.3f ms", SUBSYSTEM_NAMES[entry.second],
+                total != 0 ? entry.first * 100.0 / total : 0.0, ToMs(entry.first),
+                (unsigned long long)counter.calls.load(std::memory_order_relaxed), ToMs(counter.max.load(std::memory_order_relaxed)));
+            lines.push_back(buf);
+        }
+
+        std::map<std::string, hook_t> hooks = CollectHooks(zone);
+        std::vector<std::pair<uint64, const std::string*>> hookOrder;
+
+        for (auto& entry : hooks)
+        {
+            hookOrder.emplace_back(entry.second.cycles, &entry.first);
+        }
+        std::sort(hookOrder.rbegin(), hookOrder.rend());
+
+        for (size_t i = 0; i < hookOrder.size() && i < maxHooks; ++i)
+        {
+            hook_t& hook = hooks[*hookOrder[i].second];
+
+            snprintf(buf, sizeof(buf), "  %s %s: %.1f ms, %llu calls, max %.3f ms", SUBSYSTEM_NAMES[hook.subsystem], hookOrder[i].second->c_str(),
+                ToMs(hook.cycles), (unsigned long long)hook.calls, ToMs(hook.max));
+            lines.push_back(buf);
+        }
+        return lines;
+    }
+
+    /************************************************************************
+    *                                                                       *
+    *  Appends the current window of every zone with samples to the dump    *
+    *  file and starts a new one. One row per zone and counter:             *
+    *  time,zone,kind,name,calls,total_us,max_us                            *
+    *                                                                       *
+    ************************************************************************/
+
+    bool Dump()
+    {
+        FILE* fp = fopen(DUMP_FILE, "a");
+
+        if (fp == nullptr)
+        {
+            ShowError("profiler::Dump: cannot open %s\n", DUMP_FILE);
+            return false;
+        }
+
+        fseek(fp, 0, SEEK_END);
+        if (ftell(fp) == 0)
+        {
+            fprintf(fp, "time,zone,kind,name,calls,total_us,max_us\n");
+        }
+
+        unsigned long long now = (unsigned long long)time(nullptr);
+        auto row = [&](uint16 ZoneID, const char* kind, const char* name, uint64 calls, uint64 cycles, uint64 max)
+        {
+            fprintf(fp, "%llu,%u,%s,%s,%llu,%.0f,%.0f\n", now, ZoneID, kind, name, (unsigned long long)calls, ToMs(cycles) * 1000, ToMs(max) * 1000);
+        };
+
+        for (uint16 ZoneID = 0; ZoneID < MAX_ZONEID; ++ZoneID)
+        {
+            zone_profile_t& zone = g_Zones[ZoneID];
+
+            if (!HasSamples(zone))
+            {
+                continue;
+            }
+            row(ZoneID, "tick", "", zone.ticks.calls.load(std::memory_order_relaxed), zone.ticks.cycles.load(std::memory_order_relaxed),
+                zone.ticks.max.load(std::memory_order_relaxed));
+
+            for (uint8 i = 0; i < MAX_PROFILE; ++i)
+            {
+                counter_t& counter = zone.subsystems[i];
+
+                if (counter.calls.load(std::memory_order_relaxed) != 0)
+                {
+                    row(ZoneID, "subsystem", SUBSYSTEM_NAMES[i], counter.calls.load(std::memory_order_relaxed),
+                        counter.cycles.load(std::memory_order_relaxed), counter.max.load(std::memory_order_relaxed));
+                }
+            }
+            for (auto& hook : CollectHooks(zone))
+            {
+                row(ZoneID, SUBSYSTEM_NAMES[hook.second.subsystem], hook.first.c_str(), hook.second.calls, hook.second.cycles, hook.second.max);
+            }
+        }
+        fclose(fp);
+
+        Reset();
+        return true;
+    }
+
+    int32 dump_task(time_point tick, CTaskMgr::CTask* PTask)
+    {
+        if (IsEnabled())
+        {
+            Dump();
+        }
+        return 0;
+    }
+};
+
+/************************************************************************
+*                                                                       *
+*  Scopes                                                               *
+*                                                                       *
+************************************************************************/
+
+void CProfileScope::Begin(PROFILE_SUBSYSTEM subsystem, const char* label)
+{
+    if (profiler::CurrentZone == nullptr)
+    {
+        return;
+    }
+    m_active = true;
+    m_subsystem = subsystem;
+    m_label = label;
+    m_children = 0;
+    m_zone = profiler::CurrentZone;
+    m_parent = profiler::CurrentScope;
+    profiler::CurrentScope = this;
+    m_start = get_cycles();
+}
+
+uint64 CProfileScope::End()
+{
+    uint64 elapsed = get_cycles() - m_start;
+    auto zone = (profiler::zone_profile_t*)m_zone;
+
+    m_active = false;
+    zone->subsystems[m_subsystem].Add(elapsed > m_children ? elapsed - m_children : 0, elapsed);
+
+    if (m_label != nullptr)
+    {
+        std::lock_guard<std::mutex> lk(zone->hookMutex);
+        profiler::hook_t& hook = zone->hooks[m_label];
+        hook.cycles += elapsed;
+        hook.calls += 1;
+        hook.max = std::max(hook.max, elapsed);
+        hook.subsystem = m_subsystem;
+    }
+    if (m_parent != nullptr)
+    {
+        m_parent->m_children += elapsed;
+    }
+    profiler::CurrentScope = m_parent;
+    return elapsed;
+}
+
+CZoneProfileScope::CZoneProfileScope(CZone* PZone, PROFILE_SUBSYSTEM subsystem, bool tick)
+{
+    m_previous = profiler::CurrentZone;
+    m_tick = tick;
+
+    if (profiler::IsEnabled() && PZone != nullptr && PZone->GetID() < MAX_ZONEID)
+    {
+        profiler::CurrentZone = &profiler::g_Zones[PZone->GetID()];
+        Begin(subsystem, nullptr);
+    }
+}
+
+CZoneProfileScope::~CZoneProfileScope()
+{
+    if (m_active)
+    {
+        uint64 elapsed = End();
+
+        if (m_tick)
+        {
+            ((profiler::zone_profile_t*)m_zone)->ticks.Add(elapsed, elapsed);
+        }
+        profiler::CurrentZone = (profiler::zone_profile_t*)m_previous;
+    }
+}
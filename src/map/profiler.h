@@ -0,0 +1,143 @@
+/*
+===========================================================================
+
+  Copyright (c) 2010-2015 Darkstar Dev Teams
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see http://www.gnu.org/licenses/
+
+  This file is part of DarkStar-server source code.
+
+===========================================================================
+*/
+
+#ifndef _PROFILER_H
+#define _PROFILER_H
+
+#include "../common/cbasetypes.h"
+#include "../common/taskmgr.h"
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+enum PROFILE_SUBSYSTEM
+{
+    PROFILE_TICK,                   // zone tick time not claimed by any subsystem below
+    PROFILE_PACKETS,                // incoming packet handlers, outside the zone tick
+    PROFILE_AI,
+    PROFILE_STATUS_EFFECTS,
+    PROFILE_RECAST,
+    PROFILE_PATHFIND,
+    PROFILE_AGGRO,
+    PROFILE_MOB_SYNC,
+    PROFILE_TREASURE_POOL,
+    PROFILE_BROADCAST,
+    PROFILE_REGIONS,
+    PROFILE_BATTLEFIELD,
+    PROFILE_LUA,
+
+    MAX_PROFILE
+};
+
+/************************************************************************
+*                                                                       *
+*  Per-zone tick profiler. Scopes nest and every scope is charged only  *
+*  for its own time, so the subsystems of a zone add up to the time     *
+*  spent in it. Labelled scopes (lua hooks, chase path kinds) are also  *
+*  summed by label.                                                     *
+*                                                                       *
+*  Scopes only count inside a CZoneProfileScope; while the profiler is  *
+*  off a scope costs one relaxed load.                                  *
+*                                                                       *
+************************************************************************/
+
+namespace profiler
+{
+    extern std::atomic<bool> Enabled;
+
+    inline bool IsEnabled()
+    {
+        return Enabled.load(std::memory_order_relaxed);
+    }
+
+    void Initialize(bool enabled);
+    void Free();
+
+    void SetEnabled(bool enabled);
+    void Reset();                                               // starts a new window for every zone
+
+    std::vector<std::string> Report(uint16 ZoneID, uint8 maxHooks);
+    bool  Dump();                                               // appends the window to log/zone_profile.csv and resets it
+
+    int32 dump_task(time_point tick, CTaskMgr::CTask* PTask);
+};
+
+class CZone;
+
+class CProfileScope
+{
+public:
+
+    // label must outlive the server, it is kept by pointer
+    explicit CProfileScope(PROFILE_SUBSYSTEM subsystem, const char* label = nullptr)
+    {
+        m_active = false;
+        if (profiler::IsEnabled())
+        {
+            Begin(subsystem, label);
+        }
+    }
+
+    ~CProfileScope()
+    {
+        if (m_active)
+        {
+            End();
+        }
+    }
+
+    CProfileScope(const CProfileScope&) = delete;
+    CProfileScope& operator=(const CProfileScope&) = delete;
+
+protected:
+
+    CProfileScope() : m_active(false) {}
+
+    void Begin(PROFILE_SUBSYSTEM subsystem, const char* label);
+    uint64 End();
+
+    bool              m_active;
+    PROFILE_SUBSYSTEM m_subsystem;
+    const char*       m_label;
+    uint64            m_start;
+    uint64            m_children;      // time already charged to nested scopes
+    CProfileScope*    m_parent;
+    void*             m_zone;          // zone the enclosing CZoneProfileScope selected
+};
+
+// selects the zone the scopes on this thread are charged to
+class CZoneProfileScope : public CProfileScope
+{
+public:
+
+    CZoneProfileScope(CZone* PZone, PROFILE_SUBSYSTEM subsystem, bool tick);
+    ~CZoneProfileScope();
+
+private:
+
+    void* m_previous;
+    bool  m_tick;
+};
+
+#endif
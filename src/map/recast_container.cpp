@@ -30,6 +30,7 @@
 #include "entities/charentity.h"
 #include "recast_container.h"
 #include "item_container.h"
+#include "profiler.h"
 
 /************************************************************************
 *                                                                       *
@@ -262,6 +263,8 @@ bool CRecastContainer::HasRecast(RECASTTYPE type, uint16 id, uint32 recast)
 
 void CRecastContainer::Check()
 {
+    CProfileScope profile(PROFILE_RECAST);
+
     for (uint8 type = 0; type < MAX_RECASTTPE_SIZE; ++type)
     {
         RecastList_t* PRecastList = GetRecastList((RECASTTYPE)type);
@@ -133,11 +133,9 @@ bool CRegion::isPointInside(position_t pos)
 		// Get the distance between their Z coordinate and ours.
 		float dZ = pos.z - z1;
 
-		float distance = sqrt( (dX * dX ) + ( dZ * dZ ) );
-
 		// Check if were within range of the target.
 		// In this case of a circle, 'y' is the radius.
-		if (distance <= y1)
+		if (y1 >= 0 && (dX * dX) + (dZ * dZ) <= y1 * y1)
 			return true;
 
 		return false;
@@ -149,4 +147,26 @@ bool CRegion::isPointInside(position_t pos)
 			x2 >= pos.x && 
 			y2 >= pos.y && 
 			z2 >= pos.z);
-}
\ No newline at end of file
+}
+
+/************************************************************************
+*																		*
+*  Rectangle on the x/z plane that contains the region					*
+*																		*
+************************************************************************/
+
+void CRegion::GetBounds(float& minX, float& minZ, float& maxX, float& maxZ)
+{
+	if (circle == true)
+	{
+		minX = x1 - y1;
+		maxX = x1 + y1;
+		minZ = z1 - y1;
+		maxZ = z1 + y1;
+		return;
+	}
+	minX = x1;
+	maxX = x2;
+	minZ = z1;
+	maxZ = z2;
+}
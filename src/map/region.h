@@ -49,6 +49,7 @@ public:
 	void	SetLRCorner(float x, float y, float z);		// нижний правый угол (Lower Right)
 
 	bool	isPointInside(position_t pos);
+	void	GetBounds(float& minX, float& minZ, float& maxX, float& maxZ);	// area covered on the x/z plane
 	
 private:
 
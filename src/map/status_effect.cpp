@@ -167,22 +167,38 @@ void CStatusEffect::SetTier(uint16 tier)
 void CStatusEffect::SetDuration(uint32 Duration)
 {
 	m_Duration = Duration;
+    if (m_POwner != nullptr)
+    {
+        m_POwner->StatusEffectContainer->InvalidateEffectTimes();
+    }
 }
 
 void CStatusEffect::SetStartTime(time_point StartTime)
 {
 	m_LastTick  = StartTime;
 	m_StartTime = StartTime;
+    if (m_POwner != nullptr)
+    {
+        m_POwner->StatusEffectContainer->InvalidateEffectTimes();
+    }
 }
 
 void CStatusEffect::SetLastTick(time_point LastTick)
 {
 	m_LastTick = LastTick;
+    if (m_POwner != nullptr)
+    {
+        m_POwner->StatusEffectContainer->InvalidateEffectTimes();
+    }
 }
 
 void CStatusEffect::SetTickTime(uint32 tick)
 {
 	m_TickTime = tick;
+    if (m_POwner != nullptr)
+    {
+        m_POwner->StatusEffectContainer->InvalidateEffectTimes();
+    }
 }
 
 void CStatusEffect::SetName(const int8* name)
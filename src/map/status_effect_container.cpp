@@ -62,6 +62,7 @@ When a status effect is gained twice on a player. It can do one or more of the f
 #include "utils/petutils.h"
 #include "utils/puppetutils.h"
 #include "utils/battleutils.h"
+#include "profiler.h"
 
 /************************************************************************
 *                                                                       *
@@ -361,6 +362,8 @@ bool CStatusEffectContainer::AddStatusEffect(CStatusEffect* PStatusEffect, bool
         PStatusEffect->SetStartTime(server_clock::now());
 
         m_StatusEffectList.push_back(PStatusEffect);
+        m_EffectIDs.set(statusId);
+        InvalidateEffectTimes();
 
         luautils::OnEffectGain(m_POwner, PStatusEffect);
 
@@ -424,6 +427,7 @@ void CStatusEffectContainer::RemoveStatusEffect(uint32 id, bool silent)
     }
 
     m_StatusEffectList.erase(m_StatusEffectList.begin() + id);
+    UpdateEffectID(PStatusEffect->GetStatusID());
     luautils::OnEffectLose(m_POwner, PStatusEffect);
 
     m_POwner->delModifiers(&PStatusEffect->modList);
@@ -539,6 +543,7 @@ void CStatusEffectContainer::KillAllStatusEffect()
             m_POwner->delModifiers(&PStatusEffect->modList);
 
             m_StatusEffectList.erase(m_StatusEffectList.begin() + i);
+            UpdateEffectID(PStatusEffect->GetStatusID());
 
             delete PStatusEffect;
         }
@@ -718,14 +723,7 @@ uint8 CStatusEffectContainer::DispelAllStatusEffect(EFFECTFLAG flag)
 
 bool CStatusEffectContainer::HasStatusEffect(EFFECT StatusID)
 {
-    for (uint16 i = 0; i < m_StatusEffectList.size(); ++i)
-    {
-        if (m_StatusEffectList.at(i)->GetStatusID() == StatusID)
-        {
-            return true;
-        }
-    }
-    return false;
+    return StatusID < MAX_EFFECTID && m_EffectIDs[StatusID];
 }
 
 bool CStatusEffectContainer::HasStatusEffectByFlag(uint32 flag)
@@ -981,6 +979,10 @@ void CStatusEffectContainer::RemoveAllManeuvers()
 
 bool CStatusEffectContainer::HasStatusEffect(EFFECT StatusID, uint16 SubID)
 {
+    if (!HasStatusEffect(StatusID))
+    {
+        return false;
+    }
     for (uint16 i = 0; i < m_StatusEffectList.size(); ++i)
     {
         if (m_StatusEffectList.at(i)->GetStatusID() == StatusID &&
@@ -995,6 +997,10 @@ bool CStatusEffectContainer::HasStatusEffect(EFFECT StatusID, uint16 SubID)
 
 CStatusEffect* CStatusEffectContainer::GetStatusEffect(EFFECT StatusID)
 {
+    if (!HasStatusEffect(StatusID))
+    {
+        return nullptr;
+    }
     for (uint16 i = 0; i < m_StatusEffectList.size(); ++i)
     {
         if (m_StatusEffectList.at(i)->GetStatusID() == StatusID)
@@ -1013,6 +1019,10 @@ CStatusEffect* CStatusEffectContainer::GetStatusEffect(EFFECT StatusID)
 
 CStatusEffect* CStatusEffectContainer::GetStatusEffect(EFFECT StatusID, uint32 SubID)
 {
+    if (!HasStatusEffect(StatusID))
+    {
+        return nullptr;
+    }
     for (uint16 i = 0; i < m_StatusEffectList.size(); ++i)
     {
         if (m_StatusEffectList.at(i)->GetStatusID() == StatusID &&
@@ -1295,6 +1305,7 @@ void CStatusEffectContainer::SaveStatusEffects(bool logout)
 void CStatusEffectContainer::CheckEffects(time_point tick)
 {
     DSP_DEBUG_BREAK_IF(m_POwner == nullptr);
+    CProfileScope profile(PROFILE_STATUS_EFFECTS);
 
     if (!m_POwner->isDead())
     {
@@ -1305,6 +1316,12 @@ void CStatusEffectContainer::CheckEffects(time_point tick)
 
         m_EffectCheckTime = tick;
 
+        // no effect ticks or wears off before m_NextEffectTime, leave the list alone until then
+        if (tick < m_NextEffectTime)
+        {
+            return;
+        }
+
         for (uint16 i = 0; i < m_StatusEffectList.size(); ++i)
         {
             CStatusEffect* PStatusEffect = m_StatusEffectList.at(i);
@@ -1322,6 +1339,47 @@ void CStatusEffectContainer::CheckEffects(time_point tick)
                 RemoveStatusEffect(i--);
             }
         }
+        UpdateNextEffectTime();
+    }
+}
+
+/************************************************************************
+*                                                                       *
+*  Bookkeeping for the id bitset and the next due time                  *
+*                                                                       *
+************************************************************************/
+
+void CStatusEffectContainer::UpdateEffectID(EFFECT StatusID)
+{
+    for (auto PEffect : m_StatusEffectList)
+    {
+        if (PEffect->GetStatusID() == StatusID)
+        {
+            return;
+        }
+    }
+    m_EffectIDs.reset(StatusID);
+}
+
+void CStatusEffectContainer::InvalidateEffectTimes()
+{
+    m_NextEffectTime = time_point::min();
+}
+
+void CStatusEffectContainer::UpdateNextEffectTime()
+{
+    m_NextEffectTime = time_point::max();
+
+    for (auto PEffect : m_StatusEffectList)
+    {
+        if (PEffect->GetTickTime() != 0)
+        {
+            m_NextEffectTime = std::min(m_NextEffectTime, PEffect->GetLastTick() + std::chrono::milliseconds(PEffect->GetTickTime()));
+        }
+        if (PEffect->GetDuration() != 0)
+        {
+            m_NextEffectTime = std::min(m_NextEffectTime, PEffect->GetStartTime() + std::chrono::milliseconds(PEffect->GetDuration()));
+        }
     }
 }
 
@@ -1334,6 +1392,7 @@ void CStatusEffectContainer::CheckEffects(time_point tick)
 void CStatusEffectContainer::CheckRegen(time_point tick)
 {
     DSP_DEBUG_BREAK_IF(m_POwner == nullptr);
+    CProfileScope profile(PROFILE_STATUS_EFFECTS);
 
     if (!m_POwner->isDead())
     {
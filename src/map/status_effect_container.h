@@ -27,6 +27,8 @@
 #include "../common/cbasetypes.h"
 #include "../common/taskmgr.h"
 
+#include <bitset>
+
 #include "status_effect.h"
 
 /************************************************************************
@@ -73,6 +75,7 @@ public:
     void UpdateStatusIcons();                                   // пересчитываем иконки эффектов
     void CheckEffects(time_point tick);
     void CheckRegen(time_point tick);
+    void InvalidateEffectTimes();                               // an effect's tick or expiry time changed
 
     void LoadStatusEffects();                                   // загружаем эффекты персонажа
     void SaveStatusEffects(bool logout = false);                // сохраняем эффекты персонажа
@@ -118,10 +121,15 @@ private:
 
     void OverwriteStatusEffect(CStatusEffect* StatusEffect);
 
+    void UpdateEffectID(EFFECT StatusID);                       // resyncs the id's bit after a removal
+    void UpdateNextEffectTime();
+
 	time_point m_EffectCheckTime {server_clock::now()};
     time_point m_RegenCheckTime {server_clock::now()};
+    time_point m_NextEffectTime {time_point::min()};            // earliest tick or expiry in the list, nothing is due before it
 
 	std::vector<CStatusEffect*>	m_StatusEffectList;
+    std::bitset<MAX_EFFECTID>   m_EffectIDs;                    // ids with at least one effect in m_StatusEffectList
 };
 
 /************************************************************************
@@ -24,7 +24,6 @@
 #include "../common/showmsg.h"
 
 #include "utils/guildutils.h"
-#include "utils/instanceutils.h"
 #include "time_server.h"
 #include "transport.h"
 #include "vana_time.h"
@@ -126,6 +125,5 @@ int32 time_server(time_point tick,CTaskMgr::CTask* PTask)
     }
 
     CTransportHandler::getInstance()->TransportTimer();
-	instanceutils::CheckInstance();
     return 0;
 }
\ No newline at end of file
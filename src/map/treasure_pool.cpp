@@ -32,6 +32,7 @@
 #include "treasure_pool.h"
 #include "recast_container.h"
 #include "item_container.h"
+#include "profiler.h"
 
 
 static constexpr duration treasure_checktime = 3s;
@@ -358,6 +359,8 @@ bool CTreasurePool::HasPassedItem(CCharEntity* PChar, uint8 SlotID)
 
 void CTreasurePool::CheckItems(time_point tick) 
 {	
+    CProfileScope profile(PROFILE_TREASURE_POOL);
+
     if (m_count != 0)
     {
         if ((tick - m_Tick > treasure_checktime))
@@ -70,7 +70,10 @@ This file is part of DarkStar-server source code.
 #include "../alliance.h"
 #include "../grades.h"
 #include "../conquest_system.h"
+#include "../dbworker.h"
 #include "../map.h"
+#include "../message.h"
+#include "../profiler.h"
 #include "../spell.h"
 #include "../trait.h"
 #include "../vana_time.h"
@@ -79,6 +82,7 @@ This file is part of DarkStar-server source code.
 #include "../recast_container.h"
 #include "../status_effect_container.h"
 #include "../linkshell.h"
+#include "../items/item_linkshell.h"
 #include "../universal_container.h"
 #include "../latent_effect_container.h"
 #include "../treasure_pool.h"
@@ -96,6 +100,7 @@ This file is part of DarkStar-server source code.
 #include "puppetutils.h"
 #include "petutils.h"
 #include "zoneutils.h"
+#include "partyutils.h"
 
 /************************************************************************
 *																		*
@@ -838,6 +843,9 @@ namespace charutils
             "WHERE charid = %u "
             "ORDER BY location ASC";
 
+        time_point loadStart = server_clock::now();
+        uint32 loadedItems = 0;
+
         int32 ret = Sql_Query(SqlHandle, Query, PChar->id);
 
         if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) != 0)
@@ -848,6 +856,7 @@ namespace charutils
 
                 if (PItem != nullptr)
                 {
+                    loadedItems++;
                     PItem->setLocationID(Sql_GetUIntData(SqlHandle, 1));
                     PItem->setSlotID(Sql_GetUIntData(SqlHandle, 2));
                     PItem->setQuantity(Sql_GetUIntData(SqlHandle, 3));
@@ -915,6 +924,12 @@ namespace charutils
                 }
             }
         }
+
+        if (profiler::IsEnabled())
+        {
+            ShowDebug("LoadInventory: %u items for %s in %lldus\n", loadedItems, PChar->GetName(),
+                (long long)std::chrono::duration_cast<std::chrono::microseconds>(server_clock::now() - loadStart).count());
+        }
     }
 
     void LoadEquip(CCharEntity* PChar)
@@ -1521,9 +1536,9 @@ namespace charutils
                     CheckUnarmedWeapon(PChar);
                 }
             }
-            PChar->delEquipModifiers(&((CItemArmor*)PItem)->modList, ((CItemArmor*)PItem)->getReqLvl(), equipSlotID);
+            PChar->delEquipModifiers(&((CItemArmor*)PItem)->getModList(), ((CItemArmor*)PItem)->getReqLvl(), equipSlotID);
             PChar->PLatentEffectContainer->DelLatentEffects(((CItemArmor*)PItem)->getReqLvl(), equipSlotID);
-            PChar->delPetModifiers(&((CItemArmor*)PItem)->petModList);
+            PChar->delPetModifiers(&((CItemArmor*)PItem)->getPetModList());
 
             PChar->pushPacket(new CInventoryAssignPacket(PItem, INV_NORMAL)); //???
             PChar->pushPacket(new CEquipPacket(0, equipSlotID, LOC_INVENTORY));
@@ -2057,10 +2072,10 @@ namespace charutils
                         }
                     }
 
-                    PChar->addEquipModifiers(&PItem->modList, ((CItemArmor*)PItem)->getReqLvl(), equipSlotID);
-                    PChar->PLatentEffectContainer->AddLatentEffects(&PItem->latentList, ((CItemArmor*)PItem)->getReqLvl(), equipSlotID);
+                    PChar->addEquipModifiers(&PItem->getModList(), ((CItemArmor*)PItem)->getReqLvl(), equipSlotID);
+                    PChar->PLatentEffectContainer->AddLatentEffects(&PItem->getLatentList(), ((CItemArmor*)PItem)->getReqLvl(), equipSlotID);
                     PChar->PLatentEffectContainer->CheckLatentsEquip(equipSlotID);
-                    PChar->addPetModifiers(&PItem->petModList);
+                    PChar->addPetModifiers(&PItem->getPetModList());
 
                     PChar->pushPacket(new CEquipPacket(slotID, equipSlotID, containerID));
                     PChar->pushPacket(new CInventoryAssignPacket(PItem, INV_NODROP));
@@ -2652,6 +2667,7 @@ namespace charutils
                 if ((CurSkill / 10) < (CurSkill + SkillAmount) / 10) //if gone up a level
                 {
                     PChar->WorkingSkills.skill[SkillID] += 1;
+                    PChar->InvalidateStatSnapshot();
                     PChar->pushPacket(new CCharSkillsPacket(PChar));
                     PChar->pushPacket(new CMessageBasicPacket(PChar, PChar, SkillID, (CurSkill + SkillAmount) / 10, 53));
 
@@ -4442,7 +4458,7 @@ namespace charutils
             CItemArmor* PItem = PChar->getEquip((SLOTTYPE)slotID);
             if (PItem)
             {
-                PChar->delEquipModifiers(&PItem->modList, PItem->getReqLvl(), slotID);
+                PChar->delEquipModifiers(&PItem->getModList(), PItem->getReqLvl(), slotID);
                 if (PItem->getReqLvl() <= PChar->GetMLevel())
                 {
                     PChar->PLatentEffectContainer->DelLatentEffects(PItem->getReqLvl(), slotID);
@@ -4459,10 +4475,10 @@ namespace charutils
             CItemArmor* PItem = (CItemArmor*)PChar->getEquip((SLOTTYPE)slotID);
             if (PItem)
             {
-                PChar->addEquipModifiers(&PItem->modList, PItem->getReqLvl(), slotID);
+                PChar->addEquipModifiers(&PItem->getModList(), PItem->getReqLvl(), slotID);
                 if (PItem->getReqLvl() <= PChar->GetMLevel())
                 {
-                    PChar->PLatentEffectContainer->AddLatentEffects(&PItem->latentList, PItem->getReqLvl(), slotID);
+                    PChar->PLatentEffectContainer->AddLatentEffects(&PItem->getLatentList(), PItem->getReqLvl(), slotID);
                     PChar->PLatentEffectContainer->CheckLatentsEquip(slotID);
                 }
             }
@@ -4483,13 +4499,16 @@ namespace charutils
 
     void ReloadParty(CCharEntity* PChar)
     {
-        int ret = Sql_Query(SqlHandle, "SELECT partyid, allianceid, partyflag & %d FROM accounts_sessions s JOIN accounts_parties p ON "
-            "s.charid = p.charid WHERE p.charid = %u;", (PARTY_SECOND | PARTY_THIRD), PChar->id);
-        if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) != 0 && Sql_NextRow(SqlHandle) == SQL_SUCCESS)
+        party_member_t member;
+
+        if (partyutils::GetMember(PChar->id, &member))
         {
-            uint32 partyid = Sql_GetUIntData(SqlHandle, 0);
-            uint32 allianceid = Sql_GetUIntData(SqlHandle, 1);
-            uint32 partynumber = Sql_GetUIntData(SqlHandle, 2);
+            uint32 partyid = member.partyid;
+            uint32 allianceid = member.allianceid;
+            uint32 partynumber = member.flags & (PARTY_SECOND | PARTY_THIRD);
+
+            // other servers list the char in the zone it is in now
+            partyutils::UpdateMember(PChar, PChar->getZone(), PChar->loc.prevzone);
 
             //first, parties and alliances must be created or linked if the character's current party has changed
             // for example, joining a party from another server
@@ -4644,39 +4663,100 @@ namespace charutils
 
     void SendToZone(CCharEntity* PChar, uint8 type, uint64 ipp)
     {
-        if (type == 2)
+        // wherever the char goes it is loaded again, so its database jobs finish here first
+        dbworker::WhenIdle(PChar, [type, ipp](CCharEntity* PChar)
         {
-            Sql_Query(SqlHandle, "UPDATE accounts_sessions SET server_addr = %u, server_port = %u WHERE charid = %u;",
-                (uint32)ipp, (uint32)(ipp >> 32), PChar->id);
+            if (type == 2)
+            {
+                Sql_Query(SqlHandle, "UPDATE accounts_sessions SET server_addr = %u, server_port = %u WHERE charid = %u;",
+                    (uint32)ipp, (uint32)(ipp >> 32), PChar->id);
 
-            const int8* Query =
-                "UPDATE chars "
-                "SET "
-                "pos_zone = %u,"
-                "pos_prevzone = %u,"
-                "pos_rot = %u,"
-                "pos_x = %.3f,"
-                "pos_y = %.3f,"
-                "pos_z = %.3f,"
-                "boundary = %u "
-                "WHERE charid = %u;";
-
-            Sql_Query(SqlHandle, Query,
-                PChar->loc.destination,
-                PChar->m_moghouseID ? 0 : PChar->getZone(),
-                PChar->loc.p.rotation,
-                PChar->loc.p.x,
-                PChar->loc.p.y,
-                PChar->loc.p.z,
-                PChar->loc.boundary,
-                PChar->id);
+                const int8* Query =
+                    "UPDATE chars "
+                    "SET "
+                    "pos_zone = %u,"
+                    "pos_prevzone = %u,"
+                    "pos_rot = %u,"
+                    "pos_x = %.3f,"
+                    "pos_y = %.3f,"
+                    "pos_z = %.3f,"
+                    "boundary = %u "
+                    "WHERE charid = %u;";
+
+                Sql_Query(SqlHandle, Query,
+                    PChar->loc.destination,
+                    PChar->m_moghouseID ? 0 : PChar->getZone(),
+                    PChar->loc.p.rotation,
+                    PChar->loc.p.x,
+                    PChar->loc.p.y,
+                    PChar->loc.p.z,
+                    PChar->loc.boundary,
+                    PChar->id);
+            }
+            else
+            {
+                SaveCharPosition(PChar);
+            }
+
+            PChar->pushPacket(new CServerIPPacket(PChar, type, ipp));
+        });
+    }
+
+    /************************************************************************
+    *                                                                       *
+    *  The search server keeps its own list of online characters. Called    *
+    *  every zone tick, only sends when the entry differs from the last     *
+    *  one sent, which covers zoning, job and level changes, name flags,    *
+    *  parties and linkshells without hooking each of them.                 *
+    *                                                                       *
+    ************************************************************************/
+
+    void SendRosterUpdate(CCharEntity* PChar)
+    {
+        roster_entry_t entry;
+        memset(&entry, 0, sizeof(entry));
+
+        entry.charid = PChar->id;
+        memcpy(entry.name, PChar->GetName(), dsp_min(PChar->name.size(), sizeof(entry.name) - 1));
+        entry.zone = PChar->getZone();
+        entry.prevzone = PChar->loc.prevzone;
+        entry.mjob = PChar->GetMJob();
+        entry.mlvl = PChar->GetMLevel();
+        entry.sjob = PChar->GetSJob();
+        entry.slvl = PChar->GetSLevel();
+        entry.race = PChar->look.race;
+        entry.nation = PChar->profile.nation;
+        entry.rank = PChar->profile.rank[PChar->profile.nation];
+        entry.nameflags = PChar->nameflags.flags;
+
+        if (PChar->PParty)
+        {
+            entry.partyid = PChar->PParty->GetPartyID();
+            entry.allianceid = PChar->PParty->m_PAlliance ? PChar->PParty->m_PAlliance->m_AllianceID : 0;
         }
-        else
+        if (PChar->PLinkshell1)
+        {
+            CItemLinkshell* PItemLinkshell = (CItemLinkshell*)PChar->getEquip(SLOT_LINK1);
+            entry.linkshellid1 = PChar->PLinkshell1->getID();
+            entry.linkshellrank1 = PItemLinkshell ? PItemLinkshell->GetLSType() : 0;
+        }
+        if (PChar->PLinkshell2)
+        {
+            CItemLinkshell* PItemLinkshell = (CItemLinkshell*)PChar->getEquip(SLOT_LINK2);
+            entry.linkshellid2 = PChar->PLinkshell2->getID();
+            entry.linkshellrank2 = PItemLinkshell ? PItemLinkshell->GetLSType() : 0;
+        }
+
+        if (memcmp(&entry, &PChar->m_rosterEntry, sizeof(entry)) != 0)
         {
-            SaveCharPosition(PChar);
+            PChar->m_rosterEntry = entry;
+            message::send(MSG_ROSTER_UPDATE, &entry, sizeof(entry), nullptr);
         }
+    }
 
-        PChar->pushPacket(new CServerIPPacket(PChar, type, ipp));
+    void SendRosterRemove(uint32 charid)
+    {
+        message::send(MSG_ROSTER_REMOVE, &charid, sizeof(charid), nullptr);
     }
 
     void AddWeaponSkillPoints(CCharEntity* PChar, SLOTTYPE slotid, int wspoints)
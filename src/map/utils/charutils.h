@@ -172,6 +172,8 @@ namespace charutils
     int32   GetPoints(CCharEntity* PChar, const char* type);
     std::string GetConquestPointsName(CCharEntity* PChar);
     void    SendToZone(CCharEntity* PChar, uint8 type, uint64 ipp);
+    void    SendRosterUpdate(CCharEntity* PChar);                       // tells the search server about the char if anything it filters on changed
+    void    SendRosterRemove(uint32 charid);                            // takes a logged out char off the search server roster
     void    AddWeaponSkillPoints(CCharEntity*, SLOTTYPE, int);
 
     int32   GetVar(CCharEntity* PChar, const char* var);
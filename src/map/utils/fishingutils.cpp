@@ -24,6 +24,9 @@
 #include "../../common/showmsg.h"
 
 #include <string.h> 
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
 
 #include "../universal_container.h"
 #include "../item_container.h"
@@ -65,6 +68,93 @@ void LoadFishingMessages()
     });
 }
 
+/************************************************************************
+*																		*
+*  Catch tables, built once from fishing_zone/rod/lure/fish and keyed	*
+*  by zone, rod and lure. Normal catches keep the running total of		*
+*  their luck in ascending luck order, so picking one is a single draw	*
+*  and a binary search.													*
+*																		*
+************************************************************************/
+
+struct FishingQuestCatch_t
+{
+	uint16 FishID;
+	uint8  LogID;
+	uint8  QuestID;
+};
+
+struct FishingCatchTable_t
+{
+	std::vector<FishingQuestCatch_t> QuestCatches;		// lure.luck = 0, in table order
+	std::vector<uint16> FishID;							// lure.luck != 0, ascending luck
+	std::vector<int32>  LuckTotal;						// running sum of luck, parallel to FishID
+};
+
+std::unordered_map<uint64, FishingCatchTable_t> g_FishingCatches;
+
+uint64 GetCatchKey(uint16 ZoneID, uint16 RodID, uint16 LureID)
+{
+	return ((uint64)ZoneID << 32) | ((uint64)RodID << 16) | LureID;
+}
+
+void LoadFishingCatches()
+{
+	const int8* Query =
+		"SELECT "
+			"zone.zoneid,"		// 0
+			"rod.rodid,"		// 1
+			"lure.lureid,"		// 2
+			"fish.fishid,"		// 3
+			"fish.log,"			// 4
+			"fish.quest,"		// 5
+			"lure.luck "		// 6
+		"FROM fishing_zone AS zone "
+		"INNER JOIN fishing_rod  AS rod  USING (fishid) "
+		"INNER JOIN fishing_lure AS lure USING (fishid) "
+		"INNER JOIN fishing_fish AS fish USING (fishid) "
+		"ORDER BY zone.zoneid, rod.rodid, lure.lureid, lure.luck";
+
+	int32 ret = Sql_Query(SqlHandle, Query);
+
+	if (ret == SQL_ERROR)
+	{
+		ShowError("fishingutils::LoadFishingCatches: unable to read fishing tables, keeping %u loaded catch tables\n", (uint32)g_FishingCatches.size());
+		return;
+	}
+
+	g_FishingCatches.clear();
+
+	uint32 count = 0;
+
+	while (Sql_NextRow(SqlHandle) == SQL_SUCCESS)
+	{
+		FishingCatchTable_t& Table = g_FishingCatches[GetCatchKey(
+			(uint16)Sql_GetUIntData(SqlHandle,0),
+			(uint16)Sql_GetUIntData(SqlHandle,1),
+			(uint16)Sql_GetUIntData(SqlHandle,2))];
+
+		uint16 FishID = (uint16)Sql_GetUIntData(SqlHandle,3);
+		int32  Luck   = Sql_GetIntData(SqlHandle,6);
+
+		if (Luck == 0)
+		{
+			FishingQuestCatch_t Catch;
+			Catch.FishID  = FishID;
+			Catch.LogID   = (uint8)Sql_GetIntData(SqlHandle,4);
+			Catch.QuestID = (uint8)Sql_GetIntData(SqlHandle,5);
+			Table.QuestCatches.push_back(Catch);
+		}
+		else
+		{
+			Table.FishID.push_back(FishID);
+			Table.LuckTotal.push_back((Table.LuckTotal.empty() ? 0 : Table.LuckTotal.back()) + Luck);
+		}
+		count++;
+	}
+	ShowStatus("fishingutils::LoadFishingCatches: %u catches in %u zone/rod/lure tables\n", count, (uint32)g_FishingCatches.size());
+}
+
 /************************************************************************
 *																		*
 *  Получение смещения для сообщений рыбалки								*
@@ -168,94 +258,52 @@ bool CheckFisherLuck(CCharEntity* PChar)
 
 	uint16 LureID = WeaponItem->getID();
 
-	int32 FishingChance = dsprand::GetRandomNumber(100);
+	auto Table = g_FishingCatches.find(GetCatchKey(PChar->getZone(), RodID, LureID));
 
-	if (FishingChance <= 20)
+	if (Table == g_FishingCatches.end())
 	{
-		const int8* Query = 
-            "SELECT "
-                "fish.fishid,"      // 0
-                "fish.max,"         // 1
-                "fish.watertype,"   // 2
-                "fish.size,"        // 3
-                "fish.stamina,"     // 4
-                "fish.log,"         // 5
-                "fish.quest,"       // 6
-                "rod.flag "         // 7
-            "FROM fishing_zone AS zone "
-			"INNER JOIN fishing_rod  AS rod  USING (fishid) "
-			"INNER JOIN fishing_lure AS lure USING (fishid) "
-			"INNER JOIN fishing_fish AS fish USING (fishid) "
-			"WHERE zone.zoneid = %u AND rod.rodid = %u AND lure.lureid = %u AND lure.luck = 0";
-
-		int32 ret = Sql_Query(SqlHandle, Query, PChar->getZone(), RodID, LureID);
-
-		if( ret != SQL_ERROR && Sql_NumRows(SqlHandle) != 0)
-		{
-            while(Sql_NextRow(SqlHandle) == SQL_SUCCESS)
-			{
-                // ловля предметов, необходимых для поисков
-
-                uint8 logid = (uint8)Sql_GetIntData(SqlHandle,5);
-                uint8 quest = (uint8)Sql_GetIntData(SqlHandle,6);
-
-                if(logid < MAX_QUESTAREA && quest < MAX_QUESTID)
-	            {
-		            uint8 current  = PChar->m_questLog[logid].current [quest/8] & (1 << (quest % 8));
-		            uint8 complete = PChar->m_questLog[logid].complete[quest/8] & (1 << (quest % 8));
-
-                    if (complete == 0 && current != 0)
-                    {
-		                PFish = new CItemFish(*itemutils::GetItemPointer(Sql_GetIntData(SqlHandle,0)));
-
-					    PChar->UContainer->SetType(UCONTAINER_FISHING);
-					    PChar->UContainer->SetItem(0, PFish);
-					    break;
-                    }
-	            }
-                // TODO: ловля простых предметов
-            }
-		}						
+		return false;
 	}
-	else
+
+	int32 FishingChance = dsprand::GetRandomNumber(100);
+
+	if (FishingChance <= 20)
 	{
-		const int8* Query = 
-            "SELECT "
-                "fish.fishid,"      // 0
-                "fish.min,"         // 1
-                "fish.max,"         // 2
-                "fish.size,"        // 3
-                "fish.stamina,"     // 4
-                "fish.watertype,"   // 5
-                "rod.flag, "         // 6
-                "lure.luck "        // 7
-            "FROM fishing_zone AS zone "
-            "INNER JOIN fishing_rod  AS rod  USING (fishid) "
-			"INNER JOIN fishing_lure AS lure USING (fishid) "
-			"INNER JOIN fishing_fish AS fish USING (fishid) "
-			"WHERE zone.zoneid = %u AND rod.rodid = %u AND lure.lureid = %u AND lure.luck != 0 "
-			"ORDER BY luck"; 
-		
-		int32 ret = Sql_Query(SqlHandle, Query, PChar->getZone(), RodID, LureID);
-
-		if( ret != SQL_ERROR && Sql_NumRows(SqlHandle) != 0)
+		for (auto& Catch : Table->second.QuestCatches)
 		{
-			int32 FisherLuck = 0;
-            int32 FishingChance = dsprand::GetRandomNumber(1000);
+            // ловля предметов, необходимых для поисков
 
-			while(Sql_NextRow(SqlHandle) == SQL_SUCCESS) 
-			{
-				FisherLuck += Sql_GetIntData(SqlHandle,7);
+            if(Catch.LogID < MAX_QUESTAREA && Catch.QuestID < MAX_QUESTID)
+	        {
+		        uint8 current  = PChar->m_questLog[Catch.LogID].current [Catch.QuestID/8] & (1 << (Catch.QuestID % 8));
+		        uint8 complete = PChar->m_questLog[Catch.LogID].complete[Catch.QuestID/8] & (1 << (Catch.QuestID % 8));
 
-				if (FishingChance <= FisherLuck)
-				{
-					PFish = new CItemFish(*itemutils::GetItemPointer(Sql_GetIntData(SqlHandle,0)));
+                if (complete == 0 && current != 0)
+                {
+		            PFish = new CItemFish(*itemutils::GetItemPointer(Catch.FishID));
 
 					PChar->UContainer->SetType(UCONTAINER_FISHING);
 					PChar->UContainer->SetItem(0, PFish);
 					break;
-				}	
-			}
+                }
+	        }
+            // TODO: ловля простых предметов
+		}
+	}
+	else
+	{
+		const std::vector<int32>& LuckTotal = Table->second.LuckTotal;
+
+		// first catch whose running luck reaches the draw, same as walking the list in luck order
+		int32 FishingChance = dsprand::GetRandomNumber(1000);
+		auto Catch = std::lower_bound(LuckTotal.begin(), LuckTotal.end(), FishingChance);
+
+		if (Catch != LuckTotal.end())
+		{
+			PFish = new CItemFish(*itemutils::GetItemPointer(Table->second.FishID[Catch - LuckTotal.begin()]));
+
+			PChar->UContainer->SetType(UCONTAINER_FISHING);
+			PChar->UContainer->SetItem(0, PFish);
 		}
 	}
 
@@ -45,6 +45,7 @@ class CCharEntity;
 namespace fishingutils
 {
     void LoadFishingMessages();
+    void LoadFishingCatches();                  // (re)builds the catch tables from the fishing_* tables
 
 	void StartFishing(CCharEntity* PChar);
 	void FishingAction(CCharEntity* PChar, FISHACTION action, uint16 stamina);
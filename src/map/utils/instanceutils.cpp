@@ -21,39 +21,193 @@ This file is part of DarkStar-server source code.
 ===========================================================================
 */
 
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include "../../common/showmsg.h"
+
 #include "../instance_loader.h"
+#include "../map.h"
+#include "../profiler.h"
 
 #include "instanceutils.h"
 #include "zoneutils.h"
 
 #include "../lua/luautils.h"
 
-CInstanceLoader* Loader = nullptr;
+#define MAX_LOADER_CONNECTIONS 4
+
+struct InstanceLoadStats_t
+{
+	uint32   count;
+	duration total;
+	duration max;
+};
+
+std::vector<CInstanceLoader*> g_Loaders;
+std::vector<Sql_t*> g_LoaderConnections;		// idle connections
+uint32 g_LoaderConnectionCount = 0;
+
+std::map<uint32, InstancePrefab_t*> g_Prefabs;	// (zoneid << 8) | instanceid
+std::map<uint32, InstanceLoadStats_t> g_LoadStats;
 
 namespace instanceutils
 {
-	void CheckInstance()
+	uint32 GetPrefabKey(uint16 zoneid, uint8 instanceid)
 	{
-		if (Loader)
+		return ((uint32)zoneid << 8) | instanceid;
+	}
+
+	int32 CheckInstance(time_point tick, CTaskMgr::CTask* PTask)
+	{
+		// loaders finishing in the same tick do not depend on each other
+		for (auto it = g_Loaders.begin(); it != g_Loaders.end();)
 		{
-			if (Loader->Check())
+			if ((*it)->Check())
+			{
+				delete *it;
+				it = g_Loaders.erase(it);
+			}
+			else
 			{
-				delete Loader;
-				Loader = nullptr;
+				++it;
 			}
 		}
+		return 0;
 	}
 
 	void LoadInstance(uint8 instanceid, uint16 zoneid, CCharEntity* PRequester)
 	{
         CZone* PZone = zoneutils::GetZone(zoneid);
-		if (!Loader && PZone)
+		if (PZone)
 		{
-			Loader = new CInstanceLoader(instanceid, PZone, PRequester);
+			g_Loaders.push_back(new CInstanceLoader(instanceid, PZone, PRequester));
 		}
 		else
 		{
 			luautils::OnInstanceCreated(PRequester, nullptr);
 		}
 	}
+
+	/************************************************************************
+	*                                                                       *
+	*  Prefabs: the entity rows of an instance id are read from the        *
+	*  database once, every later instance of that id is built from them   *
+	*                                                                       *
+	************************************************************************/
+
+	const InstancePrefab_t* GetPrefab(uint16 zoneid, uint8 instanceid)
+	{
+		auto it = g_Prefabs.find(GetPrefabKey(zoneid, instanceid));
+		return it != g_Prefabs.end() ? it->second : nullptr;
+	}
+
+	const InstancePrefab_t* AddPrefab(uint16 zoneid, uint8 instanceid, InstancePrefab_t* PPrefab)
+	{
+		auto result = g_Prefabs.insert(std::make_pair(GetPrefabKey(zoneid, instanceid), PPrefab));
+
+		if (!result.second)
+		{
+			// two loaders raced for the same id, keep the first prefab
+			delete PPrefab;
+		}
+		return result.first->second;
+	}
+
+	void FreePrefabs()
+	{
+		for (auto PLoader : g_Loaders)
+		{
+			delete PLoader;
+		}
+		g_Loaders.clear();
+
+		for (auto prefab : g_Prefabs)
+		{
+			delete prefab.second;
+		}
+		g_Prefabs.clear();
+	}
+
+	/************************************************************************
+	*                                                                       *
+	*  Loader connections are opened on demand and kept for reuse, so a    *
+	*  load does not pay for a new connection. The pool is main thread     *
+	*  only; a borrowed connection belongs to its loader thread, which     *
+	*  pings it before use since nothing keeps idle ones alive.            *
+	*                                                                       *
+	************************************************************************/
+
+	Sql_t* ConnectLoader()
+	{
+		Sql_t* handle = Sql_Malloc();
+
+		if (Sql_Connect(handle, map_config.mysql_login,
+			map_config.mysql_password,
+			map_config.mysql_host,
+			map_config.mysql_port,
+			map_config.mysql_database) == SQL_ERROR)
+		{
+			ShowError("instanceutils::ConnectLoader: unable to connect to the database\n");
+			Sql_Free(handle);
+			return nullptr;
+		}
+		return handle;
+	}
+
+	LOADER_CONNECTION AcquireLoaderConnection(Sql_t** handle)
+	{
+		if (!g_LoaderConnections.empty())
+		{
+			*handle = g_LoaderConnections.back();
+			g_LoaderConnections.pop_back();
+			return LOADER_CONNECTION_OK;
+		}
+		if (g_LoaderConnectionCount >= MAX_LOADER_CONNECTIONS)
+		{
+			return LOADER_CONNECTION_BUSY;
+		}
+
+		*handle = ConnectLoader();
+
+		if (*handle == nullptr)
+		{
+			return LOADER_CONNECTION_FAILED;
+		}
+		g_LoaderConnectionCount++;
+		return LOADER_CONNECTION_OK;
+	}
+
+	void ReleaseLoaderConnection(Sql_t* handle)
+	{
+		if (handle == nullptr)
+		{
+			// lost by the loader thread and not reopened, its slot is free again
+			g_LoaderConnectionCount--;
+			return;
+		}
+		g_LoaderConnections.push_back(handle);
+	}
+
+	void ReportLoadTime(uint16 zoneid, uint8 instanceid, duration elapsed, bool cached)
+	{
+		InstanceLoadStats_t& stats = g_LoadStats[GetPrefabKey(zoneid, instanceid)];
+
+		stats.count++;
+		stats.total += elapsed;
+		stats.max = std::max(stats.max, elapsed);
+
+		if (!profiler::IsEnabled())
+		{
+			return;
+		}
+		ShowDebug("Instance %u (zone %u) ready in %lld ms (%s), average %lld ms, max %lld ms over %u loads\n",
+			instanceid, zoneid,
+			(long long)std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count(),
+			cached ? "prefab" : "database",
+			(long long)std::chrono::duration_cast<std::chrono::milliseconds>(stats.total / stats.count).count(),
+			(long long)std::chrono::duration_cast<std::chrono::milliseconds>(stats.max).count(),
+			stats.count);
+	}
 };
\ No newline at end of file
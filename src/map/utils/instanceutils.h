@@ -25,14 +25,34 @@ This file is part of DarkStar-server source code.
 #define _INSTANCEUTILS_H
 
 #include "../../common/cbasetypes.h"
+#include "../../common/sql.h"
+#include "../../common/taskmgr.h"
 
 class CInstanceLoader;
 class CCharEntity;
+struct InstancePrefab_t;
+
+enum LOADER_CONNECTION
+{
+	LOADER_CONNECTION_OK,
+	LOADER_CONNECTION_BUSY,				// every pooled connection is lent out, try again later
+	LOADER_CONNECTION_FAILED			// the database can't be reached
+};
 
 namespace instanceutils
 {
-	void CheckInstance();
+	int32 CheckInstance(time_point tick, CTaskMgr::CTask* PTask);
 	void LoadInstance(uint8 instanceid, uint16 zoneid, CCharEntity* PRequester);
+
+	const InstancePrefab_t* GetPrefab(uint16 zoneid, uint8 instanceid);
+	const InstancePrefab_t* AddPrefab(uint16 zoneid, uint8 instanceid, InstancePrefab_t* PPrefab);
+	void FreePrefabs();
+
+	Sql_t* ConnectLoader();
+	LOADER_CONNECTION AcquireLoaderConnection(Sql_t** handle);
+	void ReleaseLoaderConnection(Sql_t* handle);
+
+	void ReportLoadTime(uint16 zoneid, uint8 instanceid, duration elapsed, bool cached);
 };
 
 #endif
\ No newline at end of file
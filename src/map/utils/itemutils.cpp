@@ -554,11 +554,10 @@ namespace itemutils
 		    {
 			    CItemArmor* PItem = (CItemArmor*)g_pItemList[ItemID];
 
-			    for (uint32 i = 0; i < PItem->modList.size(); ++i)
+			    for (auto modifier : PItem->getModList())
 			    {
-				    delete PItem->modList.at(i);
+				    delete modifier;
 			    }
-			    PItem->modList.clear();
 		    }
 		    delete g_pItemList[ItemID];
 	    }
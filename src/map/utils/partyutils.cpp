@@ -0,0 +1,838 @@
+/*
+===========================================================================
+
+  Copyright (c) 2010-2015 Darkstar Dev Teams
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see http://www.gnu.org/licenses/
+
+  This file is part of DarkStar-server source code.
+
+===========================================================================
+*/
+
+#include "../../common/showmsg.h"
+#include "../../common/sql.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string.h>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "partyutils.h"
+
+#include "../entities/charentity.h"
+#include "../map.h"
+#include "../message.h"
+#include "../party.h"
+
+namespace partyutils
+{
+    namespace
+    {
+        struct mirror_job_t
+        {
+            bool           notify;          // message to send rather than a row to write
+            party_member_t row;
+            MSGSERVTYPE    type;
+            uint32         id[2];
+        };
+
+        struct tombstone_t
+        {
+            std::chrono::steady_clock::time_point removed;
+            uint32 charid;
+            uint64 version;
+            uint64 origin;
+        };
+
+        typedef std::unordered_map<uint32, std::unordered_set<uint32>> member_index_t;
+
+        // a removed row is kept this long so that older states still in flight can't bring it back
+        const std::chrono::seconds TOMBSTONE_TIME(60);
+
+        std::mutex g_Mutex;
+        std::unordered_map<uint32, party_member_t> g_Members;
+        member_index_t g_Parties;       // partyid -> charids of the live rows
+        member_index_t g_Alliances;     // allianceid -> charids of the live rows
+        std::deque<tombstone_t> g_Tombstones;
+        uint64 g_Clock = 0;
+
+        std::mutex g_JobMutex;
+        std::condition_variable g_JobSignal;
+        std::deque<mirror_job_t> g_Jobs;
+        std::thread g_Mirror;
+        bool g_Stopping = false;
+
+        uint64 GetOrder()
+        {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        }
+
+        bool IsChanged(const party_member_t& a, const party_member_t& b)
+        {
+            return a.partyid != b.partyid || a.allianceid != b.allianceid || a.flags != b.flags ||
+                a.zone != b.zone || a.prevzone != b.prevzone || strcmp(a.name, b.name) != 0;
+        }
+
+        // whether a supersedes b; equal versions from two servers are ordered by the server
+        bool IsNewer(const party_member_t& a, const party_member_t& b)
+        {
+            return a.version != b.version ? a.version > b.version : a.origin > b.origin;
+        }
+
+        void Relink(member_index_t& index, uint32 oldId, uint32 newId, uint32 charid)
+        {
+            if (oldId == newId)
+            {
+                return;
+            }
+            if (oldId != 0)
+            {
+                auto it = index.find(oldId);
+
+                if (it != index.end())
+                {
+                    it->second.erase(charid);
+
+                    if (it->second.empty())
+                    {
+                        index.erase(it);
+                    }
+                }
+            }
+            if (newId != 0)
+            {
+                index[newId].insert(charid);
+            }
+        }
+
+        // keeps the indexes and tombstones in step with a row that was old, g_Mutex must be held
+        void Reindex(const party_member_t& old, const party_member_t& row)
+        {
+            Relink(g_Parties, old.partyid, row.partyid, row.charid);
+            Relink(g_Alliances, old.partyid != 0 ? old.allianceid : 0, row.partyid != 0 ? row.allianceid : 0, row.charid);
+
+            if (row.partyid == 0)
+            {
+                g_Tombstones.push_back({ std::chrono::steady_clock::now(), row.charid, row.version, row.origin });
+            }
+        }
+
+        // drops the tombstones nothing older can arrive for anymore, g_Mutex must be held
+        void Prune()
+        {
+            auto expired = std::chrono::steady_clock::now() - TOMBSTONE_TIME;
+
+            while (!g_Tombstones.empty() && g_Tombstones.front().removed < expired)
+            {
+                const tombstone_t& tombstone = g_Tombstones.front();
+                auto it = g_Members.find(tombstone.charid);
+
+                // rows added again since then carry a newer version and stay
+                if (it != g_Members.end() && it->second.partyid == 0 && it->second.version == tombstone.version &&
+                    it->second.origin == tombstone.origin)
+                {
+                    g_Members.erase(it);
+                }
+                g_Tombstones.pop_front();
+            }
+        }
+
+        // the rows of a party or alliance, copied since touching them may move them between sets
+        std::vector<uint32> Select(const member_index_t& index, uint32 id)
+        {
+            auto it = index.find(id);
+
+            if (id == 0 || it == index.end())
+            {
+                return std::vector<uint32>();
+            }
+            return std::vector<uint32>(it->second.begin(), it->second.end());
+        }
+
+        // stamps a row changed on this server from old, g_Mutex must be held
+        void Touch(const party_member_t& old, party_member_t& row, std::vector<party_member_t>& changed)
+        {
+            row.version = ++g_Clock;
+            row.origin = ((uint64)map_ip.s_addr << 16) | map_port;
+            Reindex(old, row);
+            changed.push_back(row);
+        }
+
+        // tells the other map servers and queues the rows for the database, called without g_Mutex
+        void Commit(std::vector<party_member_t>& changed)
+        {
+            if (changed.empty())
+            {
+                return;
+            }
+            message::send(MSG_PT_STATE, changed.data(), changed.size() * sizeof(party_member_t), nullptr);
+            {
+                std::lock_guard<std::mutex> lk(g_JobMutex);
+
+                for (auto& row : changed)
+                {
+                    mirror_job_t job {};
+                    job.row = row;
+                    g_Jobs.push_back(job);
+                }
+            }
+            g_JobSignal.notify_one();
+        }
+
+        void Mirror()
+        {
+            Sql_t* handle = Sql_Malloc();
+
+            if (Sql_Connect(handle, map_config.mysql_login,
+                map_config.mysql_password,
+                map_config.mysql_host,
+                map_config.mysql_port,
+                map_config.mysql_database) == SQL_ERROR)
+            {
+                ShowError("partyutils::Mirror: unable to connect to the database, party changes won't be saved\n");
+                Sql_Free(handle);
+                handle = nullptr;
+            }
+            else
+            {
+                Sql_Keepalive(handle);
+            }
+
+            while (true)
+            {
+                std::deque<mirror_job_t> batch;
+                {
+                    std::unique_lock<std::mutex> lk(g_JobMutex);
+                    g_JobSignal.wait(lk, [] { return g_Stopping || !g_Jobs.empty(); });
+
+                    if (g_Jobs.empty())
+                    {
+                        break;
+                    }
+                    batch.swap(g_Jobs);
+                }
+
+                // only the last state of a row matters, churn during a burst collapses into one write
+                std::unordered_map<uint32, party_member_t> rows;
+
+                for (auto& job : batch)
+                {
+                    if (!job.notify)
+                    {
+                        rows[job.row.charid] = job.row;
+                    }
+                }
+
+                for (auto& entry : rows)
+                {
+                    party_member_t& row = entry.second;
+
+                    if (handle == nullptr)
+                    {
+                        break;
+                    }
+                    if (row.partyid == 0)
+                    {
+                        Sql_Query(handle, "DELETE FROM accounts_parties WHERE charid = %u;", row.charid);
+                    }
+                    else
+                    {
+                        // rows of chars that logged out in the meantime are left to the session cascade
+                        Sql_Query(handle, "INSERT INTO accounts_parties (charid, partyid, allianceid, partyflag, timestamp) "
+                            "SELECT charid, %u, %u, %u, FROM_UNIXTIME(%u) FROM accounts_sessions WHERE charid = %u "
+                            "ON DUPLICATE KEY UPDATE partyid = VALUES(partyid), allianceid = VALUES(allianceid), "
+                            "partyflag = VALUES(partyflag), timestamp = VALUES(timestamp);",
+                            row.partyid, row.allianceid, row.flags, (uint32)(row.order / 1000), row.charid);
+                    }
+                }
+
+                for (auto& job : batch)
+                {
+                    if (job.notify)
+                    {
+                        uint8 data[8] {};
+                        WBUFL(data, 0) = job.id[0];
+                        WBUFL(data, 4) = job.id[1];
+                        message::send(job.type, data, job.type == MSG_PT_DISBAND ? 8 : 4, nullptr);
+                    }
+                }
+            }
+
+            if (handle != nullptr)
+            {
+                Sql_Free(handle);
+            }
+        }
+    }
+
+    /************************************************************************
+    *                                                                       *
+    *  Loads what the other map servers left in the database               *
+    *                                                                       *
+    ************************************************************************/
+
+    void Initialize()
+    {
+        int32 ret = Sql_Query(SqlHandle, "SELECT accounts_parties.charid, partyid, allianceid, partyflag, UNIX_TIMESTAMP(timestamp), "
+            "charname, pos_zone, pos_prevzone FROM accounts_parties JOIN chars ON accounts_parties.charid = chars.charid;");
+
+        if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) != 0)
+        {
+            std::lock_guard<std::mutex> lk(g_Mutex);
+
+            while (Sql_NextRow(SqlHandle) == SQL_SUCCESS)
+            {
+                party_member_t row {};
+
+                row.charid = Sql_GetUIntData(SqlHandle, 0);
+                row.partyid = Sql_GetUIntData(SqlHandle, 1);
+                row.allianceid = Sql_GetUIntData(SqlHandle, 2);
+                row.flags = (uint16)Sql_GetUIntData(SqlHandle, 3);
+                row.order = (uint64)Sql_GetUIntData(SqlHandle, 4) * 1000;
+                strncpy(row.name, Sql_GetData(SqlHandle, 5), sizeof(row.name) - 1);
+                row.zone = (uint16)Sql_GetUIntData(SqlHandle, 6);
+                row.prevzone = (uint16)Sql_GetUIntData(SqlHandle, 7);
+
+                party_member_t& member = g_Members[row.charid];
+
+                Reindex(member, row);
+                member = row;
+            }
+        }
+        g_Mirror = std::thread(Mirror);
+    }
+
+    void Free()
+    {
+        {
+            std::lock_guard<std::mutex> lk(g_JobMutex);
+            g_Stopping = true;
+        }
+        g_JobSignal.notify_one();
+
+        if (g_Mirror.joinable())
+        {
+            g_Mirror.join();
+        }
+    }
+
+    void Apply(const void* data, size_t size)
+    {
+        const party_member_t* rows = static_cast<const party_member_t*>(data);
+
+        std::lock_guard<std::mutex> lk(g_Mutex);
+
+        Prune();
+
+        for (size_t i = 0; i < size / sizeof(party_member_t); ++i)
+        {
+            party_member_t row = rows[i];
+            row.name[sizeof(row.name) - 1] = '\0';
+
+            g_Clock = std::max(g_Clock, row.version);
+
+            auto it = g_Members.find(row.charid);
+
+            if (it == g_Members.end())
+            {
+                Reindex(party_member_t {}, row);
+                g_Members[row.charid] = row;
+            }
+            else if (IsNewer(row, it->second))
+            {
+                Reindex(it->second, row);
+                it->second = row;
+            }
+        }
+    }
+
+    /************************************************************************
+    *                                                                       *
+    *  Queries                                                              *
+    *                                                                       *
+    ************************************************************************/
+
+    bool GetMember(uint32 charid, party_member_t* member)
+    {
+        std::lock_guard<std::mutex> lk(g_Mutex);
+
+        auto it = g_Members.find(charid);
+
+        if (it == g_Members.end() || it->second.partyid == 0)
+        {
+            return false;
+        }
+        *member = it->second;
+        return true;
+    }
+
+    std::vector<party_member_t> GetMembers(uint32 partyid, uint32 allianceid)
+    {
+        std::vector<party_member_t> members;
+        {
+            std::lock_guard<std::mutex> lk(g_Mutex);
+
+            std::vector<uint32> charids = Select(g_Parties, partyid);
+
+            for (uint32 charid : Select(g_Alliances, allianceid))
+            {
+                if (g_Members[charid].partyid != partyid)
+                {
+                    charids.push_back(charid);
+                }
+            }
+            for (uint32 charid : charids)
+            {
+                members.push_back(g_Members[charid]);
+            }
+        }
+        std::sort(members.begin(), members.end(), [](const party_member_t& a, const party_member_t& b)
+        {
+            uint16 numberA = a.flags & (PARTY_SECOND | PARTY_THIRD);
+            uint16 numberB = b.flags & (PARTY_SECOND | PARTY_THIRD);
+
+            return numberA != numberB ? numberA < numberB : a.order < b.order;
+        });
+        return members;
+    }
+
+    std::string GetNextPartyLeader(uint32 partyid)
+    {
+        std::lock_guard<std::mutex> lk(g_Mutex);
+
+        const party_member_t* next = nullptr;
+
+        for (uint32 charid : Select(g_Parties, partyid))
+        {
+            const party_member_t& row = g_Members[charid];
+
+            if (!(row.flags & PARTY_LEADER) && (!next || row.order < next->order))
+            {
+                next = &row;
+            }
+        }
+        return next ? std::string(next->name) : std::string();
+    }
+
+    std::string GetNextAllianceLeader(uint32 allianceid, uint32 partyid)
+    {
+        std::lock_guard<std::mutex> lk(g_Mutex);
+
+        const party_member_t* next = nullptr;
+
+        for (uint32 charid : Select(g_Alliances, allianceid))
+        {
+            const party_member_t& row = g_Members[charid];
+
+            if (row.partyid != partyid && (row.flags & PARTY_LEADER) && (!next || row.order < next->order))
+            {
+                next = &row;
+            }
+        }
+        return next ? std::string(next->name) : std::string();
+    }
+
+    uint32 GetAlliancePartyCount(uint32 allianceid)
+    {
+        std::lock_guard<std::mutex> lk(g_Mutex);
+
+        std::unordered_set<uint32> parties;
+
+        for (uint32 charid : Select(g_Alliances, allianceid))
+        {
+            parties.insert(g_Members[charid].partyid);
+        }
+        return (uint32)parties.size();
+    }
+
+    /************************************************************************
+    *                                                                       *
+    *  Membership                                                           *
+    *                                                                       *
+    ************************************************************************/
+
+    void AddMember(CCharEntity* PChar, uint32 partyid, uint32 allianceid, uint16 flags)
+    {
+        std::vector<party_member_t> changed;
+        {
+            std::lock_guard<std::mutex> lk(g_Mutex);
+
+            party_member_t& row = g_Members[PChar->id];
+            party_member_t old = row;
+
+            row.charid = PChar->id;
+            row.partyid = partyid;
+            row.allianceid = allianceid;
+            row.flags = flags;
+            row.zone = PChar->getZone();
+            row.prevzone = PChar->loc.prevzone;
+            row.order = GetOrder();
+            memset(row.name, 0, sizeof(row.name));
+            strncpy(row.name, PChar->GetName(), sizeof(row.name) - 1);
+
+            Touch(old, row, changed);
+        }
+        Commit(changed);
+    }
+
+    void AddMember(uint32 charid, uint32 partyid, uint32 allianceid, uint16 flags)
+    {
+        // the char is on another server, its name and zone have to come from the database once
+        party_member_t row {};
+
+        int32 ret = Sql_Query(SqlHandle, "SELECT charname, pos_zone, pos_prevzone FROM chars WHERE charid = %u;", charid);
+
+        if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) != 0 && Sql_NextRow(SqlHandle) == SQL_SUCCESS)
+        {
+            strncpy(row.name, Sql_GetData(SqlHandle, 0), sizeof(row.name) - 1);
+            row.zone = (uint16)Sql_GetUIntData(SqlHandle, 1);
+            row.prevzone = (uint16)Sql_GetUIntData(SqlHandle, 2);
+        }
+        row.charid = charid;
+        row.partyid = partyid;
+        row.allianceid = allianceid;
+        row.flags = flags;
+        row.order = GetOrder();
+
+        std::vector<party_member_t> changed;
+        {
+            std::lock_guard<std::mutex> lk(g_Mutex);
+
+            party_member_t& member = g_Members[charid];
+            party_member_t old = member;
+
+            member = row;
+            Touch(old, member, changed);
+        }
+        Commit(changed);
+    }
+
+    void RemoveMember(uint32 charid)
+    {
+        std::vector<party_member_t> changed;
+        {
+            std::lock_guard<std::mutex> lk(g_Mutex);
+
+            Prune();
+
+            auto it = g_Members.find(charid);
+
+            if (it != g_Members.end() && it->second.partyid != 0)
+            {
+                party_member_t old = it->second;
+
+                it->second.partyid = 0;
+                it->second.allianceid = 0;
+                it->second.flags = 0;
+                Touch(old, it->second, changed);
+            }
+        }
+        Commit(changed);
+    }
+
+    void UpdateMember(CCharEntity* PChar, uint16 zone, uint16 prevzone)
+    {
+        std::vector<party_member_t> changed;
+        {
+            std::lock_guard<std::mutex> lk(g_Mutex);
+
+            auto it = g_Members.find(PChar->id);
+
+            if (it != g_Members.end() && it->second.partyid != 0)
+            {
+                party_member_t& row = it->second;
+                party_member_t old = row;
+
+                row.zone = zone;
+                row.prevzone = prevzone;
+                memset(row.name, 0, sizeof(row.name));
+                strncpy(row.name, PChar->GetName(), sizeof(row.name) - 1);
+
+                if (IsChanged(old, row))
+                {
+                    Touch(old, row, changed);
+                }
+            }
+        }
+        Commit(changed);
+    }
+
+    /************************************************************************
+    *                                                                       *
+    *  Party roles                                                          *
+    *                                                                       *
+    ************************************************************************/
+
+    uint32 SetPartyLeader(uint32 partyid, const int8* name)
+    {
+        std::vector<party_member_t> changed;
+        uint32 newId = 0;
+        {
+            std::lock_guard<std::mutex> lk(g_Mutex);
+
+            std::vector<uint32> charids = Select(g_Parties, partyid);
+
+            for (uint32 charid : charids)
+            {
+                if (strcmp(g_Members[charid].name, name) == 0)
+                {
+                    newId = charid;
+                    break;
+                }
+            }
+            if (newId == 0)
+            {
+                return 0;
+            }
+            // the party id doubles as the alliance id when its leader led the alliance
+            for (uint32 charid : Select(g_Alliances, partyid))
+            {
+                if (g_Members[charid].partyid != partyid)
+                {
+                    charids.push_back(charid);
+                }
+            }
+            for (uint32 charid : charids)
+            {
+                party_member_t& row = g_Members[charid];
+                party_member_t old = row;
+
+                if (row.partyid == partyid && (row.flags & PARTY_LEADER))
+                {
+                    row.flags &= ~(ALLIANCE_LEADER | PARTY_LEADER);
+                }
+                if (row.partyid == partyid)
+                {
+                    row.partyid = newId;
+                }
+                if (row.allianceid == partyid)
+                {
+                    row.allianceid = newId;
+                }
+                if (row.charid == newId)
+                {
+                    row.flags |= row.allianceid == row.partyid ? ALLIANCE_LEADER | PARTY_LEADER : PARTY_LEADER;
+                }
+                if (IsChanged(old, row))
+                {
+                    Touch(old, row, changed);
+                }
+            }
+        }
+        Commit(changed);
+        return newId;
+    }
+
+    void SetQuarterMaster(uint32 partyid, const int8* name)
+    {
+        std::vector<party_member_t> changed;
+        {
+            std::lock_guard<std::mutex> lk(g_Mutex);
+
+            for (uint32 charid : Select(g_Parties, partyid))
+            {
+                party_member_t& row = g_Members[charid];
+                party_member_t old = row;
+
+                row.flags &= ~PARTY_QM;
+
+                if (name != nullptr && strcmp(row.name, name) == 0)
+                {
+                    row.flags |= PARTY_QM;
+                }
+                if (IsChanged(old, row))
+                {
+                    Touch(old, row, changed);
+                }
+            }
+        }
+        Commit(changed);
+    }
+
+    /************************************************************************
+    *                                                                       *
+    *  Alliances                                                            *
+    *                                                                       *
+    ************************************************************************/
+
+    void SetAllianceLeaderFlag(uint32 partyid)
+    {
+        std::vector<party_member_t> changed;
+        {
+            std::lock_guard<std::mutex> lk(g_Mutex);
+
+            for (uint32 charid : Select(g_Parties, partyid))
+            {
+                party_member_t& row = g_Members[charid];
+                party_member_t old = row;
+
+                if ((row.flags & PARTY_LEADER) && !(row.flags & ALLIANCE_LEADER))
+                {
+                    row.flags |= ALLIANCE_LEADER;
+                    Touch(old, row, changed);
+                }
+            }
+        }
+        Commit(changed);
+    }
+
+    uint32 SetAllianceLeader(uint32 allianceid, const int8* name)
+    {
+        std::vector<party_member_t> changed;
+        uint32 newId = 0;
+        {
+            std::lock_guard<std::mutex> lk(g_Mutex);
+
+            std::vector<uint32> charids = Select(g_Alliances, allianceid);
+
+            for (uint32 charid : charids)
+            {
+                const party_member_t& row = g_Members[charid];
+
+                if ((row.flags & PARTY_LEADER) && strcmp(row.name, name) == 0)
+                {
+                    newId = charid;
+                    break;
+                }
+            }
+            if (newId == 0)
+            {
+                return 0;
+            }
+            for (uint32 charid : charids)
+            {
+                party_member_t& row = g_Members[charid];
+                party_member_t old = row;
+
+                row.flags &= ~ALLIANCE_LEADER;
+                row.allianceid = newId;
+
+                if (row.charid == newId)
+                {
+                    row.flags |= ALLIANCE_LEADER;
+                }
+                if (IsChanged(old, row))
+                {
+                    Touch(old, row, changed);
+                }
+            }
+        }
+        Commit(changed);
+        return newId;
+    }
+
+    uint8 JoinAlliance(uint32 partyid, uint32 allianceid)
+    {
+        std::vector<party_member_t> changed;
+        uint8 number = 0;
+        {
+            std::lock_guard<std::mutex> lk(g_Mutex);
+
+            // take the lowest party number not in use yet
+            std::vector<uint8> taken;
+
+            for (uint32 charid : Select(g_Alliances, allianceid))
+            {
+                taken.push_back(g_Members[charid].flags & (PARTY_SECOND | PARTY_THIRD));
+            }
+            std::sort(taken.begin(), taken.end());
+
+            for (uint8 used : taken)
+            {
+                if (used == number)
+                {
+                    number++;
+                }
+            }
+            for (uint32 charid : Select(g_Parties, partyid))
+            {
+                party_member_t& row = g_Members[charid];
+                party_member_t old = row;
+
+                row.allianceid = allianceid;
+                row.flags |= number;
+
+                if (IsChanged(old, row))
+                {
+                    Touch(old, row, changed);
+                }
+            }
+        }
+        Commit(changed);
+        return number;
+    }
+
+    void LeaveAlliance(uint32 partyid)
+    {
+        std::vector<party_member_t> changed;
+        {
+            std::lock_guard<std::mutex> lk(g_Mutex);
+
+            for (uint32 charid : Select(g_Parties, partyid))
+            {
+                party_member_t& row = g_Members[charid];
+                party_member_t old = row;
+
+                row.allianceid = 0;
+                row.flags &= ~(ALLIANCE_LEADER | PARTY_SECOND | PARTY_THIRD);
+
+                if (IsChanged(old, row))
+                {
+                    Touch(old, row, changed);
+                }
+            }
+        }
+        Commit(changed);
+    }
+
+    void DissolveAlliance(uint32 allianceid)
+    {
+        std::vector<party_member_t> changed;
+        {
+            std::lock_guard<std::mutex> lk(g_Mutex);
+
+            for (uint32 charid : Select(g_Alliances, allianceid))
+            {
+                party_member_t& row = g_Members[charid];
+                party_member_t old = row;
+
+                row.allianceid = 0;
+                row.flags &= ~(ALLIANCE_LEADER | PARTY_SECOND | PARTY_THIRD);
+                Touch(old, row, changed);
+            }
+        }
+        Commit(changed);
+    }
+
+    void Notify(MSGSERVTYPE type, uint32 id1, uint32 id2)
+    {
+        mirror_job_t job {};
+
+        job.notify = true;
+        job.type = type;
+        job.id[0] = id1;
+        job.id[1] = id2;
+        {
+            std::lock_guard<std::mutex> lk(g_JobMutex);
+            g_Jobs.push_back(job);
+        }
+        g_JobSignal.notify_one();
+    }
+};
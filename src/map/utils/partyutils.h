@@ -0,0 +1,104 @@
+/*
+===========================================================================
+
+  Copyright (c) 2010-2015 Darkstar Dev Teams
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see http://www.gnu.org/licenses/
+
+  This file is part of DarkStar-server source code.
+
+===========================================================================
+*/
+
+#ifndef _PARTYUTILS_H
+#define _PARTYUTILS_H
+
+#include "../../common/cbasetypes.h"
+#include "../../common/mmo.h"
+
+#include <string>
+#include <vector>
+
+/************************************************************************
+*                                                                       *
+*  Party and alliance membership of every online character.             *
+*                                                                       *
+*  Each map server keeps the whole table in memory and answers party    *
+*  queries from it. Changes are stamped with a version, sent to every   *
+*  other map server as MSG_PT_STATE and written to accounts_parties on  *
+*  a background thread, which the search server and a restarted map     *
+*  server read back.                                                    *
+*                                                                       *
+************************************************************************/
+
+class CCharEntity;
+
+// one row of accounts_parties, this is also the wire format of MSG_PT_STATE
+struct party_member_t
+{
+    uint32 charid;
+    uint32 partyid;                 // 0 once the char has left, kept so older versions can't bring it back
+    uint32 allianceid;
+    uint16 flags;                   // PARTYFLAG
+    uint16 zone;
+    uint16 prevzone;
+    uint16 reserved;
+    uint64 order;                   // join time in ms, members are listed oldest first
+    uint64 version;
+    uint64 origin;                  // map server that stamped the version (ip << 16 | port), breaks version ties
+    int8   name[16];
+};
+
+namespace partyutils
+{
+    void Initialize();
+    void Free();
+
+    // applies rows another map server changed
+    void Apply(const void* data, size_t size);
+
+    bool GetMember(uint32 charid, party_member_t* member);
+
+    // members of the alliance (if any) and of the party, ordered by party number then join time
+    std::vector<party_member_t> GetMembers(uint32 partyid, uint32 allianceid);
+
+    // the longest standing member of a party that isn't its leader
+    std::string GetNextPartyLeader(uint32 partyid);
+    // the longest standing party leader of an alliance outside the given party
+    std::string GetNextAllianceLeader(uint32 allianceid, uint32 partyid);
+    uint32 GetAlliancePartyCount(uint32 allianceid);
+
+    void AddMember(CCharEntity* PChar, uint32 partyid, uint32 allianceid, uint16 flags);
+    void AddMember(uint32 charid, uint32 partyid, uint32 allianceid, uint16 flags);
+    void RemoveMember(uint32 charid);
+    void UpdateMember(CCharEntity* PChar, uint16 zone, uint16 prevzone);
+
+    // hands the party over to the named member, the party and alliance ids follow the leader. returns the new party id or 0
+    uint32 SetPartyLeader(uint32 partyid, const int8* name);
+    void   SetQuarterMaster(uint32 partyid, const int8* name);
+
+    // flags the leader of the given party as leader of the alliance
+    void   SetAllianceLeaderFlag(uint32 partyid);
+    // hands the alliance over to the named party leader, returns the new alliance id or 0
+    uint32 SetAllianceLeader(uint32 allianceid, const int8* name);
+    // adds a party to an alliance, returns the party number it was given
+    uint8  JoinAlliance(uint32 partyid, uint32 allianceid);
+    void   LeaveAlliance(uint32 partyid);
+    void   DissolveAlliance(uint32 allianceid);
+
+    // routed by the message server from accounts_parties, so it is sent once the rows changed before it are written
+    void   Notify(MSGSERVTYPE type, uint32 id1, uint32 id2 = 0);
+};
+
+#endif
@@ -0,0 +1,77 @@
+/*
+===========================================================================
+
+  Copyright (c) 2010-2015 Darkstar Dev Teams
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see http://www.gnu.org/licenses/
+
+  This file is part of DarkStar-server source code.
+
+===========================================================================
+*/
+
+#include "../../common/showmsg.h"
+#include "../../common/sql.h"
+
+#include <string.h>
+
+#include "serverutils.h"
+#include "../map.h"
+
+namespace serverutils
+{
+    const size_t MAX_NAME = 50;     // server_variables.name
+
+    int32 GetServerVar(const int8* name)
+    {
+        int8 escaped[MAX_NAME * 2 + 1];
+        int32 value = 0;
+
+        if (strlen(name) > MAX_NAME)
+        {
+            ShowError("serverutils::GetServerVar: name too long: %s\n", name);
+            return 0;
+        }
+        Sql_EscapeString(SqlHandle, escaped, name);
+
+        int32 ret = Sql_Query(SqlHandle, "SELECT value FROM server_variables WHERE name = '%s' LIMIT 1;", escaped);
+
+        if (ret != SQL_ERROR &&
+            Sql_NumRows(SqlHandle) != 0 &&
+            Sql_NextRow(SqlHandle) == SQL_SUCCESS)
+        {
+            value = (int32)Sql_GetIntData(SqlHandle, 0);
+        }
+        return value;
+    }
+
+    void SetServerVar(const int8* name, int32 value)
+    {
+        int8 escaped[MAX_NAME * 2 + 1];
+
+        if (strlen(name) > MAX_NAME)
+        {
+            ShowError("serverutils::SetServerVar: name too long: %s\n", name);
+            return;
+        }
+        Sql_EscapeString(SqlHandle, escaped, name);
+
+        if (value == 0)
+        {
+            Sql_Query(SqlHandle, "DELETE FROM server_variables WHERE name = '%s' LIMIT 1;", escaped);
+            return;
+        }
+        Sql_Query(SqlHandle, "INSERT INTO server_variables VALUES ('%s', %i) ON DUPLICATE KEY UPDATE value = %i;", escaped, value, value);
+    }
+};
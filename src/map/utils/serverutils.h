@@ -0,0 +1,43 @@
+/*
+===========================================================================
+
+  Copyright (c) 2010-2015 Darkstar Dev Teams
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see http://www.gnu.org/licenses/
+
+  This file is part of DarkStar-server source code.
+
+===========================================================================
+*/
+
+#ifndef _SERVERUTILS_H
+#define _SERVERUTILS_H
+
+#include "../../common/cbasetypes.h"
+
+/************************************************************************
+*                                                                       *
+*  Server variables. Every lua_State and thread reads and writes them   *
+*  through here, backed by the server_variables table of the calling    *
+*  thread's connection so that all map servers see the same values.     *
+*                                                                       *
+************************************************************************/
+
+namespace serverutils
+{
+    int32 GetServerVar(const int8* name);
+    void  SetServerVar(const int8* name, int32 value);      // 0 deletes the variable
+};
+
+#endif
@@ -27,6 +27,9 @@
 
 #include <math.h>
 #include <string.h>
+#include <algorithm>
+#include <array>
+#include <unordered_map>
 
 #include "../packets/char_skills.h"
 #include "../packets/char_update.h"
@@ -53,6 +56,145 @@
 namespace synthutils
 {
 
+/************************************************************************
+*																		*
+*  Recipes indexed by crystal and ingredients. The key is the crystal	*
+*  followed by the ingredient IDs in ascending order with empty slots	*
+*  last, so it does not depend on the order the client sends them in.	*
+*  Recipes with an HQ crystal are indexed under both crystals.			*
+*																		*
+************************************************************************/
+
+struct SynthRecipe_t
+{
+	uint16 ID;
+	uint16 KeyItem;
+	uint8  Skill[8];		// SKILL_WOODWORKING .. SKILL_COOKING
+	uint16 Result[4];		// NQ, HQ1, HQ2, HQ3
+	uint8  ResultQty[4];
+};
+
+typedef std::array<uint16, 9> SynthRecipeKey_t;
+
+struct SynthRecipeKeyHash
+{
+	size_t operator()(const SynthRecipeKey_t& key) const
+	{
+		uint64 hash = 14695981039346656037ULL;
+		for (uint16 value : key)
+		{
+			hash = (hash ^ value) * 1099511628211ULL;
+		}
+		return (size_t)hash;
+	}
+};
+
+std::unordered_map<SynthRecipeKey_t, SynthRecipe_t, SynthRecipeKeyHash> g_SynthRecipes;
+
+void MakeRecipeKey(SynthRecipeKey_t& key)
+{
+	// 0 (empty slot) wraps to 0xFFFF and sorts after every real item
+	std::sort(key.begin() + 1, key.end(), [](uint16 a, uint16 b)
+	{
+		return (uint16)(a - 1) < (uint16)(b - 1);
+	});
+}
+
+const SynthRecipe_t* FindRecipe(SynthRecipeKey_t key)
+{
+	MakeRecipeKey(key);
+
+	auto recipe = g_SynthRecipes.find(key);
+	return recipe != g_SynthRecipes.end() ? &recipe->second : nullptr;
+}
+
+/************************************************************************
+*																		*
+*  Загружаем рецепты синтеза											*
+*																		*
+************************************************************************/
+
+void LoadSynthRecipes()
+{
+	const int8* Query =
+		"SELECT ID, KeyItem, Wood, Smith, Gold, Cloth, Leather, Bone, Alchemy, Cook, \
+			Result, ResultHQ1, ResultHQ2, ResultHQ3, ResultQty, ResultHQ1Qty, ResultHQ2Qty, ResultHQ3Qty, \
+			Crystal, HQCrystal, Ingredient1, Ingredient2, Ingredient3, Ingredient4, \
+			Ingredient5, Ingredient6, Ingredient7, Ingredient8 \
+		FROM synth_recipes \
+		ORDER BY ID";
+
+	int32 ret = Sql_Query(SqlHandle, Query);
+
+	if (ret == SQL_ERROR)
+	{
+		ShowError("synthutils::LoadSynthRecipes: unable to read synth_recipes, keeping %u loaded recipe keys\n", (uint32)g_SynthRecipes.size());
+		return;
+	}
+
+	g_SynthRecipes.clear();
+	g_SynthRecipes.reserve((size_t)Sql_NumRows(SqlHandle) * 2);
+
+	uint32 count = 0;
+
+	while (Sql_NextRow(SqlHandle) == SQL_SUCCESS)
+	{
+		SynthRecipe_t recipe;
+		recipe.ID      = (uint16)Sql_GetUIntData(SqlHandle, 0);
+		recipe.KeyItem = (uint16)Sql_GetUIntData(SqlHandle, 1);
+
+		for (uint8 i = 0; i < 8; ++i)
+		{
+			recipe.Skill[i] = (uint8)Sql_GetUIntData(SqlHandle, 2 + i);
+		}
+		for (uint8 i = 0; i < 4; ++i)
+		{
+			recipe.Result[i]    = (uint16)Sql_GetUIntData(SqlHandle, 10 + i);
+			recipe.ResultQty[i] = (uint8)Sql_GetUIntData(SqlHandle, 14 + i);
+		}
+
+		SynthRecipeKey_t key;
+		for (uint8 i = 0; i < 8; ++i)
+		{
+			key[i + 1] = (uint16)Sql_GetUIntData(SqlHandle, 20 + i);
+		}
+		MakeRecipeKey(key);
+
+		// the SQL lookup returned the lowest ID on a clash, emplace keeps the first row in ID order
+		key[0] = (uint16)Sql_GetUIntData(SqlHandle, 18);
+		g_SynthRecipes.emplace(key, recipe);
+
+		uint16 HQCrystal = (uint16)Sql_GetUIntData(SqlHandle, 19);
+		if (HQCrystal != 0 && HQCrystal != key[0])
+		{
+			key[0] = HQCrystal;
+			g_SynthRecipes.emplace(key, recipe);
+		}
+		count++;
+	}
+	ShowStatus("synthutils::LoadSynthRecipes: %u recipes, %u keys\n", count, (uint32)g_SynthRecipes.size());
+}
+
+/************************************************************************
+*																		*
+*  Replays every indexed key as a lookup, dsbench times it. Keys come	*
+*  from the index itself, so this measures lookups and checks nothing	*
+*																		*
+************************************************************************/
+
+void ReplaySynthRecipes()
+{
+	for (auto& recipe : g_SynthRecipes)
+	{
+		SynthRecipeKey_t key = recipe.first;
+
+		// scramble the ingredient order so every lookup has to rebuild the key
+		std::reverse(key.begin() + 1, key.end());
+
+		FindRecipe(key);
+	}
+}
+
 /************************************************************************
 *																		*
 *  Проверяем наличие рецепта и возможности его синтеза (если его		*
@@ -69,61 +211,37 @@ namespace synthutils
 
 bool isRightRecipe(CCharEntity* PChar)
 {
-	const int8* fmtQuery =
+	SynthRecipeKey_t key;
+	for (uint8 i = 0; i < 9; ++i)
+	{
+		key[i] = PChar->CraftContainer->getItemID(i);
+	}
 
-		"SELECT ID, KeyItem, Wood, Smith, Gold, Cloth, Leather, Bone, Alchemy, Cook, \
-			Result, ResultHQ1, ResultHQ2, ResultHQ3, ResultQty, ResultHQ1Qty, ResultHQ2Qty, ResultHQ3Qty \
-		FROM synth_recipes \
-		WHERE (Crystal = %u OR HQCrystal = %u) \
-			AND Ingredient1 = %u \
-			AND Ingredient2 = %u \
-			AND Ingredient3 = %u \
-			AND Ingredient4 = %u \
-			AND Ingredient5 = %u \
-			AND Ingredient6 = %u \
-			AND Ingredient7 = %u \
-			AND Ingredient8 = %u \
-		LIMIT 1";
-
-	int32 ret = Sql_Query(
-		SqlHandle,
-		fmtQuery,
-		PChar->CraftContainer->getItemID(0),
-		PChar->CraftContainer->getItemID(0),
-		PChar->CraftContainer->getItemID(1),
-		PChar->CraftContainer->getItemID(2),
-		PChar->CraftContainer->getItemID(3),
-		PChar->CraftContainer->getItemID(4),
-		PChar->CraftContainer->getItemID(5),
-		PChar->CraftContainer->getItemID(6),
-		PChar->CraftContainer->getItemID(7),
-		PChar->CraftContainer->getItemID(8));
-
-	if (ret != SQL_ERROR &&
-		Sql_NumRows(SqlHandle) != 0 &&
-		Sql_NextRow(SqlHandle) == SQL_SUCCESS)
+	const SynthRecipe_t* PRecipe = FindRecipe(key);
+
+	if (PRecipe != nullptr)
 	{
-		uint16 KeyItemID = (uint16)Sql_GetUIntData(SqlHandle,1);
+		uint16 KeyItemID = PRecipe->KeyItem;
 
 		if ((KeyItemID == 0) || (charutils::hasKeyItem(PChar,KeyItemID)))
 		{
 			// в девятую ячейку записываем id рецепта
-			PChar->CraftContainer->setItem(9, Sql_GetUIntData(SqlHandle,0),0xFF,0);
+			PChar->CraftContainer->setItem(9, PRecipe->ID,0xFF,0);
 			#ifdef _DSP_SYNTH_DEBUG_MESSAGES_
 			ShowDebug(CL_CYAN"Recipe matches ID %u.\n" CL_RESET, PChar->CraftContainer->getItemID(9));
 			#endif
 
-			PChar->CraftContainer->setItem(10 + 1, (uint16)Sql_GetUIntData(SqlHandle,10), (uint8)Sql_GetUIntData(SqlHandle,14), 0);	// RESULT_SUCCESS
-			PChar->CraftContainer->setItem(10 + 2, (uint16)Sql_GetUIntData(SqlHandle,11), (uint8)Sql_GetUIntData(SqlHandle,15), 0);	// RESULT_HQ
-			PChar->CraftContainer->setItem(10 + 3, (uint16)Sql_GetUIntData(SqlHandle,12), (uint8)Sql_GetUIntData(SqlHandle,16), 0);	// RESULT_HQ2
-			PChar->CraftContainer->setItem(10 + 4, (uint16)Sql_GetUIntData(SqlHandle,13), (uint8)Sql_GetUIntData(SqlHandle,17), 0);	// RESULT_HQ3
+			PChar->CraftContainer->setItem(10 + 1, PRecipe->Result[0], PRecipe->ResultQty[0], 0);	// RESULT_SUCCESS
+			PChar->CraftContainer->setItem(10 + 2, PRecipe->Result[1], PRecipe->ResultQty[1], 0);	// RESULT_HQ
+			PChar->CraftContainer->setItem(10 + 3, PRecipe->Result[2], PRecipe->ResultQty[2], 0);	// RESULT_HQ2
+			PChar->CraftContainer->setItem(10 + 4, PRecipe->Result[3], PRecipe->ResultQty[3], 0);	// RESULT_HQ3
 
 			uint16 skillValue   = 0;
 			uint16 currentSkill = 0;
 
 			for (uint8 skillID = 49; skillID < 57; ++skillID)
 			{
-				skillValue   = (uint16)Sql_GetUIntData(SqlHandle,(skillID-49+2));
+				skillValue   = PRecipe->Skill[skillID-49];
 				currentSkill = PChar->RealSkills.skill[skillID];
 
 				// skill записываем в поле quantity ячеек 9-16
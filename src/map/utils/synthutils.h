@@ -57,6 +57,9 @@ namespace synthutils
         SYNTHESIS_HQ3		= 4
     };
 
+	void   LoadSynthRecipes();							// (re)builds the recipe index from synth_recipes
+	void   ReplaySynthRecipes();						// looks up every indexed recipe, a timing loop for dsbench
+
 	int32 startSynth(CCharEntity* PChar);
 	int32 sendSynthDone(CCharEntity* PChar);
 };
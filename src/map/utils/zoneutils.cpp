@@ -24,6 +24,8 @@
 #include "../../common/showmsg.h"
 
 #include <string.h>
+#include <algorithm>
+#include <unordered_map>
 #include "../../common/timer.h"
 
 #include "../ai/ai_container.h"
@@ -46,6 +48,10 @@
 std::map<uint16, CZone*> g_PZoneList;   // глобальный массив указателей на игровые зоны
 CNpcEntity*  g_PTrigger;    // триггер для запуска событий
 
+// every character currently inserted into a zone or instance, by charid and by lower-case name
+std::unordered_map<uint32, CCharEntity*> g_PCharDirectory;
+std::unordered_map<std::string, CCharEntity*> g_PCharNameDirectory;
+
 
 namespace zoneutils
 {
@@ -198,16 +204,13 @@ CBaseEntity* GetEntity(uint32 ID, uint8 filter)
 
 CCharEntity* GetCharByName(int8* name)
 {
-    for (auto PZone : g_PZoneList)
+    if (name == nullptr)
     {
-        CCharEntity* PChar = PZone.second->GetCharByName(name);
-
-        if (PChar != nullptr)
-        {
-            return PChar;
-        }
+        return nullptr;
     }
-    return nullptr;
+    auto PChar = g_PCharNameDirectory.find(FoldCharName(name));
+
+    return PChar != g_PCharNameDirectory.end() ? PChar->second : nullptr;
 }
 
 /************************************************************************
@@ -218,33 +221,56 @@ CCharEntity* GetCharByName(int8* name)
 
 CCharEntity* GetCharFromWorld(uint32 charid, uint16 targid)
 {
+    CCharEntity* PChar = GetChar(charid);
+
     // will not return pointers to players in Mog House
-    for (auto PZone : g_PZoneList)
+    if (PChar == nullptr || PChar->targid != targid || PChar->loc.zone == nullptr || PChar->loc.zone->GetID() == 0)
     {
-        if (PZone.first == 0)
-        {
-            continue;
-        }
-        CBaseEntity* PEntity = PZone.second->GetEntity(targid, TYPE_PC);
-        if (PEntity != nullptr && PEntity->id == charid)
-        {
-            return (CCharEntity*)PEntity;
-        }
+        return nullptr;
     }
-    return nullptr;
+    return PChar;
 }
 
 CCharEntity* GetChar(uint32 charid)
 {
-    for (auto PZone : g_PZoneList)
+    auto PChar = g_PCharDirectory.find(charid);
+
+    return PChar != g_PCharDirectory.end() ? PChar->second : nullptr;
+}
+
+/************************************************************************
+*                                                                       *
+*  Character directory, kept in step with the zones' char lists         *
+*                                                                       *
+************************************************************************/
+
+std::string FoldCharName(const int8* name)
+{
+    std::string folded(name);
+    std::transform(folded.begin(), folded.end(), folded.begin(), ::tolower);
+    return folded;
+}
+
+void RegisterChar(CCharEntity* PChar)
+{
+    g_PCharDirectory[PChar->id] = PChar;
+    g_PCharNameDirectory[FoldCharName(PChar->GetName())] = PChar;
+}
+
+void UnregisterChar(CCharEntity* PChar)
+{
+    // only drop entries that still point at this object, a fresh login may already have replaced them
+    auto PCharById = g_PCharDirectory.find(PChar->id);
+    if (PCharById != g_PCharDirectory.end() && PCharById->second == PChar)
     {
-        CBaseEntity* PEntity = PZone.second->GetCharByID(charid);
-        if (PEntity)
-        {
-            return (CCharEntity*)PEntity;
-        }
+        g_PCharDirectory.erase(PCharById);
+    }
+
+    auto PCharByName = g_PCharNameDirectory.find(FoldCharName(PChar->GetName()));
+    if (PCharByName != g_PCharNameDirectory.end() && PCharByName->second == PChar)
+    {
+        g_PCharNameDirectory.erase(PCharByName);
     }
-    return nullptr;
 }
 
 /************************************************************************
@@ -1007,6 +1033,9 @@ void FreeZoneList()
         delete PZone.second;
     }
     delete g_PTrigger;
+
+    g_PCharDirectory.clear();
+    g_PCharNameDirectory.clear();
 }
 
 void ForEachZone(std::function<void(CZone*)> func)
@@ -26,6 +26,8 @@
 
 #include "../../common/cbasetypes.h"
 
+#include <string>
+
 #include "../zone.h"
 
 /************************************************************************
@@ -60,6 +62,9 @@ namespace zoneutils
     CCharEntity* GetCharByName(int8* name);                                         // получаем указатель на персонажа по имени
     CCharEntity* GetCharFromWorld(uint32 charid, uint16 targid);                    // returns pointer to character by id and target id
     CCharEntity* GetChar(uint32 id);                                                // returns pointer to character by id
+    void         RegisterChar(CCharEntity* PChar);                                  // adds a character to the id/name directory (zone entry)
+    void         UnregisterChar(CCharEntity* PChar);                                // removes a character from the directory (zone exit)
+    std::string  FoldCharName(const int8* name);                                    // directory key for a character name
     void         ForEachZone(std::function<void(CZone*)> func);
     uint64       GetZoneIPP(uint16 zoneid);                                         // returns IPP for zone ID
 };
@@ -31,6 +31,8 @@
 #include "../common/socket.h"
 
 #include <string.h>
+#include <algorithm>
+#include <math.h>
 
 #include "enmity_container.h"
 #include "latent_effect_container.h"
@@ -67,8 +69,10 @@
 #include "utils/charutils.h"
 #include "utils/itemutils.h"
 #include "utils/mobutils.h"
+#include "utils/partyutils.h"
 #include "utils/petutils.h"
 #include "utils/zoneutils.h"
+#include "profiler.h"
 
 
 /************************************************************************
@@ -80,6 +84,7 @@
 
 int32 zone_server(time_point tick, CTaskMgr::CTask* PTask)
 {
+    CZoneProfileScope profile((CZone*)PTask->m_data, PROFILE_TICK, true);
     ((CZone*)PTask->m_data)->ZoneServer(tick);
     return 0;
 }
@@ -94,6 +99,7 @@ int32 zone_server(time_point tick, CTaskMgr::CTask* PTask)
 int32 zone_server_region(time_point tick, CTaskMgr::CTask* PTask)
 {
     CZone* PZone = (CZone*)PTask->m_data;
+    CZoneProfileScope profile(PZone, PROFILE_TICK, true);
 
     if ((tick - PZone->m_RegionCheckTime) < 1s)
     {
@@ -144,6 +150,7 @@ CZone::CZone(ZONEID ZoneID, REGIONTYPE RegionID, CONTINENTTYPE ContinentID)
     m_Weather = WEATHER_NONE;
     m_WeatherChangeTime = 0;
     m_navMesh = nullptr;
+    m_regionGridDirty = false;
     m_zoneEntities = new CZoneEntities(this);
 
     // settings should load first
@@ -450,6 +457,7 @@ void CZone::InsertRegion(CRegion* Region)
     if (Region != nullptr)
     {
         m_regionList.push_back(Region);
+        m_regionGridDirty = true;
     }
 }
 
@@ -974,11 +982,15 @@ void CZone::CharZoneOut(CCharEntity* PChar)
     PChar->SpawnMOBList.clear();
     PChar->SpawnPETList.clear();
 
+    if (PChar->PParty && PChar->loc.destination != 0)
+    {
+        // other servers list the char in its destination from here on
+        partyutils::UpdateMember(PChar, PChar->loc.destination, PChar->getZone());
+    }
+
     if (PChar->PParty && PChar->loc.destination != 0 && PChar->m_moghouseID != 0)
     {
-        uint8 data[4] {};
-        WBUFL(data, 0) = PChar->PParty->GetPartyID();
-        message::send(MSG_PT_RELOAD, data, sizeof data, nullptr);
+        partyutils::Notify(MSG_PT_RELOAD, PChar->PParty->GetPartyID());
     }
 
     if (PChar->PParty)
@@ -987,25 +999,119 @@ void CZone::CharZoneOut(CCharEntity* PChar)
     }
 }
 
+/************************************************************************
+*                                                                       *
+*  Regions are bucketed into square cells on the x/z plane, so a        *
+*  character is only tested against the regions around its position.    *
+*  Regions spanning too many cells go to a list that is always checked. *
+*                                                                       *
+************************************************************************/
+
+#define REGION_CELL_SIZE    32.0f
+#define REGION_MAX_CELLS    256
+
+namespace
+{
+    int32 GetRegionCell(float coord)
+    {
+        return (int32)floor(coord / REGION_CELL_SIZE);
+    }
+
+    uint32 GetRegionCellKey(int32 cellX, int32 cellZ)
+    {
+        return ((uint32)(uint16)cellX << 16) | (uint16)cellZ;
+    }
+}
+
+void CZone::BuildRegionGrid()
+{
+    m_regionIndex.assign(m_regionList.begin(), m_regionList.end());
+    m_regionGrid.clear();
+    m_regionWide.clear();
+
+    for (uint16 i = 0; i < m_regionIndex.size(); ++i)
+    {
+        float minX, minZ, maxX, maxZ;
+        m_regionIndex[i]->GetBounds(minX, minZ, maxX, maxZ);
+
+        if (minX > maxX || minZ > maxZ)
+        {
+            // contains no point, nobody can enter it
+            continue;
+        }
+
+        int32 cellMinX = GetRegionCell(minX);
+        int32 cellMaxX = GetRegionCell(maxX);
+        int32 cellMinZ = GetRegionCell(minZ);
+        int32 cellMaxZ = GetRegionCell(maxZ);
+
+        if ((int64)(cellMaxX - cellMinX + 1) * (cellMaxZ - cellMinZ + 1) > REGION_MAX_CELLS)
+        {
+            m_regionWide.push_back(i);
+            continue;
+        }
+        for (int32 cellX = cellMinX; cellX <= cellMaxX; ++cellX)
+        {
+            for (int32 cellZ = cellMinZ; cellZ <= cellMaxZ; ++cellZ)
+            {
+                m_regionGrid[GetRegionCellKey(cellX, cellZ)].push_back(i);
+            }
+        }
+    }
+    m_regionGridDirty = false;
+}
+
 void CZone::CheckRegions(CCharEntity* PChar)
 {
+    CProfileScope profile(PROFILE_REGIONS);
+
+    if (m_regionGridDirty)
+    {
+        BuildRegionGrid();
+    }
+
+    // candidates: the regions touching the character's cell, the wide ones and the one it is in now,
+    // visited in m_regionList order so enter/leave callbacks fire exactly as a full scan would
+    std::vector<uint16> candidates(m_regionWide);
+
+    auto cell = m_regionGrid.find(GetRegionCellKey(GetRegionCell(PChar->loc.p.x), GetRegionCell(PChar->loc.p.z)));
+
+    if (cell != m_regionGrid.end())
+    {
+        candidates.insert(candidates.end(), cell->second.begin(), cell->second.end());
+    }
+    if (PChar->m_InsideRegionID != 0)
+    {
+        for (uint16 i = 0; i < m_regionIndex.size(); ++i)
+        {
+            if (m_regionIndex[i]->GetRegionID() == PChar->m_InsideRegionID)
+            {
+                candidates.push_back(i);
+            }
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
     uint32 RegionID = 0;
 
-    for (regionList_t::const_iterator region = m_regionList.begin(); region != m_regionList.end(); ++region)
+    for (uint16 i : candidates)
     {
-        if ((*region)->isPointInside(PChar->loc.p))
+        CRegion* region = m_regionIndex[i];
+
+        if (region->isPointInside(PChar->loc.p))
         {
-            RegionID = (*region)->GetRegionID();
+            RegionID = region->GetRegionID();
 
-            if ((*region)->GetRegionID() != PChar->m_InsideRegionID)
+            if (region->GetRegionID() != PChar->m_InsideRegionID)
             {
-                luautils::OnRegionEnter(PChar, *region);
+                luautils::OnRegionEnter(PChar, region);
             }
             if (PChar->m_InsideRegionID == 0) break;
         }
-        else if ((*region)->GetRegionID() == PChar->m_InsideRegionID)
+        else if (region->GetRegionID() == PChar->m_InsideRegionID)
         {
-            luautils::OnRegionLeave(PChar, *region);
+            luautils::OnRegionLeave(PChar, region);
         }
     }
     PChar->m_InsideRegionID = RegionID;
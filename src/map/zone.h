@@ -30,6 +30,8 @@
 
 #include <list>
 #include <map>
+#include <unordered_map>
+#include <vector>
 
 #include "region.h"
 #include "vana_time.h"
@@ -598,12 +600,18 @@ private:
     zoneMusic_t     m_zoneMusic;            // информация о мелодиях, используемых в зоне
 
     regionList_t    m_regionList;           // список активных областей зоны
+
+    std::vector<CRegion*> m_regionIndex;                            // regions in m_regionList order
+    std::unordered_map<uint32, std::vector<uint16>> m_regionGrid;   // grid cell -> positions in m_regionIndex of regions touching it
+    std::vector<uint16> m_regionWide;                               // regions too large for the grid, checked everywhere
+    bool            m_regionGridDirty;
     zoneLineList_t  m_zoneLineList;         // список всех доступных zonelines для зоны
 
     void    LoadZoneLines();                // список zonelines (можно было бы заменить этот метод методом InsertZoneLine)
     void    LoadZoneWeather();              // погода
     void    LoadZoneSettings();             // настройки зоны
     void    LoadNavMesh();                  // Load the zones navmesh. Must exist in scripts/zones/:zone/NavMesh.nav
+    void    BuildRegionGrid();              // index regions by grid cell for CheckRegions
 
     CTaskMgr::CTask* ZoneTimer;             // указатель на созданный таймер - ZoneServer. необходим для возможности его остановки
 
@@ -23,6 +23,8 @@ This file is part of DarkStar-server source code.
 
 #include "zone_entities.h"
 
+#include <algorithm>
+
 #include "../common/utils.h"
 #include "party.h"
 #include "latent_effect_container.h"
@@ -52,6 +54,7 @@ This file is part of DarkStar-server source code.
 #include "utils/petutils.h"
 #include "utils/zoneutils.h"
 #include "utils/synthutils.h"
+#include "profiler.h"
 
 CZoneEntities::CZoneEntities(CZone* zone)
 {
@@ -78,6 +81,7 @@ void CZoneEntities::HealAllMobs()
 void CZoneEntities::InsertPC(CCharEntity* PChar)
 {
     m_charList[PChar->targid] = PChar;
+    zoneutils::RegisterChar(PChar);
     ShowDebug(CL_CYAN"CZone:: %s IncreaseZoneCounter <%u> %s \n" CL_RESET, m_zone->GetName(), m_charList.size(), PChar->GetName());
 }
 
@@ -89,6 +93,7 @@ void CZoneEntities::InsertMOB(CBaseEntity* PMob)
 
         FindPartyForMob(PMob);
         m_mobList[PMob->targid] = PMob;
+        m_mobCore.Invalidate();
     }
 }
 
@@ -363,6 +368,7 @@ void CZoneEntities::DecreaseZoneCounter(CCharEntity* PChar)
     // TODO: могут возникать проблемы с переходом между одной и той же зоной (zone == prevzone)
 
     m_charList.erase(PChar->targid);
+    zoneutils::UnregisterChar(PChar);
 
     ShowDebug(CL_CYAN"CZone:: %s DecreaseZoneCounter <%u> %s\n" CL_RESET, m_zone->GetName(), m_charList.size(), PChar->GetName());
 }
@@ -403,47 +409,81 @@ void CZoneEntities::DespawnPC(CCharEntity* PChar)
 
 void CZoneEntities::SpawnMOBs(CCharEntity* PChar)
 {
-    for (EntityList_t::const_iterator it = m_mobList.begin(); it != m_mobList.end(); ++it)
+    if (m_mobCore.Invalidated())
     {
-        CMobEntity* PCurrentMob = (CMobEntity*)it->second;
-        SpawnIDList_t::iterator MOB = PChar->SpawnMOBList.lower_bound(PCurrentMob->id);
+        m_mobCore.Sync(m_mobList);
+    }
 
-        float CurrentDistance = distance(PChar->loc.p, PCurrentMob->loc.p);
+    thread_local std::vector<uint16> inRange;
+    m_mobCore.FindInRange(PChar->loc.p, 50, inRange);
 
-        if (PCurrentMob->status == STATUS_MOB &&
-            CurrentDistance < 50)
+    // despawn the visible mobs that are no longer in range, the rest of the zone is not looked at
+    for (SpawnIDList_t::iterator MOB = PChar->SpawnMOBList.begin(); MOB != PChar->SpawnMOBList.end();)
+    {
+        uint16 slot = m_mobCore.GetSlot(MOB->first & 0x0FFF);
+
+        if (slot == m_mobCore.size() || m_mobCore.GetMob(slot) != MOB->second)
         {
-            if (MOB == PChar->SpawnMOBList.end() ||
-                PChar->SpawnMOBList.key_comp()(PCurrentMob->id, MOB->first))
-            {
-                PChar->SpawnMOBList.insert(MOB, SpawnIDList_t::value_type(PCurrentMob->id, PCurrentMob));
-                PChar->pushPacket(new CEntityUpdatePacket(PCurrentMob, ENTITY_SPAWN, UPDATE_ALL_MOB));
-            }
+            ++MOB;
+            continue;
+        }
+        auto next = std::lower_bound(inRange.begin(), inRange.end(), slot);
+
+        if (next == inRange.end() || *next != slot)
+        {
+            PChar->pushPacket(new CEntityUpdatePacket(MOB->second, ENTITY_DESPAWN, UPDATE_NONE));
+            MOB = PChar->SpawnMOBList.erase(MOB);
+        }
+        else
+        {
+            ++MOB;
+        }
+    }
+
+    for (uint16 slot : inRange)
+    {
+        CMobEntity* PCurrentMob = m_mobCore.GetMob(slot);
+        SpawnIDList_t::iterator MOB = PChar->SpawnMOBList.lower_bound(PCurrentMob->id);
 
-            if (PChar->isDead() || PChar->nameflags.flags & FLAG_GM || PCurrentMob->PMaster != nullptr)
-                continue;
+        if (MOB == PChar->SpawnMOBList.end() ||
+            PChar->SpawnMOBList.key_comp()(PCurrentMob->id, MOB->first))
+        {
+            PChar->SpawnMOBList.insert(MOB, SpawnIDList_t::value_type(PCurrentMob->id, PCurrentMob));
+            PChar->pushPacket(new CEntityUpdatePacket(PCurrentMob, ENTITY_SPAWN, UPDATE_ALL_MOB));
+        }
+    }
+}
 
-            // проверка ночного/дневного сна монстров уже учтена в проверке CurrentAction, т.к. во сне монстры не ходят ^^
+/************************************************************************
+*                                                                       *
+*  Aggro for the whole zone, once per tick. The packed mob state prunes *
+*  every mob/character pair that is out of detection range, only the    *
+*  rest goes through the controller's detection logic.                  *
+*                                                                       *
+************************************************************************/
 
-            uint16 expGain = (uint16)charutils::GetRealExp(PChar->GetMLevel(), PCurrentMob->GetMLevel());
+void CZoneEntities::CheckAggro()
+{
+    CProfileScope profile(PROFILE_AGGRO);
+    thread_local std::vector<std::pair<uint16, CCharEntity*>> pairs;
+    m_mobCore.FindAggroPairs(m_charList, pairs);
 
-            CMobController* PController = static_cast<CMobController*>(PCurrentMob->PAI->GetController());
+    for (auto& pair : pairs)
+    {
+        CMobEntity* PCurrentMob = m_mobCore.GetMob(pair.first);
+        CCharEntity* PChar = pair.second;
 
-            bool validAggro = expGain > 50 || PChar->animation == ANIMATION_HEALING || PCurrentMob->getMobMod(MOBMOD_ALWAYS_AGGRO);
+        // проверка ночного/дневного сна монстров уже учтена в проверке CurrentAction, т.к. во сне монстры не ходят ^^
 
-            if (validAggro && PController->CanAggroTarget(PChar))
-            {
-                PCurrentMob->PEnmityContainer->AddAggroEnmity(PChar);
-            }
-        }
-        else
+        uint16 expGain = (uint16)charutils::GetRealExp(PChar->GetMLevel(), PCurrentMob->GetMLevel());
+
+        CMobController* PController = static_cast<CMobController*>(PCurrentMob->PAI->GetController());
+
+        bool validAggro = expGain > 50 || PChar->animation == ANIMATION_HEALING || PCurrentMob->getMobMod(MOBMOD_ALWAYS_AGGRO);
+
+        if (validAggro && PController->CanAggroTarget(PChar))
         {
-            if (MOB != PChar->SpawnMOBList.end() &&
-                !(PChar->SpawnMOBList.key_comp()(PCurrentMob->id, MOB->first)))
-            {
-                PChar->SpawnMOBList.erase(MOB);
-                PChar->pushPacket(new CEntityUpdatePacket(PCurrentMob, ENTITY_DESPAWN, UPDATE_NONE));
-            }
+            PCurrentMob->PEnmityContainer->AddAggroEnmity(PChar);
         }
     }
 }
@@ -780,6 +820,8 @@ CCharEntity* CZoneEntities::GetCharByID(uint32 id)
 void CZoneEntities::PushPacket(CBaseEntity* PEntity, GLOBAL_MESSAGE_TYPE message_type, CBasicPacket* packet)
 {
     if (!packet) { return; }
+    CProfileScope profile(PROFILE_BROADCAST);
+
     // Do not send packets that are updates of a hidden GM..
     if (packet->id() == 0x00D && PEntity != nullptr && PEntity->objtype == TYPE_PC && ((CCharEntity*)PEntity)->m_isGMHidden)
     {
@@ -942,6 +984,8 @@ void CZoneEntities::ZoneServer(time_point tick)
         PMob->PAI->Tick(tick);
         PMob->StatusEffectContainer->CheckRegen(tick);
     }
+    m_mobCore.Sync(m_mobList);
+    CheckAggro();
 
     for (EntityList_t::const_iterator it = m_npcList.begin(); it != m_npcList.end(); ++it)
     {
@@ -986,6 +1030,7 @@ void CZoneEntities::ZoneServer(time_point tick)
             PChar->PAI->Tick(tick);
             PChar->PTreasurePool->CheckItems(tick);
             PChar->StatusEffectContainer->CheckRegen(tick);
+            charutils::SendRosterUpdate(PChar);
         }
     }
 }
@@ -999,6 +1044,8 @@ void CZoneEntities::ZoneServerRegion(time_point tick)
         PMob->StatusEffectContainer->CheckEffects(tick);
         PMob->PAI->Tick(tick);
     }
+    m_mobCore.Sync(m_mobList);
+    CheckAggro();
 
     for (EntityList_t::const_iterator it = m_petList.begin(); it != m_petList.end(); ++it)
     {
@@ -1020,6 +1067,7 @@ void CZoneEntities::ZoneServerRegion(time_point tick)
             PChar->PTreasurePool->CheckItems(tick);
 
             m_zone->CheckRegions(PChar);
+            charutils::SendRosterUpdate(PChar);
         }
     }
 }
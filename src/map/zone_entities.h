@@ -25,6 +25,7 @@ This file is part of DarkStar-server source code.
 #define _CZONEENTITIES_H
 
 #include "zone.h"
+#include "mob_hot_core.h"
 
 class CZoneEntities
 {
@@ -64,6 +65,7 @@ public:
 
     void			ZoneServer(time_point tick);
     void			ZoneServerRegion(time_point tick);
+    void			CheckAggro();													// mobs look for characters to aggro
 
     EntityList_t	GetCharList();
     bool			CharListEmpty();
@@ -80,6 +82,7 @@ private:
 
     CZone* m_zone;
     CBaseEntity*    m_Transport;            // указатель на транспорт в зоне
+    CMobHotCore     m_mobCore;              // packed copy of m_mobList state, refreshed every tick
 
 };
 
@@ -135,329 +135,60 @@ std::vector<ahItem*> CDataLoader::GetAHItemsToCategory(uint8 AHCategoryID, int8*
 
 /************************************************************************
 *                                                                       *
-*  Количество активных игроков в мире                                   *
-*                                                                       *
+*  Все персонажи в игровом мире, для заполнения roster                  *
+*  Every online character, the roster is (re)built from this            *
 ************************************************************************/
 
-uint32 CDataLoader::GetPlayersCount(search_req sr)
+std::vector<roster_entry_t> CDataLoader::GetOnlineRoster()
 {
-    uint8 jobid = sr.jobid;
-    if (jobid > 0 && jobid < 21){
-        if (Sql_Query(SqlHandle, "SELECT COUNT(*) FROM accounts_sessions LEFT JOIN char_stats USING (charid) WHERE mjob = %u", jobid)
-            != SQL_ERROR && Sql_NumRows(SqlHandle) != 0)
-        {
-            if (Sql_NextRow(SqlHandle) == SQL_SUCCESS)
-            {
-                return Sql_GetUIntData(SqlHandle, 0);
-            }
-        }
-    }
-    else{
-        if (Sql_Query(SqlHandle, "SELECT COUNT(*) FROM accounts_sessions") != SQL_ERROR && Sql_NumRows(SqlHandle) != 0)
-        {
-            if (Sql_NextRow(SqlHandle) == SQL_SUCCESS)
-            {
-                return Sql_GetUIntData(SqlHandle, 0);
-            }
-        }
-    }
-    return 0;
-}
+    std::vector<roster_entry_t> Roster;
 
-/************************************************************************
-*                                                                       *
-*  Список найденных персонажей в игровом мире                           *
-*          Job ID is 0 for none specified.                              *
-************************************************************************/
-
-std::list<SearchEntity*> CDataLoader::GetPlayersList(search_req sr, int* count)
-{
-    std::list<SearchEntity*> PlayersList;
-    std::string filterQry = "";
-    if (sr.jobid > 0 && sr.jobid < 21){
-        filterQry.append(" AND ");
-        filterQry.append(" mjob = ");
-        filterQry.append(std::to_string(static_cast<unsigned long long>(sr.jobid)));
-    }
-    if (sr.zoneid[0] > 0) {
-        string_t zoneList;
-        int i = 1;
-        zoneList.append(std::to_string(static_cast<unsigned long long>(sr.zoneid[0])));
-        while (i < 10 && sr.zoneid[i] != 0)
-        {
-            zoneList.append(", ");
-            zoneList.append(std::to_string(static_cast<unsigned long long>(sr.zoneid[i])));
-            i++;
-        }
-        filterQry.append(" AND ");
-        filterQry.append("(pos_zone IN (");
-        filterQry.append(zoneList);
-        filterQry.append(") OR (pos_zone = 0 AND pos_prevzone IN (");
-        filterQry.append(zoneList);
-        filterQry.append("))) ");
-    }
-
-    std::string fmtQuery = "SELECT charid, partyid, charname, pos_zone, pos_prevzone, nation, rank_sandoria, rank_bastok, rank_windurst, race, nameflags, mjob, sjob, mlvl, slvl "
+    const int8* Query = "SELECT charid, charname, pos_zone, pos_prevzone, nation, rank_sandoria, rank_bastok, rank_windurst, race, nameflags, "
+        "mjob, sjob, mlvl, slvl, partyid, allianceid, linkshellid1, linkshellid2, linkshellrank1, linkshellrank2 "
         "FROM accounts_sessions "
         "LEFT JOIN accounts_parties USING (charid) "
         "LEFT JOIN chars USING (charid) "
         "LEFT JOIN char_look USING (charid) "
         "LEFT JOIN char_stats USING (charid) "
-        "LEFT JOIN char_profile USING(charid) "
-        "WHERE charname IS NOT NULL ";
-    fmtQuery.append(filterQry);
-    fmtQuery.append(" ORDER BY charname ASC");
+        "LEFT JOIN char_profile USING (charid) "
+        "WHERE charname IS NOT NULL";
 
-    int32 ret = Sql_Query(SqlHandle, fmtQuery.c_str());
+    int32 ret = Sql_Query(SqlHandle, Query);
 
     if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) != 0)
     {
-        int totalResults = 0; //gives ALL matching criteria (total)
-        int visibleResults = 0; //capped at first 20
-        while (Sql_NextRow(SqlHandle) == SQL_SUCCESS)
-        {
-            SearchEntity* PPlayer = new SearchEntity;
-            memset(PPlayer, 0, sizeof(SearchEntity));
-
-            memcpy(PPlayer->name, Sql_GetData(SqlHandle, 2), 15);
-
-            PPlayer->id = (uint32)Sql_GetUIntData(SqlHandle, 0);
-            PPlayer->zone = (uint16)Sql_GetIntData(SqlHandle, 3);
-            PPlayer->prevzone = (uint16)Sql_GetIntData(SqlHandle, 4);
-            PPlayer->nation = (uint8)Sql_GetIntData(SqlHandle, 5);
-            PPlayer->mjob = (uint8)Sql_GetIntData(SqlHandle, 11);
-            PPlayer->sjob = (uint8)Sql_GetIntData(SqlHandle, 12);
-            PPlayer->mlvl = (uint8)Sql_GetIntData(SqlHandle, 13);
-            PPlayer->slvl = (uint8)Sql_GetIntData(SqlHandle, 14);
-            PPlayer->race = (uint8)Sql_GetIntData(SqlHandle, 9);
-            PPlayer->rank = (uint8)Sql_GetIntData(SqlHandle, 6 + PPlayer->nation);
-
-            PPlayer->zone = (PPlayer->zone == 0 ? PPlayer->prevzone : PPlayer->zone);
-
-            uint32 partyid = (uint32)Sql_GetUIntData(SqlHandle, 1);
-            uint32 nameflag = (uint32)Sql_GetUIntData(SqlHandle, 10);
-
-            if (partyid == PPlayer->id) PPlayer->flags1 |= 0x0008;
-            if (nameflag & FLAG_AWAY)   PPlayer->flags1 |= 0x0100;
-            if (nameflag & FLAG_DC)     PPlayer->flags1 |= 0x0800;
-            if (partyid != 0)           PPlayer->flags1 |= 0x2000;
-            if (nameflag & FLAG_ANON)   PPlayer->flags1 |= 0x4000;
-            if (nameflag & FLAG_INVITE) PPlayer->flags1 |= 0x8000;
+        Roster.reserve((size_t)Sql_NumRows(SqlHandle));
 
-            PPlayer->flags2 = PPlayer->flags1;
-
-            // TODO: search comments
-
-            // filter by job
-            if (sr.jobid > 0 && sr.jobid != PPlayer->mjob)
-                continue;
-
-            // filter by nation
-            if (sr.nation != 255 && !sr.nation == PPlayer->nation)
-                continue;
-
-            // filter by race
-            if (sr.race != 255)
-            {
-                // hume (male/female)
-                if (sr.race == 0 && (PPlayer->race != 1 && PPlayer->race != 2))
-                    continue;
-                // elvaan (male/female)
-                else if (sr.race == 1 && (PPlayer->race != 3 && PPlayer->race != 4))
-                    continue;
-                // tarutaru (male/female)
-                else if (sr.race == 2 && (PPlayer->race != 5 && PPlayer->race != 6))
-                    continue;
-                // mithra (female only)
-                else if (sr.race == 3 && PPlayer->race != 7)
-                    continue;
-                // galka (male only)
-                else if (sr.race == 4 && PPlayer->race != 8)
-                    continue;
-            }
-
-            // filter by rank
-            if (sr.minRank > 0 && sr.maxRank >= sr.minRank)
-            {
-                if (PPlayer->rank < sr.minRank || PPlayer->rank > sr.maxRank)
-                    continue;
-            }
-
-            // filter by flag (away, seek party etc.)
-            if (sr.flags != 0 && !(PPlayer->flags2 & sr.flags))
-                continue;
-
-            // filter by level
-            if (sr.minlvl > 0 && sr.maxlvl >= sr.minlvl){
-                if (PPlayer->mlvl < sr.minlvl || PPlayer->mlvl > sr.maxlvl)
-                    continue;
-            }
-
-            // filter by name
-            if (sr.nameLen > 0){
-                string_t dbname;
-                dbname.insert(0, (int8*)PPlayer->name);
-
-                //can't be this name, too long
-                if (sr.nameLen > dbname.length()){
-                    continue;
-                }
-                bool validName = true;
-                for (int i = 0; i < sr.nameLen; i++){
-                    //convert to lowercase for both
-                    if (tolower(sr.name[i]) != tolower(PPlayer->name[i])){
-                        validName = false;
-                        break;
-                    }
-                }
-                if (!validName){
-                    continue;
-                }
-            }
-            // dont show hidden gm
-            if (nameflag & FLAG_ANON && nameflag & FLAG_GM)
-            {
-                continue;
-            }
-            if (visibleResults < 20){
-                PlayersList.push_back(PPlayer);
-                visibleResults++;
-            }
-            totalResults++;
-        }
-        if (totalResults > 0){
-            *count = totalResults;
-        }
-        ShowMessage("Found %i results, displaying %i. \n", totalResults, visibleResults);
-    }
-
-    return PlayersList;
-}
-
-/************************************************************************
-*                                                                       *
-*  Список персонажей, состоящих в одной группе                          *
-*                                                                       *
-************************************************************************/
-
-std::list<SearchEntity*> CDataLoader::GetPartyList(uint16 PartyID, uint16 AllianceID)
-{
-    std::list<SearchEntity*> PartyList;
-
-    const int8* Query = "SELECT charid, partyid, charname, pos_zone, nation, rank_sandoria, rank_bastok, rank_windurst, race, nameflags, mjob, sjob, mlvl, slvl "
-        "FROM accounts_sessions "
-        "LEFT JOIN accounts_parties USING(charid) "
-        "LEFT JOIN chars USING(charid) "
-        "LEFT JOIN char_look USING(charid) "
-        "LEFT JOIN char_stats USING(charid) "
-        "LEFT JOIN char_profile USING(charid) "
-        "WHERE IF (allianceid <> 0, allianceid IN (SELECT allianceid FROM accounts_parties WHERE charid = %u) , partyid = %u) "
-        "ORDER BY charname ASC "
-        "LIMIT 18";
-
-    int32 ret = Sql_Query(SqlHandle, Query, (!AllianceID ? PartyID : AllianceID), (!PartyID ? AllianceID : PartyID));
-
-    if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) != 0)
-    {
         while (Sql_NextRow(SqlHandle) == SQL_SUCCESS)
         {
-            SearchEntity* PPlayer = new SearchEntity;
-            memset(PPlayer, 0, sizeof(SearchEntity));
-
-            memcpy(PPlayer->name, Sql_GetData(SqlHandle, 2), 15);
-
-            PPlayer->id = (uint32)Sql_GetUIntData(SqlHandle, 0);
-            PPlayer->zone = (uint16)Sql_GetIntData(SqlHandle, 3);
-            PPlayer->nation = (uint8)Sql_GetIntData(SqlHandle, 4);
-            PPlayer->mjob = (uint8)Sql_GetIntData(SqlHandle, 10);
-            PPlayer->sjob = (uint8)Sql_GetIntData(SqlHandle, 11);
-            PPlayer->mlvl = (uint8)Sql_GetIntData(SqlHandle, 12);
-            PPlayer->slvl = (uint8)Sql_GetIntData(SqlHandle, 13);
-            PPlayer->race = (uint8)Sql_GetIntData(SqlHandle, 8);
-            PPlayer->rank = (uint8)Sql_GetIntData(SqlHandle, 5 + PPlayer->nation);
-
-            uint32 nameflag = (uint32)Sql_GetUIntData(SqlHandle, 9);
-
-            if (PartyID == PPlayer->id) PPlayer->flags1 |= 0x0008;
-            if (nameflag & FLAG_AWAY)   PPlayer->flags1 |= 0x0100;
-            if (nameflag & FLAG_DC)     PPlayer->flags1 |= 0x0800;
-            if (PartyID != 0)           PPlayer->flags1 |= 0x2000;
-            if (nameflag & FLAG_ANON)   PPlayer->flags1 |= 0x4000;
-            if (nameflag & FLAG_INVITE) PPlayer->flags1 |= 0x8000;
-
-            PPlayer->flags2 = PPlayer->flags1;
-
-            PartyList.push_back(PPlayer);
+            roster_entry_t entry;
+            memset(&entry, 0, sizeof(entry));
+
+            entry.charid = (uint32)Sql_GetUIntData(SqlHandle, 0);
+            snprintf(entry.name, sizeof(entry.name), "%s", Sql_GetData(SqlHandle, 1));
+            entry.zone = (uint16)Sql_GetIntData(SqlHandle, 2);
+            entry.prevzone = (uint16)Sql_GetIntData(SqlHandle, 3);
+            entry.nation = (uint8)Sql_GetIntData(SqlHandle, 4);
+            entry.rank = (uint8)Sql_GetIntData(SqlHandle, 5 + dsp_min(entry.nation, 2));
+            entry.race = (uint8)Sql_GetIntData(SqlHandle, 8);
+            entry.nameflags = (uint32)Sql_GetUIntData(SqlHandle, 9);
+            entry.mjob = (uint8)Sql_GetIntData(SqlHandle, 10);
+            entry.sjob = (uint8)Sql_GetIntData(SqlHandle, 11);
+            entry.mlvl = (uint8)Sql_GetIntData(SqlHandle, 12);
+            entry.slvl = (uint8)Sql_GetIntData(SqlHandle, 13);
+            entry.partyid = (uint32)Sql_GetUIntData(SqlHandle, 14);
+            entry.allianceid = (uint32)Sql_GetUIntData(SqlHandle, 15);
+            entry.linkshellid1 = (uint32)Sql_GetUIntData(SqlHandle, 16);
+            entry.linkshellid2 = (uint32)Sql_GetUIntData(SqlHandle, 17);
+            entry.linkshellrank1 = (uint8)Sql_GetUIntData(SqlHandle, 18);
+            entry.linkshellrank2 = (uint8)Sql_GetUIntData(SqlHandle, 19);
+
+            Roster.push_back(entry);
         }
     }
-    return PartyList;
+    return Roster;
 }
 
-/************************************************************************
-*                                                                       *
-*  Список персонажей, состоящих в одной linkshell                       *
-*                                                                       *
-************************************************************************/
-
-std::list<SearchEntity*> CDataLoader::GetLinkshellList(uint32 LinkshellID)
-{
-    std::list<SearchEntity*> LinkshellList;
-    const int8* fmtQuery = "SELECT charid, partyid, charname, pos_zone, nation, rank_sandoria, rank_bastok, rank_windurst, race, nameflags, mjob, sjob, "
-        "mlvl, slvl, linkshellid1, linkshellid2, "
-        "linkshellrank1, linkshellrank2 "
-        "FROM accounts_sessions "
-        "LEFT JOIN accounts_parties USING (charid) "
-        "LEFT JOIN chars USING (charid) "
-        "LEFT JOIN char_look USING (charid) "
-        "LEFT JOIN char_stats USING (charid) "
-        "LEFT JOIN char_profile USING(charid) "
-        "WHERE linkshellid1 = %u OR linkshellid2 = %u "
-        "ORDER BY charname ASC "
-        "LIMIT 18";
-
-    int32 ret = Sql_Query(SqlHandle, fmtQuery, LinkshellID, LinkshellID);
-
-    if (ret != SQL_ERROR && Sql_NumRows(SqlHandle) != 0)
-    {
-        while (Sql_NextRow(SqlHandle) == SQL_SUCCESS)
-        {
-            SearchEntity* PPlayer = new SearchEntity;
-            memset(PPlayer, 0, sizeof(SearchEntity));
-
-            memcpy(PPlayer->name, Sql_GetData(SqlHandle, 2), 15);
-
-            PPlayer->id = (uint32)Sql_GetUIntData(SqlHandle, 0);
-            PPlayer->zone = (uint16)Sql_GetIntData(SqlHandle, 3);
-            PPlayer->nation = (uint8)Sql_GetIntData(SqlHandle, 4);
-            PPlayer->mjob = (uint8)Sql_GetIntData(SqlHandle, 10);
-            PPlayer->sjob = (uint8)Sql_GetIntData(SqlHandle, 11);
-            PPlayer->mlvl = (uint8)Sql_GetIntData(SqlHandle, 12);
-            PPlayer->slvl = (uint8)Sql_GetIntData(SqlHandle, 13);
-            PPlayer->race = (uint8)Sql_GetIntData(SqlHandle, 8);
-            PPlayer->rank = (uint8)Sql_GetIntData(SqlHandle, 5 + PPlayer->nation);
-            PPlayer->linkshellid1 = Sql_GetIntData(SqlHandle, 14);
-            PPlayer->linkshellid2 = Sql_GetIntData(SqlHandle, 15);
-            PPlayer->linkshellrank1 = Sql_GetIntData(SqlHandle, 16);
-            PPlayer->linkshellrank2 = Sql_GetIntData(SqlHandle, 17);
-
-            uint32 partyid = (uint32)Sql_GetUIntData(SqlHandle, 1);
-            uint32 nameflag = (uint32)Sql_GetUIntData(SqlHandle, 9);
-
-            if (partyid == PPlayer->id) PPlayer->flags1 |= 0x0008;
-            if (nameflag & FLAG_AWAY)   PPlayer->flags1 |= 0x0100;
-            if (nameflag & FLAG_DC)     PPlayer->flags1 |= 0x0800;
-            if (partyid != 0)           PPlayer->flags1 |= 0x2000;
-            if (nameflag & FLAG_ANON)   PPlayer->flags1 |= 0x4000;
-            if (nameflag & FLAG_INVITE) PPlayer->flags1 |= 0x8000;
-
-            PPlayer->flags2 = PPlayer->flags1;
-
-            LinkshellList.push_back(PPlayer);
-        }
-    }
-
-    return LinkshellList;
-}
 void CDataLoader::ExpireAHItems()
 {
 	Sql_t* sqlH2 = Sql_Malloc();
@@ -25,6 +25,7 @@ This file is part of DarkStar-server source code.
 #define _CDATALOADER_H_
 
 #include "../common/cbasetypes.h"
+#include "../common/mmo.h"
 
 #include <list>
 #include <vector>
@@ -32,7 +33,6 @@ This file is part of DarkStar-server source code.
 #include <string.h>
 
 struct Sql_t;
-struct search_req;
 
 struct ahItem
 {
@@ -85,12 +85,8 @@ public:
     CDataLoader();
     ~CDataLoader();
 
-    uint32 GetPlayersCount(search_req sr);
-
     std::vector<ahHistory*>  GetAHItemHystory(uint16 ItemID, bool stack);
-    std::list<SearchEntity*> GetPartyList(uint16 PartyID, uint16 AllianceID);
-    std::list<SearchEntity*> GetLinkshellList(uint32 LinkshellID);
-    std::list<SearchEntity*> GetPlayersList(search_req sr, int* count);
+    std::vector<roster_entry_t> GetOnlineRoster();
     std::vector<ahItem*>     GetAHItemsToCategory(uint8 AHCategoryID, int8* OrderByString);
     void					 ExpireAHItems();
 
@@ -0,0 +1,655 @@
+﻿/*
+===========================================================================
+
+Copyright (c) 2010-2015 Darkstar Dev Teams
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses/
+
+This file is part of DarkStar-server source code.
+
+===========================================================================
+*/
+
+#include "../common/showmsg.h"
+#include "../common/socket.h"
+
+#include <algorithm>
+#include <chrono>
+#include <ctype.h>
+#include <mutex>
+#include <string.h>
+#include <unordered_map>
+
+#include <zmq.hpp>
+
+#include "roster.h"
+#include "search.h"
+
+namespace
+{
+    /************************************************************************
+    *                                                                       *
+    *  One bit per roster slot. Bitmaps only grow, a missing word reads     *
+    *  as zero.                                                             *
+    *                                                                       *
+    ************************************************************************/
+
+    class CRosterBitmap
+    {
+    public:
+
+        void set(uint32 slot)
+        {
+            if ((slot >> 6) >= m_words.size())
+            {
+                m_words.resize((slot >> 6) + 1, 0);
+            }
+            m_words[slot >> 6] |= (uint64)1 << (slot & 63);
+        }
+
+        void reset(uint32 slot)
+        {
+            if ((slot >> 6) < m_words.size())
+            {
+                m_words[slot >> 6] &= ~((uint64)1 << (slot & 63));
+            }
+        }
+
+        bool test(uint32 slot) const
+        {
+            return (slot >> 6) < m_words.size() && (m_words[slot >> 6] >> (slot & 63)) & 1;
+        }
+
+        CRosterBitmap& operator|=(const CRosterBitmap& other)
+        {
+            if (other.m_words.size() > m_words.size())
+            {
+                m_words.resize(other.m_words.size(), 0);
+            }
+            for (size_t i = 0; i < other.m_words.size(); ++i)
+            {
+                m_words[i] |= other.m_words[i];
+            }
+            return *this;
+        }
+
+        CRosterBitmap& operator&=(const CRosterBitmap& other)
+        {
+            for (size_t i = 0; i < m_words.size(); ++i)
+            {
+                m_words[i] &= i < other.m_words.size() ? other.m_words[i] : 0;
+            }
+            return *this;
+        }
+
+        void subtract(const CRosterBitmap& other)
+        {
+            for (size_t i = 0; i < m_words.size() && i < other.m_words.size(); ++i)
+            {
+                m_words[i] &= ~other.m_words[i];
+            }
+        }
+
+    private:
+
+        std::vector<uint64> m_words;
+    };
+
+    struct RosterSlot_t
+    {
+        roster_entry_t entry;
+        uint64         seq;             // value of UpdateSeq when the entry was written, 0 if it came from sql
+        bool           used;
+    };
+
+    const uint8  ROSTER_JOBS        = 32;
+    const uint8  ROSTER_RACES       = 9;
+    const uint8  ROSTER_NATIONS     = 3;
+    const uint8  ROSTER_LEVEL_BANDS = 10;   // 10 levels per band, 90-99 share the last one
+    const uint8  ROSTER_FLAGS       = 16;   // bits of SearchEntity::flags1
+    const uint8  ROSTER_LIST_SIZE   = 20;   // entries a /sea reply shows
+    const uint8  ROSTER_GROUP_SIZE  = 18;   // entries a party or linkshell reply shows
+
+    std::mutex                          RosterMutex;
+    std::vector<RosterSlot_t>           Slots;
+    std::vector<uint32>                 FreeSlots;
+    std::unordered_map<uint32, uint32>  SlotByChar;
+    std::unordered_map<uint32, uint64>  RemovedAt;      // charid -> UpdateSeq of its remove, stops a reload from bringing it back
+    std::vector<uint32>                 NameOrder;      // used slots sorted by name, rebuilt when somebody logs in or out
+    bool                                NameOrderDirty = false;
+    uint64                              UpdateSeq = 0;
+
+    CRosterBitmap                       Online;
+    CRosterBitmap                       HiddenGM;
+    CRosterBitmap                       JobIndex[ROSTER_JOBS];
+    CRosterBitmap                       RaceIndex[ROSTER_RACES];
+    CRosterBitmap                       NationIndex[ROSTER_NATIONS];
+    CRosterBitmap                       LevelIndex[ROSTER_LEVEL_BANDS];
+    CRosterBitmap                       FlagIndex[ROSTER_FLAGS];
+    std::vector<CRosterBitmap>          ZoneIndex;
+
+    uint16 SearchZone(const roster_entry_t& entry)
+    {
+        return entry.zone == 0 ? entry.prevzone : entry.zone;
+    }
+
+    uint8 LevelBand(uint8 level)
+    {
+        return dsp_min(level / 10, ROSTER_LEVEL_BANDS - 1);
+    }
+
+    uint16 SearchFlags(const roster_entry_t& entry, uint32 partyid)
+    {
+        uint16 flags = 0;
+
+        if (partyid == entry.charid)          flags |= 0x0008;
+        if (entry.nameflags & FLAG_AWAY)      flags |= 0x0100;
+        if (entry.nameflags & FLAG_DC)        flags |= 0x0800;
+        if (partyid != 0)                     flags |= 0x2000;
+        if (entry.nameflags & FLAG_ANON)      flags |= 0x4000;
+        if (entry.nameflags & FLAG_INVITE)    flags |= 0x8000;
+
+        return flags;
+    }
+
+    SearchEntity ToSearchEntity(const roster_entry_t& entry, uint32 partyid)
+    {
+        SearchEntity PPlayer;
+        memset(&PPlayer, 0, sizeof(SearchEntity));
+
+        memcpy(PPlayer.name, entry.name, 15);
+
+        PPlayer.id = entry.charid;
+        PPlayer.zone = entry.zone;
+        PPlayer.prevzone = entry.prevzone;
+        PPlayer.nation = entry.nation;
+        PPlayer.mjob = entry.mjob;
+        PPlayer.sjob = entry.sjob;
+        PPlayer.mlvl = entry.mlvl;
+        PPlayer.slvl = entry.slvl;
+        PPlayer.race = entry.race;
+        PPlayer.rank = entry.rank;
+        PPlayer.flags1 = SearchFlags(entry, partyid);
+        PPlayer.flags2 = PPlayer.flags1;
+
+        return PPlayer;
+    }
+
+    void IndexSlot(uint32 slot, const roster_entry_t& entry, bool add)
+    {
+        auto apply = [slot, add](CRosterBitmap& bitmap)
+        {
+            add ? bitmap.set(slot) : bitmap.reset(slot);
+        };
+
+        apply(Online);
+
+        // anon gms are never listed
+        if ((entry.nameflags & FLAG_ANON) && (entry.nameflags & FLAG_GM))
+            apply(HiddenGM);
+        if (entry.mjob < ROSTER_JOBS)
+            apply(JobIndex[entry.mjob]);
+        if (entry.race < ROSTER_RACES)
+            apply(RaceIndex[entry.race]);
+        if (entry.nation < ROSTER_NATIONS)
+            apply(NationIndex[entry.nation]);
+
+        apply(LevelIndex[LevelBand(entry.mlvl)]);
+
+        uint16 zone = SearchZone(entry);
+        if (zone >= ZoneIndex.size())
+        {
+            ZoneIndex.resize(zone + 1);
+        }
+        apply(ZoneIndex[zone]);
+
+        uint16 flags = SearchFlags(entry, entry.partyid);
+        for (uint8 bit = 0; bit < ROSTER_FLAGS; ++bit)
+        {
+            if (flags & (1 << bit))
+                apply(FlagIndex[bit]);
+        }
+    }
+
+    // callers hold RosterMutex
+    void WriteEntry(const roster_entry_t& entry, uint64 seq)
+    {
+        auto it = SlotByChar.find(entry.charid);
+        uint32 slot;
+
+        if (it != SlotByChar.end())
+        {
+            slot = it->second;
+            IndexSlot(slot, Slots[slot].entry, false);
+            NameOrderDirty |= strncmp(Slots[slot].entry.name, entry.name, sizeof(entry.name)) != 0;
+        }
+        else
+        {
+            if (FreeSlots.empty())
+            {
+                FreeSlots.push_back(Slots.size());
+                Slots.push_back(RosterSlot_t());
+            }
+            slot = FreeSlots.back();
+            FreeSlots.pop_back();
+
+            SlotByChar[entry.charid] = slot;
+            NameOrderDirty = true;
+        }
+        Slots[slot].entry = entry;
+        Slots[slot].entry.name[sizeof(entry.name) - 1] = '\0';
+        Slots[slot].seq = seq;
+        Slots[slot].used = true;
+
+        IndexSlot(slot, Slots[slot].entry, true);
+    }
+
+    void EraseEntry(uint32 charid)
+    {
+        auto it = SlotByChar.find(charid);
+
+        if (it != SlotByChar.end())
+        {
+            IndexSlot(it->second, Slots[it->second].entry, false);
+            Slots[it->second].used = false;
+            FreeSlots.push_back(it->second);
+            SlotByChar.erase(it);
+            NameOrderDirty = true;
+        }
+    }
+
+    // same order as ORDER BY charname did
+    bool NameLess(uint32 a, uint32 b)
+    {
+        const int8* nameA = Slots[a].entry.name;
+        const int8* nameB = Slots[b].entry.name;
+
+        for (; *nameA && tolower(*nameA) == tolower(*nameB); ++nameA, ++nameB);
+
+        return tolower(*nameA) < tolower(*nameB);
+    }
+
+    const std::vector<uint32>& GetNameOrder()
+    {
+        if (NameOrderDirty)
+        {
+            NameOrder.clear();
+            for (auto& member : SlotByChar)
+            {
+                NameOrder.push_back(member.second);
+            }
+            std::sort(NameOrder.begin(), NameOrder.end(), NameLess);
+            NameOrderDirty = false;
+        }
+        return NameOrder;
+    }
+
+    void Parse(MSGSERVTYPE type, zmq::message_t& extra)
+    {
+        switch (type)
+        {
+        case MSG_ROSTER_UPDATE:
+        {
+            if (extra.size() == sizeof(roster_entry_t))
+            {
+                roster_entry_t entry;
+                memcpy(&entry, extra.data(), sizeof(roster_entry_t));
+                roster::Update(entry);
+            }
+            break;
+        }
+        case MSG_ROSTER_REMOVE:
+        {
+            if (extra.size() == sizeof(uint32))
+            {
+                uint32 charid;
+                memcpy(&charid, extra.data(), sizeof(uint32));
+                roster::Remove(charid);
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+}
+
+namespace roster
+{
+    /************************************************************************
+    *                                                                       *
+    *  Listens to the message server. The subscription is renewed every     *
+    *  30 seconds so a restarted message server picks us up again.          *
+    *                                                                       *
+    ************************************************************************/
+
+    void listen(const int8* msgServerIp, uint16 msgServerPort, uint64 identity)
+    {
+        zmq::context_t zContext(1);
+        zmq::socket_t zSocket(zContext, ZMQ_DEALER);
+
+        zSocket.setsockopt(ZMQ_IDENTITY, &identity, sizeof identity);
+
+        string_t server = "tcp://";
+        server.append(msgServerIp);
+        server.append(":");
+        server.append(std::to_string(msgServerPort));
+
+        try
+        {
+            zSocket.connect(server.c_str());
+        }
+        catch (zmq::error_t& err)
+        {
+            ShowError("Roster: Unable to connect to message server: %s\n", err.what());
+            return;
+        }
+
+        zmq::pollitem_t items[] = { { (void*)zSocket, 0, ZMQ_POLLIN, 0 } };
+        time_point subscribed = server_clock::now() - std::chrono::minutes(1);
+
+        while (true)
+        {
+            try
+            {
+                if (server_clock::now() - subscribed > std::chrono::seconds(30))
+                {
+                    zmq::message_t type(sizeof(MSGSERVTYPE));
+                    WBUFB(type.data(), 0) = MSG_ROSTER_SUBSCRIBE;
+                    zmq::message_t extra(0);
+                    zmq::message_t packet(0);
+
+                    zSocket.send(type, ZMQ_SNDMORE);
+                    zSocket.send(extra, ZMQ_SNDMORE);
+                    zSocket.send(packet);
+                    subscribed = server_clock::now();
+                }
+
+                zmq::poll(items, 1, 1000);
+
+                if (!(items[0].revents & ZMQ_POLLIN))
+                {
+                    continue;
+                }
+
+                zmq::message_t type;
+                zmq::message_t extra;
+                zmq::message_t packet;
+
+                while (zSocket.recv(&type, ZMQ_DONTWAIT))
+                {
+                    int more;
+                    size_t size = sizeof(more);
+                    zSocket.getsockopt(ZMQ_RCVMORE, &more, &size);
+                    if (more)
+                    {
+                        zSocket.recv(&extra);
+                        zSocket.getsockopt(ZMQ_RCVMORE, &more, &size);
+                        if (more)
+                        {
+                            zSocket.recv(&packet);
+                        }
+                    }
+                    Parse((MSGSERVTYPE)RBUFB(type.data(), 0), extra);
+                }
+            }
+            catch (zmq::error_t& e)
+            {
+                ShowError("Roster: %s\n", e.what());
+            }
+        }
+    }
+
+    /************************************************************************
+    *                                                                       *
+    *  Rebuilds the roster from sql. Runs at startup and then periodically  *
+    *  to drop characters of a map server that went away without telling   *
+    *  anyone. Updates that arrive while the query runs win over its rows.  *
+    *                                                                       *
+    ************************************************************************/
+
+    void Reload()
+    {
+        uint64 since;
+        {
+            std::lock_guard<std::mutex> lk(RosterMutex);
+            since = UpdateSeq;
+        }
+
+        CDataLoader PDataLoader;
+        std::vector<roster_entry_t> entries = PDataLoader.GetOnlineRoster();
+
+        std::lock_guard<std::mutex> lk(RosterMutex);
+
+        std::unordered_map<uint32, bool> loaded;
+        for (auto& entry : entries)
+        {
+            loaded[entry.charid] = true;
+
+            auto removed = RemovedAt.find(entry.charid);
+            if (removed != RemovedAt.end() && removed->second > since)
+                continue;
+
+            auto it = SlotByChar.find(entry.charid);
+            if (it != SlotByChar.end() && Slots[it->second].seq > since)
+                continue;
+
+            WriteEntry(entry, 0);
+        }
+
+        std::vector<uint32> stale;
+        for (auto& member : SlotByChar)
+        {
+            if (Slots[member.second].seq <= since && loaded.find(member.first) == loaded.end())
+                stale.push_back(member.first);
+        }
+        for (uint32 charid : stale)
+        {
+            EraseEntry(charid);
+        }
+
+        for (auto it = RemovedAt.begin(); it != RemovedAt.end();)
+        {
+            it = it->second <= since ? RemovedAt.erase(it) : std::next(it);
+        }
+        ShowMessage("Roster: %u characters online\n", (uint32)SlotByChar.size());
+    }
+
+    void Update(const roster_entry_t& entry)
+    {
+        std::lock_guard<std::mutex> lk(RosterMutex);
+
+        RemovedAt.erase(entry.charid);
+        WriteEntry(entry, ++UpdateSeq);
+    }
+
+    void Remove(uint32 charid)
+    {
+        std::lock_guard<std::mutex> lk(RosterMutex);
+
+        EraseEntry(charid);
+        RemovedAt[charid] = ++UpdateSeq;
+    }
+
+    /************************************************************************
+    *                                                                       *
+    *  /sea: every filter that has an index narrows the candidate bitmap,   *
+    *  rank, exact level and name are checked while walking in name order   *
+    *                                                                       *
+    ************************************************************************/
+
+    std::vector<SearchEntity> GetPlayersList(const search_req& sr, int* count)
+    {
+        std::vector<SearchEntity> PlayersList;
+        std::lock_guard<std::mutex> lk(RosterMutex);
+
+        CRosterBitmap match = Online;
+        match.subtract(HiddenGM);
+
+        if (sr.jobid > 0)
+        {
+            match &= sr.jobid < ROSTER_JOBS ? JobIndex[sr.jobid] : CRosterBitmap();
+        }
+        if (sr.zoneid[0] > 0)
+        {
+            CRosterBitmap zones;
+            for (uint8 i = 0; i < 10 && sr.zoneid[i] != 0; ++i)
+            {
+                if (sr.zoneid[i] < ZoneIndex.size())
+                    zones |= ZoneIndex[sr.zoneid[i]];
+            }
+            match &= zones;
+        }
+        if (sr.nation != 255)
+        {
+            match &= sr.nation < ROSTER_NATIONS ? NationIndex[sr.nation] : CRosterBitmap();
+        }
+        if (sr.race < 5)
+        {
+            // hume, elvaan and tarutaru come as male and female, mithra and galka as one
+            static const uint8 races[5][2] = { { 1, 2 }, { 3, 4 }, { 5, 6 }, { 7, 7 }, { 8, 8 } };
+
+            CRosterBitmap race = RaceIndex[races[sr.race][0]];
+            race |= RaceIndex[races[sr.race][1]];
+            match &= race;
+        }
+        if (sr.flags != 0)
+        {
+            CRosterBitmap flags;
+            for (uint8 bit = 0; bit < ROSTER_FLAGS; ++bit)
+            {
+                if (sr.flags & (1 << bit))
+                    flags |= FlagIndex[bit];
+            }
+            match &= flags;
+        }
+        bool filterLevel = sr.minlvl > 0 && sr.maxlvl >= sr.minlvl;
+        if (filterLevel)
+        {
+            CRosterBitmap levels;
+            for (uint8 band = LevelBand(sr.minlvl); band <= LevelBand(sr.maxlvl); ++band)
+            {
+                levels |= LevelIndex[band];
+            }
+            match &= levels;
+        }
+        bool filterRank = sr.minRank > 0 && sr.maxRank >= sr.minRank;
+
+        int totalResults = 0;
+
+        for (uint32 slot : GetNameOrder())
+        {
+            if (!match.test(slot))
+                continue;
+
+            const roster_entry_t& entry = Slots[slot].entry;
+
+            if (filterRank && (entry.rank < sr.minRank || entry.rank > sr.maxRank))
+                continue;
+            if (filterLevel && (entry.mlvl < sr.minlvl || entry.mlvl > sr.maxlvl))
+                continue;
+            if (sr.nameLen > 0)
+            {
+                if (sr.nameLen > strlen(entry.name))
+                    continue;
+
+                bool validName = true;
+                for (uint8 i = 0; i < sr.nameLen; ++i)
+                {
+                    if (tolower(sr.name[i]) != tolower(entry.name[i]))
+                    {
+                        validName = false;
+                        break;
+                    }
+                }
+                if (!validName)
+                    continue;
+            }
+
+            if (PlayersList.size() < ROSTER_LIST_SIZE)
+            {
+                PlayersList.push_back(ToSearchEntity(entry, entry.partyid));
+                PlayersList.back().zone = SearchZone(entry);
+            }
+            totalResults++;
+        }
+        if (totalResults > 0)
+        {
+            *count = totalResults;
+        }
+        ShowMessage("Found %i results, displaying %i. \n", totalResults, (int)PlayersList.size());
+
+        return PlayersList;
+    }
+
+    /************************************************************************
+    *                                                                       *
+    *  Members of a party, or of the whole alliance if it is in one         *
+    *                                                                       *
+    ************************************************************************/
+
+    std::vector<SearchEntity> GetPartyList(uint16 PartyID, uint16 AllianceID)
+    {
+        std::vector<SearchEntity> PartyList;
+        std::lock_guard<std::mutex> lk(RosterMutex);
+
+        uint32 partyid = !PartyID ? AllianceID : PartyID;
+        uint32 allianceid = 0;
+
+        auto it = SlotByChar.find(!AllianceID ? PartyID : AllianceID);
+        if (it != SlotByChar.end())
+        {
+            allianceid = Slots[it->second].entry.allianceid;
+        }
+
+        for (uint32 slot : GetNameOrder())
+        {
+            const roster_entry_t& entry = Slots[slot].entry;
+
+            if (entry.allianceid != 0 ? entry.allianceid != allianceid : entry.partyid != partyid)
+                continue;
+
+            PartyList.push_back(ToSearchEntity(entry, PartyID));
+
+            if (PartyList.size() == ROSTER_GROUP_SIZE)
+                break;
+        }
+        return PartyList;
+    }
+
+    std::vector<SearchEntity> GetLinkshellList(uint32 LinkshellID)
+    {
+        std::vector<SearchEntity> LinkshellList;
+        std::lock_guard<std::mutex> lk(RosterMutex);
+
+        for (uint32 slot : GetNameOrder())
+        {
+            const roster_entry_t& entry = Slots[slot].entry;
+
+            if (entry.linkshellid1 != LinkshellID && entry.linkshellid2 != LinkshellID)
+                continue;
+
+            SearchEntity PPlayer = ToSearchEntity(entry, entry.partyid);
+            PPlayer.linkshellid1 = entry.linkshellid1;
+            PPlayer.linkshellid2 = entry.linkshellid2;
+            PPlayer.linkshellrank1 = entry.linkshellrank1;
+            PPlayer.linkshellrank2 = entry.linkshellrank2;
+            LinkshellList.push_back(PPlayer);
+
+            if (LinkshellList.size() == ROSTER_GROUP_SIZE)
+                break;
+        }
+        return LinkshellList;
+    }
+};
@@ -0,0 +1,58 @@
+﻿/*
+===========================================================================
+
+Copyright (c) 2010-2015 Darkstar Dev Teams
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses/
+
+This file is part of DarkStar-server source code.
+
+===========================================================================
+*/
+
+#ifndef _ROSTER_H
+#define _ROSTER_H
+
+#include "../common/cbasetypes.h"
+#include "../common/mmo.h"
+
+#include <vector>
+
+#include "data_loader.h"
+
+struct search_req;
+
+/************************************************************************
+*                                                                       *
+*  In-memory list of the characters that are online. Map servers push   *
+*  changes through the message server, searches never touch sql.        *
+*  Every searchable attribute has a bitmap of roster slots, a search    *
+*  ANDs the bitmaps it filters on and walks the slots in name order.    *
+*                                                                       *
+************************************************************************/
+
+namespace roster
+{
+    void   listen(const int8* msgServerIp, uint16 msgServerPort, uint64 identity); // subscribes to the message server and applies updates, does not return
+
+    void   Reload();                                                    // replaces the roster with what accounts_sessions holds
+    void   Update(const roster_entry_t& entry);
+    void   Remove(uint32 charid);
+
+    std::vector<SearchEntity> GetPlayersList(const search_req& sr, int* count);
+    std::vector<SearchEntity> GetPartyList(uint16 PartyID, uint16 AllianceID);
+    std::vector<SearchEntity> GetLinkshellList(uint32 LinkshellID);
+};
+
+#endif
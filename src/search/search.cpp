@@ -56,6 +56,7 @@ typedef u_int SOCKET;
 #include <sstream>
 
 #include "data_loader.h"
+#include "roster.h"
 #include "search.h"
 #include "tcp_request.h"
 
@@ -81,6 +82,7 @@ struct SearchCommInfo
 void TaskManagerThread();
 
 int32 ah_cleanup(time_point tick, CTaskMgr::CTask* PTask);
+int32 roster_reload(time_point tick, CTaskMgr::CTask* PTask);
 
 
 const int8* SEARCH_CONF_FILENAME = "./conf/search_server.conf";
@@ -105,6 +107,8 @@ void search_config_read(const int8* file);
 void login_config_default();
 void login_config_read(const int8* file);		// We only need the search server port defined here
 
+uint32 roster_identity_ip();
+
 /************************************************************************
 *																		*
 *  Отображения содержимого входящего пакета в консоли					*
@@ -178,6 +182,7 @@ int32 main(int32 argc, int8 **argv)
 
     search_config_default();
     search_config_read(SEARCH_CONF_FILENAME);
+    login_config_default();
     login_config_read(LOGIN_CONF_FILENAME);
 
 #ifdef WIN32
@@ -200,7 +205,7 @@ int32 main(int32 argc, int8 **argv)
     hints.ai_flags = AI_PASSIVE;
 
     // Resolve the server address and port
-    iResult = getaddrinfo(nullptr, login_config.search_server_port, &hints, &result);
+    iResult = getaddrinfo(search_config.search_server_ip[0] != '\0' ? search_config.search_server_ip : nullptr, login_config.search_server_port, &hints, &result);
     if (iResult != 0)
     {
         ShowError("getaddrinfo failed with error: %d\n", iResult);
@@ -265,6 +270,12 @@ int32 main(int32 argc, int8 **argv)
         ShowMessage(CL_GREEN"AH task to return items older than %u days is running\n" CL_RESET, search_config.expire_days);
         CTaskMgr::getInstance()->AddTask("ah_cleanup", server_clock::now(), nullptr, CTaskMgr::TASK_INTERVAL, ah_cleanup, std::chrono::seconds(search_config.expire_interval));
     }
+    // the listener subscribes before the first load, so nothing that changes during the load is missed
+    uint64 identity = roster_identity_ip() | ((uint64)atoi(login_config.search_server_port) << 32);
+    std::thread(roster::listen, login_config.msg_server_ip, login_config.msg_server_port, identity).detach();
+    roster::Reload();
+    CTaskMgr::getInstance()->AddTask("roster_reload", server_clock::now() + std::chrono::minutes(5), nullptr, CTaskMgr::TASK_INTERVAL, roster_reload, std::chrono::minutes(5));
+
     //	ShowMessage(CL_CYAN"[TASKMGR] Starting task manager thread..\n" CL_RESET);
 
     std::thread(TaskManagerThread).detach();
@@ -316,6 +327,54 @@ int32 main(int32 argc, int8 **argv)
     return 0;
 }
 
+/************************************************************************
+*                                                                       *
+*  Address the roster listener identifies with at the message server,   *
+*  like map servers do with theirs: search_server_ip, or else the local *
+*  address this host reaches the message server from                    *
+*                                                                       *
+************************************************************************/
+
+uint32 roster_identity_ip()
+{
+    if (search_config.search_server_ip[0] != '\0')
+    {
+        return inet_addr(search_config.search_server_ip);
+    }
+
+    uint32 ip = 0;
+    SOCKET probe = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+
+    if (probe != INVALID_SOCKET)
+    {
+        struct sockaddr_in remote;
+        struct sockaddr_in local;
+        socklen_t length = sizeof(local);
+
+        memset(&remote, 0, sizeof(remote));
+        remote.sin_family = AF_INET;
+        remote.sin_port = htons(login_config.msg_server_port);
+        remote.sin_addr.s_addr = inet_addr(login_config.msg_server_ip);
+
+        // connecting a udp socket sends nothing, it only picks the route
+        if (connect(probe, (struct sockaddr*)&remote, sizeof(remote)) == 0 &&
+            getsockname(probe, (struct sockaddr*)&local, &length) == 0)
+        {
+            ip = local.sin_addr.s_addr;
+        }
+#ifdef WIN32
+        closesocket(probe);
+#else
+        close(probe);
+#endif
+    }
+    if (ip == 0)
+    {
+        ShowWarning("roster: could not determine the address of this host, set search_server_ip in %s\n", SEARCH_CONF_FILENAME);
+    }
+    return ip;
+}
+
 /************************************************************************
 *                                                                       *
 *  DSSearch-Server default config                                       *
@@ -332,6 +391,7 @@ void search_config_default()
     search_config.expire_auctions = 1;
     search_config.expire_days = 3;
     search_config.expire_interval = 3600;
+    search_config.search_server_ip = "";
 }
 
 /************************************************************************
@@ -399,6 +459,10 @@ void search_config_read(const int8* file)
         {
             search_config.expire_interval = atoi(w2);
         }
+        else if (strcmp(w1, "search_server_ip") == 0)
+        {
+            search_config.search_server_ip = aStrdup(w2);
+        }
         else
         {
             ShowWarning(CL_YELLOW"Unknown setting '%s' in file %s\n" CL_RESET, w1, file);
@@ -416,6 +480,8 @@ void search_config_read(const int8* file)
 void login_config_default()
 {
     login_config.search_server_port = "54002";
+    login_config.msg_server_ip = "127.0.0.1";
+    login_config.msg_server_port = 54003;
 }
 
 
@@ -456,6 +522,14 @@ void login_config_read(const int8* file)
         {
             login_config.search_server_port = aStrdup(w2);
         }
+        else if (strcmp(w1, "msg_server_ip") == 0)
+        {
+            login_config.msg_server_ip = aStrdup(w2);
+        }
+        else if (strcmp(w1, "msg_server_port") == 0)
+        {
+            login_config.msg_server_port = atoi(w2);
+        }
     }
     fclose(fp);
 }
@@ -533,17 +607,15 @@ void HandleGroupListRequest(CTCPRequestPacket& PTCPRequest)
     ShowMessage("SEARCH::PartyID = %u\n", partyid);
     ShowMessage("SEARCH::LinkshellIDs = %u, %u\n", linkshellid1, linkshellid2);
 
-    CDataLoader PDataLoader;
-
     if (partyid != 0 || allianceid != 0)
     {
-        std::list<SearchEntity*> PartyList = PDataLoader.GetPartyList(partyid, allianceid);
+        std::vector<SearchEntity> PartyList = roster::GetPartyList(partyid, allianceid);
 
         CPartyListPacket PPartyPacket(partyid, PartyList.size());
 
-        for (std::list<SearchEntity*>::iterator it = PartyList.begin(); it != PartyList.end(); ++it)
+        for (auto& member : PartyList)
         {
-            PPartyPacket.AddPlayer(*it);
+            PPartyPacket.AddPlayer(&member);
         }
 
         PrintPacket((int8*)PPartyPacket.GetData(), PPartyPacket.GetSize());
@@ -552,13 +624,13 @@ void HandleGroupListRequest(CTCPRequestPacket& PTCPRequest)
     else if (linkshellid1 != 0 || linkshellid2 != 0)
     {
         uint32 linkshellid = linkshellid1 == 0 ? linkshellid2 : linkshellid1;
-        std::list<SearchEntity*> LinkshellList = PDataLoader.GetLinkshellList(linkshellid);
+        std::vector<SearchEntity> LinkshellList = roster::GetLinkshellList(linkshellid);
 
         CLinkshellListPacket PLinkshellPacket(linkshellid, LinkshellList.size());
 
-        for (std::list<SearchEntity*>::iterator it = LinkshellList.begin(); it != LinkshellList.end(); ++it)
+        for (auto& member : LinkshellList)
         {
-            PLinkshellPacket.AddPlayer(*it);
+            PLinkshellPacket.AddPlayer(&member);
         }
 
         PrintPacket((int8*)PLinkshellPacket.GetData(), PLinkshellPacket.GetSize());
@@ -604,14 +676,12 @@ void HandleSearchRequest(CTCPRequestPacket& PTCPRequest)
     search_req sr = _HandleSearchRequest(PTCPRequest);
     int totalCount = 0;
 
-    CDataLoader PDataLoader;
-    std::list<SearchEntity*> SearchList = PDataLoader.GetPlayersList(sr, &totalCount);
-    //PDataLoader->GetPlayersCount(sr)
+    std::vector<SearchEntity> SearchList = roster::GetPlayersList(sr, &totalCount);
     CSearchListPacket PSearchPacket(totalCount);
 
-    for (std::list<SearchEntity*>::iterator it = SearchList.begin(); it != SearchList.end(); ++it)
+    for (auto& player : SearchList)
     {
-        PSearchPacket.AddPlayer(*it);
+        PSearchPacket.AddPlayer(&player);
     }
 
     //PrintPacket((int8*)PSearchPacket->GetData(), PSearchPacket->GetSize());
@@ -1005,5 +1075,12 @@ int32 ah_cleanup(time_point tick, CTaskMgr::CTask* PTask)
     CDataLoader data;
     data.ExpireAHItems();
 
+    return 0;
+}
+
+int32 roster_reload(time_point tick, CTaskMgr::CTask* PTask)
+{
+    roster::Reload();
+
     return 0;
 }
\ No newline at end of file
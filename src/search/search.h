@@ -34,11 +34,14 @@ struct search_config_t
     bool		expire_auctions;	// If true, then start task to expire old auctions off the auction house
     uint8		expire_days;		// Number of days to keep stuff on the auction house
     int16		expire_interval;	// How often the task should run (time * 1000) in seconds
+    const int8* search_server_ip;   // address to bind and to identify as at the message server -> empty for any
 };
 
 struct login_config_t
 {
     char* search_server_port;		// search_server_port	-> 54002
+    const char* msg_server_ip;		// msg_server_ip		-> 127.0.0.1
+    uint16 msg_server_port;			// msg_server_port		-> 54003
 };
 
 struct search_req